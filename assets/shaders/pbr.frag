@@ -22,6 +22,22 @@ layout(set = 0, binding = 0) uniform GlobalUniforms {
 }
 global;
 
+// Feedback buffers are only read by the NO_FEEDBACK variants, built for GPUs
+// without fragmentStoresAndAtomics
+#ifdef NO_FEEDBACK
+  #define FEEDBACK_ACCESS readonly
+  #define VT_FEEDBACK_ACCESS readonly
+#else
+  #define FEEDBACK_ACCESS
+  #define VT_FEEDBACK_ACCESS writeonly
+#endif
+
+// Texture streaming feedback: per bindless texture, log2 of the resolution it
+// is sampled at in 8.8 fixed point (TextureStreamer::kFeedbackScale)
+layout(std430, set = 0, binding = 1) FEEDBACK_ACCESS buffer MipFeedbackBuffer {
+  uint mipFeedback[];
+};
+
 struct MaterialData {
   vec4 baseColorFactor;
   vec4 emissiveFactorAndMetallic;
@@ -78,11 +94,48 @@ layout(set = 4, binding = 3) uniform LightCullUniforms {
 }
 lightCull;
 
+// Virtual texturing (set 5). Material texture indices with the top bit set
+// refer to VirtualTextureInfo entries instead of bindless textures.
+struct VirtualTextureInfo {
+  uint width;
+  uint height;
+  uint levelCount;
+  uint pageOffset;
+};
+
+layout(set = 5, binding = 0) uniform sampler2D vtCache;
+
+layout(std430, set = 5, binding = 1) readonly buffer VirtualTextureBuffer {
+  VirtualTextureInfo vtInfos[];
+};
+
+// Per page: slot column, slot row and level of the finest resident page
+layout(std430, set = 5, binding = 2) readonly buffer PageTableBuffer {
+  uint pageTable[];
+};
+
+// Wanted page plus one, per 16x16 pixel block and sample point in it
+layout(std430, set = 5, binding = 3) VT_FEEDBACK_ACCESS buffer VTFeedback {
+  uint vtFeedback[];
+};
+
 const float PI = 3.14159265359;
 const float MAX_REFLECTION_LOD = 4.0;
 const uint TILE_SIZE = 16;
 const uint MAX_LIGHTS_PER_TILE = 256;
 
+// Must match VirtualTextureSystem
+const uint VIRTUAL_TEXTURE_BIT = 0x80000000u;
+const uint VT_TILE_SIZE = 128u;
+const float VT_TILE_BORDER = 4.0;
+const float VT_SLOT_SIZE = 136.0;
+const uint VT_FEEDBACK_BLOCK_SIZE = 16u;
+const uint VT_FEEDBACK_BLOCKS_PER_ROW = 256u;
+
+// Texture coordinate derivatives, taken in uniform control flow
+vec2 uvDx;
+vec2 uvDy;
+
 float DistributionGGX(vec3 N, vec3 H, float roughness) {
   float a = roughness * roughness;
   float a2 = a * a;
@@ -184,37 +237,141 @@ vec3 calculateLightContribution(GPULight light, vec3 N, vec3 V, vec3 worldPos,
   return (kD * albedo / PI + specular) * radiance * NdotL;
 }
 
+#ifndef NO_FEEDBACK
+// Runs outside uniform control flow, so the level comes from the derivatives
+// main takes instead of implicit ones
+void recordMipFeedback(uint texIdx) {
+  if ((texIdx & VIRTUAL_TEXTURE_BIT) != 0u) {
+    return;
+  }
+  ivec2 size = textureSize(textures[nonuniformEXT(texIdx)], 0);
+  vec2 dx = uvDx * vec2(size);
+  vec2 dy = uvDy * vec2(size);
+  float lod = max(0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)), 0.0);
+  float wanted = log2(float(max(size.x, size.y))) - lod;
+  atomicMax(mipFeedback[texIdx], uint(clamp(wanted, 0.0, 16.0) * 256.0));
+}
+#endif
+
+uvec2 vtLevelSize(VirtualTextureInfo info, uint level) {
+  return max(uvec2(info.width, info.height) >> level, uvec2(1u));
+}
+
+uvec2 vtLevelPages(VirtualTextureInfo info, uint level) {
+  return (vtLevelSize(info, level) + VT_TILE_SIZE - 1u) / VT_TILE_SIZE;
+}
+
+// Sample a virtual texture through the page table. Every texture of a
+// material has its own sample point in each feedback block.
+vec4 sampleVirtual(uint vt, uint feedbackSlot) {
+  VirtualTextureInfo info = vtInfos[vt];
+
+  vec2 size = vec2(info.width, info.height);
+  vec2 dx = uvDx * size;
+  vec2 dy = uvDy * size;
+  float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+  uint level = uint(clamp(lod, 0.0, float(info.levelCount - 1u)));
+
+  vec2 uv = fract(inTexCoord);
+  uint page = info.pageOffset;
+  for (uint l = 0u; l < level; ++l) {
+    uvec2 pages = vtLevelPages(info, l);
+    page += pages.x * pages.y;
+  }
+  uvec2 pages = vtLevelPages(info, level);
+  uvec2 pageXY = min(uvec2(uv * vec2(vtLevelSize(info, level))) / VT_TILE_SIZE,
+                     pages - 1u);
+  page += pageXY.y * pages.x + pageXY.x;
+
+#ifndef NO_FEEDBACK
+  uvec2 pixel = uvec2(gl_FragCoord.xy);
+  uvec2 point = (pixel >> 2u) & 3u;
+  uvec2 block = pixel / VT_FEEDBACK_BLOCK_SIZE;
+  if (((pixel.x | pixel.y) & 3u) == 0u &&
+      ((point.x + point.y) & 3u) == feedbackSlot &&
+      block.x < VT_FEEDBACK_BLOCKS_PER_ROW &&
+      block.y < VT_FEEDBACK_BLOCKS_PER_ROW) {
+    uint blockIndex = block.y * VT_FEEDBACK_BLOCKS_PER_ROW + block.x;
+    vtFeedback[blockIndex * 16u + point.y * 4u + point.x] = page + 1u;
+  }
+#endif
+
+  // Missing pages point at a coarser resident one
+  uint entry = pageTable[page];
+  vec2 slot = vec2(entry & 0xFFu, (entry >> 8u) & 0xFFu);
+  uint residentLevel = (entry >> 16u) & 0xFFu;
+
+  vec2 texel = uv * vec2(vtLevelSize(info, residentLevel));
+  vec2 residentPage = vec2(min(uvec2(texel) / VT_TILE_SIZE,
+                               vtLevelPages(info, residentLevel) - 1u));
+  vec2 cachePos = slot * VT_SLOT_SIZE + VT_TILE_BORDER +
+                  (texel - residentPage * float(VT_TILE_SIZE));
+  return textureLod(vtCache, cachePos / vec2(textureSize(vtCache, 0)), 0.0);
+}
+
+vec4 sampleMaterialTexture(uint texIdx, uint feedbackSlot) {
+  if ((texIdx & VIRTUAL_TEXTURE_BIT) != 0u) {
+    return sampleVirtual(texIdx & ~VIRTUAL_TEXTURE_BIT, feedbackSlot);
+  }
+  return texture(textures[nonuniformEXT(texIdx)], inTexCoord);
+}
+
 void main() {
   MaterialData mat = materials[inMaterialIndex];
+  uvDx = dFdx(inTexCoord);
+  uvDy = dFdy(inTexCoord);
+
+#ifndef NO_FEEDBACK
+  // One pixel in each 4x4 block is enough to find the levels in use
+  uvec2 pixel = uvec2(gl_FragCoord.xy);
+  if (((pixel.x | pixel.y) & 3u) == 0u) {
+    recordMipFeedback(mat.baseColorTexIdx);
+    recordMipFeedback(mat.metallicRoughnessTexIdx);
+    recordMipFeedback(mat.normalTexIdx);
+    if (mat.occlusionTexIdx != mat.metallicRoughnessTexIdx) {
+      recordMipFeedback(mat.occlusionTexIdx);
+    }
+#ifndef PBR_NO_EMISSIVE
+    recordMipFeedback(mat.emissiveTexIdx);
+#endif
+  }
+#endif
 
-  vec4 baseColor =
-      texture(textures[nonuniformEXT(mat.baseColorTexIdx)], inTexCoord) *
-      mat.baseColorFactor * inColor;
+  vec4 baseColor = sampleMaterialTexture(mat.baseColorTexIdx, 0u) *
+                   mat.baseColorFactor * inColor;
 
   float alphaCutoff = mat.roughnessAlphaCutoffOcclusion.y;
   if (baseColor.a < alphaCutoff) {
     discard;
   }
 
-  vec2 metallicRoughness =
-      texture(textures[nonuniformEXT(mat.metallicRoughnessTexIdx)], inTexCoord)
-          .bg;
-  float metallic = metallicRoughness.x * mat.emissiveFactorAndMetallic.w;
-  float roughness = metallicRoughness.y * mat.roughnessAlphaCutoffOcclusion.x;
+  // Occlusion in R, roughness in G, metallic in B
+  vec3 orm = sampleMaterialTexture(mat.metallicRoughnessTexIdx, 1u).rgb;
+  float metallic = orm.b * mat.emissiveFactorAndMetallic.w;
+  float roughness = orm.g * mat.roughnessAlphaCutoffOcclusion.x;
   roughness = max(roughness, 0.04);
 
-  float ao =
-      texture(textures[nonuniformEXT(mat.occlusionTexIdx)], inTexCoord).r;
+  // Packed (ORM) materials already have occlusion from the sample above
+  float ao = orm.r;
+  if (mat.occlusionTexIdx != mat.metallicRoughnessTexIdx) {
+    ao = sampleMaterialTexture(mat.occlusionTexIdx, 3u).r;
+  }
   float occlusionStrength = mat.roughnessAlphaCutoffOcclusion.z;
   ao = mix(1.0, ao, occlusionStrength);
 
-  vec3 emissive =
-      texture(textures[nonuniformEXT(mat.emissiveTexIdx)], inTexCoord).rgb *
-      mat.emissiveFactorAndMetallic.xyz;
-
+#ifdef PBR_NO_EMISSIVE
+  // Variant for materials without emission
+  const vec3 emissive = vec3(0.0);
+#else
+  vec3 emissive = sampleMaterialTexture(mat.emissiveTexIdx, 3u).rgb *
+                  mat.emissiveFactorAndMetallic.xyz;
+#endif
+
+  // Z is rebuilt from XY so two-channel (BC5) normal maps work as well
+  vec2 normalXY = sampleMaterialTexture(mat.normalTexIdx, 2u).rg;
+  normalXY = normalXY * 2.0 - 1.0;
   vec3 normalSample =
-      texture(textures[nonuniformEXT(mat.normalTexIdx)], inTexCoord).rgb;
-  normalSample = normalSample * 2.0 - 1.0;
+      vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
   vec3 N = normalize(inTBN * normalSample);
 
   vec3 V = normalize(global.cameraPosition.xyz - inWorldPos);
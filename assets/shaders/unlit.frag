@@ -25,11 +25,120 @@ layout(std430, set = 1, binding = 0) readonly buffer MaterialBuffer {
 
 layout(set = 1, binding = 1) uniform sampler2D textures[];
 
+// Virtual texturing (set 5). Material texture indices with the top bit set
+// refer to VirtualTextureInfo entries instead of bindless textures.
+struct VirtualTextureInfo {
+  uint width;
+  uint height;
+  uint levelCount;
+  uint pageOffset;
+};
+
+layout(set = 5, binding = 0) uniform sampler2D vtCache;
+
+layout(std430, set = 5, binding = 1) readonly buffer VirtualTextureBuffer {
+  VirtualTextureInfo vtInfos[];
+};
+
+// Per page: slot column, slot row and level of the finest resident page
+layout(std430, set = 5, binding = 2) readonly buffer PageTableBuffer {
+  uint pageTable[];
+};
+
+// Only read by the NO_FEEDBACK variant, built for GPUs without
+// fragmentStoresAndAtomics
+#ifdef NO_FEEDBACK
+  #define VT_FEEDBACK_ACCESS readonly
+#else
+  #define VT_FEEDBACK_ACCESS writeonly
+#endif
+
+// Wanted page plus one, per 16x16 pixel block and sample point in it
+layout(std430, set = 5, binding = 3) VT_FEEDBACK_ACCESS buffer VTFeedback {
+  uint vtFeedback[];
+};
+
+// Must match VirtualTextureSystem
+const uint VIRTUAL_TEXTURE_BIT = 0x80000000u;
+const uint VT_TILE_SIZE = 128u;
+const float VT_TILE_BORDER = 4.0;
+const float VT_SLOT_SIZE = 136.0;
+const uint VT_FEEDBACK_BLOCK_SIZE = 16u;
+const uint VT_FEEDBACK_BLOCKS_PER_ROW = 256u;
+
+// Texture coordinate derivatives, taken in uniform control flow
+vec2 uvDx;
+vec2 uvDy;
+
+uvec2 vtLevelSize(VirtualTextureInfo info, uint level) {
+  return max(uvec2(info.width, info.height) >> level, uvec2(1u));
+}
+
+uvec2 vtLevelPages(VirtualTextureInfo info, uint level) {
+  return (vtLevelSize(info, level) + VT_TILE_SIZE - 1u) / VT_TILE_SIZE;
+}
+
+// Sample a virtual texture through the page table. Every texture of a
+// material has its own sample point in each feedback block.
+vec4 sampleVirtual(uint vt, uint feedbackSlot) {
+  VirtualTextureInfo info = vtInfos[vt];
+
+  vec2 size = vec2(info.width, info.height);
+  vec2 dx = uvDx * size;
+  vec2 dy = uvDy * size;
+  float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+  uint level = uint(clamp(lod, 0.0, float(info.levelCount - 1u)));
+
+  vec2 uv = fract(inTexCoord);
+  uint page = info.pageOffset;
+  for (uint l = 0u; l < level; ++l) {
+    uvec2 pages = vtLevelPages(info, l);
+    page += pages.x * pages.y;
+  }
+  uvec2 pages = vtLevelPages(info, level);
+  uvec2 pageXY = min(uvec2(uv * vec2(vtLevelSize(info, level))) / VT_TILE_SIZE,
+                     pages - 1u);
+  page += pageXY.y * pages.x + pageXY.x;
+
+#ifndef NO_FEEDBACK
+  uvec2 pixel = uvec2(gl_FragCoord.xy);
+  uvec2 point = (pixel >> 2u) & 3u;
+  uvec2 block = pixel / VT_FEEDBACK_BLOCK_SIZE;
+  if (((pixel.x | pixel.y) & 3u) == 0u &&
+      ((point.x + point.y) & 3u) == feedbackSlot &&
+      block.x < VT_FEEDBACK_BLOCKS_PER_ROW &&
+      block.y < VT_FEEDBACK_BLOCKS_PER_ROW) {
+    uint blockIndex = block.y * VT_FEEDBACK_BLOCKS_PER_ROW + block.x;
+    vtFeedback[blockIndex * 16u + point.y * 4u + point.x] = page + 1u;
+  }
+#endif
+
+  // Missing pages point at a coarser resident one
+  uint entry = pageTable[page];
+  vec2 slot = vec2(entry & 0xFFu, (entry >> 8u) & 0xFFu);
+  uint residentLevel = (entry >> 16u) & 0xFFu;
+
+  vec2 texel = uv * vec2(vtLevelSize(info, residentLevel));
+  vec2 residentPage = vec2(min(uvec2(texel) / VT_TILE_SIZE,
+                               vtLevelPages(info, residentLevel) - 1u));
+  vec2 cachePos = slot * VT_SLOT_SIZE + VT_TILE_BORDER +
+                  (texel - residentPage * float(VT_TILE_SIZE));
+  return textureLod(vtCache, cachePos / vec2(textureSize(vtCache, 0)), 0.0);
+}
+
+vec4 sampleMaterialTexture(uint texIdx, uint feedbackSlot) {
+  if ((texIdx & VIRTUAL_TEXTURE_BIT) != 0u) {
+    return sampleVirtual(texIdx & ~VIRTUAL_TEXTURE_BIT, feedbackSlot);
+  }
+  return texture(textures[nonuniformEXT(texIdx)], inTexCoord);
+}
+
 void main() {
   MaterialData mat = materials[inMaterialIndex];
+  uvDx = dFdx(inTexCoord);
+  uvDy = dFdy(inTexCoord);
 
-  vec4 texColor =
-      texture(textures[nonuniformEXT(mat.baseColorTexIdx)], inTexCoord);
+  vec4 texColor = sampleMaterialTexture(mat.baseColorTexIdx, 0u);
   vec4 finalColor = texColor * mat.baseColorFactor * inColor;
 
   float alphaCutoff = mat.roughnessAlphaCutoffOcclusion.y;
@@ -37,9 +146,8 @@ void main() {
     discard;
   }
 
-  vec3 emissive =
-      texture(textures[nonuniformEXT(mat.emissiveTexIdx)], inTexCoord).rgb *
-      mat.emissiveFactorAndMetallic.xyz;
+  vec3 emissive = sampleMaterialTexture(mat.emissiveTexIdx, 3u).rgb *
+                  mat.emissiveFactorAndMetallic.xyz;
   finalColor.rgb += emissive;
 
   finalColor.rgb = pow(finalColor.rgb, vec3(1.0 / 2.2));
@@ -27,19 +27,44 @@ struct ObjectData {
   mat4 normalMatrix;
   vec4 boundingSphere;
   uint materialIndex;
-  uint indexCount;
-  uint indexOffset;
-  int vertexOffset;
+  uint drawGroup;
+  uint firstSlot;
+  uint firstItem;
+  uint firstInstance;
+  uint _padding0;
+  uint _padding1;
+  uint _padding2;
+};
+
+struct InstanceData {
+  mat4 model;
+  mat4 normalMatrix;
 };
 
 layout(std430, set = 2, binding = 0) readonly buffer ObjectBuffer {
   ObjectData objects[];
 };
 
+// Instances of a draw are the visible objects of its group, each with its
+// instance table entry if it has one
+layout(std430, set = 2, binding = 1) readonly buffer VisibleBuffer {
+  uvec2 visibleObjects[];
+};
+
+layout(std430, set = 2, binding = 2) readonly buffer InstanceBuffer {
+  InstanceData instances[];
+};
+
 void main() {
-  ObjectData obj = objects[gl_InstanceIndex];
+  uvec2 visible = visibleObjects[gl_InstanceIndex];
+  ObjectData obj = objects[visible.x];
+
+  mat4 model = obj.model;
+  if (visible.y != 0xFFFFFFFFu) {
+    model = model * instances[visible.y].model;
+  }
 
-  vec4 worldPos = obj.model * vec4(inPosition, 1.0);
+  vec4 worldPos = model * vec4(inPosition, 1.0);
   gl_Position = global.viewProjection * worldPos;
 
   outTexCoord = inTexCoord;
@@ -1,5 +1,6 @@
 #include "backends/vulkan/vulkan_command.hpp"
 
+#include <algorithm>
 #include <bit>
 #include <memory>
 #include <utility>
@@ -322,7 +323,8 @@ void VulkanCommandBuffer::BufferBarrier(const rhi::Buffer* buffer,
     }
     if ((flags & rhi::AccessFlags::ShaderRead) != rhi::AccessFlags::None ||
         (flags & rhi::AccessFlags::ShaderWrite) != rhi::AccessFlags::None) {
-      stage |= vk::PipelineStageFlagBits2::eComputeShader;
+      stage |= vk::PipelineStageFlagBits2::eFragmentShader |
+               vk::PipelineStageFlagBits2::eComputeShader;
     }
     if (stage == vk::PipelineStageFlags2{}) {
       stage = vk::PipelineStageFlagBits2::eAllCommands;
@@ -340,6 +342,7 @@ void VulkanCommandBuffer::BufferBarrier(const rhi::Buffer* buffer,
     if ((flags & rhi::AccessFlags::ShaderRead) != rhi::AccessFlags::None ||
         (flags & rhi::AccessFlags::ShaderWrite) != rhi::AccessFlags::None) {
       stage |= vk::PipelineStageFlagBits2::eVertexShader |
+               vk::PipelineStageFlagBits2::eFragmentShader |
                vk::PipelineStageFlagBits2::eComputeShader;
     }
     if ((flags & rhi::AccessFlags::TransferRead) != rhi::AccessFlags::None ||
@@ -429,12 +432,13 @@ void VulkanCommandBuffer::CopyBuffer(const rhi::Buffer* src, rhi::Buffer* dst,
 void VulkanCommandBuffer::CopyBufferToTexture(const rhi::Buffer* src,
                                               rhi::Texture* dst,
                                               uint32_t mipLevel,
-                                              uint32_t arrayLayer) {
+                                              uint32_t arrayLayer,
+                                              rhi::Size srcOffset) {
   const auto* vkSrc = std::bit_cast<const VulkanBuffer*>(src);
   auto* vkDst = std::bit_cast<VulkanTexture*>(dst);
 
   vk::BufferImageCopy copyRegion{
-      .bufferOffset = 0,
+      .bufferOffset = srcOffset,
       .bufferRowLength = 0,
       .bufferImageHeight = 0,
       .imageSubresource =
@@ -445,8 +449,8 @@ void VulkanCommandBuffer::CopyBufferToTexture(const rhi::Buffer* src,
               .layerCount = 1,
           },
       .imageOffset = {.x = 0, .y = 0, .z = 0},
-      .imageExtent = {.width = vkDst->GetWidth(),
-                      .height = vkDst->GetHeight(),
+      .imageExtent = {.width = std::max(1U, vkDst->GetWidth() >> mipLevel),
+                      .height = std::max(1U, vkDst->GetHeight() >> mipLevel),
                       .depth = 1},
   };
 
@@ -75,7 +75,8 @@ class VulkanCommandBuffer : public rhi::CommandBuffer {
                   rhi::Size dstOffset, rhi::Size size) override;
 
   void CopyBufferToTexture(const rhi::Buffer* src, rhi::Texture* dst,
-                           uint32_t mipLevel, uint32_t arrayLayer) override;
+                           uint32_t mipLevel, uint32_t arrayLayer,
+                           rhi::Size srcOffset) override;
 
   void PushConstants(const rhi::Pipeline* pipeline, uint32_t offset,
                      std::span<const std::byte> data) override;
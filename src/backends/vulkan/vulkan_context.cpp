@@ -367,11 +367,30 @@ void VulkanContext::CreateLogicalDevice() {
           .customBorderColorWithoutFormat = VK_FALSE,
       };
 
+  vk::PhysicalDeviceFeatures supportedFeatures = physicalDevice_.getFeatures();
+
+  // Cooked assets may carry BCn textures; every desktop GPU samples them
+  if (supportedFeatures.textureCompressionBC == VK_FALSE) {
+    LOG_WARNING("GPU does not support BC texture compression");
+  }
+
+  // Texture feedback is written from fragment shaders
+  features_.fragmentStoresAndAtomics =
+      supportedFeatures.fragmentStoresAndAtomics == VK_TRUE;
+  if (!features_.fragmentStoresAndAtomics) {
+    LOG_WARNING(
+        "GPU does not support fragment shader stores, texture feedback is "
+        "disabled");
+  }
+
   vk::PhysicalDeviceFeatures2 deviceFeatures2{
       .pNext = &deviceCustomBorderColorFeatures,
       .features =
           vk::PhysicalDeviceFeatures{
               .fillModeNonSolid = VK_TRUE,
+              .textureCompressionBC = supportedFeatures.textureCompressionBC,
+              .fragmentStoresAndAtomics =
+                  supportedFeatures.fragmentStoresAndAtomics,
           },
   };
 
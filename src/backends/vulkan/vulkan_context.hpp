@@ -51,6 +51,10 @@ class VulkanContext : public rhi::Device {
     return std::bit_cast<rhi::Swapchain*>(swapchain_.get());
   }
 
+  [[nodiscard]] const rhi::DeviceFeatures& GetFeatures() const override {
+    return features_;
+  }
+
   // Vulkan-specific getters (for internal usage)
   [[nodiscard]] vk::Instance GetInstance() const { return instance_.get(); }
 
@@ -93,6 +97,7 @@ class VulkanContext : public rhi::Device {
   };
 
   bool enableValidation_{false};
+  rhi::DeviceFeatures features_;
 
   vk::UniqueInstance instance_;
   vk::UniqueDebugUtilsMessengerEXT debugMessenger_;
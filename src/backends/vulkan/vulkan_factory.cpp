@@ -20,8 +20,9 @@ std::unique_ptr<rhi::Buffer> VulkanFactory::CreateBuffer(
 
 std::unique_ptr<rhi::Texture> VulkanFactory::CreateTexture(
     uint32_t width, uint32_t height, rhi::Format format,
-    rhi::TextureUsage usage) {
-  return VulkanTexture::Create(context_, width, height, format, usage);
+    rhi::TextureUsage usage, uint32_t mipLevels) {
+  return VulkanTexture::Create(context_, width, height, format, usage,
+                               mipLevels);
 }
 
 std::unique_ptr<rhi::Sampler> VulkanFactory::CreateSampler(
@@ -17,7 +17,8 @@ class VulkanFactory : public rhi::Factory {
 
   std::unique_ptr<rhi::Texture> CreateTexture(uint32_t width, uint32_t height,
                                               rhi::Format format,
-                                              rhi::TextureUsage usage) override;
+                                              rhi::TextureUsage usage,
+                                              uint32_t mipLevels = 1) override;
   std::unique_ptr<rhi::Sampler> CreateSampler(
       rhi::Filter magFilter, rhi::Filter minFilter,
       rhi::AddressMode addressMode,
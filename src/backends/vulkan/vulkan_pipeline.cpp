@@ -22,6 +22,8 @@ vk::Format ToVkFormat(rhi::Format format) {
       return vk::Format::eR8G8B8A8Unorm;
     case rhi::Format::R8G8B8A8Srgb:
       return vk::Format::eR8G8B8A8Srgb;
+    case rhi::Format::R8G8B8A8Snorm:
+      return vk::Format::eR8G8B8A8Snorm;
     case rhi::Format::B8G8R8A8Unorm:
       return vk::Format::eB8G8R8A8Unorm;
     case rhi::Format::B8G8R8A8Srgb:
@@ -32,6 +34,8 @@ vk::Format ToVkFormat(rhi::Format format) {
       return vk::Format::eR16G16Sfloat;
     case rhi::Format::R16G16B16A16Sfloat:
       return vk::Format::eR16G16B16A16Sfloat;
+    case rhi::Format::R16G16B16A16Snorm:
+      return vk::Format::eR16G16B16A16Snorm;
     case rhi::Format::R32Sfloat:
       return vk::Format::eR32Sfloat;
     case rhi::Format::R32G32Sfloat:
@@ -205,6 +209,8 @@ std::unique_ptr<VulkanPipeline> VulkanPipeline::Create(
 
   vk::PipelineInputAssemblyStateCreateInfo inputAssembly{
       .topology = vk::PrimitiveTopology::eTriangleList,
+      // Index lists only; nothing relies on restart indices
+      .primitiveRestartEnable = VK_FALSE,
   };
 
   vk::PipelineViewportStateCreateInfo viewportState{
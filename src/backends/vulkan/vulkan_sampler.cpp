@@ -70,6 +70,10 @@ std::unique_ptr<VulkanSampler> VulkanSampler::Create(
   vk::SamplerCreateInfo createInfo{
       .magFilter = vkMagFilter,
       .minFilter = vkMinFilter,
+      // Blend between mip levels whenever minification filters linearly
+      .mipmapMode = minFilter == rhi::Filter::Linear
+                        ? vk::SamplerMipmapMode::eLinear
+                        : vk::SamplerMipmapMode::eNearest,
       .addressModeU = vkAddressU,
       .addressModeV = vkAddressV,
       .addressModeW = vk::SamplerAddressMode::eClampToEdge,  // Default for W
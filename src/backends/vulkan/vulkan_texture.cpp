@@ -1,7 +1,9 @@
 #include "backends/vulkan/vulkan_texture.hpp"
 
+#include <algorithm>
 #include <bit>
 #include <utility>
+#include <vector>
 
 #include "backends/vulkan/vulkan_buffer.hpp"
 #include "backends/vulkan/vulkan_context.hpp"
@@ -19,6 +21,8 @@ vk::Format ToVkFormat(rhi::Format format) {
       return vk::Format::eR8G8B8A8Unorm;
     case rhi::Format::R8G8B8A8Srgb:
       return vk::Format::eR8G8B8A8Srgb;
+    case rhi::Format::R8G8B8A8Snorm:
+      return vk::Format::eR8G8B8A8Snorm;
     case rhi::Format::B8G8R8A8Unorm:
       return vk::Format::eB8G8R8A8Unorm;
     case rhi::Format::B8G8R8A8Srgb:
@@ -29,6 +33,8 @@ vk::Format ToVkFormat(rhi::Format format) {
       return vk::Format::eR16G16Sfloat;
     case rhi::Format::R16G16B16A16Sfloat:
       return vk::Format::eR16G16B16A16Sfloat;
+    case rhi::Format::R16G16B16A16Snorm:
+      return vk::Format::eR16G16B16A16Snorm;
     case rhi::Format::R32Sfloat:
       return vk::Format::eR32Sfloat;
     case rhi::Format::R32G32Sfloat:
@@ -45,6 +51,16 @@ vk::Format ToVkFormat(rhi::Format format) {
       return vk::Format::eD24UnormS8Uint;
     case rhi::Format::D32SfloatS8Uint:
       return vk::Format::eD32SfloatS8Uint;
+    case rhi::Format::Bc1RgbaUnorm:
+      return vk::Format::eBc1RgbaUnormBlock;
+    case rhi::Format::Bc3RgbaUnorm:
+      return vk::Format::eBc3UnormBlock;
+    case rhi::Format::Bc4Unorm:
+      return vk::Format::eBc4UnormBlock;
+    case rhi::Format::Bc5Unorm:
+      return vk::Format::eBc5UnormBlock;
+    case rhi::Format::Bc7Unorm:
+      return vk::Format::eBc7UnormBlock;
     default:
       return vk::Format::eUndefined;
   }
@@ -80,7 +96,8 @@ std::unique_ptr<VulkanTexture> VulkanTexture::Create(VulkanContext& context,
                                                      uint32_t width,
                                                      uint32_t height,
                                                      rhi::Format format,
-                                                     rhi::TextureUsage usage) {
+                                                     rhi::TextureUsage usage,
+                                                     uint32_t mipLevels) {
   vk::Format vkFormat{ToVkFormat(format)};
 
   vk::ImageUsageFlags vkUsage;
@@ -104,7 +121,7 @@ std::unique_ptr<VulkanTexture> VulkanTexture::Create(VulkanContext& context,
       .imageType = vk::ImageType::e2D,
       .format = vkFormat,
       .extent = {.width = width, .height = height, .depth = 1},
-      .mipLevels = 1,
+      .mipLevels = mipLevels,
       .arrayLayers = 1,
       .samples = vk::SampleCountFlagBits::e1,
       .tiling = vk::ImageTiling::eOptimal,
@@ -136,7 +153,7 @@ std::unique_ptr<VulkanTexture> VulkanTexture::Create(VulkanContext& context,
               .aspectMask = IsDepthFormat(format)
                                 ? vk::ImageAspectFlagBits::eDepth
                                 : vk::ImageAspectFlagBits::eColor,
-              .levelCount = 1,
+              .levelCount = mipLevels,
               .layerCount = 1,
           },
   };
@@ -144,8 +161,9 @@ std::unique_ptr<VulkanTexture> VulkanTexture::Create(VulkanContext& context,
   vk::UniqueImageView imageView =
       context.GetDevice().createImageViewUnique(viewInfo);
 
-  return std::unique_ptr<VulkanTexture>(new VulkanTexture(
-      context, width, height, format, image, allocation, std::move(imageView)));
+  return std::unique_ptr<VulkanTexture>(
+      new VulkanTexture(context, width, height, format, mipLevels, image,
+                        allocation, std::move(imageView)));
 }
 
 std::unique_ptr<VulkanTexture> VulkanTexture::CreateCubemap(
@@ -209,41 +227,170 @@ std::unique_ptr<VulkanTexture> VulkanTexture::CreateCubemap(
   vk::UniqueImageView imageView =
       context.GetDevice().createImageViewUnique(viewInfo);
 
-  return std::unique_ptr<VulkanTexture>(new VulkanTexture(
-      context, size, size, format, image, allocation, std::move(imageView)));
+  return std::unique_ptr<VulkanTexture>(
+      new VulkanTexture(context, size, size, format, mipLevels, image,
+                        allocation, std::move(imageView)));
 }
 
 VulkanTexture::VulkanTexture(VulkanContext& context, uint32_t width,
                              uint32_t height, rhi::Format format,
-                             vk::Image image, VmaAllocation allocation,
+                             uint32_t mipLevels, vk::Image image,
+                             VmaAllocation allocation,
                              vk::UniqueImageView imageView)
     : context_{context},
       width_{width},
       height_{height},
       format_{format},
+      mipLevels_{mipLevels},
       image_{image},
       allocation_{allocation},
       imageView_{std::move(imageView)} {}
 
 void VulkanTexture::Upload(std::span<const std::byte> data, uint32_t mipLevel,
-                           uint32_t arrayLayer) {
+                           uint32_t arrayLayer, uint32_t levelCount) {
+  // Split the tightly packed levels into one subresource each
+  std::vector<rhi::TextureSubresourceData> subresources;
+  subresources.reserve(levelCount);
+  size_t offset = 0;
+  for (uint32_t level = mipLevel; level < mipLevel + levelCount; ++level) {
+    size_t size = rhi::GetMipLevelSize(format_, width_, height_, level);
+    if (offset + size > data.size()) {
+      size = data.size() - offset;
+    }
+    if (size == 0) {
+      break;
+    }
+    subresources.push_back({
+        .data = data.subspan(offset, size),
+        .mipLevel = level,
+        .arrayLayer = arrayLayer,
+    });
+    offset += size;
+  }
+  UploadSubresources(subresources);
+}
+
+void VulkanTexture::UploadSubresources(
+    std::span<const rhi::TextureSubresourceData> subresources) {
   if (allocation_ == VK_NULL_HANDLE) {  // Swapchain images can't be uploaded to
     return;
   }
 
-  if (data.empty()) {
+  // Offsets into the staging buffer have to be multiples of the texel block
+  // size and of 4; 16 covers every format
+  constexpr vk::DeviceSize kStagingAlignment = 16;
+  auto alignOffset = [](vk::DeviceSize offset) {
+    return (offset + kStagingAlignment - 1) & ~(kStagingAlignment - 1);
+  };
+
+  vk::DeviceSize stagingSize = 0;
+  for (const auto& subresource : subresources) {
+    stagingSize = alignOffset(stagingSize) + subresource.data.size();
+  }
+  if (stagingSize == 0) {
     return;
   }
 
-  // Calculate mip level dimensions
-  uint32_t mipWidth = std::max(1U, width_ >> mipLevel);
-  uint32_t mipHeight = std::max(1U, height_ >> mipLevel);
-
-  // Create staging buffer and upload data to it
-  auto staging = VulkanBuffer::Create(context_.GetAllocator(), data.size(),
+  // Each subresource is copied once, straight from its source into staging
+  auto staging = VulkanBuffer::Create(context_.GetAllocator(), stagingSize,
                                       rhi::BufferUsage::TransferSrc,
                                       rhi::MemoryUsage::CPUToGPU);
-  staging->Upload(data, 0);
+
+  // Determine aspect mask
+  vk::ImageAspectFlags aspectMask = IsDepthFormat(format_)
+                                        ? vk::ImageAspectFlagBits::eDepth
+                                        : vk::ImageAspectFlagBits::eColor;
+
+  std::vector<vk::BufferImageCopy> copyRegions;
+  std::vector<vk::ImageMemoryBarrier> toTransferBarriers;
+  std::vector<vk::ImageMemoryBarrier> toShaderReadBarriers;
+  copyRegions.reserve(subresources.size());
+  toTransferBarriers.reserve(subresources.size());
+  toShaderReadBarriers.reserve(subresources.size());
+
+  // Rectangles keep the rest of their level, so the previous frames' reads of
+  // it have to finish first instead of its contents being discarded
+  vk::PipelineStageFlags srcStage = vk::PipelineStageFlagBits::eTopOfPipe;
+  std::vector<std::pair<uint32_t, uint32_t>> transitioned;
+
+  vk::DeviceSize bufferOffset = 0;
+  for (const auto& subresource : subresources) {
+    if (subresource.data.empty()) {
+      continue;
+    }
+    bufferOffset = alignOffset(bufferOffset);
+    staging->Upload(subresource.data, bufferOffset);
+
+    bool partial = subresource.width != 0 && subresource.height != 0;
+    vk::Extent3D extent{
+        .width = std::max(1U, width_ >> subresource.mipLevel),
+        .height = std::max(1U, height_ >> subresource.mipLevel),
+        .depth = 1,
+    };
+    if (partial) {
+      extent.width = subresource.width;
+      extent.height = subresource.height;
+    }
+
+    copyRegions.push_back(vk::BufferImageCopy{
+        .bufferOffset = bufferOffset,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource =
+            {
+                .aspectMask = aspectMask,
+                .mipLevel = subresource.mipLevel,
+                .baseArrayLayer = subresource.arrayLayer,
+                .layerCount = 1,
+            },
+        .imageOffset = {.x = static_cast<int32_t>(subresource.x),
+                        .y = static_cast<int32_t>(subresource.y),
+                        .z = 0},
+        .imageExtent = extent,
+    });
+    bufferOffset += subresource.data.size();
+
+    // Only the subresources being written are transitioned, so earlier
+    // uploads to other levels or layers survive. Several rectangles in one
+    // subresource share its barriers.
+    std::pair key{subresource.mipLevel, subresource.arrayLayer};
+    if (std::ranges::find(transitioned, key) != transitioned.end()) {
+      continue;
+    }
+    transitioned.push_back(key);
+    if (partial) {
+      srcStage |= vk::PipelineStageFlagBits::eFragmentShader;
+    }
+
+    vk::ImageSubresourceRange range{
+        .aspectMask = aspectMask,
+        .baseMipLevel = subresource.mipLevel,
+        .levelCount = 1,
+        .baseArrayLayer = subresource.arrayLayer,
+        .layerCount = 1,
+    };
+    toTransferBarriers.push_back(vk::ImageMemoryBarrier{
+        .srcAccessMask = vk::AccessFlags{},
+        .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .oldLayout = partial ? vk::ImageLayout::eShaderReadOnlyOptimal
+                             : vk::ImageLayout::eUndefined,
+        .newLayout = vk::ImageLayout::eTransferDstOptimal,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image_,
+        .subresourceRange = range,
+    });
+    toShaderReadBarriers.push_back(vk::ImageMemoryBarrier{
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eShaderRead,
+        .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+        .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image_,
+        .subresourceRange = range,
+    });
+  }
 
   // Create a temporary command pool and command buffer for the upload
   vk::CommandPoolCreateInfo poolInfo{
@@ -270,77 +417,15 @@ void VulkanTexture::Upload(std::span<const std::byte> data, uint32_t mipLevel,
   };
   cmd.begin(beginInfo);
 
-  // Determine aspect mask
-  vk::ImageAspectFlags aspectMask = IsDepthFormat(format_)
-                                        ? vk::ImageAspectFlagBits::eDepth
-                                        : vk::ImageAspectFlagBits::eColor;
-
-  // Transition image from Undefined to TransferDst
-  vk::ImageMemoryBarrier toTransferBarrier{
-      .srcAccessMask = vk::AccessFlags{},
-      .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
-      .oldLayout = vk::ImageLayout::eUndefined,
-      .newLayout = vk::ImageLayout::eTransferDstOptimal,
-      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-      .image = image_,
-      .subresourceRange =
-          {
-              .aspectMask = aspectMask,
-              .baseMipLevel = mipLevel,
-              .levelCount = 1,
-              .baseArrayLayer = arrayLayer,
-              .layerCount = 1,
-          },
-  };
-
-  cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
-                      vk::PipelineStageFlagBits::eTransfer, {}, {}, {},
-                      toTransferBarrier);
-
-  // Copy buffer to image
-  vk::BufferImageCopy copyRegion{
-      .bufferOffset = 0,
-      .bufferRowLength = 0,
-      .bufferImageHeight = 0,
-      .imageSubresource =
-          {
-              .aspectMask = aspectMask,
-              .mipLevel = mipLevel,
-              .baseArrayLayer = arrayLayer,
-              .layerCount = 1,
-          },
-      .imageOffset = {.x = 0, .y = 0, .z = 0},
-      .imageExtent = {.width = mipWidth,
-                      .height = mipHeight,
-                      .depth = 1},  // Use mip dimensions
-  };
+  cmd.pipelineBarrier(srcStage, vk::PipelineStageFlagBits::eTransfer, {}, {},
+                      {}, toTransferBarriers);
 
   cmd.copyBufferToImage(staging->GetHandle(), image_,
-                        vk::ImageLayout::eTransferDstOptimal, copyRegion);
-
-  // Transition image from TransferDst to ShaderReadOnly
-  vk::ImageMemoryBarrier toShaderReadBarrier{
-      .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
-      .dstAccessMask = vk::AccessFlagBits::eShaderRead,
-      .oldLayout = vk::ImageLayout::eTransferDstOptimal,
-      .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-      .image = image_,
-      .subresourceRange =
-          {
-              .aspectMask = aspectMask,
-              .baseMipLevel = mipLevel,
-              .levelCount = 1,
-              .baseArrayLayer = arrayLayer,
-              .layerCount = 1,
-          },
-  };
+                        vk::ImageLayout::eTransferDstOptimal, copyRegions);
 
   cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
                       vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {},
-                      toShaderReadBarrier);
+                      toShaderReadBarriers);
 
   // End recording
   cmd.end();
@@ -23,7 +23,8 @@ class VulkanTexture : public rhi::Texture {
   static std::unique_ptr<VulkanTexture> Create(VulkanContext& context,
                                                uint32_t width, uint32_t height,
                                                rhi::Format format,
-                                               rhi::TextureUsage usage);
+                                               rhi::TextureUsage usage,
+                                               uint32_t mipLevels = 1);
 
   static std::unique_ptr<VulkanTexture> CreateCubemap(VulkanContext& context,
                                                       uint32_t size,
@@ -33,12 +34,14 @@ class VulkanTexture : public rhi::Texture {
 
   // RHI implementations
   void Upload(std::span<const std::byte> data, uint32_t mipLevel = 0,
-              uint32_t arrayLayer = 0) override;
+              uint32_t arrayLayer = 0, uint32_t levelCount = 1) override;
+  void UploadSubresources(
+      std::span<const rhi::TextureSubresourceData> subresources) override;
   [[nodiscard]] rhi::Format GetFormat() const override { return format_; }
   [[nodiscard]] uint32_t GetWidth() const override { return width_; }
   [[nodiscard]] uint32_t GetHeight() const override { return height_; }
   [[nodiscard]] uint32_t GetDepth() const override { return 1; }
-  [[nodiscard]] uint32_t GetMipLevels() const override { return 1; }
+  [[nodiscard]] uint32_t GetMipLevels() const override { return mipLevels_; }
 
   // Vulkan getters
   [[nodiscard]] vk::Image GetImage() const { return image_; }
@@ -46,14 +49,15 @@ class VulkanTexture : public rhi::Texture {
 
  private:
   VulkanTexture(VulkanContext& context, uint32_t width, uint32_t height,
-                rhi::Format format, vk::Image image, VmaAllocation allocation,
-                vk::UniqueImageView imageView);
+                rhi::Format format, uint32_t mipLevels, vk::Image image,
+                VmaAllocation allocation, vk::UniqueImageView imageView);
 
   VulkanContext& context_;  // NOLINT
 
   uint32_t width_;
   uint32_t height_;
   rhi::Format format_;
+  uint32_t mipLevels_{1};
   vk::Image image_;
   VmaAllocation allocation_;
   vk::UniqueImageView imageView_;
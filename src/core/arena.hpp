@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace core {
+namespace detail {
+inline thread_local std::pmr::memory_resource* tScratch = nullptr;
+
+// Counts what is allocated through it and passes everything on
+class CountingResource final : public std::pmr::memory_resource {
+ public:
+  explicit CountingResource(std::pmr::memory_resource* upstream)
+      : upstream_{upstream} {}
+
+  [[nodiscard]] uint64_t GetCount() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+  [[nodiscard]] uint64_t GetBytes() const {
+    return bytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    count_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    return upstream_->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+    upstream_->deallocate(p, bytes, alignment);
+  }
+
+  [[nodiscard]] bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource* upstream_;
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> bytes_{0};
+};
+}  // namespace detail
+
+/**
+ * @brief Monotonic scratch memory for one job spread over several threads.
+ *
+ * Every thread taking part allocates from an arena of its own, so there is
+ * no contention and no locking past the first request. Allocations are
+ * carved from large heap blocks and never freed one by one; all of it goes
+ * back to the heap at once in Release or the destructor, when nothing
+ * allocated from the arenas may be in use any more.
+ */
+class ScratchArena {
+ public:
+  struct Stats {
+    uint64_t allocations{0};  // Served from the arenas
+    uint64_t allocatedBytes{0};
+    uint64_t blocks{0};  // Taken from the heap
+    uint64_t blockBytes{0};
+  };
+
+  explicit ScratchArena(size_t blockSize = size_t{1} << 20)
+      : blockSize_{blockSize} {}
+
+  ScratchArena(const ScratchArena&) = delete;
+  ScratchArena& operator=(const ScratchArena&) = delete;
+  ScratchArena(ScratchArena&&) = delete;
+  ScratchArena& operator=(ScratchArena&&) = delete;
+  ~ScratchArena() = default;
+
+  /**
+   * @brief The calling thread's arena.
+   */
+  [[nodiscard]] std::pmr::memory_resource* GetThreadResource() {
+    std::scoped_lock lock{mutex_};
+    auto& arena = arenas_[std::this_thread::get_id()];
+    if (!arena) {
+      arena = std::make_unique<Arena>(blockSize_, &upstream_);
+    }
+    return &arena->front;
+  }
+
+  /**
+   * @brief Free all arenas at once.
+   */
+  void Release() {
+    std::scoped_lock lock{mutex_};
+    for (auto& [thread, arena] : arenas_) {
+      allocations_ += arena->front.GetCount();
+      allocatedBytes_ += arena->front.GetBytes();
+    }
+    arenas_.clear();
+  }
+
+  /**
+   * @brief Totals since construction, released arenas included.
+   */
+  [[nodiscard]] Stats GetStats() const {
+    std::scoped_lock lock{mutex_};
+    Stats stats{
+        .allocations = allocations_,
+        .allocatedBytes = allocatedBytes_,
+        .blocks = upstream_.GetCount(),
+        .blockBytes = upstream_.GetBytes(),
+    };
+    for (const auto& [thread, arena] : arenas_) {
+      stats.allocations += arena->front.GetCount();
+      stats.allocatedBytes += arena->front.GetBytes();
+    }
+    return stats;
+  }
+
+ private:
+  struct Arena {
+    Arena(size_t blockSize, std::pmr::memory_resource* upstream)
+        : memory{blockSize, upstream} {}
+
+    std::pmr::monotonic_buffer_resource memory;
+    detail::CountingResource front{&memory};
+  };
+
+  size_t blockSize_;
+  detail::CountingResource upstream_{std::pmr::new_delete_resource()};
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::thread::id, std::unique_ptr<Arena>> arenas_;
+  uint64_t allocations_{0};
+  uint64_t allocatedBytes_{0};
+};
+
+/**
+ * @brief Makes an arena the calling thread's scratch memory for the
+ * lifetime of the scope.
+ */
+class ScratchScope {
+ public:
+  explicit ScratchScope(ScratchArena& arena) : previous_{detail::tScratch} {
+    detail::tScratch = arena.GetThreadResource();
+  }
+  ~ScratchScope() { detail::tScratch = previous_; }
+
+  ScratchScope(const ScratchScope&) = delete;
+  ScratchScope& operator=(const ScratchScope&) = delete;
+  ScratchScope(ScratchScope&&) = delete;
+  ScratchScope& operator=(ScratchScope&&) = delete;
+
+ private:
+  std::pmr::memory_resource* previous_;
+};
+
+/**
+ * @brief Memory for short-lived buffers: the calling thread's arena inside
+ * a ScratchScope, the heap outside of one.
+ */
+inline std::pmr::memory_resource* GetScratchResource() {
+  return detail::tScratch != nullptr ? detail::tScratch
+                                     : std::pmr::new_delete_resource();
+}
+
+}  // namespace core
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace core {
+namespace detail {
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+template <typename T>
+T Read(const std::byte* data) {
+  T value{};
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+inline uint64_t Round(uint64_t acc, uint64_t input) {
+  acc += input * kPrime2;
+  return std::rotl(acc, 31) * kPrime1;
+}
+
+inline uint64_t MergeRound(uint64_t acc, uint64_t value) {
+  acc ^= Round(0, value);
+  return (acc * kPrime1) + kPrime4;
+}
+}  // namespace detail
+
+/**
+ * @brief 64-bit content hash of a byte range (the XXH64 algorithm).
+ *
+ * Fast enough to fingerprint whole textures. Chained hashes pass the
+ * previous result as the seed.
+ */
+inline uint64_t HashBytes(std::span<const std::byte> bytes, uint64_t seed = 0) {
+  using detail::kPrime1;
+  using detail::kPrime2;
+  using detail::kPrime3;
+  using detail::kPrime4;
+  using detail::kPrime5;
+  using detail::Read;
+  using detail::Round;
+
+  const std::byte* p = bytes.data();
+  const std::byte* end = p + bytes.size();
+
+  uint64_t hash = 0;
+  if (bytes.size() >= 32) {
+    uint64_t v1 = seed + kPrime1 + kPrime2;
+    uint64_t v2 = seed + kPrime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - kPrime1;
+    for (; end - p >= 32; p += 32) {
+      v1 = Round(v1, Read<uint64_t>(p));
+      v2 = Round(v2, Read<uint64_t>(p + 8));
+      v3 = Round(v3, Read<uint64_t>(p + 16));
+      v4 = Round(v4, Read<uint64_t>(p + 24));
+    }
+    hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) +
+           std::rotl(v4, 18);
+    hash = detail::MergeRound(hash, v1);
+    hash = detail::MergeRound(hash, v2);
+    hash = detail::MergeRound(hash, v3);
+    hash = detail::MergeRound(hash, v4);
+  } else {
+    hash = seed + kPrime5;
+  }
+  hash += bytes.size();
+
+  for (; end - p >= 8; p += 8) {
+    hash ^= Round(0, Read<uint64_t>(p));
+    hash = (std::rotl(hash, 27) * kPrime1) + kPrime4;
+  }
+  if (end - p >= 4) {
+    hash ^= Read<uint32_t>(p) * kPrime1;
+    hash = (std::rotl(hash, 23) * kPrime2) + kPrime3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    hash ^= static_cast<uint64_t>(*p) * kPrime5;
+    hash = std::rotl(hash, 11) * kPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+/**
+ * @brief Content hash of a trivially copyable value, padding included.
+ */
+template <typename T>
+uint64_t HashValue(const T& value, uint64_t seed = 0) {
+  return HashBytes(std::as_bytes(std::span{&value, 1}), seed);
+}
+
+}  // namespace core
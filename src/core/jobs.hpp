@@ -0,0 +1,408 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace core {
+class JobCounter;
+class JobSystem;
+
+namespace detail {
+// The job system the calling thread is a worker of and its queue
+inline thread_local const JobSystem* tJobSystem = nullptr;
+inline thread_local uint32_t tJobQueue = 0;
+
+struct Job {
+  void (*invoke)(JobSystem& system, const Job& job){nullptr};
+  void* context{nullptr};
+  size_t begin{0};
+  size_t end{0};
+  JobCounter* counter{nullptr};
+};
+}  // namespace detail
+
+/**
+ * @brief Number of jobs spawned against it that have not finished yet.
+ *
+ * JobSystem::Wait returns once it reaches zero and the jobs queued with
+ * SpawnAfter to follow it have been released. A counter may be spawned
+ * against again after it has been waited for.
+ */
+class JobCounter {
+ public:
+  JobCounter() = default;
+  // Lets the job that released the continuations leave the lock first
+  ~JobCounter() { std::scoped_lock lock{mutex_}; }
+
+  JobCounter(const JobCounter&) = delete;
+  JobCounter& operator=(const JobCounter&) = delete;
+  JobCounter(JobCounter&&) = delete;
+  JobCounter& operator=(JobCounter&&) = delete;
+
+  [[nodiscard]] bool IsDone() const {
+    return pending_.load(std::memory_order_acquire) == 0;
+  }
+
+ private:
+  friend class JobSystem;
+
+  // Set in pending_ while continuations are stored, so the count only reads
+  // zero once they have been queued
+  static constexpr uint32_t kHasContinuations = 1U << 31;
+
+  std::atomic<uint32_t> pending_{0};
+  std::mutex mutex_;  // Guards continuations_
+  std::vector<detail::Job> continuations_;
+};
+
+/**
+ * @brief Work-stealing pool of one worker per hardware thread but one.
+ *
+ * Every worker owns a queue: it pushes and pops jobs at the back, so the
+ * most recently split work stays in its caches, and idle workers steal from
+ * the front of the others, where the largest pieces are. Other threads
+ * share one more queue. Waiting on a counter runs queued jobs until the
+ * counter reaches zero instead of blocking, so jobs may spawn and wait for
+ * jobs of their own, to any depth, without tying up a worker. Threads
+ * outside the pool only help with the jobs they wait for. Jobs run to
+ * completion; a continuation is spawned with SpawnAfter, which holds it
+ * back until its dependency is done rather than suspending a job.
+ */
+class JobSystem {
+ public:
+  explicit JobSystem(uint32_t workerCount) {
+    queues_.reserve(workerCount + 1);
+    for (uint32_t i = 0; i <= workerCount; ++i) {
+      queues_.push_back(std::make_unique<Queue>());
+    }
+    workers_.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; ++i) {
+      workers_.emplace_back([this, i] { Run(i); });
+    }
+  }
+
+  ~JobSystem() {
+    stopping_.store(true, std::memory_order_release);
+    work_.fetch_add(1, std::memory_order_release);
+    work_.notify_all();
+    workers_.clear();
+  }
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+  JobSystem(JobSystem&&) = delete;
+  JobSystem& operator=(JobSystem&&) = delete;
+
+  /**
+   * @brief The process-wide pool, started on first use.
+   */
+  static JobSystem& Get() {
+    static JobSystem system{std::max(1U, std::thread::hardware_concurrency()) -
+                            1};
+    return system;
+  }
+
+  [[nodiscard]] uint32_t GetWorkerCount() const {
+    return static_cast<uint32_t>(workers_.size());
+  }
+
+  /**
+   * @brief Queue fn() to run on some thread, counted against counter.
+   *
+   * The caller must Wait on the counter before anything fn uses goes away.
+   */
+  template <typename Fn>
+  void Spawn(JobCounter& counter, Fn&& fn) {
+    counter.pending_.fetch_add(1, std::memory_order_relaxed);
+    Push(MakeJob(counter, std::forward<Fn>(fn)));
+  }
+
+  /**
+   * @brief Queue fn() to run once dependency reaches zero, counted against
+   * counter.
+   *
+   * Until then the job is stored with dependency rather than queued, and
+   * the job that brings dependency to zero queues it. Nothing blocks while
+   * it waits, so chains of any length cannot tie up a worker.
+   */
+  template <typename Fn>
+  void SpawnAfter(JobCounter& dependency, JobCounter& counter, Fn&& fn) {
+    counter.pending_.fetch_add(1, std::memory_order_relaxed);
+    Job job = MakeJob(counter, std::forward<Fn>(fn));
+    {
+      std::scoped_lock lock{dependency.mutex_};
+      uint32_t pending = dependency.pending_.load(std::memory_order_acquire);
+      while ((pending & ~JobCounter::kHasContinuations) != 0) {
+        if (dependency.pending_.compare_exchange_weak(
+                pending, pending | JobCounter::kHasContinuations,
+                std::memory_order_acq_rel)) {
+          dependency.continuations_.push_back(job);
+          return;
+        }
+      }
+    }
+    Push(job);
+  }
+
+  /**
+   * @brief Run queued jobs on the calling thread until counter reaches
+   * zero, sleeping only when there is nothing left to run.
+   *
+   * Workers run any job. Other threads, such as the render thread, only
+   * run jobs counted against `counter`, so waiting on a small batch never
+   * picks up someone else's long job; with no workers they run any job.
+   */
+  void Wait(const JobCounter& counter) {
+    const JobCounter* only =
+        detail::tJobSystem == this || workers_.empty() ? nullptr : &counter;
+    while (true) {
+      uint32_t seen = done_.load(std::memory_order_acquire);
+      if (counter.IsDone()) {
+        return;
+      }
+      if (!TryRunOne(only)) {
+        done_.wait(seen, std::memory_order_acquire);
+      }
+    }
+  }
+
+  /**
+   * @brief Run fn(i) for every i in [0, count) and return once all are
+   * done.
+   *
+   * The range is halved recursively down to grain indices, leaving the
+   * upper halves to be stolen, so uneven work balances itself. The calling
+   * thread takes part, and fn may call ParallelFor itself.
+   */
+  template <typename Fn>
+  void ParallelFor(size_t count, Fn&& fn, size_t grain = 1) {
+    grain = std::max<size_t>(grain, 1);
+    if (workers_.empty() || count <= grain) {
+      for (size_t i = 0; i < count; ++i) {
+        fn(i);
+      }
+      return;
+    }
+
+    using Body = std::remove_reference_t<Fn>;
+    Range<Body> range{.fn = &fn, .grain = grain};
+    JobCounter counter;
+    counter.pending_.store(1, std::memory_order_relaxed);
+    Execute(Job{
+        .invoke = &RunRange<Body>,
+        .context = &range,
+        .begin = 0,
+        .end = count,
+        .counter = &counter,
+    });
+    Wait(counter);
+  }
+
+ private:
+  using Job = detail::Job;
+
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  template <typename Body>
+  struct Range {
+    Body* fn;
+    size_t grain;
+  };
+
+  // Spins before a worker sleeps, so back-to-back batches don't pay for a
+  // wake-up
+  static constexpr int kIdleSpins = 64;
+
+  template <typename Fn>
+  static Job MakeJob(JobCounter& counter, Fn&& fn) {
+    using Callable = std::decay_t<Fn>;
+    return Job{
+        .invoke =
+            [](JobSystem& /*system*/, const Job& job) {
+              std::unique_ptr<Callable> callable{
+                  static_cast<Callable*>(job.context)};
+              (*callable)();
+            },
+        .context = std::make_unique<Callable>(std::forward<Fn>(fn)).release(),
+        .begin = 0,
+        .end = 0,
+        .counter = &counter,
+    };
+  }
+
+  template <typename Body>
+  static void RunRange(JobSystem& system, const Job& job) {
+    const auto& range = *static_cast<const Range<Body>*>(job.context);
+    size_t end = job.end;
+    while (end - job.begin > range.grain) {
+      size_t middle = job.begin + ((end - job.begin) / 2);
+      job.counter->pending_.fetch_add(1, std::memory_order_relaxed);
+      system.Push(Job{
+          .invoke = job.invoke,
+          .context = job.context,
+          .begin = middle,
+          .end = end,
+          .counter = job.counter,
+      });
+      end = middle;
+    }
+    for (size_t i = job.begin; i < end; ++i) {
+      (*range.fn)(i);
+    }
+  }
+
+  [[nodiscard]] uint32_t GetQueueIndex() const {
+    return detail::tJobSystem == this
+               ? detail::tJobQueue
+               : static_cast<uint32_t>(queues_.size() - 1);
+  }
+
+  void Push(const Job& job) {
+    Queue& queue = *queues_[GetQueueIndex()];
+    {
+      std::scoped_lock lock{queue.mutex};
+      queue.jobs.push_back(job);
+    }
+    work_.fetch_add(1, std::memory_order_release);
+    work_.notify_one();
+    // Threads waiting on a counter help as well; not all of them may take
+    // this job
+    done_.fetch_add(1, std::memory_order_release);
+    done_.notify_all();
+  }
+
+  // Run a queued job, or only one counted against `only` if it is set
+  bool TryRunOne(const JobCounter* only = nullptr) {
+    uint32_t own = GetQueueIndex();
+    Job job;
+    if (only != nullptr) {
+      if (!std::ranges::any_of(queues_, [&](const auto& queue) {
+            return TakeCounted(*queue, only, job);
+          })) {
+        return false;
+      }
+    } else if (!TakeBack(*queues_[own], job)) {
+      // Victims are tried from a random start so thieves spread out
+      thread_local uint32_t seed = static_cast<uint32_t>(
+          std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1U);
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+
+      auto count = static_cast<uint32_t>(queues_.size());
+      bool stolen = false;
+      for (uint32_t i = 0; i < count && !stolen; ++i) {
+        uint32_t victim = (seed + i) % count;
+        stolen = victim != own && TakeFront(*queues_[victim], job);
+      }
+      if (!stolen) {
+        return false;
+      }
+    }
+    Execute(job);
+    return true;
+  }
+
+  static bool TakeBack(Queue& queue, Job& job) {
+    std::scoped_lock lock{queue.mutex};
+    if (queue.jobs.empty()) {
+      return false;
+    }
+    job = queue.jobs.back();
+    queue.jobs.pop_back();
+    return true;
+  }
+
+  // The newest matching job, which is the one its own thread would take
+  static bool TakeCounted(Queue& queue, const JobCounter* counter, Job& job) {
+    std::scoped_lock lock{queue.mutex};
+    auto it = std::ranges::find(queue.jobs.rbegin(), queue.jobs.rend(),
+                                counter, &Job::counter);
+    if (it == queue.jobs.rend()) {
+      return false;
+    }
+    job = *it;
+    queue.jobs.erase(std::next(it).base());
+    return true;
+  }
+
+  static bool TakeFront(Queue& queue, Job& job) {
+    std::scoped_lock lock{queue.mutex};
+    if (queue.jobs.empty()) {
+      return false;
+    }
+    job = queue.jobs.front();
+    queue.jobs.pop_front();
+    return true;
+  }
+
+  void Execute(const Job& job) {
+    job.invoke(*this, job);
+    // The counter may be gone once it reads zero, so waiters are woken
+    // through the system
+    auto& counter = *job.counter;
+    uint32_t pending = counter.pending_.fetch_sub(1, std::memory_order_acq_rel);
+    if (pending == JobCounter::kHasContinuations + 1) {
+      // The flag is cleared under the lock, which the counter's destructor
+      // takes, so the counter stays alive until this is done with it
+      std::scoped_lock lock{counter.mutex_};
+      for (const auto& continuation : counter.continuations_) {
+        Push(continuation);
+      }
+      counter.continuations_.clear();
+      counter.pending_.fetch_and(~JobCounter::kHasContinuations,
+                                 std::memory_order_acq_rel);
+      pending = 1;
+    }
+    if (pending == 1) {
+      done_.fetch_add(1, std::memory_order_release);
+      done_.notify_all();
+    }
+  }
+
+  void Run(uint32_t index) {
+    detail::tJobSystem = this;
+    detail::tJobQueue = index;
+    while (true) {
+      uint32_t seen = work_.load(std::memory_order_acquire);
+      bool ran = false;
+      for (int spin = 0; spin < kIdleSpins && !ran; ++spin) {
+        ran = TryRunOne();
+        if (!ran) {
+          std::this_thread::yield();
+        }
+      }
+      if (ran) {
+        continue;
+      }
+      if (stopping_.load(std::memory_order_acquire)) {
+        return;
+      }
+      work_.wait(seen, std::memory_order_acquire);
+    }
+  }
+
+  std::vector<std::unique_ptr<Queue>> queues_;  // Per worker, then shared
+  std::atomic<uint32_t> work_{0};  // Bumped when a job is queued
+  std::atomic<uint32_t> done_{0};  // And when a counter reaches zero
+  std::atomic<bool> stopping_{false};
+
+  // Last member so the workers stop before the state above goes away
+  std::vector<std::jthread> workers_;
+};
+
+}  // namespace core
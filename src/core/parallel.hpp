@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#include "core/jobs.hpp"
+
+namespace core {
+
+/**
+ * @brief Run fn(i) for every i in [0, count) on the process-wide job system.
+ * Indices are split off one at a time as workers go idle, so uneven work
+ * balances itself. The calling thread participates, nested calls help
+ * instead of starting threads, and the call returns once every index has
+ * been processed.
+ */
+template <typename Fn>
+void ParallelFor(size_t count, Fn&& fn) {
+  JobSystem::Get().ParallelFor(count, std::forward<Fn>(fn));
+}
+
+}  // namespace core
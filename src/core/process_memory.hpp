@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+#ifdef _WIN32
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #ifndef NOMINMAX
+    #define NOMINMAX
+  #endif
+  #include <windows.h>
+  // Must follow windows.h
+  #include <psapi.h>
+#else
+  #include <sys/resource.h>
+#endif
+
+namespace core {
+
+/**
+ * @brief Largest resident set the process has had so far, in bytes; 0 if
+ * the platform cannot tell.
+ */
+inline uint64_t GetPeakResidentBytes() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters{};
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return counters.PeakWorkingSetSize;
+  }
+  return 0;
+#else
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  #ifdef __APPLE__
+  return static_cast<uint64_t>(usage.ru_maxrss);  // Bytes on macOS
+  #else
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // KiB on Linux
+  #endif
+#endif
+}
+
+}  // namespace core
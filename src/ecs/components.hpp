@@ -6,6 +6,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include "resource/handle.hpp"
 #include "rhi/buffer.hpp"
 #include "rhi/pipeline.hpp"
 #include "rhi/texture.hpp"
@@ -91,6 +92,57 @@ struct Vertex {
   }
 };
 
+// Vertex storage layouts; each needs its own pipeline variant
+enum class VertexFormat : uint8_t {
+  Float,      // Vertex
+  Quantized,  // QuantizedVertex
+};
+
+// Compact 24-byte vertex. Positions are snorm16 relative to the mesh bounds
+// and are dequantized by MeshComponent::positionDequantization, normals and
+// tangents are snorm8, texture coordinates are half floats and color unorm8.
+// The attribute locations match Vertex so the same shaders consume both.
+struct QuantizedVertex {
+  uint64_t position{0};  // snorm16 x4, w unused
+  uint32_t normal{0};    // snorm8 x4, w unused
+  uint32_t tangent{0};   // snorm8 x4, w is handedness
+  uint32_t texCoord{0};  // half x2
+  uint32_t color{0};     // unorm8 x4
+
+  static std::vector<rhi::VertexBinding> GetBindings() {
+    return {{
+        .binding = 0,
+        .stride = sizeof(QuantizedVertex),
+        .inputRate = rhi::VertexInputRate::Vertex,
+    }};
+  }
+
+  static std::vector<rhi::VertexAttribute> GetAttributes() {
+    return {
+        {.location = 0,
+         .binding = 0,
+         .format = rhi::Format::R16G16B16A16Snorm,
+         .offset = offsetof(QuantizedVertex, position)},
+        {.location = 1,
+         .binding = 0,
+         .format = rhi::Format::R8G8B8A8Snorm,
+         .offset = offsetof(QuantizedVertex, normal)},
+        {.location = 2,
+         .binding = 0,
+         .format = rhi::Format::R8G8B8A8Snorm,
+         .offset = offsetof(QuantizedVertex, tangent)},
+        {.location = 3,
+         .binding = 0,
+         .format = rhi::Format::R16G16Sfloat,
+         .offset = offsetof(QuantizedVertex, texCoord)},
+        {.location = 4,
+         .binding = 0,
+         .format = rhi::Format::R8G8B8A8Unorm,
+         .offset = offsetof(QuantizedVertex, color)},
+    };
+  }
+};
+
 struct SubMesh {
   uint32_t indexOffset{0};
   uint32_t indexCount{0};
@@ -101,9 +153,24 @@ struct SubMesh {
 struct MeshComponent {
   std::shared_ptr<rhi::Buffer> vertexBuffer;
   std::shared_ptr<rhi::Buffer> indexBuffer;
+  rhi::IndexType indexType{rhi::IndexType::Uint32};
+  VertexFormat vertexFormat{VertexFormat::Float};
+  // Maps stored positions to mesh space (identity for float vertices)
+  glm::mat4 positionDequantization{1.0F};
   std::vector<SubMesh> subMeshes;
   uint32_t vertexCount{0};
   uint32_t indexCount{0};
+  // Mesh of a cached model the buffers belong to, so scene snapshots can
+  // store a reference instead of the geometry
+  resource::ModelHandle model;
+  uint32_t meshIndex{0};
+};
+
+// Copies of the entity's mesh, each with a transform relative to the entity
+// (EXT_mesh_gpu_instancing). They are culled and drawn one by one on the GPU
+// without becoming entities; entities may share a table.
+struct MeshInstancesComponent {
+  std::shared_ptr<const std::vector<glm::mat4>> transforms;
 };
 
 // ============================================================================
@@ -126,6 +193,18 @@ struct MaterialComponent {
   std::vector<uint32_t> materialIndices;
 };
 
+// ============================================================================
+// Resource Components
+// ============================================================================
+
+// Keeps a model cached while the entity lives, and releases the bindless
+// materials registered for it once the entity is destroyed. Set on the root
+// entity of an instantiated model, which is destroyed with its children.
+struct ModelReferenceComponent {
+  resource::ModelHandle model;
+  std::vector<uint32_t> materialIndices;
+};
+
 // ============================================================================
 // Rendering Components
 // ============================================================================
@@ -187,4 +266,9 @@ struct CameraComponent {
 struct MainCameraTag {};
 struct StaticTag {};
 struct DynamicTag {};
+
+// Drawn from object data the renderer keeps resident in its culling buffers
+// (RenderSystem::AddResidentObjects) instead of rebuilding every frame, so
+// changes to the entity's transform, mesh or materials are not picked up
+struct ResidentDrawTag {};
 }  // namespace ecs
@@ -0,0 +1,357 @@
+#include "io/file_reader.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <utility>
+
+#include "core/parallel.hpp"
+#include "logger.hpp"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+  #define VKR_IO_URING 1
+  #include <atomic>
+  #include <cerrno>
+  #include <cstring>
+  #include <stdexcept>
+  #include <string>
+
+  #include <fcntl.h>
+  #include <linux/io_uring.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+namespace io {
+namespace {
+std::optional<FileBuffer> ReadWholeFile(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return std::nullopt;
+  }
+
+  auto size = file.tellg();
+  if (size < 0) {
+    return std::nullopt;
+  }
+
+  FileBuffer buffer{static_cast<size_t>(size)};
+  file.seekg(0);
+  file.read(std::bit_cast<char*>(buffer.GetStorage()), size);
+  if (!file) {
+    return std::nullopt;
+  }
+  buffer.SetSize(static_cast<size_t>(size));
+  return buffer;
+}
+}  // namespace
+
+FileBuffer::FileBuffer(size_t size)
+    : size_{size},
+      capacity_{std::max(kAlignment,
+                         (size + kAlignment - 1) / kAlignment * kAlignment)} {
+  data_.reset(static_cast<std::byte*>(
+      ::operator new[](capacity_, std::align_val_t{kAlignment})));
+}
+
+#ifdef VKR_IO_URING
+// The submission and completion rings shared with the kernel, driven through
+// the raw system calls
+struct FileReader::Ring {
+  int fd{-1};
+  void* sqRing{MAP_FAILED};
+  size_t sqRingSize{0};
+  void* cqRing{MAP_FAILED};
+  size_t cqRingSize{0};
+  io_uring_sqe* sqes{static_cast<io_uring_sqe*>(MAP_FAILED)};
+  size_t sqesSize{0};
+
+  uint32_t* sqTail{nullptr};
+  uint32_t* sqArray{nullptr};
+  uint32_t sqMask{0};
+  uint32_t sqEntries{0};
+  uint32_t* cqHead{nullptr};
+  uint32_t* cqTail{nullptr};
+  io_uring_cqe* cqes{nullptr};
+  uint32_t cqMask{0};
+
+  Ring() = default;
+  Ring(const Ring&) = delete;
+  Ring& operator=(const Ring&) = delete;
+  Ring(Ring&&) = delete;
+  Ring& operator=(Ring&&) = delete;
+
+  ~Ring() {
+    if (sqes != MAP_FAILED) {
+      munmap(sqes, sqesSize);
+    }
+    if (cqRing != MAP_FAILED && cqRing != sqRing) {
+      munmap(cqRing, cqRingSize);
+    }
+    if (sqRing != MAP_FAILED) {
+      munmap(sqRing, sqRingSize);
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+
+  static std::unique_ptr<Ring> Create(uint32_t depth) {
+    io_uring_params params{};
+    auto ring = std::make_unique<Ring>();
+    ring->fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+    if (ring->fd < 0) {
+      return nullptr;
+    }
+
+    ring->sqRingSize =
+        params.sq_off.array + (params.sq_entries * sizeof(uint32_t));
+    ring->cqRingSize =
+        params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe));
+    bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap) {
+      ring->sqRingSize = ring->cqRingSize =
+          std::max(ring->sqRingSize, ring->cqRingSize);
+    }
+
+    ring->sqRing =
+        mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED) {
+      return nullptr;
+    }
+    ring->cqRing = singleMap ? ring->sqRing
+                             : mmap(nullptr, ring->cqRingSize,
+                                    PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_POPULATE, ring->fd,
+                                    IORING_OFF_CQ_RING);
+    if (ring->cqRing == MAP_FAILED) {
+      return nullptr;
+    }
+    ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sqes = static_cast<io_uring_sqe*>(
+        mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES));
+    if (ring->sqes == MAP_FAILED) {
+      return nullptr;
+    }
+
+    auto* sq = static_cast<std::byte*>(ring->sqRing);
+    auto* cq = static_cast<std::byte*>(ring->cqRing);
+    ring->sqTail = std::bit_cast<uint32_t*>(sq + params.sq_off.tail);
+    ring->sqArray = std::bit_cast<uint32_t*>(sq + params.sq_off.array);
+    ring->sqMask = *std::bit_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+    ring->sqEntries = params.sq_entries;
+    ring->cqHead = std::bit_cast<uint32_t*>(cq + params.cq_off.head);
+    ring->cqTail = std::bit_cast<uint32_t*>(cq + params.cq_off.tail);
+    ring->cqes = std::bit_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    ring->cqMask = *std::bit_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+    return ring;
+  }
+
+  // Queue a read; the caller keeps fewer than sqEntries in flight
+  void PushRead(int file, std::byte* data, uint32_t size, uint64_t offset,
+                uint64_t userData) {
+    uint32_t tail = *sqTail;
+    uint32_t index = tail & sqMask;
+    io_uring_sqe& sqe = sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = file;
+    sqe.addr = std::bit_cast<uint64_t>(data);
+    sqe.len = size;
+    sqe.off = offset;
+    sqe.user_data = userData;
+    sqArray[index] = index;
+    std::atomic_ref{*sqTail}.store(tail + 1, std::memory_order_release);
+  }
+
+  // Submit what was queued and wait for at least one completion
+  void Enter(uint32_t submit) const {
+    while (syscall(__NR_io_uring_enter, fd, submit, 1, IORING_ENTER_GETEVENTS,
+                   nullptr, 0) < 0) {
+      // Reads in flight may still write to their buffers, so there is no
+      // falling back past this point
+      if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        throw std::runtime_error{std::string{"io_uring_enter failed: "} +
+                                 std::strerror(errno)};
+      }
+    }
+  }
+
+  template <typename Fn>
+  void Reap(Fn&& fn) {
+    uint32_t head = *cqHead;
+    uint32_t tail = std::atomic_ref{*cqTail}.load(std::memory_order_acquire);
+    for (; head != tail; ++head) {
+      const io_uring_cqe& cqe = cqes[head & cqMask];
+      fn(cqe.user_data, cqe.res);
+    }
+    std::atomic_ref{*cqHead}.store(head, std::memory_order_release);
+  }
+};
+#else
+struct FileReader::Ring {};
+#endif
+
+FileReader::FileReader(FileReaderSettings settings) : settings_{settings} {
+#ifdef VKR_IO_URING
+  if (settings_.useIoUring) {
+    ring_ = Ring::Create(std::max(1U, settings_.queueDepth));
+    if (!ring_) {
+      LOG_DEBUG("io_uring unavailable, reading files with blocking reads");
+    }
+  }
+#endif
+}
+
+FileReader::~FileReader() = default;
+
+FileReader& FileReader::GetThreadReader() {
+  thread_local FileReader reader;
+  return reader;
+}
+
+void FileReader::ReadBlocking(std::span<const std::filesystem::path> paths,
+                              const Completion& onComplete) const {
+  (void)this;
+
+  std::vector<std::optional<FileBuffer>> buffers(paths.size());
+  core::ParallelFor(paths.size(),
+                    [&](size_t i) { buffers[i] = ReadWholeFile(paths[i]); });
+  for (size_t i = 0; i < paths.size(); ++i) {
+    onComplete(i, std::move(buffers[i]));
+  }
+}
+
+void FileReader::ReadBatch(std::span<const std::filesystem::path> paths,
+                           const Completion& onComplete) {
+#ifdef VKR_IO_URING
+  if (!ring_) {
+    ReadBlocking(paths, onComplete);
+    return;
+  }
+
+  struct File {
+    int fd{-1};
+    bool direct{false};
+    uint64_t size{0};
+    uint64_t offset{0};
+    FileBuffer buffer;
+  };
+  std::vector<File> files(paths.size());
+
+  auto complete = [&](size_t i, bool success) {
+    File& file = files[i];
+    if (file.fd >= 0) {
+      close(file.fd);
+      file.fd = -1;
+    }
+    if (!success) {
+      onComplete(i, std::nullopt);
+      return;
+    }
+    file.buffer.SetSize(file.size);
+    onComplete(i, std::move(file.buffer));
+  };
+
+  // Everything is opened up front; large files bypass the page cache, which
+  // they would mostly evict other assets from
+  std::vector<size_t> queued;
+  for (size_t i = 0; i < paths.size(); ++i) {
+    File& file = files[i];
+    file.fd = open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info{};
+    if (file.fd < 0 || fstat(file.fd, &info) != 0) {
+      complete(i, false);
+      continue;
+    }
+    file.size = static_cast<uint64_t>(info.st_size);
+    if (file.size >= settings_.directIoThreshold) {
+      int direct = open(paths[i].c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+      if (direct >= 0) {
+        close(file.fd);
+        file.fd = direct;
+        file.direct = true;
+      }
+    }
+    file.buffer = FileBuffer{file.size};
+    if (file.size == 0) {
+      complete(i, true);
+      continue;
+    }
+    queued.push_back(i);
+  }
+  std::ranges::reverse(queued);
+
+  // Reads are capped so a huge file does not hold one request for long;
+  // direct reads cover whole aligned blocks up to the buffer's capacity
+  constexpr uint64_t kMaxReadSize = 64ULL << 20;
+  uint32_t inFlight = 0;
+  size_t remaining = queued.size();
+  while (remaining > 0) {
+    uint32_t submit = 0;
+    while (!queued.empty() && inFlight < ring_->sqEntries) {
+      size_t i = queued.back();
+      queued.pop_back();
+      File& file = files[i];
+      uint64_t end = file.direct ? file.buffer.GetCapacity() : file.size;
+      auto size = static_cast<uint32_t>(
+          std::min(end - file.offset, kMaxReadSize));
+      ring_->PushRead(file.fd, file.buffer.GetStorage() + file.offset, size,
+                      file.offset, i);
+      ++submit;
+      ++inFlight;
+    }
+
+    ring_->Enter(submit);
+    ring_->Reap([&](uint64_t userData, int32_t result) {
+      --inFlight;
+      auto i = static_cast<size_t>(userData);
+      File& file = files[i];
+      if (result < 0 && file.direct && result == -EINVAL) {
+        // The file system does not take direct reads of this size
+        int buffered = open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+        close(file.fd);
+        file.fd = buffered;
+        file.direct = false;
+        if (buffered >= 0) {
+          queued.push_back(i);
+          return;
+        }
+      }
+      if (result < 0) {
+        complete(i, false);
+        --remaining;
+        return;
+      }
+
+      file.offset += static_cast<uint64_t>(result);
+      if (result == 0 || file.offset >= file.size) {
+        complete(i, file.offset >= file.size);
+        --remaining;
+      } else {
+        queued.push_back(i);
+      }
+    });
+  }
+#else
+  ReadBlocking(paths, onComplete);
+#endif
+}
+
+std::vector<std::optional<FileBuffer>> FileReader::ReadBatch(
+    std::span<const std::filesystem::path> paths) {
+  std::vector<std::optional<FileBuffer>> buffers(paths.size());
+  ReadBatch(paths, [&buffers](size_t index, std::optional<FileBuffer> buffer) {
+    buffers[index] = std::move(buffer);
+  });
+  return buffers;
+}
+
+std::optional<FileBuffer> FileReader::Read(const std::filesystem::path& path) {
+  return std::move(ReadBatch(std::span{&path, 1}).front());
+}
+}  // namespace io
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace io {
+/**
+ * @brief Contents of a file, in storage aligned for direct I/O.
+ */
+class FileBuffer {
+ public:
+  static constexpr size_t kAlignment = 4096;
+
+  FileBuffer() = default;
+
+  /**
+   * @brief Allocate room for `size` bytes, rounded up to kAlignment.
+   */
+  explicit FileBuffer(size_t size);
+
+  [[nodiscard]] std::span<const std::byte> GetData() const {
+    return {data_.get(), size_};
+  }
+  [[nodiscard]] std::byte* GetStorage() { return data_.get(); }
+  [[nodiscard]] size_t GetCapacity() const { return capacity_; }
+
+  /**
+   * @brief Set how many of the allocated bytes hold file contents.
+   */
+  void SetSize(size_t size) { size_ = size; }
+
+ private:
+  struct Deleter {
+    void operator()(std::byte* data) const {
+      ::operator delete[](data, std::align_val_t{kAlignment});
+    }
+  };
+
+  std::unique_ptr<std::byte[], Deleter> data_;
+  size_t size_{0};
+  size_t capacity_{0};
+};
+
+struct FileReaderSettings {
+  // Use io_uring where the kernel allows it, otherwise blocking reads on
+  // worker threads
+  bool useIoUring{true};
+  // Reads in flight at once
+  uint32_t queueDepth{64};
+  // Files at least this large are read with O_DIRECT, past the page cache
+  uint64_t directIoThreshold{16ULL << 20};
+};
+
+/**
+ * @brief Batched whole-file reads for asset loading.
+ *
+ * On Linux a batch goes to an io_uring as one submission, so reads of many
+ * files overlap without a thread each; large files skip the page cache with
+ * O_DIRECT into aligned buffers. Elsewhere, or when io_uring is not
+ * available, files are read with blocking reads spread over threads.
+ *
+ * A reader serves one thread at a time; GetThreadReader gives each thread
+ * its own.
+ */
+class FileReader {
+ public:
+  // Called on the reading thread as each file of a batch completes, with
+  // the file's index in the batch and nullopt when it could not be read
+  using Completion =
+      std::function<void(size_t index, std::optional<FileBuffer> buffer)>;
+
+  explicit FileReader(FileReaderSettings settings = {});
+  ~FileReader();
+
+  FileReader(const FileReader&) = delete;
+  FileReader& operator=(const FileReader&) = delete;
+  FileReader(FileReader&&) = delete;
+  FileReader& operator=(FileReader&&) = delete;
+
+  /**
+   * @brief The calling thread's reader, with default settings.
+   */
+  [[nodiscard]] static FileReader& GetThreadReader();
+
+  /**
+   * @brief Read files as one batch; returns once all completed.
+   */
+  void ReadBatch(std::span<const std::filesystem::path> paths,
+                 const Completion& onComplete);
+
+  /**
+   * @brief Read files as one batch.
+   *
+   * @return Contents in the order of `paths`, nullopt for unreadable files
+   */
+  [[nodiscard]] std::vector<std::optional<FileBuffer>> ReadBatch(
+      std::span<const std::filesystem::path> paths);
+
+  [[nodiscard]] std::optional<FileBuffer> Read(
+      const std::filesystem::path& path);
+
+  [[nodiscard]] bool UsesIoUring() const { return ring_ != nullptr; }
+
+ private:
+  struct Ring;
+
+  void ReadBlocking(std::span<const std::filesystem::path> paths,
+                    const Completion& onComplete) const;
+
+  FileReaderSettings settings_;
+  std::unique_ptr<Ring> ring_;
+};
+}  // namespace io
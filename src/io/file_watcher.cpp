@@ -0,0 +1,162 @@
+#include "io/file_watcher.hpp"
+
+#include <system_error>
+
+#include "logger.hpp"
+
+#if defined(__linux__) && __has_include(<sys/inotify.h>)
+  #define VKR_INOTIFY 1
+  #include <array>
+  #include <cerrno>
+  #include <cstdint>
+  #include <cstring>
+
+  #include <poll.h>
+  #include <sys/inotify.h>
+  #include <unistd.h>
+#endif
+
+namespace io {
+#ifdef VKR_INOTIFY
+namespace {
+// Files closed after writing or renamed over, and directories appearing
+constexpr uint32_t kWatchEvents =
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+// Bounds how long stopping the worker takes
+constexpr int kPollMilliseconds = 50;
+}  // namespace
+
+FileWatcher::FileWatcher() {
+  fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd_ < 0) {
+    LOG_WARNING("inotify unavailable, file changes are not watched");
+    return;
+  }
+  worker_ = std::jthread{[this](const std::stop_token& stop) { Run(stop); }};
+}
+
+FileWatcher::~FileWatcher() {
+  // The worker reads the descriptor, so it stops before it is closed
+  if (worker_.joinable()) {
+    worker_.request_stop();
+    worker_.join();
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+bool FileWatcher::Watch(const std::filesystem::path& directory) {
+  std::error_code error;
+  if (fd_ < 0 || !std::filesystem::is_directory(directory, error)) {
+    return false;
+  }
+  AddWatches(directory);
+  return true;
+}
+
+void FileWatcher::AddWatches(const std::filesystem::path& directory) {
+  std::vector<std::filesystem::path> pending{directory};
+  while (!pending.empty()) {
+    std::filesystem::path current = std::move(pending.back());
+    pending.pop_back();
+
+    int watch = inotify_add_watch(fd_, current.c_str(), kWatchEvents);
+    if (watch < 0) {
+      LOG_WARNING("Failed to watch {} ({})", current.string(),
+                  std::system_category().message(errno));
+      continue;
+    }
+    {
+      std::scoped_lock lock{mutex_};
+      directories_[watch] = current;
+    }
+
+    std::error_code error;
+    for (const auto& entry :
+         std::filesystem::directory_iterator{current, error}) {
+      if (entry.is_directory(error)) {
+        pending.push_back(entry.path());
+      }
+    }
+  }
+}
+
+void FileWatcher::Run(const std::stop_token& stop) {
+  alignas(inotify_event) std::array<char, 16 * 1024> buffer{};
+  while (!stop.stop_requested()) {
+    pollfd descriptor{.fd = fd_, .events = POLLIN, .revents = 0};
+    if (poll(&descriptor, 1, kPollMilliseconds) <= 0) {
+      continue;
+    }
+    ssize_t size = read(fd_, buffer.data(), buffer.size());
+    if (size <= 0) {
+      continue;
+    }
+
+    std::vector<std::filesystem::path> created;
+    auto now = std::chrono::steady_clock::now();
+    {
+      std::scoped_lock lock{mutex_};
+      for (ssize_t offset = 0; offset < size;) {
+        inotify_event event{};
+        std::memcpy(&event, buffer.data() + offset, sizeof(event));
+        const char* name = buffer.data() + offset + sizeof(event);
+        offset += static_cast<ssize_t>(sizeof(event) + event.len);
+
+        // The directory was deleted or moved out of the tree
+        if ((event.mask & IN_IGNORED) != 0) {
+          directories_.erase(event.wd);
+          continue;
+        }
+        auto it = directories_.find(event.wd);
+        if (it == directories_.end() || event.len == 0) {
+          continue;
+        }
+
+        std::filesystem::path path = it->second / name;
+        if ((event.mask & IN_ISDIR) != 0) {
+          created.push_back(std::move(path));
+        } else if ((event.mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0) {
+          changes_[path.string()] = now;
+        }
+      }
+    }
+
+    for (const auto& directory : created) {
+      AddWatches(directory);
+    }
+  }
+}
+#else
+FileWatcher::FileWatcher() {
+  LOG_WARNING("File watching needs inotify, file changes are not watched");
+}
+
+FileWatcher::~FileWatcher() = default;
+
+bool FileWatcher::Watch(const std::filesystem::path& /*directory*/) {
+  return false;
+}
+
+void FileWatcher::AddWatches(const std::filesystem::path& /*directory*/) {}
+
+void FileWatcher::Run(const std::stop_token& /*stop*/) {}
+#endif
+
+std::vector<std::filesystem::path> FileWatcher::TakeChanges() {
+  std::vector<std::filesystem::path> settled;
+  auto now = std::chrono::steady_clock::now();
+
+  std::scoped_lock lock{mutex_};
+  for (auto it = changes_.begin(); it != changes_.end();) {
+    if (now - it->second < kSettleTime) {
+      ++it;
+      continue;
+    }
+    settled.emplace_back(it->first);
+    it = changes_.erase(it);
+  }
+  return settled;
+}
+}  // namespace io
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace io {
+/**
+ * @brief Reports files written in watched directory trees.
+ *
+ * On Linux a worker thread reads inotify events for files closed after
+ * writing or moved into place, which covers editors that save through a
+ * temporary file. Directories created later in a watched tree are watched
+ * as well. Elsewhere nothing is reported.
+ */
+class FileWatcher {
+ public:
+  // Changes are reported once a file has been quiet this long, so a save
+  // in several steps is reported once
+  static constexpr std::chrono::milliseconds kSettleTime{100};
+
+  FileWatcher();
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher&) = delete;
+  FileWatcher& operator=(const FileWatcher&) = delete;
+  FileWatcher(FileWatcher&&) = delete;
+  FileWatcher& operator=(FileWatcher&&) = delete;
+
+  /**
+   * @brief Watch a directory and everything below it.
+   *
+   * @return false if the directory cannot be watched
+   */
+  bool Watch(const std::filesystem::path& directory);
+
+  /**
+   * @brief Files changed since the last call that have settled, each once.
+   */
+  [[nodiscard]] std::vector<std::filesystem::path> TakeChanges();
+
+ private:
+  void AddWatches(const std::filesystem::path& directory);
+  void Run(const std::stop_token& stop);
+
+  int fd_{-1};
+
+  // Shared with the worker
+  std::mutex mutex_;
+  std::unordered_map<int, std::filesystem::path> directories_;  // By watch
+  std::unordered_map<std::string, std::chrono::steady_clock::time_point>
+      changes_;  // Last event per path
+
+  // Last member so it stops before the state above goes away
+  std::jthread worker_;
+};
+}  // namespace io
@@ -0,0 +1,129 @@
+#include "io/mapped_file.hpp"
+
+#include <bit>
+#include <utility>
+
+#ifdef _WIN32
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #ifndef NOMINMAX
+    #define NOMINMAX
+  #endif
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace io {
+MappedFile::~MappedFile() { Close(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_{std::exchange(other.data_, nullptr)},
+      size_{std::exchange(other.size_, 0)}
+#ifdef _WIN32
+      ,
+      mapping_{std::exchange(other.mapping_, nullptr)}
+#endif
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    Close();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+#ifdef _WIN32
+    mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+  }
+  return *this;
+}
+
+#ifdef _WIN32
+std::optional<MappedFile> MappedFile::Open(const std::filesystem::path& path) {
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return std::nullopt;
+  }
+
+  LARGE_INTEGER size{};
+  if (GetFileSizeEx(file, &size) == 0 || size.QuadPart == 0) {
+    CloseHandle(file);
+    return std::nullopt;
+  }
+
+  // The mapping object keeps the file open, so the handle can go now
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    return std::nullopt;
+  }
+
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == nullptr) {
+    CloseHandle(mapping);
+    return std::nullopt;
+  }
+
+  MappedFile result;
+  result.data_ = std::bit_cast<const std::byte*>(view);
+  result.size_ = static_cast<size_t>(size.QuadPart);
+  result.mapping_ = mapping;
+  return result;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  mapping_ = nullptr;
+}
+#else
+std::optional<MappedFile> MappedFile::Open(const std::filesystem::path& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+
+  struct stat info{};
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    close(fd);
+    return std::nullopt;
+  }
+
+  auto size = static_cast<size_t>(info.st_size);
+  void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping holds its own reference to the file
+  close(fd);
+  if (view == MAP_FAILED) {
+    return std::nullopt;
+  }
+
+  // Everything in the file is about to be read, so start paging it in
+  madvise(view, size, MADV_WILLNEED);
+
+  MappedFile result;
+  result.data_ = std::bit_cast<const std::byte*>(view);
+  result.size_ = size;
+  return result;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(std::bit_cast<void*>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+#endif
+}  // namespace io
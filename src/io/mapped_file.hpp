@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+
+namespace io {
+/**
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * The mapping stays at the same address for the lifetime of the object, so
+ * spans into it remain valid across moves.
+ */
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  /**
+   * @brief Map a file for reading.
+   *
+   * @param path File to map
+   * @return The mapping, or nullopt if the file cannot be opened or mapped
+   */
+  [[nodiscard]] static std::optional<MappedFile> Open(
+      const std::filesystem::path& path);
+
+  /**
+   * @brief Gets the mapped bytes.
+   *
+   * @return std::span<const std::byte> Contents of the file
+   */
+  [[nodiscard]] std::span<const std::byte> GetData() const {
+    return {data_, size_};
+  }
+
+ private:
+  void Close();
+
+  const std::byte* data_{nullptr};
+  size_t size_{0};
+#ifdef _WIN32
+  void* mapping_{nullptr};
+#endif
+};
+}  // namespace io
@@ -1,3 +1,13 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include <entt/entt.hpp>
 
 #include "application.hpp"
@@ -7,11 +17,14 @@
 #include "logger.hpp"
 #include "renderer/pipeline_manager.hpp"
 #include "renderer/render_system.hpp"
+#include "resource/hot_reloader.hpp"
 #include "resource/resource_manager.hpp"
 #include "resource/scene_loader.hpp"
+#include "resource/scene_snapshot.hpp"
+#include "resource/world_streamer.hpp"
 #include "rhi/backend.hpp"
 
-int main() {
+int main(int argc, char** argv) {
   quill::Backend::start();
 
   GetLogger()->set_log_level(
@@ -36,33 +49,170 @@ int main() {
   // Create resource manager and load Sponza
   resource::ResourceManager resources{*factory};
 
+  // --virtual-texturing pages large textures through a fixed tile cache
+  renderer::RenderSettings renderSettings{};
+  std::span<char*> args{argv, static_cast<size_t>(argc)};
+  renderSettings.virtualTexturing.enabled =
+      std::ranges::any_of(args.subspan(1), [](const char* arg) {
+        return std::string_view{arg} == "--virtual-texturing";
+      });
+
   // Create render system
-  renderer::RenderSystem renderSystem{*device, *factory};
+  renderer::RenderSystem renderSystem{*device, *factory, renderSettings};
+
+  // Instantiated models keep themselves loaded and release their materials
+  resources.Connect(registry, renderSystem.GetContext().GetBindlessMaterials());
+
+  // --hot-reload reloads models, images and shaders under assets/ when they
+  // change on disk
+  std::unique_ptr<resource::HotReloader> hotReloader;
+  if (std::ranges::any_of(args.subspan(1), [](const char* arg) {
+        return std::string_view{arg} == "--hot-reload";
+      })) {
+    hotReloader = std::make_unique<resource::HotReloader>(
+        resources, renderSystem.GetContext().GetPipelineManager());
+    hotReloader->Watch("assets");
+  }
 
   // Current pipeline mode
   renderer::PipelineType currentPipeline = renderer::PipelineType::PBRLit;
 
-  resource::Model* sponzaModel =
-      resources.LoadModel("assets/models/Sponza/Sponza.gltf");
-  if (sponzaModel == nullptr) {
-    LOG_WARNING("Sponza model not found at assets/models/Sponza/Sponza.gltf");
-    return 1;
+  // --scene=<file> restores the scene from a snapshot if the file exists;
+  // otherwise the scene is built as usual and saved there once complete
+  std::string scenePath;
+  for (std::string_view arg : args.subspan(1)) {
+    if (arg.starts_with("--scene=")) {
+      scenePath = arg.substr(std::string_view{"--scene="}.size());
+    }
+  }
+  bool sceneRestored =
+      !scenePath.empty() && std::filesystem::exists(scenePath) &&
+      resource::LoadSceneSnapshot(
+          registry, resources,
+          renderSystem.GetContext().GetBindlessMaterials(), scenePath);
+  bool sceneSavePending = !scenePath.empty() && !sceneRestored;
+
+  // --world=<dir> streams the cells of a partitioned world around the camera
+  // instead of building the scene; --partition-world=<dir> partitions the
+  // built scene into cells of --cell-size=<units> (16 by default)
+  std::string worldPath;
+  std::string partitionPath;
+  float cellSize = 16.0F;
+  for (std::string_view arg : args.subspan(1)) {
+    if (arg.starts_with("--world=")) {
+      worldPath = arg.substr(std::string_view{"--world="}.size());
+    } else if (arg.starts_with("--partition-world=")) {
+      partitionPath =
+          arg.substr(std::string_view{"--partition-world="}.size());
+    } else if (arg.starts_with("--cell-size=")) {
+      cellSize = std::stof(
+          std::string{arg.substr(std::string_view{"--cell-size="}.size())});
+    }
+  }
+  std::unique_ptr<resource::WorldStreamer> worldStreamer;
+  if (!worldPath.empty()) {
+    if (auto manifest = resource::LoadWorldManifest(worldPath)) {
+      worldStreamer = std::make_unique<resource::WorldStreamer>(
+          std::move(*manifest), registry, resources,
+          renderSystem.GetContext().GetBindlessMaterials(), renderSystem);
+    }
+  }
+  bool buildScene = !sceneRestored && !worldStreamer;
+  bool partitionPending = !partitionPath.empty() && buildScene;
+  sceneSavePending = sceneSavePending && buildScene;
+
+  // Sponza loads on the loader threads while the rest of the scene renders;
+  // the reference keeps it cached until it is instantiated
+  resource::ModelHandle sponzaHandle;
+  bool sponzaPending = buildScene;
+  if (sponzaPending) {
+    sponzaHandle = resources.LoadModelAsync("assets/models/Sponza/Sponza.gltf");
+    resources.AddRef(sponzaHandle);
   }
 
-  LOG_INFO("Sponza model loaded successfully");
+  auto instantiateSponza = [&]() {
+    if (resources.GetLoadStage(sponzaHandle) == resource::LoadStage::Failed) {
+      LOG_WARNING(
+          "Sponza model not found at assets/models/Sponza/Sponza.gltf");
+      sponzaPending = false;
+      return;
+    }
+    resource::Model* sponzaModel = resources.GetModel(sponzaHandle);
+    if (sponzaModel == nullptr) {
+      return;
+    }
+    sponzaPending = false;
 
-  ecs::TransformComponent sponzaTransform{};
-  sponzaTransform.scale = glm::vec3(1.0F);
-  auto rootEntity = resource::InstantiateModel(
-      registry, *sponzaModel, renderSystem.GetContext().GetBindlessMaterials());
+    resource::InstantiateModel(
+        registry, *sponzaModel,
+        renderSystem.GetContext().GetBindlessMaterials(), sponzaHandle);
+    resources.Release(sponzaHandle);
 
-  size_t totalPrimitives = 0;
-  for (const auto& mesh : sponzaModel->meshes) {
-    totalPrimitives += mesh.primitives.size();
+    size_t totalPrimitives = 0;
+    for (const auto& mesh : sponzaModel->meshes) {
+      totalPrimitives += mesh.primitives.size();
+    }
+    LOG_INFO("Sponza: {} meshes, {} primitives, {} materials, {} textures",
+             sponzaModel->meshes.size(), totalPrimitives,
+             sponzaModel->materials.size(), sponzaModel->textures.size());
+  };
+
+  // --instances=<model> spawns a grid of copies of a model in one call;
+  // --instance-count=<n> sets how many (10000 by default)
+  std::string instancePath;
+  size_t instanceCount = 10000;
+  for (std::string_view arg : args.subspan(1)) {
+    if (arg.starts_with("--instances=")) {
+      instancePath = arg.substr(std::string_view{"--instances="}.size());
+    } else if (arg.starts_with("--instance-count=")) {
+      instanceCount = std::stoul(std::string{
+          arg.substr(std::string_view{"--instance-count="}.size())});
+    }
+  }
+  resource::ModelHandle instanceHandle;
+  bool instancesPending = !instancePath.empty() && buildScene;
+  if (instancesPending) {
+    instanceHandle = resources.LoadModelAsync(instancePath);
+    resources.AddRef(instanceHandle);
   }
-  LOG_INFO("Sponza: {} meshes, {} primitives, {} materials, {} textures",
-           sponzaModel->meshes.size(), totalPrimitives,
-           sponzaModel->materials.size(), sponzaModel->textures.size());
+
+  auto instantiateCopies = [&]() {
+    if (resources.GetLoadStage(instanceHandle) == resource::LoadStage::Failed) {
+      LOG_WARNING("Instanced model not found at {}", instancePath);
+      instancesPending = false;
+      return;
+    }
+    resource::Model* model = resources.GetModel(instanceHandle);
+    if (model == nullptr) {
+      return;
+    }
+    instancesPending = false;
+
+    // Square grid on the ground plane, spaced by the model's largest mesh
+    glm::vec3 extents{1.0F};
+    for (const auto& mesh : model->meshes) {
+      extents = glm::max(extents, mesh.bounds.max - mesh.bounds.min);
+    }
+    auto side = static_cast<size_t>(
+        std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+    std::vector<ecs::TransformComponent> transforms(instanceCount);
+    for (size_t i = 0; i < instanceCount; ++i) {
+      transforms[i].position =
+          glm::vec3(static_cast<float>(i % side) * extents.x, 0.0F,
+                    static_cast<float>(i / side) * extents.z);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    resource::InstantiateModelInstances(
+        registry, *model, renderSystem.GetContext().GetBindlessMaterials(),
+        transforms, instanceHandle);
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    resources.Release(instanceHandle);
+
+    LOG_INFO("Spawned {} instances of {} in {:.2f} ms", instanceCount,
+             instancePath, elapsed.count());
+  };
 
   // Create camera entity
   auto cameraEntity{registry.create()};
@@ -70,64 +220,67 @@ int main() {
   registry.emplace<ecs::CameraComponent>(cameraEntity, cameraComp);
   registry.emplace<ecs::MainCameraTag>(cameraEntity);
 
-  // Create directional light
-  auto lightEntity = registry.create();
-  ecs::DirectionalLightComponent light{
-      .direction = glm::normalize(glm::vec3(-1.0F, -1.0F, -0.5F)),
-      .color = glm::vec3(1.0F, 0.98F, 0.95F),
-      .intensity = 1.5F,
-  };
-  registry.emplace<ecs::DirectionalLightComponent>(lightEntity, light);
-
-  {
-    auto spotLightEntity = registry.create();
-    ecs::SpotLightComponent spotLight{
-        .direction = glm::normalize(glm::vec3(0.0F, -1.0F, 0.0F)),
-        .color = glm::vec3(1.0F, 0.0F, 0.0F),
-        .intensity = 40.0F,
-        .innerConeAngle = glm::radians(10.0F),
-        .outerConeAngle = glm::radians(25.0F),
-        .radius = 40.0F,
-    };
-    ecs::TransformComponent spotLightTransform{
-        .position = glm::vec3(-2.0F, 2.0F, 2.0F),
+  // Lights are part of a restored snapshot
+  if (!sceneRestored) {
+    // Create directional light
+    auto lightEntity = registry.create();
+    ecs::DirectionalLightComponent light{
+        .direction = glm::normalize(glm::vec3(-1.0F, -1.0F, -0.5F)),
+        .color = glm::vec3(1.0F, 0.98F, 0.95F),
+        .intensity = 1.5F,
     };
-    registry.emplace<ecs::SpotLightComponent>(spotLightEntity, spotLight);
-    registry.emplace<ecs::TransformComponent>(spotLightEntity,
-                                              spotLightTransform);
-    registry.emplace<ecs::WorldTransformComponent>(spotLightEntity);
-  }
+    registry.emplace<ecs::DirectionalLightComponent>(lightEntity, light);
 
-  {
-    auto pointLightEntity = registry.create();
-    ecs::PointLightComponent pointLight{
-        .color = glm::vec3(0.0F, 1.0F, 0.0F),
-        .intensity = 50.0F,
-        .radius = 10.0F,
-    };
-    ecs::TransformComponent pointLightTransform{
-        .position = glm::vec3(-2.0F, 3.0F, -2.0F),
-    };
-    registry.emplace<ecs::PointLightComponent>(pointLightEntity, pointLight);
-    registry.emplace<ecs::TransformComponent>(pointLightEntity,
-                                              pointLightTransform);
-    registry.emplace<ecs::WorldTransformComponent>(pointLightEntity);
-  }
+    {
+      auto spotLightEntity = registry.create();
+      ecs::SpotLightComponent spotLight{
+          .direction = glm::normalize(glm::vec3(0.0F, -1.0F, 0.0F)),
+          .color = glm::vec3(1.0F, 0.0F, 0.0F),
+          .intensity = 40.0F,
+          .innerConeAngle = glm::radians(10.0F),
+          .outerConeAngle = glm::radians(25.0F),
+          .radius = 40.0F,
+      };
+      ecs::TransformComponent spotLightTransform{
+          .position = glm::vec3(-2.0F, 2.0F, 2.0F),
+      };
+      registry.emplace<ecs::SpotLightComponent>(spotLightEntity, spotLight);
+      registry.emplace<ecs::TransformComponent>(spotLightEntity,
+                                                spotLightTransform);
+      registry.emplace<ecs::WorldTransformComponent>(spotLightEntity);
+    }
 
-  {
-    auto pointLightEntity = registry.create();
-    ecs::PointLightComponent pointLight{
-        .color = glm::vec3(0.0F, 0.0F, 1.0F),
-        .intensity = 50.0F,
-        .radius = 10.0F,
-    };
-    ecs::TransformComponent pointLightTransform{
-        .position = glm::vec3(2.0F, 3.0F, 2.0F),
-    };
-    registry.emplace<ecs::PointLightComponent>(pointLightEntity, pointLight);
-    registry.emplace<ecs::TransformComponent>(pointLightEntity,
-                                              pointLightTransform);
-    registry.emplace<ecs::WorldTransformComponent>(pointLightEntity);
+    {
+      auto pointLightEntity = registry.create();
+      ecs::PointLightComponent pointLight{
+          .color = glm::vec3(0.0F, 1.0F, 0.0F),
+          .intensity = 50.0F,
+          .radius = 10.0F,
+      };
+      ecs::TransformComponent pointLightTransform{
+          .position = glm::vec3(-2.0F, 3.0F, -2.0F),
+      };
+      registry.emplace<ecs::PointLightComponent>(pointLightEntity, pointLight);
+      registry.emplace<ecs::TransformComponent>(pointLightEntity,
+                                                pointLightTransform);
+      registry.emplace<ecs::WorldTransformComponent>(pointLightEntity);
+    }
+
+    {
+      auto pointLightEntity = registry.create();
+      ecs::PointLightComponent pointLight{
+          .color = glm::vec3(0.0F, 0.0F, 1.0F),
+          .intensity = 50.0F,
+          .radius = 10.0F,
+      };
+      ecs::TransformComponent pointLightTransform{
+          .position = glm::vec3(2.0F, 3.0F, 2.0F),
+      };
+      registry.emplace<ecs::PointLightComponent>(pointLightEntity, pointLight);
+      registry.emplace<ecs::TransformComponent>(pointLightEntity,
+                                                pointLightTransform);
+      registry.emplace<ecs::WorldTransformComponent>(pointLightEntity);
+    }
   }
 
   // Create camera controller
@@ -187,6 +340,30 @@ int main() {
         camComp.view = camera.GetView();
         camComp.projection = camera.GetProjection();
         camComp.frustumPlanes = camera.GetFrustumPlanes();
+
+        if (hotReloader) {
+          hotReloader->Update();
+        }
+        resources.Update(renderSystem.GetSubmittedFrameCount(),
+                         renderSystem.GetCompletedFrameCount());
+        if (sponzaPending) {
+          instantiateSponza();
+        }
+        if (instancesPending) {
+          instantiateCopies();
+        }
+        if (sceneSavePending && !sponzaPending && !instancesPending) {
+          sceneSavePending = false;
+          resource::SaveSceneSnapshot(registry, resources, scenePath);
+        }
+        if (partitionPending && !sponzaPending && !instancesPending) {
+          partitionPending = false;
+          resource::PartitionScene(registry, resources, cellSize,
+                                   partitionPath);
+        }
+        if (worldStreamer) {
+          worldStreamer->Update(camera, deltaTime);
+        }
       },
       // Render callback
       [&](float deltaTime) { renderSystem.Render(registry, deltaTime); });
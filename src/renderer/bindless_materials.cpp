@@ -1,13 +1,22 @@
 #include "renderer/bindless_materials.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cstring>
+#include <utility>
 
+#include "core/hash.hpp"
 #include "logger.hpp"
+#include "renderer/texture_streamer.hpp"
+#include "renderer/virtual_texture.hpp"
 
 namespace renderer {
 
-BindlessMaterialManager::BindlessMaterialManager(rhi::Factory& factory)
-    : factory_{factory} {}
+BindlessMaterialManager::BindlessMaterialManager(rhi::Factory& factory,
+                                                 uint32_t framesInFlight)
+    : factory_{factory},
+      descriptorSets_(framesInFlight),
+      pendingSlots_(framesInFlight) {}
 
 void BindlessMaterialManager::Initialize() {
   // Create sampler
@@ -31,22 +40,18 @@ void BindlessMaterialManager::Initialize() {
       rhi::BufferUsage::Storage | rhi::BufferUsage::TransferDst,
       rhi::MemoryUsage::CPUToGPU);
 
-  // Create descriptor set BEFORE creating default textures
-  descriptorSet_ = factory_.CreateDescriptorSet(descriptorLayout_.get());
-
-  // Bind material buffer
-  descriptorSet_->BindStorageBuffer(
-      0, materialBuffer_.get(), 0,
-      sizeof(BindlessMaterialData) * kMaxMaterials);
-
-  // Now create default textures (this will call RegisterTexture which uses
-  // descriptorSet_)
+  // Default textures first, so every slot can start out white; the slots
+  // they are registered in are written by the first UpdateDescriptorSet
   CreateDefaultTextures();
 
-  // Initialize remaining texture slots with white texture
-  for (auto i = static_cast<uint32_t>(textures_.size()); i < kMaxTextures;
-       ++i) {
-    descriptorSet_->BindTexture(1, whiteTexture_.get(), sampler_.get(), i);
+  for (auto& descriptorSet : descriptorSets_) {
+    descriptorSet = factory_.CreateDescriptorSet(descriptorLayout_.get());
+    descriptorSet->BindStorageBuffer(
+        0, materialBuffer_.get(), 0,
+        sizeof(BindlessMaterialData) * kMaxMaterials);
+    for (uint32_t i = 0; i < kMaxTextures; ++i) {
+      descriptorSet->BindTexture(1, whiteTexture_.get(), sampler_.get(), i);
+    }
   }
 
   // Create default material (index 0)
@@ -60,6 +65,7 @@ void BindlessMaterialManager::Initialize() {
   defaultMat.occlusionTexIdx = whiteTextureIdx_;
   defaultMat.emissiveTexIdx = blackTextureIdx_;
   materials_.push_back(defaultMat);
+  materialRefCounts_.push_back(1);  // Never released
   materialsDirty_ = true;
 
   UpdateMaterialBuffer();
@@ -103,29 +109,115 @@ uint32_t BindlessMaterialManager::RegisterTexture(
     return it->second;
   }
 
-  auto index = static_cast<uint32_t>(textures_.size());
-  if (index >= kMaxTextures) {
-    LOG_WARNING("Max texture count reached, returning white texture");
-    return whiteTextureIdx_;
+  // Slots of released textures are reused first
+  uint32_t index = 0;
+  if (!freeTextures_.empty()) {
+    index = freeTextures_.back();
+    freeTextures_.pop_back();
+  } else {
+    index = static_cast<uint32_t>(textures_.size());
+    if (index >= kMaxTextures) {
+      LOG_WARNING("Max texture count reached, returning white texture");
+      return whiteTextureIdx_;
+    }
+    textures_.emplace_back();
+    textureRefCounts_.push_back(0);
   }
-
-  textures_.push_back(texture);
   textureIndexMap_[texture.get()] = index;
 
-  // Update descriptor
-  descriptorSet_->BindTexture(1, texture.get(), sampler_.get(), index);
+  SetSlot(index, texture);
 
   return index;
 }
 
+void BindlessMaterialManager::ReplaceTexture(
+    uint32_t index, std::shared_ptr<rhi::Texture> texture) {
+  if (index >= textures_.size() || !texture) {
+    return;
+  }
+  // The index map stays keyed by the originally registered texture
+  SetSlot(index, std::move(texture));
+}
+
+void BindlessMaterialManager::SetSlot(uint32_t index,
+                                      std::shared_ptr<rhi::Texture> texture) {
+  // Submitted frames may still sample the previous texture through their
+  // set, so it lives on until every set has been rewritten
+  if (textures_[index]) {
+    retiredTextures_.push_back({
+        .texture = std::move(textures_[index]),
+        .pendingSets = (1U << descriptorSets_.size()) - 1,
+    });
+  }
+  textures_[index] = std::move(texture);
+  for (auto& pending : pendingSlots_) {
+    pending.push_back(index);
+  }
+}
+
+void BindlessMaterialManager::UpdateDescriptorSet(uint32_t frameIndex) {
+  auto& pending = pendingSlots_[frameIndex];
+  std::ranges::sort(pending);
+  auto [first, last] = std::ranges::unique(pending);
+  pending.erase(first, last);
+
+  // Released slots show white until they are reused
+  auto* descriptorSet = descriptorSets_[frameIndex].get();
+  for (uint32_t index : pending) {
+    auto* texture =
+        textures_[index] ? textures_[index].get() : whiteTexture_.get();
+    descriptorSet->BindTexture(1, texture, sampler_.get(), index);
+  }
+  pending.clear();
+
+  std::erase_if(retiredTextures_, [frameIndex](RetiredTexture& retired) {
+    retired.pendingSets &= ~(1U << frameIndex);
+    return retired.pendingSets == 0;
+  });
+}
+
+bool BindlessMaterialManager::ReloadTexture(
+    rhi::Texture* previous, const resource::TextureResource& texture) {
+  auto it = textureIndexMap_.find(previous);
+  if (it == textureIndexMap_.end() || !texture.texture) {
+    return false;
+  }
+  uint32_t index = it->second;
+  textureIndexMap_.erase(it);
+  textureIndexMap_.try_emplace(texture.texture.get(), index);
+
+  // Levels streamed for the old texture do not fit the new one
+  if (streamer_ != nullptr) {
+    streamer_->Untrack(index);
+  }
+  ReplaceTexture(index, texture.texture);
+  if (streamer_ != nullptr) {
+    streamer_->Track(index, texture);
+  }
+  return true;
+}
+
+void BindlessMaterialManager::ReleaseTexture(uint32_t index) {
+  if (index == whiteTextureIdx_ || index == normalTextureIdx_ ||
+      index == blackTextureIdx_ || index >= textureRefCounts_.size() ||
+      textureRefCounts_[index] == 0 || --textureRefCounts_[index] > 0) {
+    return;
+  }
+
+  // The map is keyed by the registered texture, which streaming may since
+  // have replaced in the slot
+  std::erase_if(textureIndexMap_,
+                [index](const auto& entry) { return entry.second == index; });
+  if (streamer_ != nullptr) {
+    streamer_->Untrack(index);
+  }
+  SetSlot(index, nullptr);
+  freeTextures_.push_back(index);
+}
+
 uint32_t BindlessMaterialManager::RegisterMaterial(
     const resource::Material& material,
     const std::vector<resource::TextureResource>& textureResources) {
-  if (materials_.size() >= kMaxMaterials) {
-    LOG_WARNING("Max material count reached, returning default material");
-    return 0;
-  }
-
   BindlessMaterialData matData{};
   matData.baseColorFactor = material.baseColorFactor;
   matData.emissiveFactorAndMetallic =
@@ -139,8 +231,17 @@ uint32_t BindlessMaterialManager::RegisterMaterial(
   auto getTextureIndex = [&](int32_t texIdx, uint32_t defaultIdx) -> uint32_t {
     if (texIdx >= 0 && texIdx < static_cast<int32_t>(textureResources.size())) {
       const auto& texRes = textureResources[texIdx];
+      if (texRes.texture && virtualTextures_ != nullptr) {
+        if (auto index = virtualTextures_->Register(texRes)) {
+          return *index | VirtualTextureSystem::kVirtualTextureBit;
+        }
+      }
       if (texRes.texture) {
-        return RegisterTexture(texRes.texture);
+        uint32_t index = RegisterTexture(texRes.texture);
+        if (streamer_ != nullptr) {
+          streamer_->Track(index, texRes);
+        }
+        return index;
       }
     }
     return defaultIdx;
@@ -157,13 +258,78 @@ uint32_t BindlessMaterialManager::RegisterMaterial(
   matData.emissiveTexIdx =
       getTextureIndex(material.emissiveTexture, blackTextureIdx_);
 
-  auto index = static_cast<uint32_t>(materials_.size());
-  materials_.push_back(matData);
+  // Identical materials, from instancing a model twice or from models that
+  // share assets, take one slot
+  uint64_t hash = core::HashValue(matData);
+  if (auto it = materialIndexMap_.find(hash); it != materialIndexMap_.end() &&
+      std::memcmp(&materials_[it->second], &matData, sizeof(matData)) == 0) {
+    ++materialRefCounts_[it->second];
+    return it->second;
+  }
+
+  uint32_t index = 0;
+  if (!freeMaterials_.empty()) {
+    index = freeMaterials_.back();
+    freeMaterials_.pop_back();
+    materials_[index] = matData;
+  } else {
+    if (materials_.size() >= kMaxMaterials) {
+      LOG_WARNING("Max material count reached, returning default material");
+      return 0;
+    }
+    index = static_cast<uint32_t>(materials_.size());
+    materials_.push_back(matData);
+    materialRefCounts_.push_back(0);
+  }
+  materialRefCounts_[index] = 1;
+  materialIndexMap_.try_emplace(hash, index);
   materialsDirty_ = true;
 
+  // The material holds a reference to each bindless texture it samples
+  for (uint32_t texIdx : {matData.baseColorTexIdx, matData.normalTexIdx,
+                          matData.metallicRoughnessTexIdx,
+                          matData.occlusionTexIdx, matData.emissiveTexIdx}) {
+    if ((texIdx & VirtualTextureSystem::kVirtualTextureBit) == 0 &&
+        texIdx < textureRefCounts_.size()) {
+      ++textureRefCounts_[texIdx];
+    }
+  }
+
   return index;
 }
 
+void BindlessMaterialManager::ReleaseMaterial(uint32_t materialIndex) {
+  // The default material is never released
+  if (materialIndex == 0 || materialIndex >= materialRefCounts_.size() ||
+      materialRefCounts_[materialIndex] == 0 ||
+      --materialRefCounts_[materialIndex] > 0) {
+    return;
+  }
+
+  const auto& material = materials_[materialIndex];
+  std::erase_if(materialIndexMap_, [materialIndex](const auto& entry) {
+    return entry.second == materialIndex;
+  });
+  for (uint32_t texIdx : {material.baseColorTexIdx, material.normalTexIdx,
+                          material.metallicRoughnessTexIdx,
+                          material.occlusionTexIdx, material.emissiveTexIdx}) {
+    if ((texIdx & VirtualTextureSystem::kVirtualTextureBit) == 0) {
+      ReleaseTexture(texIdx);
+    }
+  }
+  freeMaterials_.push_back(materialIndex);
+}
+
+bool BindlessMaterialManager::IsEmissive(uint32_t materialIndex) const {
+  if (materialIndex >= materials_.size()) {
+    return false;
+  }
+  // pbr.frag scales the emissive texture by the factor; black is the default
+  const auto& material = materials_[materialIndex];
+  return material.emissiveTexIdx != blackTextureIdx_ &&
+         glm::vec3(material.emissiveFactorAndMetallic) != glm::vec3(0.0F);
+}
+
 void BindlessMaterialManager::UpdateMaterialBuffer() {
   if (!materialsDirty_ || materials_.empty()) {
     return;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -14,6 +15,8 @@
 #include "rhi/texture.hpp"
 
 namespace renderer {
+class TextureStreamer;
+class VirtualTextureSystem;
 
 // GPU material data - must match shader struct
 struct alignas(16) BindlessMaterialData {
@@ -30,29 +33,70 @@ struct alignas(16) BindlessMaterialData {
   uint32_t _padding[3]{0, 0, 0};  // NOLINT
 };
 
+/**
+ * @brief Material SSBO and bindless texture array of set 1.
+ *
+ * Each frame in flight has its own copy of the descriptor set. Texture slot
+ * changes are written to a frame's copy in UpdateDescriptorSet, once the
+ * frame that last bound it has completed, so a set is never updated while a
+ * submitted frame may still use it. Textures taken out of a slot stay alive
+ * until every copy has stopped referring to them.
+ */
 class BindlessMaterialManager {
  public:
   static constexpr uint32_t kMaxTextures = 1024;
   static constexpr uint32_t kMaxMaterials = 1024;
 
-  BindlessMaterialManager(rhi::Factory& factory);
+  BindlessMaterialManager(rhi::Factory& factory, uint32_t framesInFlight);
 
   void Initialize();
 
   // Register a texture and get its bindless index
   uint32_t RegisterTexture(const std::shared_ptr<rhi::Texture>& texture);
 
-  // Register a material and get its index
+  // Point a bindless index at another texture, e.g. one with more mip levels
+  void ReplaceTexture(uint32_t index, std::shared_ptr<rhi::Texture> texture);
+
+  // Point the slot registered for `previous` at a reloaded texture, which is
+  // streamed like a newly registered one. Returns false if `previous` has no
+  // slot, e.g. because it is virtual.
+  bool ReloadTexture(rhi::Texture* previous,
+                     const resource::TextureResource& texture);
+
+  // Textures of registered materials that have a mip chain are streamed
+  void SetTextureStreamer(TextureStreamer* streamer) { streamer_ = streamer; }
+
+  // Textures of registered materials the system accepts become virtual; their
+  // indices carry VirtualTextureSystem::kVirtualTextureBit
+  void SetVirtualTextures(VirtualTextureSystem* virtualTextures) {
+    virtualTextures_ = virtualTextures;
+  }
+
+  // Register a material and get its index. Materials with identical data
+  // share one slot, and each registration holds a reference to it.
   uint32_t RegisterMaterial(
       const resource::Material& material,
       const std::vector<resource::TextureResource>& textureResources);
 
+  // Drop a reference taken by RegisterMaterial. The slot, and the texture
+  // slots only it used, are reused once unreferenced, so the material must
+  // no longer be in use by the GPU.
+  void ReleaseMaterial(uint32_t materialIndex);
+
+  // Whether a material adds emission; the rest draw with PBRLitNoEmissive
+  [[nodiscard]] bool IsEmissive(uint32_t materialIndex) const;
+
   // Update material buffer on GPU
   void UpdateMaterialBuffer();
 
+  // Write the slots changed since this frame last bound its descriptor set.
+  // Call once the frame's fence has been waited on, before binding the set.
+  void UpdateDescriptorSet(uint32_t frameIndex);
+
   // Get descriptor set for binding (set 1)
-  [[nodiscard]] rhi::DescriptorSet* GetDescriptorSet() const {
-    return descriptorSet_.get();
+  [[nodiscard]] rhi::DescriptorSet* GetDescriptorSet(
+      uint32_t frameIndex) const {
+    return descriptorSets_[frameIndex].get();
   }
   [[nodiscard]] rhi::DescriptorSetLayout* GetDescriptorLayout() const {
     return descriptorLayout_.get();
@@ -71,22 +115,40 @@ class BindlessMaterialManager {
 
  private:
   void CreateDefaultTextures();
+  void ReleaseTexture(uint32_t index);
+  // Point a slot at `texture` in every frame's set, retiring what it held
+  void SetSlot(uint32_t index, std::shared_ptr<rhi::Texture> texture);
+
+  // Held until none of the sets in `pendingSets` still refer to it
+  struct RetiredTexture {
+    std::shared_ptr<rhi::Texture> texture;
+    uint32_t pendingSets{0};  // Bit per frame in flight
+  };
 
   rhi::Factory& factory_;
+  TextureStreamer* streamer_{nullptr};
+  VirtualTextureSystem* virtualTextures_{nullptr};
   std::unique_ptr<rhi::Sampler> sampler_;
 
-  // Descriptor layout and set
+  // Descriptor layout and one set per frame in flight
   std::unique_ptr<rhi::DescriptorSetLayout> descriptorLayout_;
-  std::unique_ptr<rhi::DescriptorSet> descriptorSet_;
+  std::vector<std::unique_ptr<rhi::DescriptorSet>> descriptorSets_;
+  std::vector<std::vector<uint32_t>> pendingSlots_;  // Per set
+  std::vector<RetiredTexture> retiredTextures_;
 
   // Material SSBO
   std::unique_ptr<rhi::Buffer> materialBuffer_;
   std::vector<BindlessMaterialData> materials_;
+  std::vector<uint32_t> materialRefCounts_;
+  std::unordered_map<uint64_t, uint32_t> materialIndexMap_;  // By content
+  std::vector<uint32_t> freeMaterials_;
   bool materialsDirty_{false};
 
   // Bindless texture array
   std::vector<std::shared_ptr<rhi::Texture>> textures_;
   std::unordered_map<rhi::Texture*, uint32_t> textureIndexMap_;
+  std::vector<uint32_t> textureRefCounts_;  // Materials using each slot
+  std::vector<uint32_t> freeTextures_;
 
   // Default textures
   std::shared_ptr<rhi::Texture> whiteTexture_;
@@ -1,9 +1,11 @@
 #include "renderer/gpu_culling.hpp"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstring>
-#include <fstream>
 
 #include "logger.hpp"
+#include "rhi/shader_utils.hpp"
 
 namespace renderer {
 
@@ -23,21 +25,44 @@ void GPUCulling::CreateBuffers() {
       rhi::BufferUsage::Storage | rhi::BufferUsage::TransferDst,
       rhi::MemoryUsage::CPUToGPU);
 
+  // Draw group buffer (input) - index range and draw slots per group
+  groupBuffer_ = factory_.CreateBuffer(
+      sizeof(DrawGroup) * maxObjects_,
+      rhi::BufferUsage::Storage | rhi::BufferUsage::TransferDst,
+      rhi::MemoryUsage::CPUToGPU);
+
   // Cull uniforms buffer
   cullUniformBuffer_ =
       factory_.CreateBuffer(sizeof(CullUniforms), rhi::BufferUsage::Uniform,
                             rhi::MemoryUsage::CPUToGPU);
 
+  // Instance table (input) - uploaded when the set of tables changes
+  instanceBuffer_ = factory_.CreateBuffer(
+      sizeof(InstanceData) * maxInstances_,
+      rhi::BufferUsage::Storage | rhi::BufferUsage::TransferDst,
+      rhi::MemoryUsage::CPUToGPU);
+
+  // Visible object and instance indices (output) - each group owns as many
+  // slots as its objects have cull items, starting at its first slot
+  visibleBuffer_ = factory_.CreateBuffer(sizeof(glm::uvec2) * maxInstances_,
+                                         rhi::BufferUsage::Storage,
+                                         rhi::MemoryUsage::GPUOnly);
+
+  // Visible instance count buffer (output - one atomic counter per group)
+  instanceCountBuffer_ = factory_.CreateBuffer(
+      sizeof(uint32_t) * maxObjects_,
+      rhi::BufferUsage::Storage | rhi::BufferUsage::TransferDst,
+      rhi::MemoryUsage::GPUOnly);
+
   // Draw command buffer (output)
   drawCommandBuffer_ = factory_.CreateBuffer(
       sizeof(DrawIndexedIndirectCommand) * maxObjects_,
       rhi::BufferUsage::Storage | rhi::BufferUsage::Indirect,
       rhi::MemoryUsage::GPUOnly);
 
-  // Draw count buffer (output - atomic counter)
-  // Extra 4 bytes at start for reset via transfer
+  // Draw count buffer (output - one atomic counter per draw batch)
   drawCountBuffer_ = factory_.CreateBuffer(
-      sizeof(uint32_t) * 2,  // [0] = count, [1] = zero for reset
+      sizeof(uint32_t) * maxDrawBatches_,
       rhi::BufferUsage::Storage | rhi::BufferUsage::Indirect |
           rhi::BufferUsage::TransferDst,
       rhi::MemoryUsage::GPUOnly);
@@ -45,29 +70,26 @@ void GPUCulling::CreateBuffers() {
 
 void GPUCulling::CreatePipeline() {
   // Load compute shader
-  std::ifstream file("assets/shaders/cull.comp.spv", std::ios::binary);
-  if (!file) {
+  auto spirv = rhi::LoadSPIRV("assets/shaders/cull.comp.spv");
+  if (!spirv) {
     LOG_ERROR("Failed to load cull.comp.spv");
     return;
   }
 
-  std::vector<char> buffer((std::istreambuf_iterator<char>(file)),
-                           std::istreambuf_iterator<char>());
-  std::vector<uint32_t> spirv(buffer.size() / 4);
-  std::memcpy(spirv.data(), buffer.data(), buffer.size());
-
-  cullShader_ = factory_.CreateShader(rhi::ShaderStage::Compute, spirv);
+  cullShader_ = factory_.CreateShader(rhi::ShaderStage::Compute, *spirv);
 
   // Culling descriptor layout
   // binding 0: CullUniforms (uniform)
   // binding 1: ObjectData[] (storage, read)
-  // binding 2: DrawCommands[] (storage, write)
-  // binding 3: DrawCount (storage, write)
-  std::array<rhi::DescriptorBinding, 4> cullBindings = {{
+  // binding 2: VisibleObjects[] (storage, write)
+  // binding 3: InstanceCounts[] (storage, write - one counter per group)
+  // binding 4: InstanceData[] (storage, read)
+  std::array<rhi::DescriptorBinding, 5> cullBindings = {{
       {.binding = 0, .type = rhi::DescriptorType::UniformBuffer, .count = 1},
       {.binding = 1, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
       {.binding = 2, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
       {.binding = 3, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
+      {.binding = 4, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
   }};
   cullDescriptorLayout_ = factory_.CreateDescriptorSetLayout(cullBindings);
 
@@ -90,17 +112,25 @@ void GPUCulling::CreatePipeline() {
                                  sizeof(CullUniforms));
   cullDescriptorSet_->BindStorageBuffer(1, objectBuffer_.get(), 0,
                                         sizeof(ObjectData) * maxObjects_);
-  cullDescriptorSet_->BindStorageBuffer(
-      2, drawCommandBuffer_.get(), 0,
-      sizeof(DrawIndexedIndirectCommand) * maxObjects_);
-  cullDescriptorSet_->BindStorageBuffer(3, drawCountBuffer_.get(), 0,
-                                        sizeof(uint32_t));
+  cullDescriptorSet_->BindStorageBuffer(2, visibleBuffer_.get(), 0,
+                                        sizeof(glm::uvec2) * maxInstances_);
+  cullDescriptorSet_->BindStorageBuffer(3, instanceCountBuffer_.get(), 0,
+                                        sizeof(uint32_t) * maxObjects_);
+  cullDescriptorSet_->BindStorageBuffer(4, instanceBuffer_.get(), 0,
+                                        sizeof(InstanceData) * maxInstances_);
+
+  CreateEmitPipeline();
 
   // Object data descriptor layout for graphics pipeline (set 2)
   // binding 0: ObjectData[] (storage, read) - for fetching transforms in vertex
   // shader
-  std::array<rhi::DescriptorBinding, 1> objectBindings = {{
+  // binding 1: VisibleObjects[] (storage, read) - object and table instance
+  // per drawn instance
+  // binding 2: InstanceData[] (storage, read)
+  std::array<rhi::DescriptorBinding, 3> objectBindings = {{
       {.binding = 0, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
+      {.binding = 1, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
+      {.binding = 2, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
   }};
   objectDescriptorLayout_ = factory_.CreateDescriptorSetLayout(objectBindings);
 
@@ -108,22 +138,153 @@ void GPUCulling::CreatePipeline() {
       factory_.CreateDescriptorSet(objectDescriptorLayout_.get());
   objectDescriptorSet_->BindStorageBuffer(0, objectBuffer_.get(), 0,
                                           sizeof(ObjectData) * maxObjects_);
+  objectDescriptorSet_->BindStorageBuffer(1, visibleBuffer_.get(), 0,
+                                          sizeof(glm::uvec2) * maxInstances_);
+  objectDescriptorSet_->BindStorageBuffer(
+      2, instanceBuffer_.get(), 0, sizeof(InstanceData) * maxInstances_);
 
   LOG_DEBUG("GPU Culling pipeline created");
 }
 
-void GPUCulling::UpdateObjects(std::span<const ObjectData> objects) {
+void GPUCulling::CreateEmitPipeline() {
+  auto spirv = rhi::LoadSPIRV("assets/shaders/cull_emit.comp.spv");
+  if (!spirv) {
+    LOG_ERROR("Failed to load cull_emit.comp.spv");
+    return;
+  }
+
+  emitShader_ = factory_.CreateShader(rhi::ShaderStage::Compute, *spirv);
+
+  // Draw command descriptor layout
+  // binding 0: CullUniforms (uniform)
+  // binding 1: DrawGroups[] (storage, read)
+  // binding 2: InstanceCounts[] (storage, read)
+  // binding 3: DrawCommands[] (storage, write)
+  // binding 4: DrawCounts[] (storage, write - one counter per batch)
+  std::array<rhi::DescriptorBinding, 5> emitBindings = {{
+      {.binding = 0, .type = rhi::DescriptorType::UniformBuffer, .count = 1},
+      {.binding = 1, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
+      {.binding = 2, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
+      {.binding = 3, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
+      {.binding = 4, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
+  }};
+  emitDescriptorLayout_ = factory_.CreateDescriptorSetLayout(emitBindings);
+
+  std::array<const rhi::DescriptorSetLayout*, 1> layouts = {
+      emitDescriptorLayout_.get()};
+  emitPipelineLayout_ = factory_.CreatePipelineLayout(layouts);
+
+  rhi::ComputePipelineDesc desc{
+      .computeShader = emitShader_.get(),
+      .layout = emitPipelineLayout_.get(),
+  };
+  emitPipeline_ = factory_.CreateComputePipeline(desc);
+
+  emitDescriptorSet_ =
+      factory_.CreateDescriptorSet(emitDescriptorLayout_.get());
+  emitDescriptorSet_->BindBuffer(0, cullUniformBuffer_.get(), 0,
+                                 sizeof(CullUniforms));
+  emitDescriptorSet_->BindStorageBuffer(1, groupBuffer_.get(), 0,
+                                        sizeof(DrawGroup) * maxObjects_);
+  emitDescriptorSet_->BindStorageBuffer(2, instanceCountBuffer_.get(), 0,
+                                        sizeof(uint32_t) * maxObjects_);
+  emitDescriptorSet_->BindStorageBuffer(
+      3, drawCommandBuffer_.get(), 0,
+      sizeof(DrawIndexedIndirectCommand) * maxObjects_);
+  emitDescriptorSet_->BindStorageBuffer(4, drawCountBuffer_.get(), 0,
+                                        sizeof(uint32_t) * maxDrawBatches_);
+}
+
+void GPUCulling::UpdateObjects(std::span<const ObjectData> objects,
+                               std::span<const DrawGroup> groups,
+                               std::span<const DrawBatch> batches,
+                               uint32_t itemCount, uint32_t unchangedObjects,
+                               uint32_t unchangedGroups) {
   objectCount_ = static_cast<uint32_t>(objects.size());
   if (objectCount_ > maxObjects_) {
     LOG_WARNING("Object count {} exceeds max {}", objectCount_, maxObjects_);
     objectCount_ = maxObjects_;
   }
 
-  if (objectCount_ > 0) {
-    void* data = objectBuffer_->Map();
-    std::memcpy(data, objects.data(), sizeof(ObjectData) * objectCount_);
+  // Every item needs a visible slot, so keep the objects whose items fit
+  auto itemsEnd = [&](uint32_t count) {
+    return count < objects.size() ? objects[count].firstItem : itemCount;
+  };
+  if (itemsEnd(objectCount_) > maxInstances_) {
+    LOG_WARNING("Cull item count {} exceeds max {}", itemsEnd(objectCount_),
+                maxInstances_);
+    while (objectCount_ > 0 && itemsEnd(objectCount_) > maxInstances_) {
+      --objectCount_;
+    }
+  }
+
+  // Keep only the batches (or parts of them) that made it into the buffer.
+  // Groups cut short just draw fewer instances.
+  batches_.clear();
+  for (const auto& batch : batches) {
+    if (batches_.size() >= maxDrawBatches_) {
+      LOG_WARNING("Draw batch count exceeds max {}", maxDrawBatches_);
+      break;
+    }
+    if (batch.firstObject >= objectCount_) {
+      break;
+    }
+    DrawBatch clamped = batch;
+    clamped.objectCount =
+        std::min(batch.objectCount, objectCount_ - batch.firstObject);
+    clamped.groupCount = 0;
+    while (clamped.groupCount < batch.groupCount &&
+           groups[batch.firstGroup + clamped.groupCount].firstObject <
+               objectCount_) {
+      ++clamped.groupCount;
+    }
+    batches_.push_back(clamped);
+  }
+
+  // Objects of dropped batches must not be culled into foreign counters
+  if (!batches_.empty()) {
+    objectCount_ = std::min(objectCount_, batches_.back().firstObject +
+                                              batches_.back().objectCount);
+    groupCount_ = batches_.back().firstGroup + batches_.back().groupCount;
+    itemCount_ = itemsEnd(objectCount_);
+  } else {
+    objectCount_ = 0;
+    groupCount_ = 0;
+    itemCount_ = 0;
+  }
+
+  uint32_t firstObject = std::min(unchangedObjects, objectCount_);
+  if (firstObject < objectCount_) {
+    auto* data = static_cast<std::byte*>(objectBuffer_->Map());
+    std::memcpy(data + (sizeof(ObjectData) * firstObject),
+                objects.data() + firstObject,
+                sizeof(ObjectData) * (objectCount_ - firstObject));
     objectBuffer_->Unmap();
   }
+
+  uint32_t firstGroup = std::min(unchangedGroups, groupCount_);
+  if (firstGroup < groupCount_) {
+    auto* data = static_cast<std::byte*>(groupBuffer_->Map());
+    std::memcpy(data + (sizeof(DrawGroup) * firstGroup),
+                groups.data() + firstGroup,
+                sizeof(DrawGroup) * (groupCount_ - firstGroup));
+    groupBuffer_->Unmap();
+  }
+}
+
+void GPUCulling::UpdateInstances(std::span<const InstanceData> instances) {
+  size_t count = instances.size();
+  if (count > maxInstances_) {
+    LOG_WARNING("Instance count {} exceeds max {}", count, maxInstances_);
+    count = maxInstances_;
+  }
+  if (count == 0) {
+    return;
+  }
+
+  void* data = instanceBuffer_->Map();
+  std::memcpy(data, instances.data(), sizeof(InstanceData) * count);
+  instanceBuffer_->Unmap();
 }
 
 void GPUCulling::ExtractFrustumPlanes(const glm::mat4& viewProj,
@@ -168,6 +329,8 @@ void GPUCulling::UpdateFrustum(const glm::mat4& viewProjection) {
   CullUniforms uniforms{};
   uniforms.viewProjection = viewProjection;
   uniforms.objectCount = objectCount_;
+  uniforms.groupCount = groupCount_;
+  uniforms.itemCount = itemCount_;
   ExtractFrustumPlanes(viewProjection, uniforms.frustumPlanes.data());
 
   void* data = cullUniformBuffer_->Map();
@@ -176,17 +339,28 @@ void GPUCulling::UpdateFrustum(const glm::mat4& viewProjection) {
 }
 
 void GPUCulling::ResetDrawCount(rhi::CommandBuffer* cmd) {
-  // Fill draw count buffer with zero
-  cmd->FillBuffer(drawCountBuffer_.get(), 0, sizeof(uint32_t), 0);
+  if (batches_.empty()) {
+    return;
+  }
+
+  // Zero the counters of all active batches and groups
+  cmd->FillBuffer(drawCountBuffer_.get(), 0,
+                  sizeof(uint32_t) * batches_.size(), 0);
+  cmd->FillBuffer(instanceCountBuffer_.get(), 0,
+                  sizeof(uint32_t) * groupCount_, 0);
 
   // Barrier to ensure fill completes before compute
   cmd->BufferBarrier(
       drawCountBuffer_.get(), rhi::AccessFlags::TransferWrite,
       rhi::AccessFlags::ShaderRead | rhi::AccessFlags::ShaderWrite);
+  cmd->BufferBarrier(
+      instanceCountBuffer_.get(), rhi::AccessFlags::TransferWrite,
+      rhi::AccessFlags::ShaderRead | rhi::AccessFlags::ShaderWrite);
 }
 
 void GPUCulling::Execute(rhi::CommandBuffer* cmd) {
-  if (objectCount_ == 0 || cullPipeline_ == nullptr) {
+  if (objectCount_ == 0 || cullPipeline_ == nullptr ||
+      emitPipeline_ == nullptr) {
     return;
   }
 
@@ -195,13 +369,29 @@ void GPUCulling::Execute(rhi::CommandBuffer* cmd) {
   std::array<const rhi::DescriptorSet*, 1> sets = {cullDescriptorSet_.get()};
   cmd->BindDescriptorSets(cullPipeline_.get(), 0, sets);
 
-  // Dispatch one thread per object
-  uint32_t groupCount = (objectCount_ + 63) / 64;
+  // Dispatch one thread per object, or per table instance of an object
+  uint32_t groupCount = (itemCount_ + 63) / 64;
   cmd->Dispatch(groupCount, 1, 1);
 
+  // Barrier: instance counts complete before draws are emitted
+  cmd->BufferBarrier(instanceCountBuffer_.get(),
+                     rhi::AccessFlags::ShaderWrite,
+                     rhi::AccessFlags::ShaderRead);
+
+  cmd->BindPipeline(emitPipeline_.get());
+
+  std::array<const rhi::DescriptorSet*, 1> emitSets = {
+      emitDescriptorSet_.get()};
+  cmd->BindDescriptorSets(emitPipeline_.get(), 0, emitSets);
+
+  // Dispatch one thread per draw group
+  cmd->Dispatch((groupCount_ + 63) / 64, 1, 1);
+
   // Barrier: compute writes -> indirect read + vertex shader read
   cmd->BufferBarrier(drawCommandBuffer_.get(), rhi::AccessFlags::ShaderWrite,
                      rhi::AccessFlags::IndirectCommandRead);
+  cmd->BufferBarrier(visibleBuffer_.get(), rhi::AccessFlags::ShaderWrite,
+                     rhi::AccessFlags::ShaderRead);
   cmd->BufferBarrier(drawCountBuffer_.get(), rhi::AccessFlags::ShaderWrite,
                      rhi::AccessFlags::IndirectCommandRead);
   cmd->BufferBarrier(objectBuffer_.get(), rhi::AccessFlags::ShaderWrite,
@@ -1,10 +1,13 @@
 #pragma once
 
-#include <memory>
 #include <array>
+#include <memory>
+#include <span>
+#include <vector>
 
 #include <glm/glm.hpp>
 
+#include "ecs/components.hpp"
 #include "rhi/buffer.hpp"
 #include "rhi/command.hpp"
 #include "rhi/descriptor.hpp"
@@ -14,15 +17,57 @@
 
 namespace renderer {
 
-// Must match shader struct - object instance data
+// ObjectData::firstInstance of objects drawn once, without an instance table
+inline constexpr uint32_t kNoInstances = UINT32_MAX;
+
+// Must match shader struct - object instance data. An object is culled and
+// drawn once, or once per entry of its range in the instance table.
 struct alignas(16) ObjectData {
   glm::mat4 model;
   glm::mat4 normalMatrix;
   glm::vec4 boundingSphere;  // xyz = center (local space), w = radius
   uint32_t materialIndex;
-  uint32_t indexCount;
-  uint32_t indexOffset;
-  int32_t vertexOffset;
+  uint32_t drawGroup;      // Index of the draw group (per-group count)
+  uint32_t firstSlot;      // First visible instance slot of the group
+  uint32_t firstItem;      // First cull thread; objects are in item order
+  uint32_t firstInstance;  // Instance table offset, or kNoInstances
+  uint32_t _padding[3];    // NOLINT
+};
+
+// Must match shader struct - per-instance transform applied after the
+// object's, with the mesh's dequantization already folded in
+struct alignas(16) InstanceData {
+  glm::mat4 model;
+  glm::mat4 normalMatrix;
+};
+
+// Must match shader struct - objects of a batch drawing the same index
+// range, issued as one instanced draw of the visible ones. Objects of a
+// group are contiguous in the object buffer.
+struct DrawGroup {
+  uint32_t indexCount{0};
+  uint32_t indexOffset{0};
+  int32_t vertexOffset{0};
+  uint32_t firstObject{0};
+  uint32_t firstSlot{0};     // Visible instance slots, one per cull item
+  uint32_t drawBatch{0};     // Index of the draw batch (per-batch draw count)
+  uint32_t drawSlotBase{0};  // First draw command slot of the batch
+  uint32_t _padding{0};      // NOLINT
+};
+
+// Objects sharing vertex/index buffers, index width and fragment shader
+// variant, drawn with a single indirect call. Groups and objects of a batch
+// are contiguous in the group and object buffers.
+struct DrawBatch {
+  const rhi::Buffer* vertexBuffer{nullptr};
+  const rhi::Buffer* indexBuffer{nullptr};
+  rhi::IndexType indexType{rhi::IndexType::Uint32};
+  ecs::VertexFormat vertexFormat{ecs::VertexFormat::Float};
+  bool emissive{true};  // False draws with the PBRLitNoEmissive variant
+  uint32_t firstObject{0};
+  uint32_t objectCount{0};
+  uint32_t firstGroup{0};
+  uint32_t groupCount{0};
 };
 
 // VkDrawIndexedIndirectCommand compatible
@@ -31,14 +76,16 @@ struct DrawIndexedIndirectCommand {
   uint32_t instanceCount;
   uint32_t firstIndex;
   int32_t vertexOffset;
-  uint32_t firstInstance;  // Used as object index to fetch transform
+  uint32_t firstInstance;  // First visible instance slot of the group
 };
 
 struct CullUniforms {
   glm::mat4 viewProjection;
   std::array<glm::vec4, 6> frustumPlanes;
   uint32_t objectCount;
-  uint32_t _padding[3];  // NOLINT
+  uint32_t groupCount;
+  uint32_t itemCount;    // Objects plus extra table instances
+  uint32_t _padding;     // NOLINT
 };
 
 class GPUCulling {
@@ -47,16 +94,28 @@ class GPUCulling {
 
   void Initialize();
 
-  // Update object data for culling (call when scene changes)
-  void UpdateObjects(std::span<const ObjectData> objects);
+  // Update object data for culling (call when scene changes). Objects must be
+  // ordered by group and groups by batch, matching the ranges described by
+  // `groups` and `batches`; `itemCount` is where the last object's items
+  // end. The first `unchangedObjects` objects and `unchangedGroups` groups
+  // are the same as in an earlier call and are not uploaded again.
+  void UpdateObjects(std::span<const ObjectData> objects,
+                     std::span<const DrawGroup> groups,
+                     std::span<const DrawBatch> batches, uint32_t itemCount,
+                     uint32_t unchangedObjects = 0,
+                     uint32_t unchangedGroups = 0);
+
+  // Replace the instance table (call only when it changes)
+  void UpdateInstances(std::span<const InstanceData> instances);
 
   // Update camera frustum
   void UpdateFrustum(const glm::mat4& viewProjection);
 
-  // Reset draw count to zero (call before culling)
+  // Reset draw and instance counts to zero (call before culling)
   void ResetDrawCount(rhi::CommandBuffer* cmd);
 
-  // Execute culling compute pass
+  // Execute culling compute pass, then turn each group with visible
+  // instances into one draw command
   void Execute(rhi::CommandBuffer* cmd);
 
   // Get buffers for rendering
@@ -71,6 +130,11 @@ class GPUCulling {
   }
   [[nodiscard]] uint32_t GetMaxDrawCount() const { return maxObjects_; }
   [[nodiscard]] uint32_t GetObjectCount() const { return objectCount_; }
+  [[nodiscard]] uint32_t GetGroupCount() const { return groupCount_; }
+  [[nodiscard]] uint32_t GetMaxInstances() const { return maxInstances_; }
+  [[nodiscard]] std::span<const DrawBatch> GetDrawBatches() const {
+    return batches_;
+  }
 
   // Get descriptor layout for object data (for graphics pipeline)
   [[nodiscard]] rhi::DescriptorSetLayout* GetObjectDescriptorLayout() const {
@@ -83,6 +147,7 @@ class GPUCulling {
  private:
   void CreateBuffers();
   void CreatePipeline();
+  void CreateEmitPipeline();
   void ExtractFrustumPlanes(const glm::mat4& viewProj, glm::vec4* planes);
 
   rhi::Factory& factory_;
@@ -95,18 +160,37 @@ class GPUCulling {
   std::unique_ptr<rhi::Pipeline> cullPipeline_;
   std::unique_ptr<rhi::DescriptorSet> cullDescriptorSet_;
 
+  // Draw command pipeline, one thread per group
+  std::unique_ptr<rhi::Shader> emitShader_;
+  std::unique_ptr<rhi::DescriptorSetLayout> emitDescriptorLayout_;
+  std::unique_ptr<rhi::PipelineLayout> emitPipelineLayout_;
+  std::unique_ptr<rhi::Pipeline> emitPipeline_;
+  std::unique_ptr<rhi::DescriptorSet> emitDescriptorSet_;
+
   // Object data descriptor for graphics pipeline (set 2)
   std::unique_ptr<rhi::DescriptorSetLayout> objectDescriptorLayout_;
   std::unique_ptr<rhi::DescriptorSet> objectDescriptorSet_;
 
   // Buffers
   std::unique_ptr<rhi::Buffer> objectBuffer_;  // Object transforms + bounds
+  std::unique_ptr<rhi::Buffer> groupBuffer_;   // Index range per group
   std::unique_ptr<rhi::Buffer> cullUniformBuffer_;  // Frustum planes
+  std::unique_ptr<rhi::Buffer> instanceBuffer_;  // Instance table
+  std::unique_ptr<rhi::Buffer> visibleBuffer_;  // Visible items per group
+  std::unique_ptr<rhi::Buffer> instanceCountBuffer_;  // Count per group
   std::unique_ptr<rhi::Buffer> drawCommandBuffer_;  // Indirect commands
-  std::unique_ptr<rhi::Buffer> drawCountBuffer_;    // Visible count
+  std::unique_ptr<rhi::Buffer> drawCountBuffer_;    // Draw count per batch
+
+  std::vector<DrawBatch> batches_;
 
-  uint32_t maxObjects_{10000};
+  // Groups never outnumber objects, so draw slots are bounded the same way
+  uint32_t maxObjects_{65536};
+  uint32_t maxDrawBatches_{1024};
+  // Bounds both the instance table and the cull items
+  uint32_t maxInstances_{131072};
   uint32_t objectCount_{0};
+  uint32_t groupCount_{0};
+  uint32_t itemCount_{0};
 };
 
 }  // namespace renderer
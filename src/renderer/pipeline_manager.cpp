@@ -1,5 +1,6 @@
 #include "renderer/pipeline_manager.hpp"
 
+#include <algorithm>
 #include <array>
 
 #include "ecs/components.hpp"
@@ -11,16 +12,18 @@ namespace renderer {
 PipelineManager::PipelineManager(rhi::Factory& factory, rhi::Device& device)
     : factory_{factory}, device_{device} {}
 
-void PipelineManager::Initialize(rhi::DescriptorSetLayout* globalLayout,
-                                 rhi::DescriptorSetLayout* materialLayout,
-                                 rhi::DescriptorSetLayout* objectLayout,
-                                 rhi::DescriptorSetLayout* iblLayout,
-                                 rhi::DescriptorSetLayout* lightLayout) {
+void PipelineManager::Initialize(
+    rhi::DescriptorSetLayout* globalLayout,
+    rhi::DescriptorSetLayout* materialLayout,
+    rhi::DescriptorSetLayout* objectLayout, rhi::DescriptorSetLayout* iblLayout,
+    rhi::DescriptorSetLayout* lightLayout,
+    rhi::DescriptorSetLayout* virtualTextureLayout) {
   globalLayout_ = globalLayout;
   materialLayout_ = materialLayout;
   objectLayout_ = objectLayout;
   iblLayout_ = iblLayout;
   lightLayout_ = lightLayout;
+  virtualTextureLayout_ = virtualTextureLayout;
 
   // Create pipeline layout with all descriptor sets
   // Set 0: Global
@@ -28,6 +31,7 @@ void PipelineManager::Initialize(rhi::DescriptorSetLayout* globalLayout,
   // Set 2: Objects
   // Set 3: IBL
   // Set 4: Forward+ Lights (optional)
+  // Set 5: Virtual textures (optional, needs set 4)
   std::vector<rhi::DescriptorSetLayout*> layouts = {
       globalLayout_,    // set 0
       materialLayout_,  // set 1
@@ -37,6 +41,9 @@ void PipelineManager::Initialize(rhi::DescriptorSetLayout* globalLayout,
 
   if (lightLayout_ != nullptr) {
     layouts.push_back(lightLayout_);  // set 4
+    if (virtualTextureLayout_ != nullptr) {
+      layouts.push_back(virtualTextureLayout_);  // set 5
+    }
   }
 
   std::array<rhi::PushConstantRange, 1> pushConstants = {{
@@ -45,29 +52,44 @@ void PipelineManager::Initialize(rhi::DescriptorSetLayout* globalLayout,
 
   pipelineLayout_ = factory_.CreatePipelineLayout(layouts, pushConstants);
 
-  // Create default pipelines
-  CreatePipeline(PipelineType::PBRLit,
-                 {
-                     .vertexShaderPath = "assets/shaders/pbr.vert.spv",
-                     .fragmentShaderPath = "assets/shaders/pbr.frag.spv",
-                 });
+  // Create default pipelines, once per mesh vertex format
+  for (auto format :
+       {ecs::VertexFormat::Float, ecs::VertexFormat::Quantized}) {
+    CreatePipeline(PipelineType::PBRLit,
+                   {
+                       .vertexShaderPath = "assets/shaders/pbr.vert.spv",
+                       .fragmentShaderPath = GetFeedbackShaderPath("pbr"),
+                       .vertexFormat = format,
+                   });
 
-  CreatePipeline(PipelineType::Unlit,
-                 {
-                     .vertexShaderPath = "assets/shaders/unlit.vert.spv",
-                     .fragmentShaderPath = "assets/shaders/unlit.frag.spv",
-                 });
+    CreatePipeline(
+        PipelineType::PBRLitNoEmissive,
+        {
+            .vertexShaderPath = "assets/shaders/pbr.vert.spv",
+            .fragmentShaderPath = GetFeedbackShaderPath("pbr_no_emissive"),
+            .vertexFormat = format,
+        });
 
-  CreatePipeline(PipelineType::Wireframe,
-                 {
-                     .vertexShaderPath = "assets/shaders/wireframe.vert.spv",
-                     .fragmentShaderPath = "assets/shaders/wireframe.frag.spv",
-                     .depthTest = true,
-                     .depthWrite = true,
-                     .doubleSided = true,
-                     .wireframe = true,
-                     .blendEnabled = false,
-                 });
+    CreatePipeline(PipelineType::Unlit,
+                   {
+                       .vertexShaderPath = "assets/shaders/unlit.vert.spv",
+                       .fragmentShaderPath = GetFeedbackShaderPath("unlit"),
+                       .vertexFormat = format,
+                   });
+
+    CreatePipeline(
+        PipelineType::Wireframe,
+        {
+            .vertexShaderPath = "assets/shaders/wireframe.vert.spv",
+            .fragmentShaderPath = "assets/shaders/wireframe.frag.spv",
+            .depthTest = true,
+            .depthWrite = true,
+            .doubleSided = true,
+            .wireframe = true,
+            .blendEnabled = false,
+            .vertexFormat = format,
+        });
+  }
 
   // Skybox only uses position
   std::vector<rhi::VertexBinding> skyboxBindings = {{
@@ -98,15 +120,37 @@ void PipelineManager::Initialize(rhi::DescriptorSetLayout* globalLayout,
                  });
 }
 
+std::unique_ptr<rhi::Shader> PipelineManager::CreateShader(
+    const std::string& path, rhi::ShaderStage stage) {
+  if (auto it = reloadedShaders_.find(path); it != reloadedShaders_.end()) {
+    return factory_.CreateShader(stage, it->second);
+  }
+  return rhi::CreateShaderFromFile(factory_, path, stage);
+}
+
+std::string PipelineManager::GetFeedbackShaderPath(
+    const std::string& name) const {
+  const char* suffix =
+      device_.GetFeatures().fragmentStoresAndAtomics ? "" : "_no_feedback";
+  return "assets/shaders/" + name + suffix + ".frag.spv";
+}
+
 void PipelineManager::CreatePipeline(PipelineType type,
                                      const PipelineConfig& config) {
-  auto vertShader = rhi::CreateShaderFromFile(factory_, config.vertexShaderPath,
-                                              rhi::ShaderStage::Vertex);
+  if (std::ranges::none_of(configs_, [&](const auto& entry) {
+        return entry.first == type &&
+               entry.second.vertexFormat == config.vertexFormat;
+      })) {
+    configs_.emplace_back(type, config);
+  }
+
+  auto vertShader =
+      CreateShader(config.vertexShaderPath, rhi::ShaderStage::Vertex);
 
   std::unique_ptr<rhi::Shader> fragShader = nullptr;
   if (!config.fragmentShaderPath.empty()) {
-    fragShader = rhi::CreateShaderFromFile(factory_, config.fragmentShaderPath,
-                                           rhi::ShaderStage::Fragment);
+    fragShader =
+        CreateShader(config.fragmentShaderPath, rhi::ShaderStage::Fragment);
 
     if (!fragShader) {
       LOG_WARNING("Failed to load fragment shader: {}",
@@ -127,6 +171,9 @@ void PipelineManager::CreatePipeline(PipelineType type,
   if (config.vertexBindings && config.vertexAttributes) {
     bindings = *config.vertexBindings;
     attributes = *config.vertexAttributes;
+  } else if (config.vertexFormat == ecs::VertexFormat::Quantized) {
+    bindings = ecs::QuantizedVertex::GetBindings();
+    attributes = ecs::QuantizedVertex::GetAttributes();
   } else {
     bindings = ecs::Vertex::GetBindings();
     attributes = ecs::Vertex::GetAttributes();
@@ -156,14 +203,21 @@ void PipelineManager::CreatePipeline(PipelineType type,
 
   auto pipeline = factory_.CreateGraphicsPipeline(pipelineDesc);
   if (pipeline) {
-    pipelines_[type] = std::move(pipeline);
+    auto& pipelines = config.vertexFormat == ecs::VertexFormat::Quantized
+                          ? quantizedPipelines_
+                          : pipelines_;
+    pipelines[type] = std::move(pipeline);
     LOG_INFO("Created pipeline: {}", config.vertexShaderPath);
   }
 }
 
-rhi::Pipeline* PipelineManager::GetPipeline(PipelineType type) {
-  auto it = pipelines_.find(type);
-  if (it != pipelines_.end()) {
+rhi::Pipeline* PipelineManager::GetPipeline(PipelineType type,
+                                            ecs::VertexFormat vertexFormat) {
+  const auto& pipelines = vertexFormat == ecs::VertexFormat::Quantized
+                              ? quantizedPipelines_
+                              : pipelines_;
+  auto it = pipelines.find(type);
+  if (it != pipelines.end()) {
     return it->second.get();
   }
   return nullptr;
@@ -171,8 +225,45 @@ rhi::Pipeline* PipelineManager::GetPipeline(PipelineType type) {
 
 void PipelineManager::RecreatePipelines() {
   pipelines_.clear();
+  quantizedPipelines_.clear();
+  configs_.clear();
   Initialize(globalLayout_, materialLayout_, objectLayout_, iblLayout_,
              lightLayout_);
 }
 
+uint32_t PipelineManager::ReloadShader(const std::filesystem::path& path,
+                                       std::vector<uint32_t> spirv) {
+  std::filesystem::path changed = path.lexically_normal();
+  auto uses = [&changed](const std::string& shaderPath) {
+    return !shaderPath.empty() &&
+           std::filesystem::path{shaderPath}.lexically_normal() == changed;
+  };
+
+  std::vector<std::pair<PipelineType, PipelineConfig>> affected;
+  for (const auto& [type, config] : configs_) {
+    if (uses(config.vertexShaderPath) || uses(config.fragmentShaderPath)) {
+      affected.emplace_back(type, config);
+    }
+  }
+  if (affected.empty()) {
+    return 0;
+  }
+
+  for (const auto& [type, config] : affected) {
+    if (uses(config.vertexShaderPath)) {
+      reloadedShaders_[config.vertexShaderPath] = spirv;
+    }
+    if (uses(config.fragmentShaderPath)) {
+      reloadedShaders_[config.fragmentShaderPath] = spirv;
+    }
+  }
+
+  // Frames in flight may still be using the pipelines being replaced
+  device_.WaitIdle();
+  for (const auto& [type, config] : affected) {
+    CreatePipeline(type, config);
+  }
+  return static_cast<uint32_t>(affected.size());
+}
+
 }  // namespace renderer
@@ -1,12 +1,15 @@
 #pragma once
 
 #include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "ecs/components.hpp"
 #include "rhi/device.hpp"
 #include "rhi/factory.hpp"
 #include "rhi/pipeline.hpp"
@@ -15,6 +18,7 @@ namespace renderer {
 
 enum class PipelineType : uint8_t {
   PBRLit,
+  PBRLitNoEmissive,  // PBRLit for materials without emission
   Unlit,
   Wireframe,
   Skybox,
@@ -31,6 +35,7 @@ struct PipelineConfig {
   bool doubleSided{false};
   bool wireframe{false};
   bool blendEnabled{false};
+  ecs::VertexFormat vertexFormat{ecs::VertexFormat::Float};
 
   // Optional custom vertex layout (for skybox which only uses position)
   std::optional<std::vector<rhi::VertexBinding>> vertexBindings;
@@ -45,29 +50,58 @@ class PipelineManager {
                   rhi::DescriptorSetLayout* materialLayout,
                   rhi::DescriptorSetLayout* objectLayout,
                   rhi::DescriptorSetLayout* iblLayout,
-                  rhi::DescriptorSetLayout* lightLayout = nullptr);
+                  rhi::DescriptorSetLayout* lightLayout = nullptr,
+                  rhi::DescriptorSetLayout* virtualTextureLayout = nullptr);
 
-  [[nodiscard]] rhi::Pipeline* GetPipeline(PipelineType type);
+  [[nodiscard]] rhi::Pipeline* GetPipeline(
+      PipelineType type,
+      ecs::VertexFormat vertexFormat = ecs::VertexFormat::Float);
   [[nodiscard]] rhi::PipelineLayout* GetPipelineLayout() {
     return pipelineLayout_.get();
   }
 
   void RecreatePipelines();
 
+  /**
+   * @brief Rebuild the pipelines that use a shader, from new SPIR-V.
+   *
+   * Waits for the GPU to go idle before the pipelines are replaced. A
+   * pipeline that fails to build keeps its previous version. The code is
+   * kept for later rebuilds, such as on swapchain resize.
+   *
+   * @return Number of pipelines rebuilt
+   */
+  uint32_t ReloadShader(const std::filesystem::path& path,
+                        std::vector<uint32_t> spirv);
+
  private:
   void CreatePipeline(PipelineType type, const PipelineConfig& config);
+  // Reloaded code if there is any, otherwise the file at `path`
+  std::unique_ptr<rhi::Shader> CreateShader(const std::string& path,
+                                            rhi::ShaderStage stage);
+  // Compiled fragment shader `name`, or its variant that writes no texture
+  // feedback when the device cannot store from fragment shaders
+  [[nodiscard]] std::string GetFeedbackShaderPath(
+      const std::string& name) const;
 
   rhi::Factory& factory_;
   rhi::Device& device_;
 
   std::unique_ptr<rhi::PipelineLayout> pipelineLayout_;
   std::unordered_map<PipelineType, std::unique_ptr<rhi::Pipeline>> pipelines_;
+  // Mesh pipeline variants reading ecs::QuantizedVertex
+  std::unordered_map<PipelineType, std::unique_ptr<rhi::Pipeline>>
+      quantizedPipelines_;
+  // What each pipeline was created from, for reloading its shaders
+  std::vector<std::pair<PipelineType, PipelineConfig>> configs_;
+  std::unordered_map<std::string, std::vector<uint32_t>> reloadedShaders_;
 
   rhi::DescriptorSetLayout* globalLayout_{nullptr};
   rhi::DescriptorSetLayout* materialLayout_{nullptr};
   rhi::DescriptorSetLayout* objectLayout_{nullptr};
   rhi::DescriptorSetLayout* iblLayout_{nullptr};
   rhi::DescriptorSetLayout* lightLayout_{nullptr};
+  rhi::DescriptorSetLayout* virtualTextureLayout_{nullptr};
 };
 
 }  // namespace renderer
@@ -9,14 +9,40 @@
 
 namespace renderer {
 
-RenderContext::RenderContext(rhi::Device& device, rhi::Factory& factory)
+RenderContext::RenderContext(rhi::Device& device, rhi::Factory& factory,
+                             const RenderSettings& settings)
     : device_{device}, factory_{factory}, pipelineManager_{factory, device} {
   CreateDescriptors();
 
   // Initialize bindless material manager
-  bindlessMaterials_ = std::make_unique<BindlessMaterialManager>(factory_);
+  bindlessMaterials_ =
+      std::make_unique<BindlessMaterialManager>(factory_, kMaxFramesInFlight);
   bindlessMaterials_->Initialize();
 
+  // Mip streaming for bindless textures, fed back from pbr.frag when the
+  // device lets fragment shaders write it
+  TextureStreamingSettings streaming = settings.textureStreaming;
+  streaming.feedback = streaming.feedback &&
+                       device_.GetFeatures().fragmentStoresAndAtomics;
+  textureStreamer_ = std::make_unique<TextureStreamer>(
+      factory_, BindlessMaterialManager::kMaxTextures, kMaxFramesInFlight,
+      streaming);
+  bindlessMaterials_->SetTextureStreamer(textureStreamer_.get());
+
+  // Virtual texturing; set 5 exists even when it is off. Pages are picked
+  // from shader feedback, so it needs the same device support.
+  VirtualTextureSettings virtualTexturing = settings.virtualTexturing;
+  if (virtualTexturing.enabled &&
+      !device_.GetFeatures().fragmentStoresAndAtomics) {
+    LOG_WARNING("Virtual texturing needs fragment shader stores, disabled");
+    virtualTexturing.enabled = false;
+  }
+  virtualTextures_ = std::make_unique<VirtualTextureSystem>(
+      factory_, kMaxFramesInFlight, virtualTexturing);
+  if (virtualTextures_->IsEnabled()) {
+    bindlessMaterials_->SetVirtualTextures(virtualTextures_.get());
+  }
+
   // Initialize GPU culling
   gpuCulling_ = std::make_unique<GPUCulling>(factory_, device_);
   gpuCulling_->Initialize();
@@ -35,11 +61,13 @@ RenderContext::RenderContext(rhi::Device& device, rhi::Factory& factory)
   // set 2: object data SSBO
   // set 3: IBL (skybox, irradiance, prefiltered, BRDF LUT)
   // set 4: Forward+ lighting
+  // set 5: virtual textures
   pipelineManager_.Initialize(globalDescriptorLayout_.get(),
                               bindlessMaterials_->GetDescriptorLayout(),
                               gpuCulling_->GetObjectDescriptorLayout(),
                               skyboxIBL_->GetIBLDescriptorLayout(),
-                              forwardPlus_->GetLightDescriptorLayout());
+                              forwardPlus_->GetLightDescriptorLayout(),
+                              virtualTextures_->GetDescriptorLayout());
 
   CreateSyncObjects();
   CreateFrameResources();
@@ -61,7 +89,8 @@ void RenderContext::CreateSyncObjects() {
 }
 
 void RenderContext::CreateFrameResources() {
-  for (auto& frame : frames_) {
+  for (uint32_t i = 0; i < kMaxFramesInFlight; ++i) {
+    auto& frame = frames_[i];  // NOLINT
     frame.inFlightFence = factory_.CreateFence(true);
 
     frame.commandPool = factory_.CreateCommandPool(rhi::QueueType::Graphics);
@@ -76,13 +105,17 @@ void RenderContext::CreateFrameResources() {
 
     frame.globalDescriptorSet->BindBuffer(0, frame.globalUniformBuffer.get(), 0,
                                           sizeof(GlobalUniforms));
+    frame.globalDescriptorSet->BindStorageBuffer(
+        1, textureStreamer_->GetFeedbackBuffer(i));
   }
 }
 
 void RenderContext::CreateDescriptors() {
-  // Global descriptor layout (set 0) - just camera/lighting uniforms
-  std::array<rhi::DescriptorBinding, 1> globalBindings = {{
+  // Global descriptor layout (set 0) - camera/lighting uniforms and the
+  // texture streaming feedback written by pbr.frag
+  std::array<rhi::DescriptorBinding, 2> globalBindings = {{
       {.binding = 0, .type = rhi::DescriptorType::UniformBuffer, .count = 1},
+      {.binding = 1, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
   }};
   globalDescriptorLayout_ = factory_.CreateDescriptorSetLayout(globalBindings);
 }
@@ -103,6 +136,9 @@ void RenderContext::BeginFrame(uint32_t frameIndex) {
   frame.inFlightFence->Wait();
   frame.inFlightFence->Reset();
   frame.commandPool->Reset();
+
+  textureStreamer_->Update(currentFrame_);
+  virtualTextures_->Update(currentFrame_);
 }
 
 void RenderContext::EndFrame(uint32_t /*frameIndex*/) {}
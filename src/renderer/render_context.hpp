@@ -10,6 +10,8 @@
 #include "renderer/gpu_culling.hpp"
 #include "renderer/pipeline_manager.hpp"
 #include "renderer/skybox_ibl.hpp"
+#include "renderer/texture_streamer.hpp"
+#include "renderer/virtual_texture.hpp"
 #include "rhi/buffer.hpp"
 #include "rhi/command.hpp"
 #include "rhi/descriptor.hpp"
@@ -32,6 +34,11 @@ struct GlobalUniforms {
   alignas(4) float time;
 };
 
+struct RenderSettings {
+  TextureStreamingSettings textureStreaming;
+  VirtualTextureSettings virtualTexturing;
+};
+
 struct FrameData {
   std::unique_ptr<rhi::Fence> inFlightFence;
   std::unique_ptr<rhi::CommandPool> commandPool;
@@ -42,7 +49,8 @@ struct FrameData {
 
 class RenderContext {
  public:
-  RenderContext(rhi::Device& device, rhi::Factory& factory);
+  RenderContext(rhi::Device& device, rhi::Factory& factory,
+                const RenderSettings& settings = {});
 
   void BeginFrame(uint32_t frameIndex);
   void EndFrame(uint32_t frameIndex);
@@ -67,8 +75,10 @@ class RenderContext {
   [[nodiscard]] PipelineManager& GetPipelineManager() {
     return pipelineManager_;
   }
-  [[nodiscard]] rhi::Pipeline* GetPipeline(PipelineType type) {
-    return pipelineManager_.GetPipeline(type);
+  [[nodiscard]] rhi::Pipeline* GetPipeline(
+      PipelineType type,
+      ecs::VertexFormat vertexFormat = ecs::VertexFormat::Float) {
+    return pipelineManager_.GetPipeline(type, vertexFormat);
   }
   [[nodiscard]] rhi::PipelineLayout* GetPipelineLayout() {
     return pipelineManager_.GetPipelineLayout();
@@ -90,6 +100,14 @@ class RenderContext {
     return *bindlessMaterials_;
   }
 
+  [[nodiscard]] TextureStreamer& GetTextureStreamer() {
+    return *textureStreamer_;
+  }
+
+  [[nodiscard]] VirtualTextureSystem& GetVirtualTextures() {
+    return *virtualTextures_;
+  }
+
   [[nodiscard]] SkyboxIBL& GetSkyboxIBL() { return *skyboxIBL_; }
 
   // Forward+ Lighting
@@ -118,6 +136,8 @@ class RenderContext {
   // GPU Systems
   std::unique_ptr<GPUCulling> gpuCulling_;
   std::unique_ptr<BindlessMaterialManager> bindlessMaterials_;
+  std::unique_ptr<TextureStreamer> textureStreamer_;
+  std::unique_ptr<VirtualTextureSystem> virtualTextures_;
   std::unique_ptr<ForwardPlus> forwardPlus_;
 
   PipelineManager pipelineManager_;
@@ -1,16 +1,27 @@
 #include "renderer/render_system.hpp"
 
+#include <algorithm>
 #include <cmath>
-#include <unordered_set>
+#include <filesystem>
+#include <numeric>
+#include <optional>
+#include <tuple>
 
 #include "logger.hpp"
 
 namespace renderer {
 
-RenderSystem::RenderSystem(rhi::Device& device, rhi::Factory& factory)
-    : device_{device}, factory_{factory}, context_{device, factory} {
-  if (!context_.GetSkyboxIBL().LoadHDREnvironment(
-          "assets/textures/skybox.hdr")) {
+RenderSystem::RenderSystem(rhi::Device& device, rhi::Factory& factory,
+                           const RenderSettings& settings)
+    : device_{device},
+      factory_{factory},
+      context_{device, factory, settings} {
+  // A cooked KTX2 cubemap skips the equirectangular conversion
+  const char* skyboxPath =
+      std::filesystem::exists("assets/textures/skybox.ktx2")
+          ? "assets/textures/skybox.ktx2"
+          : "assets/textures/skybox.hdr";
+  if (!context_.GetSkyboxIBL().LoadHDREnvironment(skyboxPath)) {
     LOG_ERROR("Failed to load HDR environment map for skybox IBL.");
   }
 
@@ -200,42 +211,335 @@ void RenderSystem::CollectLights(entt::registry& registry) {
   context_.GetForwardPlus().UpdateLights(lightCache_);
 }
 
+std::optional<uint32_t> RenderSystem::AddInstanceTable(
+    const std::shared_ptr<const std::vector<glm::mat4>>& transforms,
+    const glm::mat4& dequantization) {
+  auto [it, inserted] =
+      instanceTableLookup_.try_emplace(transforms.get(), instanceCount_);
+  if (inserted) {
+    auto maxInstances = context_.GetGPUCulling().GetMaxInstances();
+    if (transforms->size() > maxInstances - instanceCount_) {
+      LOG_WARNING("Instance table of {} entries exceeds max {}",
+                  transforms->size(), maxInstances);
+      instanceTableLookup_.erase(it);
+      return std::nullopt;
+    }
+    instanceTables_.push_back(
+        {.transforms = transforms, .dequantization = dequantization});
+    instanceCount_ += static_cast<uint32_t>(transforms->size());
+  }
+  return it->second;
+}
+
 void RenderSystem::BuildObjectDataForCulling(entt::registry& registry) {
-  objectDataCache_.clear();
+  // Resident objects stay at the front of the caches; the rest is rebuilt
+  TruncateToResident();
+  instanceTables_.clear();
+  instanceTableLookup_.clear();
+  instanceCount_ = 0;
 
   auto view =
       registry.view<ecs::MeshComponent, ecs::WorldTransformComponent,
-                    ecs::RenderableComponent, ecs::BoundingBoxComponent>();
+                    ecs::RenderableComponent, ecs::BoundingBoxComponent>(
+          entt::exclude<ecs::ResidentDrawTag>);
 
   for (auto entity : view) {
-    auto& mesh = view.get<ecs::MeshComponent>(entity);
-    auto& world = view.get<ecs::WorldTransformComponent>(entity);
-    auto& bounds = view.get<ecs::BoundingBoxComponent>(entity);
+    CollectObjects(view.get<ecs::MeshComponent>(entity),
+                   view.get<ecs::WorldTransformComponent>(entity),
+                   view.get<ecs::BoundingBoxComponent>(entity),
+                   registry.try_get<ecs::MeshInstancesComponent>(entity));
+  }
 
-    if (!mesh.vertexBuffer || !mesh.indexBuffer) {
+  // The instance table is uploaded only when the tables in use change
+  auto& culling = context_.GetGPUCulling();
+  if (instanceTables_ != uploadedInstanceTables_) {
+    instanceDataCache_.clear();
+    instanceDataCache_.reserve(instanceCount_);
+    for (const auto& table : instanceTables_) {
+      for (const auto& transform : *table.transforms) {
+        instanceDataCache_.push_back({
+            .model = transform * table.dequantization,
+            .normalMatrix = glm::transpose(glm::inverse(transform)),
+        });
+      }
+    }
+    culling.UpdateInstances(instanceDataCache_);
+    uploadedInstanceTables_ = instanceTables_;
+  }
+
+  uint32_t itemCount = resident_.itemCount;
+  LayoutBatches(itemCount);
+
+  culling.UpdateObjects(objectDataCache_, drawGroupCache_, drawBatchCache_,
+                        itemCount, uploadedResidentObjects_,
+                        uploadedResidentGroups_);
+  // As much of the resident range as fit is on the GPU now
+  uploadedResidentObjects_ =
+      std::min(resident_.objectCount, culling.GetObjectCount());
+  uploadedResidentGroups_ =
+      std::min(resident_.groupCount, culling.GetGroupCount());
+}
+
+void RenderSystem::TruncateToResident() {
+  objectDataCache_.resize(resident_.objectCount);
+  drawGroupCache_.resize(resident_.groupCount);
+  drawBatchCache_.resize(resident_.batchCount);
+  unsortedBatchCache_.clear();
+  batchLookup_.clear();
+  for (auto& objects : batchObjectsCache_) {
+    objects.clear();
+  }
+}
+
+void RenderSystem::CollectObjects(
+    const ecs::MeshComponent& mesh, const ecs::WorldTransformComponent& world,
+    const ecs::BoundingBoxComponent& bounds,
+    const ecs::MeshInstancesComponent* instances) {
+  if (!mesh.vertexBuffer || !mesh.indexBuffer) {
+    return;
+  }
+
+  glm::vec3 center = bounds.GetCenter();
+  glm::vec3 extents = bounds.GetExtents();
+  float radius = glm::length(extents);
+  glm::mat4 normalMatrix = glm::transpose(glm::inverse(world.matrix));
+  // Quantized positions are expanded to mesh space by the vertex shader's
+  // model transform; normals only ever see the world transform
+  glm::mat4 model = world.matrix * mesh.positionDequantization;
+  if (mesh.vertexFormat == ecs::VertexFormat::Quantized) {
+    // The culling shader applies the model matrix to the sphere as well, so
+    // move it into quantized space. Dividing by the smallest axis scale
+    // keeps the radius conservative under the non-uniform dequantization.
+    const auto& deq = mesh.positionDequantization;
+    glm::vec3 scale{deq[0][0], deq[1][1], deq[2][2]};
+    center = (center - glm::vec3(deq[3])) / scale;
+    radius /= std::min({scale.x, scale.y, scale.z});
+  }
+
+  // Table instances go between the world transform and the
+  // dequantization, which their uploaded matrices carry instead
+  uint32_t firstInstance = kNoInstances;
+  uint32_t itemCount = 1;
+  if (instances != nullptr && instances->transforms &&
+      !instances->transforms->empty()) {
+    auto offset =
+        AddInstanceTable(instances->transforms, mesh.positionDequantization);
+    if (!offset) {
+      return;
+    }
+    firstInstance = *offset;
+    itemCount = static_cast<uint32_t>(instances->transforms->size());
+    model = world.matrix;
+  }
+
+  const auto& materials = context_.GetBindlessMaterials();
+  for (const auto& submesh : mesh.subMeshes) {
+    // Group by vertex buffer and shader variant; the index buffer, index
+    // width and vertex format come with the vertex buffer
+    bool emissive = materials.IsEmissive(submesh.materialIndex);
+    auto [it, inserted] = batchLookup_.try_emplace(
+        BatchKey{.vertexBuffer = mesh.vertexBuffer.get(),
+                 .emissive = emissive},
+        static_cast<uint32_t>(unsortedBatchCache_.size()));
+    if (inserted) {
+      unsortedBatchCache_.push_back(DrawBatch{
+          .vertexBuffer = mesh.vertexBuffer.get(),
+          .indexBuffer = mesh.indexBuffer.get(),
+          .indexType = mesh.indexType,
+          .vertexFormat = mesh.vertexFormat,
+          .emissive = emissive,
+      });
+      if (batchObjectsCache_.size() < unsortedBatchCache_.size()) {
+        batchObjectsCache_.emplace_back();
+      }
+    }
+
+    PendingObject pending{};
+    pending.object.model = model;
+    pending.object.normalMatrix = normalMatrix;
+    pending.object.boundingSphere = glm::vec4(center, radius);
+    pending.object.materialIndex =
+        submesh.materialIndex;  // Now references bindless material
+    pending.indexCount = submesh.indexCount;
+    pending.indexOffset = submesh.indexOffset;
+    pending.vertexOffset = static_cast<int32_t>(submesh.vertexOffset);
+    pending.object.firstInstance = firstInstance;
+    pending.itemCount = itemCount;
+
+    batchObjectsCache_[it->second].push_back(pending);
+  }
+}
+
+void RenderSystem::LayoutBatches(uint32_t& itemCount) {
+  // Order batches by vertex format and shader variant (one pipeline bind
+  // each), then by index width so 16-bit and 32-bit draws stay together
+  batchOrder_.resize(unsortedBatchCache_.size());
+  std::iota(batchOrder_.begin(), batchOrder_.end(), 0U);
+  std::ranges::stable_sort(batchOrder_, [this](uint32_t a, uint32_t b) {
+    const auto& lhs = unsortedBatchCache_[a];
+    const auto& rhs = unsortedBatchCache_[b];
+    return std::tie(lhs.vertexFormat, lhs.emissive, lhs.indexType) <
+           std::tie(rhs.vertexFormat, rhs.emissive, rhs.indexType);
+  });
+
+  for (uint32_t unsortedIndex : batchOrder_) {
+    auto& batchObjects = batchObjectsCache_[unsortedIndex];
+    if (batchObjects.empty()) {
       continue;
     }
 
-    glm::vec3 center = bounds.GetCenter();
-    glm::vec3 extents = bounds.GetExtents();
-    float radius = glm::length(extents);
-
-    for (const auto& submesh : mesh.subMeshes) {
-      ObjectData objData{};
-      objData.model = world.matrix;
-      objData.normalMatrix = glm::transpose(glm::inverse(world.matrix));
-      objData.boundingSphere = glm::vec4(center, radius);
-      objData.materialIndex =
-          submesh.materialIndex;  // Now references bindless material
-      objData.indexCount = submesh.indexCount;
-      objData.indexOffset = submesh.indexOffset;
-      objData.vertexOffset = static_cast<int32_t>(submesh.vertexOffset);
+    // Objects drawing the same index range become instances of one draw,
+    // whatever their transform and material
+    auto geometry = [](const PendingObject& pending) {
+      return std::tie(pending.indexOffset, pending.indexCount,
+                      pending.vertexOffset);
+    };
+    std::ranges::sort(batchObjects, {}, geometry);
+
+    DrawBatch batch = unsortedBatchCache_[unsortedIndex];
+    batch.firstObject = static_cast<uint32_t>(objectDataCache_.size());
+    batch.objectCount = static_cast<uint32_t>(batchObjects.size());
+    batch.firstGroup = static_cast<uint32_t>(drawGroupCache_.size());
+
+    auto batchIndex = static_cast<uint32_t>(drawBatchCache_.size());
+    for (size_t i = 0; i < batchObjects.size(); ++i) {
+      const auto& pending = batchObjects[i];
+      if (i == 0 || geometry(pending) != geometry(batchObjects[i - 1])) {
+        drawGroupCache_.push_back(DrawGroup{
+            .indexCount = pending.indexCount,
+            .indexOffset = pending.indexOffset,
+            .vertexOffset = pending.vertexOffset,
+            .firstObject = static_cast<uint32_t>(objectDataCache_.size()),
+            .firstSlot = itemCount,
+            .drawBatch = batchIndex,
+            .drawSlotBase = batch.firstGroup,
+            ._padding = 0,
+        });
+      }
 
+      ObjectData objData = pending.object;
+      objData.drawGroup = static_cast<uint32_t>(drawGroupCache_.size() - 1);
+      objData.firstSlot = drawGroupCache_.back().firstSlot;
+      objData.firstItem = itemCount;
+      itemCount += pending.itemCount;
       objectDataCache_.push_back(objData);
     }
+    batch.groupCount =
+        static_cast<uint32_t>(drawGroupCache_.size()) - batch.firstGroup;
+    drawBatchCache_.push_back(batch);
   }
+}
+
+uint32_t RenderSystem::AddResidentObjects(
+    entt::registry& registry, std::span<const entt::entity> entities) {
+  // The segment goes where this frame's per-frame objects were; the next
+  // frame lays those out behind it again
+  TruncateToResident();
+
+  ResidentSegment segment{
+      .id = nextResidentId_++,
+      .range = {},
+      .first = resident_,
+      .entities = {},
+  };
+  segment.entities.reserve(entities.size());
+  for (auto entity : entities) {
+    // Instance tables are shared and uploaded per frame, so entities using
+    // them stay on the per-frame path
+    if (!registry.all_of<ecs::MeshComponent, ecs::WorldTransformComponent,
+                         ecs::RenderableComponent,
+                         ecs::BoundingBoxComponent>(entity) ||
+        registry.all_of<ecs::MeshInstancesComponent>(entity)) {
+      continue;
+    }
+    CollectObjects(registry.get<ecs::MeshComponent>(entity),
+                   registry.get<ecs::WorldTransformComponent>(entity),
+                   registry.get<ecs::BoundingBoxComponent>(entity), nullptr);
+    segment.entities.push_back(entity);
+  }
+  registry.insert<ecs::ResidentDrawTag>(segment.entities.begin(),
+                                        segment.entities.end());
 
-  context_.GetGPUCulling().UpdateObjects(objectDataCache_);
+  uint32_t itemCount = resident_.itemCount;
+  LayoutBatches(itemCount);
+
+  resident_ = {
+      .objectCount = static_cast<uint32_t>(objectDataCache_.size()),
+      .groupCount = static_cast<uint32_t>(drawGroupCache_.size()),
+      .batchCount = static_cast<uint32_t>(drawBatchCache_.size()),
+      .itemCount = itemCount,
+  };
+  segment.range = {
+      .objectCount = resident_.objectCount - segment.first.objectCount,
+      .groupCount = resident_.groupCount - segment.first.groupCount,
+      .batchCount = resident_.batchCount - segment.first.batchCount,
+      .itemCount = resident_.itemCount - segment.first.itemCount,
+  };
+
+  uint32_t id = segment.id;
+  residentSegments_.push_back(std::move(segment));
+  return id;
+}
+
+void RenderSystem::RemoveResidentObjects(entt::registry& registry,
+                                         uint32_t id) {
+  auto it = std::ranges::find(residentSegments_, id, &ResidentSegment::id);
+  if (it == residentSegments_.end()) {
+    return;
+  }
+  for (auto entity : it->entities) {
+    if (registry.valid(entity)) {
+      registry.remove<ecs::ResidentDrawTag>(entity);
+    }
+  }
+
+  // Later segments move down into the gap, and the indices they hold into
+  // the object, group, batch and item ranges shift with them
+  TruncateToResident();
+  const ResidentCounts first = it->first;
+  const ResidentCounts range = it->range;
+  auto erase = [](auto& cache, uint32_t begin, uint32_t count) {
+    cache.erase(cache.begin() + begin, cache.begin() + begin + count);
+  };
+  erase(objectDataCache_, first.objectCount, range.objectCount);
+  erase(drawGroupCache_, first.groupCount, range.groupCount);
+  erase(drawBatchCache_, first.batchCount, range.batchCount);
+
+  for (size_t i = first.objectCount; i < objectDataCache_.size(); ++i) {
+    auto& object = objectDataCache_[i];
+    object.drawGroup -= range.groupCount;
+    object.firstSlot -= range.itemCount;
+    object.firstItem -= range.itemCount;
+  }
+  for (size_t i = first.groupCount; i < drawGroupCache_.size(); ++i) {
+    auto& group = drawGroupCache_[i];
+    group.firstObject -= range.objectCount;
+    group.firstSlot -= range.itemCount;
+    group.drawBatch -= range.batchCount;
+    group.drawSlotBase -= range.groupCount;
+  }
+  for (size_t i = first.batchCount; i < drawBatchCache_.size(); ++i) {
+    auto& batch = drawBatchCache_[i];
+    batch.firstObject -= range.objectCount;
+    batch.firstGroup -= range.groupCount;
+  }
+  for (auto later = std::next(it); later != residentSegments_.end();
+       ++later) {
+    later->first.objectCount -= range.objectCount;
+    later->first.groupCount -= range.groupCount;
+    later->first.batchCount -= range.batchCount;
+    later->first.itemCount -= range.itemCount;
+  }
+  resident_.objectCount -= range.objectCount;
+  resident_.groupCount -= range.groupCount;
+  resident_.batchCount -= range.batchCount;
+  resident_.itemCount -= range.itemCount;
+
+  // Only what moved is uploaded again
+  uploadedResidentObjects_ =
+      std::min(uploadedResidentObjects_, first.objectCount);
+  uploadedResidentGroups_ = std::min(uploadedResidentGroups_, first.groupCount);
+  residentSegments_.erase(it);
 }
 
 void RenderSystem::ExecuteGPUDrivenRendering(entt::registry& registry,
@@ -250,6 +554,13 @@ void RenderSystem::ExecuteGPUDrivenRendering(entt::registry& registry,
 
   cmd->Begin();
 
+  // Streamed mip levels are uploaded first, then this frame's texture slots
+  // pick up the textures they went into
+  auto& materials = context_.GetBindlessMaterials();
+  context_.GetTextureStreamer().RecordUploads(*cmd, context_.GetFrameIndex(),
+                                              materials);
+  materials.UpdateDescriptorSet(context_.GetFrameIndex());
+
   // Reset draw count and execute GPU culling
   context_.GetGPUCulling().ResetDrawCount(cmd);
   context_.GetGPUCulling().Execute(cmd);
@@ -257,6 +568,8 @@ void RenderSystem::ExecuteGPUDrivenRendering(entt::registry& registry,
   // Execute Forward+ light culling
   context_.GetForwardPlus().ExecuteLightCulling(cmd);
 
+  context_.GetVirtualTextures().ResetFeedback(cmd);
+
   cmd->TransitionTexture(swapchainImage, rhi::ImageLayout::Undefined,
                          rhi::ImageLayout::ColorAttachment);
   cmd->TransitionTexture(depthTexture, rhi::ImageLayout::Undefined,
@@ -294,9 +607,11 @@ void RenderSystem::ExecuteGPUDrivenRendering(entt::registry& registry,
   cmd->SetScissor(0, 0, swapchain->GetWidth(), swapchain->GetHeight());
 
   // Render geometry FIRST
-  auto* pipeline = context_.GetPipeline(activePipeline_);
+  PipelineType pipelineType = activePipeline_;
+  auto* pipeline = context_.GetPipeline(pipelineType);
   if (pipeline == nullptr) {
-    pipeline = context_.GetPipeline(PipelineType::PBRLit);
+    pipelineType = PipelineType::PBRLit;
+    pipeline = context_.GetPipeline(pipelineType);
   }
 
   if (pipeline != nullptr && context_.GetGPUCulling().GetObjectCount() > 0) {
@@ -310,7 +625,8 @@ void RenderSystem::ExecuteGPUDrivenRendering(entt::registry& registry,
 
     // Set 1: Bindless materials
     std::array<const rhi::DescriptorSet*, 1> materialSets = {
-        context_.GetBindlessMaterials().GetDescriptorSet()};
+        context_.GetBindlessMaterials().GetDescriptorSet(
+            context_.GetFrameIndex())};
     cmd->BindDescriptorSets(pipeline, 1, materialSets);
 
     // Set 2: Object data SSBO
@@ -328,34 +644,51 @@ void RenderSystem::ExecuteGPUDrivenRendering(entt::registry& registry,
         context_.GetForwardPlus().GetLightDescriptorSet()};
     cmd->BindDescriptorSets(pipeline, 4, lightSets);
 
-    // Bind mesh buffers and issue indirect draw
-    auto view = registry.view<ecs::MeshComponent>();
-    std::unordered_set<rhi::Buffer*> processedBuffers;
+    // Set 5: Virtual textures
+    std::array<const rhi::DescriptorSet*, 1> virtualTextureSets = {
+        context_.GetVirtualTextures().GetDescriptorSet()};
+    cmd->BindDescriptorSets(pipeline, 5, virtualTextureSets);
 
-    for (auto entity : view) {
-      auto& mesh = view.get<ecs::MeshComponent>(entity);
+    // Bind mesh buffers and issue one indirect draw per batch, reading the
+    // batch's draw count written by the culling pass. Each draw instances
+    // the visible objects of one group.
+    auto& culling = context_.GetGPUCulling();
+    const auto batches = culling.GetDrawBatches();
 
-      if (!mesh.vertexBuffer || !mesh.indexBuffer) {
-        continue;
-      }
+    auto boundFormat = ecs::VertexFormat::Float;
+    PipelineType boundType = pipelineType;
+
+    for (uint32_t batchIndex = 0; batchIndex < batches.size(); ++batchIndex) {
+      const auto& batch = batches[batchIndex];
 
-      if (processedBuffers.contains(mesh.vertexBuffer.get())) {
-        continue;
+      PipelineType batchType = pipelineType;
+      if (pipelineType == PipelineType::PBRLit && !batch.emissive) {
+        batchType = PipelineType::PBRLitNoEmissive;
+      }
+      if (batch.vertexFormat != boundFormat || batchType != boundType) {
+        auto* variant = context_.GetPipeline(batchType, batch.vertexFormat);
+        if (variant == nullptr) {
+          variant = context_.GetPipeline(pipelineType, batch.vertexFormat);
+        }
+        if (variant == nullptr) {
+          continue;
+        }
+        cmd->BindPipeline(variant);
+        boundFormat = batch.vertexFormat;
+        boundType = batchType;
       }
-      processedBuffers.insert(mesh.vertexBuffer.get());
 
-      std::array<const rhi::Buffer*, 1> vertexBuffers = {
-          mesh.vertexBuffer.get()};
+      std::array<const rhi::Buffer*, 1> vertexBuffers = {batch.vertexBuffer};
       std::array<uint64_t, 1> offsets = {0};
       cmd->BindVertexBuffers(0, vertexBuffers, offsets);
-      cmd->BindIndexBuffer(*mesh.indexBuffer, 0, true);
+      cmd->BindIndexBuffer(*batch.indexBuffer, 0,
+                           batch.indexType == rhi::IndexType::Uint32);
 
-      // Single indirect draw with count from GPU
       cmd->DrawIndexedIndirectCount(
-          context_.GetGPUCulling().GetDrawCommandBuffer(), 0,
-          context_.GetGPUCulling().GetDrawCountBuffer(), 0,
-          context_.GetGPUCulling().GetMaxDrawCount(),
-          sizeof(DrawIndexedIndirectCommand));
+          culling.GetDrawCommandBuffer(),
+          sizeof(DrawIndexedIndirectCommand) * batch.firstGroup,
+          culling.GetDrawCountBuffer(), sizeof(uint32_t) * batchIndex,
+          batch.groupCount, sizeof(DrawIndexedIndirectCommand));
     }
   }
 
@@ -388,6 +721,10 @@ void RenderSystem::ExecuteGPUDrivenRendering(entt::registry& registry,
 
   cmd->EndRendering();
 
+  // Turn this frame's virtual texture feedback into page requests
+  context_.GetVirtualTextures().CompactFeedback(
+      cmd, context_.GetFrameIndex(), swapchain->GetHeight());
+
   cmd->TransitionTexture(swapchainImage, rhi::ImageLayout::ColorAttachment,
                          rhi::ImageLayout::Present);
 }
@@ -1,5 +1,13 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
 #include <entt/entt.hpp>
 
 #include "ecs/components.hpp"
@@ -12,7 +20,8 @@ namespace renderer {
 
 class RenderSystem {
  public:
-  RenderSystem(rhi::Device& device, rhi::Factory& factory);
+  RenderSystem(rhi::Device& device, rhi::Factory& factory,
+               const RenderSettings& settings = {});
 
   void Render(entt::registry& registry, float deltaTime);
 
@@ -25,9 +34,103 @@ class RenderSystem {
 
   [[nodiscard]] RenderContext& GetContext() { return context_; }
 
+  // Frames submitted so far, and how many of them the GPU has finished
+  [[nodiscard]] uint64_t GetSubmittedFrameCount() const {
+    return frameCounter_;
+  }
+  [[nodiscard]] uint64_t GetCompletedFrameCount() const {
+    return frameCounter_ > kMaxFramesInFlight
+               ? frameCounter_ - kMaxFramesInFlight
+               : 0;
+  }
+
+  /**
+   * @brief Keep the object data of static entities in the culling buffers.
+   *
+   * The entities' draws are laid out once and uploaded with the next frame;
+   * later frames upload only the objects that are rebuilt every frame.
+   * Entities are tagged with ecs::ResidentDrawTag and skipped by the
+   * per-frame pass, so changes to them are not picked up until they are
+   * removed. Entities without a mesh, bounds or world transform, and ones
+   * with instance tables, are left to the per-frame pass.
+   *
+   * @return Identifier of the entities' segment for RemoveResidentObjects
+   */
+  uint32_t AddResidentObjects(entt::registry& registry,
+                              std::span<const entt::entity> entities);
+
+  /**
+   * @brief Drop a segment added by AddResidentObjects.
+   *
+   * Entities of the segment that are still alive go back to the per-frame
+   * pass. Segments added after it move down, so their objects are uploaded
+   * again.
+   */
+  void RemoveResidentObjects(entt::registry& registry, uint32_t id);
+
  private:
+  // Draws are batched per vertex buffer and fragment shader variant
+  struct BatchKey {
+    const rhi::Buffer* vertexBuffer{nullptr};
+    bool emissive{true};
+
+    bool operator==(const BatchKey&) const = default;
+  };
+  struct BatchKeyHash {
+    size_t operator()(const BatchKey& key) const {
+      return std::hash<const rhi::Buffer*>{}(key.vertexBuffer) ^
+             static_cast<size_t>(key.emissive);
+    }
+  };
+
+  // Object of a batch before it is placed in its draw group
+  struct PendingObject {
+    ObjectData object{};
+    uint32_t indexCount{0};
+    uint32_t indexOffset{0};
+    int32_t vertexOffset{0};
+    uint32_t itemCount{1};  // Instances culled for it
+  };
+
+  // Transforms of an ecs::MeshInstancesComponent, uploaded for one mesh
+  struct InstanceTable {
+    std::shared_ptr<const std::vector<glm::mat4>> transforms;
+    glm::mat4 dequantization{1.0F};
+
+    bool operator==(const InstanceTable&) const = default;
+  };
+
+  // Sizes of the resident prefix of the caches, or of a segment in it
+  struct ResidentCounts {
+    uint32_t objectCount{0};
+    uint32_t groupCount{0};
+    uint32_t batchCount{0};
+    uint32_t itemCount{0};
+  };
+  struct ResidentSegment {
+    uint32_t id{0};
+    ResidentCounts range;
+    ResidentCounts first;  // Where the segment starts
+    std::vector<entt::entity> entities;
+  };
+
   void UpdateTransforms(entt::registry& registry);
   void BuildObjectDataForCulling(entt::registry& registry);
+  // Drop everything but the resident objects, groups and batches
+  void TruncateToResident();
+  // Add the draws of one mesh to the batches being collected
+  void CollectObjects(const ecs::MeshComponent& mesh,
+                      const ecs::WorldTransformComponent& world,
+                      const ecs::BoundingBoxComponent& bounds,
+                      const ecs::MeshInstancesComponent* instances);
+  // Append the collected batches to the caches; `itemCount` is where their
+  // items start and is advanced past them
+  void LayoutBatches(uint32_t& itemCount);
+  // Offset of a table in this frame's instance table, or nullopt if it does
+  // not fit
+  std::optional<uint32_t> AddInstanceTable(
+      const std::shared_ptr<const std::vector<glm::mat4>>& transforms,
+      const glm::mat4& dequantization);
   void CollectLights(entt::registry& registry);
   void ExecuteGPUDrivenRendering(entt::registry& registry, uint32_t imageIndex);
 
@@ -41,6 +144,24 @@ class RenderSystem {
   ecs::CameraComponent* activeCamera_{nullptr};
 
   std::vector<ObjectData> objectDataCache_;
+  std::vector<DrawGroup> drawGroupCache_;
+  std::vector<DrawBatch> drawBatchCache_;
+  std::vector<DrawBatch> unsortedBatchCache_;
+  std::vector<std::vector<PendingObject>> batchObjectsCache_;
+  std::vector<uint32_t> batchOrder_;
+  std::unordered_map<BatchKey, uint32_t, BatchKeyHash> batchLookup_;
+  std::vector<InstanceTable> instanceTables_;
+  std::vector<InstanceTable> uploadedInstanceTables_;
+  std::unordered_map<const std::vector<glm::mat4>*, uint32_t>
+      instanceTableLookup_;
+  std::vector<InstanceData> instanceDataCache_;
+  uint32_t instanceCount_{0};
+  ResidentCounts resident_;
+  std::vector<ResidentSegment> residentSegments_;
+  uint32_t nextResidentId_{0};
+  // Resident objects and groups the culling buffers already hold
+  uint32_t uploadedResidentObjects_{0};
+  uint32_t uploadedResidentGroups_{0};
   std::vector<GPULight> lightCache_;
 
   // Camera parameters for Forward+
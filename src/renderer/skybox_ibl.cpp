@@ -4,15 +4,19 @@
 #include <cmath>
 #include <cstddef>
 #include <cstring>
+#include <filesystem>
 #include <numbers>
+#include <vector>
 
 #include <glm/glm.hpp>
 
+#include "io/mapped_file.hpp"
 #include "logger.hpp"
 #include "renderer/cube_mesh.hpp"
+#include "resource/ktx2.hpp"
 
 // NOLINTBEGIN
-// stb_image is already included in model_loader.cpp, so just declare the
+// stb_image is already included in model_importer.cpp, so just declare the
 // functions
 extern "C" {
 float* stbi_loadf(const char* filename, int* x, int* y, int* comp,
@@ -277,6 +281,10 @@ void SkyboxIBL::CreateIBLDescriptorSet() {
 }
 
 bool SkyboxIBL::LoadHDREnvironment(const std::string& hdrPath) {
+  if (std::filesystem::path{hdrPath}.extension() == ".ktx2") {
+    return LoadKtx2Environment(hdrPath);
+  }
+
   int width = 0;
   int height = 0;
   int channels = 0;
@@ -404,4 +412,45 @@ bool SkyboxIBL::LoadHDREnvironment(const std::string& hdrPath) {
            hdrPath);
   return true;
 }
+
+bool SkyboxIBL::LoadKtx2Environment(const std::string& ktxPath) {
+  auto file = io::MappedFile::Open(ktxPath);
+  if (!file) {
+    LOG_WARNING("Failed to map KTX2 environment: {}", ktxPath);
+    return false;
+  }
+
+  auto ktx = resource::ParseKtx2(file->GetData());
+  if (!ktx || ktx->faceCount != 6 || ktx->width != ktx->height) {
+    LOG_WARNING("Not a KTX2 cubemap: {}", ktxPath);
+    return false;
+  }
+
+  // Prebuilt levels and faces go from the mapping to staging in one upload
+  skyboxCubemap_ =
+      factory_.CreateCubemap(ktx->width, ktx->format,
+                             rhi::TextureUsage::Sampled, ktx->mipLevels);
+
+  std::vector<rhi::TextureSubresourceData> subresources;
+  subresources.reserve(static_cast<size_t>(ktx->mipLevels) * 6);
+  for (uint32_t level = 0; level < ktx->mipLevels; ++level) {
+    for (uint32_t face = 0; face < 6; ++face) {
+      subresources.push_back({
+          .data = ktx->GetImage(level, 0, face),
+          .mipLevel = level,
+          .arrayLayer = face,
+      });
+    }
+  }
+  skyboxCubemap_->UploadSubresources(subresources);
+
+  // Regenerate IBL maps from the new skybox
+  GenerateIrradianceMap();
+  GeneratePrefilteredMap();
+  CreateIBLDescriptorSet();
+
+  LOG_INFO("Loaded KTX2 cubemap ({}x{}, {} mips) from {}", ktx->width,
+           ktx->width, ktx->mipLevels, ktxPath);
+  return true;
+}
 }  // namespace renderer
@@ -28,6 +28,10 @@ class SkyboxIBL {
     return iblDescriptorLayout_.get();
   }
 
+  /**
+   * @brief Load an equirectangular .hdr, or a KTX2 cubemap with prebuilt
+   * mips when the path ends in .ktx2.
+   */
   [[nodiscard]] bool LoadHDREnvironment(const std::string& hdrPath);
 
   [[nodiscard]] bool IsLoaded() const { return skyboxCubemap_ != nullptr; }
@@ -44,6 +48,7 @@ class SkyboxIBL {
   [[nodiscard]] uint32_t GetCubeIndexCount() const { return cubeIndexCount_; }
 
  private:
+  [[nodiscard]] bool LoadKtx2Environment(const std::string& ktxPath);
   void CreateDefaultSkybox();
   void GenerateIrradianceMap();
   void GeneratePrefilteredMap();
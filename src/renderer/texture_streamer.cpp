@@ -0,0 +1,308 @@
+#include "renderer/texture_streamer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <utility>
+
+#include "logger.hpp"
+#include "renderer/bindless_materials.hpp"
+
+namespace renderer {
+namespace {
+// The finest level whose resolution covers what pbr.frag asked for
+uint32_t GetWantedMip(const resource::TextureMipChain& chain, uint32_t tailMip,
+                      uint32_t feedback) {
+  float wanted =
+      static_cast<float>(feedback) / TextureStreamer::kFeedbackScale;
+  float full =
+      std::log2(static_cast<float>(std::max(chain.width, chain.height)));
+  float mip = std::floor(full - wanted);
+  return static_cast<uint32_t>(
+      std::clamp(mip, 0.0F, static_cast<float>(tailMip)));
+}
+}  // namespace
+
+TextureStreamer::TextureStreamer(rhi::Factory& factory, uint32_t maxTextures,
+                                 uint32_t framesInFlight,
+                                 TextureStreamingSettings settings)
+    : factory_{factory},
+      settings_{settings},
+      stagingBuffers_(framesInFlight),
+      textures_(maxTextures) {
+  for (uint32_t i = 0; i < framesInFlight; ++i) {
+    auto buffer = factory_.CreateBuffer(sizeof(uint32_t) * maxTextures,
+                                        rhi::BufferUsage::Storage,
+                                        rhi::MemoryUsage::GPUToCPU);
+    std::memset(buffer->Map(), 0, sizeof(uint32_t) * maxTextures);
+    buffer->Unmap();
+    feedbackBuffers_.push_back(std::move(buffer));
+  }
+
+  worker_ = std::jthread{[this](const std::stop_token& stop) { Run(stop); }};
+
+  LOG_INFO("Texture streamer initialized ({} MiB budget)",
+           settings_.budgetBytes >> 20);
+}
+
+TextureStreamer::~TextureStreamer() = default;
+
+uint64_t TextureStreamer::GetChainSize(const resource::TextureMipChain& chain,
+                                       uint32_t firstMip) {
+  uint64_t size = 0;
+  for (size_t level = firstMip; level < chain.levels.size(); ++level) {
+    size += chain.levels[level].size();
+  }
+  return size;
+}
+
+void TextureStreamer::Track(uint32_t bindlessIndex,
+                            const resource::TextureResource& texture) {
+  if (!texture.mipChain ||
+      std::ranges::any_of(texture.mipChain->levels,
+                          [](const auto& level) { return level.empty(); })) {
+    return;
+  }
+
+  std::scoped_lock lock{mutex_};
+  if (bindlessIndex >= textures_.size() || textures_[bindlessIndex].chain) {
+    return;
+  }
+  textures_[bindlessIndex] = {
+      .chain = texture.mipChain,
+      .tailMip = texture.residentMip,
+      .residentMip = texture.residentMip,
+      .targetMip = texture.residentMip,
+      .wantedMip = texture.residentMip,
+  };
+}
+
+void TextureStreamer::Untrack(uint32_t bindlessIndex) {
+  std::scoped_lock lock{mutex_};
+  if (bindlessIndex < textures_.size()) {
+    textures_[bindlessIndex] = {};
+  }
+}
+
+void TextureStreamer::Update(uint32_t frameIndex) {
+  // The frame that wrote this buffer has finished, so it can be read and
+  // cleared for the frame about to be recorded; its uploads are done too
+  stagingBuffers_[frameIndex].clear();
+
+  auto* buffer = feedbackBuffers_[frameIndex].get();
+  std::span<uint32_t> feedback{static_cast<uint32_t*>(buffer->Map()),
+                               textures_.size()};
+  {
+    std::scoped_lock lock{mutex_};
+    feedback_.resize(feedback.size());
+    for (size_t i = 0; i < feedback.size(); ++i) {
+      feedback_[i] = std::max(feedback_[i], feedback[i]);
+    }
+    hasFeedback_ = true;
+  }
+  std::ranges::fill(feedback, 0U);
+  buffer->Unmap();
+  wake_.notify_one();
+}
+
+void TextureStreamer::RecordUploads(rhi::CommandBuffer& cmd,
+                                    uint32_t frameIndex,
+                                    BindlessMaterialManager& materials) {
+  for (uint32_t i = 0; i < settings_.maxUploadsPerFrame; ++i) {
+    LevelLoad load;
+    {
+      std::scoped_lock lock{mutex_};
+      if (ready_.empty()) {
+        break;
+      }
+      load = std::move(ready_.front());
+      ready_.pop_front();
+    }
+    Apply(load, cmd, frameIndex, materials);
+  }
+}
+
+uint64_t TextureStreamer::GetStreamedBytes() const {
+  std::scoped_lock lock{mutex_};
+  uint64_t size = 0;
+  for (const auto& texture : textures_) {
+    if (texture.chain) {
+      size += GetChainSize(*texture.chain, texture.targetMip);
+    }
+  }
+  return size;
+}
+
+void TextureStreamer::Run(const std::stop_token& stop) {
+  while (true) {
+    std::vector<uint32_t> feedback;
+    std::vector<LevelLoad> loads;
+    {
+      std::unique_lock lock{mutex_};
+      if (!wake_.wait(lock, stop, [this] { return hasFeedback_; })) {
+        return;
+      }
+      feedback.swap(feedback_);
+      hasFeedback_ = false;
+      loads = Plan(feedback);
+    }
+
+    // Copying the levels reads them in from disk for mapped packs, which is
+    // what keeps that off the render thread
+    for (auto& load : loads) {
+      const auto& levels = load.chain->levels;
+      for (size_t level = load.firstMip; level < levels.size(); ++level) {
+        load.pixels.insert(load.pixels.end(), levels[level].begin(),
+                           levels[level].end());
+      }
+    }
+
+    std::scoped_lock lock{mutex_};
+    for (auto& load : loads) {
+      ready_.push_back(std::move(load));
+    }
+  }
+}
+
+std::vector<TextureStreamer::LevelLoad> TextureStreamer::Plan(
+    std::span<const uint32_t> feedback) {
+  ++epoch_;
+
+  // Textures in view can drop to what they need, the rest to their tail
+  auto keepMip = [this](const StreamedTexture& texture) {
+    return texture.lastSeen == epoch_ ? texture.wantedMip : texture.tailMip;
+  };
+
+  uint64_t used = 0;
+  std::vector<uint32_t> upgrades;
+  std::vector<uint32_t> evictable;
+  for (uint32_t i = 0; i < textures_.size(); ++i) {
+    auto& texture = textures_[i];
+    if (!texture.chain) {
+      continue;
+    }
+    if (!settings_.feedback) {
+      texture.wantedMip = 0;
+      texture.lastSeen = epoch_;
+    } else if (i < feedback.size() && feedback[i] != 0) {
+      texture.wantedMip =
+          GetWantedMip(*texture.chain, texture.tailMip, feedback[i]);
+      texture.lastSeen = epoch_;
+    }
+    used += GetChainSize(*texture.chain, texture.targetMip);
+
+    if (texture.loading) {
+      continue;
+    }
+    if (texture.lastSeen == epoch_ && texture.wantedMip < texture.targetMip) {
+      upgrades.push_back(i);
+    } else if (keepMip(texture) > texture.targetMip) {
+      evictable.push_back(i);
+    }
+  }
+
+  // Largest shortfall first; the least recently seen give memory back first
+  std::ranges::sort(upgrades, std::greater{}, [this](uint32_t i) {
+    return textures_[i].targetMip - textures_[i].wantedMip;
+  });
+  std::ranges::sort(evictable, {},
+                    [this](uint32_t i) { return textures_[i].lastSeen; });
+
+  std::vector<LevelLoad> loads;
+  auto request = [&](uint32_t index, uint32_t firstMip) {
+    auto& texture = textures_[index];
+    used -= GetChainSize(*texture.chain, texture.targetMip);
+    used += GetChainSize(*texture.chain, firstMip);
+    texture.targetMip = firstMip;
+    texture.loading = true;
+    loads.push_back({.index = index,
+                     .firstMip = firstMip,
+                     .chain = texture.chain,
+                     .pixels = {}});
+  };
+
+  auto victim = evictable.begin();
+  for (uint32_t index : upgrades) {
+    const auto& texture = textures_[index];
+    uint64_t extra = GetChainSize(*texture.chain, texture.wantedMip) -
+                     GetChainSize(*texture.chain, texture.targetMip);
+    while (used + extra > settings_.budgetBytes && victim != evictable.end()) {
+      request(*victim, keepMip(textures_[*victim]));
+      ++victim;
+    }
+    if (used + extra > settings_.budgetBytes) {
+      break;
+    }
+    request(index, texture.wantedMip);
+  }
+
+  return loads;
+}
+
+void TextureStreamer::Apply(const LevelLoad& load, rhi::CommandBuffer& cmd,
+                            uint32_t frameIndex,
+                            BindlessMaterialManager& materials) {
+  {
+    // The texture may have been released while its levels were loading
+    std::scoped_lock lock{mutex_};
+    if (textures_[load.index].chain != load.chain) {
+      return;
+    }
+  }
+
+  const auto& chain = *load.chain;
+  auto mipLevels = static_cast<uint32_t>(chain.levels.size()) - load.firstMip;
+
+  std::shared_ptr<rhi::Texture> texture = factory_.CreateTexture(
+      std::max(1U, chain.width >> load.firstMip),
+      std::max(1U, chain.height >> load.firstMip), chain.format,
+      rhi::TextureUsage::Sampled, mipLevels);
+
+  // Level offsets in staging are multiples of 16, which suits every format
+  constexpr rhi::Size kStagingAlignment = 16;
+  auto alignOffset = [](rhi::Size offset) {
+    return (offset + kStagingAlignment - 1) & ~(kStagingAlignment - 1);
+  };
+
+  std::vector<rhi::Size> offsets;
+  rhi::Size stagingSize = 0;
+  for (uint32_t level = 0; level < mipLevels; ++level) {
+    offsets.push_back(alignOffset(stagingSize));
+    stagingSize = offsets.back() + chain.levels[load.firstMip + level].size();
+  }
+
+  auto staging = factory_.CreateBuffer(
+      stagingSize, rhi::BufferUsage::TransferSrc, rhi::MemoryUsage::CPUToGPU);
+  auto* data = static_cast<std::byte*>(staging->Map());
+  std::span<const std::byte> pixels = load.pixels;
+  for (uint32_t level = 0; level < mipLevels; ++level) {
+    size_t size = chain.levels[load.firstMip + level].size();
+    std::memcpy(data + offsets[level], pixels.data(), size);
+    pixels = pixels.subspan(size);
+  }
+  staging->Unmap();
+
+  // Recorded ahead of this frame's draws; the texture it replaces stays
+  // alive in the bindless manager until no frame's set refers to it
+  cmd.TransitionTexture(texture.get(), rhi::ImageLayout::Undefined,
+                        rhi::ImageLayout::TransferDst);
+  for (uint32_t level = 0; level < mipLevels; ++level) {
+    cmd.CopyBufferToTexture(staging.get(), texture.get(), level, 0,
+                            offsets[level]);
+  }
+  cmd.TransitionTexture(texture.get(), rhi::ImageLayout::TransferDst,
+                        rhi::ImageLayout::ShaderReadOnly);
+  stagingBuffers_[frameIndex].push_back(std::move(staging));
+
+  materials.ReplaceTexture(load.index, std::move(texture));
+
+  std::scoped_lock lock{mutex_};
+  auto& streamed = textures_[load.index];
+  LOG_DEBUG("Streamed texture {}: mip {} -> {}", load.index,
+            streamed.residentMip, load.firstMip);
+  streamed.residentMip = load.firstMip;
+  streamed.loading = false;
+}
+
+}  // namespace renderer
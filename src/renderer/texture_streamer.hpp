@@ -0,0 +1,145 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "resource/types.hpp"
+#include "rhi/buffer.hpp"
+#include "rhi/command.hpp"
+#include "rhi/factory.hpp"
+
+namespace renderer {
+class BindlessMaterialManager;
+
+struct TextureStreamingSettings {
+  // GPU memory all streamed textures may use together
+  uint64_t budgetBytes{512ULL << 20};
+  // Finished level loads uploaded per frame
+  uint32_t maxUploadsPerFrame{4};
+  // Follow the levels pbr.frag samples; without feedback every texture is
+  // streamed in full as far as the budget allows
+  bool feedback{true};
+};
+
+/**
+ * @brief Streams mip levels of bindless textures driven by GPU feedback.
+ *
+ * pbr.frag records the resolution it would sample every bindless texture at
+ * into a per-frame feedback buffer. A worker thread turns the feedback into
+ * target levels under the memory budget, evicting the least recently seen
+ * textures first, and copies the levels to load out of the imported or
+ * mapped source data. The render thread records the uploads into the frame's
+ * command buffer and swaps the new textures into their bindless slots.
+ */
+class TextureStreamer {
+ public:
+  // Feedback holds log2 of the wanted resolution in 8.8 fixed point; must
+  // match pbr.frag
+  static constexpr float kFeedbackScale = 256.0F;
+
+  TextureStreamer(rhi::Factory& factory, uint32_t maxTextures,
+                  uint32_t framesInFlight,
+                  TextureStreamingSettings settings = {});
+  ~TextureStreamer();
+
+  TextureStreamer(const TextureStreamer&) = delete;
+  TextureStreamer& operator=(const TextureStreamer&) = delete;
+  TextureStreamer(TextureStreamer&&) = delete;
+  TextureStreamer& operator=(TextureStreamer&&) = delete;
+
+  /**
+   * @brief Start streaming a texture registered at a bindless index.
+   *
+   * Textures without a mip chain stay as they are.
+   */
+  void Track(uint32_t bindlessIndex, const resource::TextureResource& texture);
+
+  /**
+   * @brief Stop streaming a bindless index whose texture was released;
+   * loads still in flight for it are dropped.
+   */
+  void Untrack(uint32_t bindlessIndex);
+
+  /**
+   * @brief Read back a frame's feedback and free its upload staging.
+   *
+   * Must run after the frame's fence was waited on and before its commands
+   * are recorded.
+   */
+  void Update(uint32_t frameIndex);
+
+  /**
+   * @brief Record the uploads of finished level loads and point their
+   * bindless slots at the new textures.
+   *
+   * Call at the start of the frame's command buffer, before anything that
+   * samples the textures and before the frame's bindless set is updated.
+   */
+  void RecordUploads(rhi::CommandBuffer& cmd, uint32_t frameIndex,
+                     BindlessMaterialManager& materials);
+
+  /**
+   * @brief Storage buffer pbr.frag writes feedback to in a frame.
+   */
+  [[nodiscard]] rhi::Buffer* GetFeedbackBuffer(uint32_t frameIndex) const {
+    return feedbackBuffers_[frameIndex].get();
+  }
+
+  /**
+   * @brief GPU memory the streamed textures use or are loading into.
+   */
+  [[nodiscard]] uint64_t GetStreamedBytes() const;
+
+ private:
+  struct StreamedTexture {
+    std::shared_ptr<const resource::TextureMipChain> chain;
+    uint32_t tailMip{0};      // Coarsest first level; never evicted
+    uint32_t residentMip{0};  // First level on the GPU
+    uint32_t targetMip{0};    // First level once pending loads finish
+    uint32_t wantedMip{0};    // First level the feedback asked for
+    uint64_t lastSeen{0};     // Feedback epoch that last sampled it
+    bool loading{false};
+  };
+
+  struct LevelLoad {
+    uint32_t index{0};
+    uint32_t firstMip{0};
+    std::shared_ptr<const resource::TextureMipChain> chain;
+    std::vector<std::byte> pixels;  // Levels firstMip and up, packed
+  };
+
+  static uint64_t GetChainSize(const resource::TextureMipChain& chain,
+                               uint32_t firstMip);
+
+  void Run(const std::stop_token& stop);
+  std::vector<LevelLoad> Plan(std::span<const uint32_t> feedback);
+  void Apply(const LevelLoad& load, rhi::CommandBuffer& cmd,
+             uint32_t frameIndex, BindlessMaterialManager& materials);
+
+  rhi::Factory& factory_;
+  TextureStreamingSettings settings_;
+  std::vector<std::unique_ptr<rhi::Buffer>> feedbackBuffers_;
+  // Per frame, kept until its fence has been waited on
+  std::vector<std::vector<std::unique_ptr<rhi::Buffer>>> stagingBuffers_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable_any wake_;
+  std::vector<StreamedTexture> textures_;  // By bindless index
+  std::vector<uint32_t> feedback_;         // Merged, not yet planned
+  bool hasFeedback_{false};
+  uint64_t epoch_{0};
+  std::deque<LevelLoad> ready_;
+
+  // Last member so it stops before the state above goes away
+  std::jthread worker_;
+};
+
+}  // namespace renderer
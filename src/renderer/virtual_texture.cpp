@@ -0,0 +1,612 @@
+#include "renderer/virtual_texture.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <utility>
+
+#include "logger.hpp"
+#include "rhi/shader_utils.hpp"
+
+namespace renderer {
+namespace {
+constexpr uint32_t kTexelSize = 4;  // RGBA8
+constexpr uint32_t kCompactGroupSize = 64;
+
+// Page table entries: slot column, slot row and the level of the page in it
+uint32_t EncodeEntry(uint32_t slotX, uint32_t slotY, uint32_t level) {
+  return slotX | (slotY << 8) | (level << 16);
+}
+}  // namespace
+
+VirtualTextureSystem::VirtualTextureSystem(rhi::Factory& factory,
+                                           uint32_t framesInFlight,
+                                           VirtualTextureSettings settings)
+    : factory_{factory}, settings_{settings} {
+  CreateResources(framesInFlight);
+  if (!settings_.enabled) {
+    return;
+  }
+
+  CreatePipeline(framesInFlight);
+  worker_ = std::jthread{[this](const std::stop_token& stop) { Run(stop); }};
+
+  LOG_INFO("Virtual texturing initialized ({}x{} tile cache, {} MiB)",
+           slotsPerSide_, slotsPerSide_,
+           (static_cast<uint64_t>(slotsPerSide_ * kSlotSize) *
+            slotsPerSide_ * kSlotSize * kTexelSize) >>
+               20);
+}
+
+VirtualTextureSystem::~VirtualTextureSystem() = default;
+
+void VirtualTextureSystem::CreateResources(uint32_t framesInFlight) {
+  // Disabled, everything shrinks to one element so set 5 stays valid
+  bool enabled = settings_.enabled;
+  slotsPerSide_ =
+      enabled ? std::clamp(settings_.cacheTilesPerSide, 1U, 256U) : 1;
+  slots_.resize(static_cast<size_t>(slotsPerSide_) * slotsPerSide_);
+
+  uint32_t side = slotsPerSide_ * kSlotSize;
+  cache_ = factory_.CreateTexture(side, side, rhi::Format::R8G8B8A8Unorm,
+                                  rhi::TextureUsage::Sampled);
+  // Tiles are written as rectangles, which need the level uploaded once
+  std::vector<std::byte> clear(static_cast<size_t>(side) * side * kTexelSize);
+  std::array<rhi::TextureSubresourceData, 1> initial{{{.data = clear}}};
+  cache_->UploadSubresources(initial);
+
+  sampler_ = factory_.CreateSampler(rhi::Filter::Linear, rhi::Filter::Linear,
+                                    rhi::AddressMode::ClampToEdge);
+
+  infoBuffer_ = factory_.CreateBuffer(
+      sizeof(VirtualTextureInfo) * (enabled ? kMaxVirtualTextures : 1),
+      rhi::BufferUsage::Storage, rhi::MemoryUsage::CPUToGPU);
+  pageTableBuffer_ = factory_.CreateBuffer(
+      sizeof(uint32_t) * (enabled ? kMaxPages : 1), rhi::BufferUsage::Storage,
+      rhi::MemoryUsage::CPUToGPU);
+  feedbackBuffer_ = factory_.CreateBuffer(
+      sizeof(uint32_t) *
+          (enabled ? kFeedbackBlocksPerRow * kFeedbackBlocksPerRow *
+                         kFeedbackEntriesPerBlock
+                   : 1),
+      rhi::BufferUsage::Storage | rhi::BufferUsage::TransferDst,
+      rhi::MemoryUsage::GPUOnly);
+
+  // Graphics descriptor layout (set 5)
+  // binding 0: tile cache atlas
+  // binding 1: VirtualTextureInfo[]
+  // binding 2: page table
+  // binding 3: screen-space feedback written by pbr.frag
+  std::array<rhi::DescriptorBinding, 4> bindings = {{
+      {.binding = 0,
+       .type = rhi::DescriptorType::CombinedImageSampler,
+       .count = 1},
+      {.binding = 1, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
+      {.binding = 2, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
+      {.binding = 3, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
+  }};
+  descriptorLayout_ = factory_.CreateDescriptorSetLayout(bindings);
+
+  descriptorSet_ = factory_.CreateDescriptorSet(descriptorLayout_.get());
+  descriptorSet_->BindTexture(0, cache_.get(), sampler_.get());
+  descriptorSet_->BindStorageBuffer(1, infoBuffer_.get());
+  descriptorSet_->BindStorageBuffer(2, pageTableBuffer_.get());
+  descriptorSet_->BindStorageBuffer(3, feedbackBuffer_.get());
+
+  if (!enabled) {
+    return;
+  }
+
+  requestedBitsBuffer_ = factory_.CreateBuffer(
+      sizeof(uint32_t) * (kMaxPages / 32),
+      rhi::BufferUsage::Storage | rhi::BufferUsage::TransferDst,
+      rhi::MemoryUsage::GPUOnly);
+
+  // Request lists: a count followed by the requested pages
+  for (uint32_t i = 0; i < framesInFlight; ++i) {
+    auto buffer = factory_.CreateBuffer(sizeof(uint32_t) * (1 + kMaxRequests),
+                                        rhi::BufferUsage::Storage,
+                                        rhi::MemoryUsage::GPUToCPU);
+    std::memset(buffer->Map(), 0, sizeof(uint32_t) * (1 + kMaxRequests));
+    buffer->Unmap();
+    requestBuffers_.push_back(std::move(buffer));
+  }
+}
+
+void VirtualTextureSystem::CreatePipeline(uint32_t framesInFlight) {
+  compactShader_ =
+      rhi::CreateShaderFromFile(factory_, "assets/shaders/vt_feedback.comp.spv",
+                                rhi::ShaderStage::Compute);
+
+  // Compaction descriptor layout
+  // binding 0: screen-space feedback (read and cleared)
+  // binding 1: bit per page already requested this frame
+  // binding 2: request list of the frame
+  std::array<rhi::DescriptorBinding, 3> bindings = {{
+      {.binding = 0, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
+      {.binding = 1, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
+      {.binding = 2, .type = rhi::DescriptorType::StorageBuffer, .count = 1},
+  }};
+  compactDescriptorLayout_ = factory_.CreateDescriptorSetLayout(bindings);
+
+  std::array<const rhi::DescriptorSetLayout*, 1> layouts = {
+      compactDescriptorLayout_.get()};
+  std::array<rhi::PushConstantRange, 1> pushConstants = {{
+      {.stage = rhi::ShaderStage::Compute,
+       .offset = 0,
+       .size = sizeof(uint32_t)},
+  }};
+  compactPipelineLayout_ =
+      factory_.CreatePipelineLayout(layouts, pushConstants);
+
+  rhi::ComputePipelineDesc desc{
+      .computeShader = compactShader_.get(),
+      .layout = compactPipelineLayout_.get(),
+  };
+  compactPipeline_ = factory_.CreateComputePipeline(desc);
+
+  for (uint32_t i = 0; i < framesInFlight; ++i) {
+    auto set = factory_.CreateDescriptorSet(compactDescriptorLayout_.get());
+    set->BindStorageBuffer(0, feedbackBuffer_.get());
+    set->BindStorageBuffer(1, requestedBitsBuffer_.get());
+    set->BindStorageBuffer(2, requestBuffers_[i].get());
+    compactDescriptorSets_.push_back(std::move(set));
+  }
+}
+
+uint32_t VirtualTextureSystem::GetPagesX(const VirtualTexture& texture,
+                                         uint32_t level) {
+  return (std::max(1U, texture.width >> level) + kTileSize - 1) / kTileSize;
+}
+
+uint32_t VirtualTextureSystem::GetPagesY(const VirtualTexture& texture,
+                                         uint32_t level) {
+  return (std::max(1U, texture.height >> level) + kTileSize - 1) / kTileSize;
+}
+
+uint32_t VirtualTextureSystem::GetPage(uint32_t texture, uint32_t level,
+                                       uint32_t x, uint32_t y) const {
+  const auto& virtualTexture = textures_[texture];
+  return virtualTexture.levelOffsets[level] +
+         (y * GetPagesX(virtualTexture, level)) + x;
+}
+
+VirtualTextureSystem::PageAddress VirtualTextureSystem::GetAddress(
+    uint32_t page) const {
+  // Textures and their levels take consecutive page ranges
+  auto texture = std::ranges::upper_bound(
+      textures_, page, {},
+      [](const VirtualTexture& t) { return t.levelOffsets.front(); });
+  auto index = static_cast<uint32_t>(texture - textures_.begin()) - 1;
+  const auto& offsets = textures_[index].levelOffsets;
+  auto level = static_cast<uint32_t>(
+      std::ranges::upper_bound(offsets, page) - offsets.begin() - 1);
+
+  uint32_t local = page - offsets[level];
+  uint32_t pagesX = GetPagesX(textures_[index], level);
+  return {
+      .texture = index,
+      .level = level,
+      .x = local % pagesX,
+      .y = local / pagesX,
+  };
+}
+
+std::vector<std::byte> VirtualTextureSystem::CopyTile(
+    const resource::TextureMipChain& chain, const PageAddress& address) {
+  uint32_t width = std::max(1U, chain.width >> address.level);
+  uint32_t height = std::max(1U, chain.height >> address.level);
+  const auto* source = chain.levels[address.level].data();
+
+  // Texels past the edges wrap around, like the Repeat sampler of bindless
+  // textures does
+  auto wrap = [](int64_t coord, uint32_t size) {
+    return static_cast<uint32_t>(((coord % size) + size) % size);
+  };
+  int64_t originX = (static_cast<int64_t>(address.x) * kTileSize) - kTileBorder;
+  int64_t originY = (static_cast<int64_t>(address.y) * kTileSize) - kTileBorder;
+
+  std::vector<std::byte> pixels(static_cast<size_t>(kSlotSize) * kSlotSize *
+                                kTexelSize);
+  for (uint32_t row = 0; row < kSlotSize; ++row) {
+    const auto* sourceRow = source + (static_cast<size_t>(wrap(
+                                          originY + row, height)) *
+                                      width * kTexelSize);
+    auto* destRow =
+        pixels.data() + (static_cast<size_t>(row) * kSlotSize * kTexelSize);
+    for (uint32_t column = 0; column < kSlotSize; ++column) {
+      std::memcpy(destRow + (column * kTexelSize),
+                  sourceRow + (static_cast<size_t>(wrap(originX + column,
+                                                        width)) *
+                               kTexelSize),
+                  kTexelSize);
+    }
+  }
+  return pixels;
+}
+
+std::optional<uint32_t> VirtualTextureSystem::Register(
+    const resource::TextureResource& texture) {
+  if (!settings_.enabled || !texture.texture || !texture.mipChain) {
+    return std::nullopt;
+  }
+  if (auto it = textureIndexMap_.find(texture.texture.get());
+      it != textureIndexMap_.end()) {
+    return it->second;
+  }
+
+  const auto& chain = *texture.mipChain;
+  if (chain.format != rhi::Format::R8G8B8A8Unorm ||
+      std::max(chain.width, chain.height) <= kTileSize) {
+    return std::nullopt;
+  }
+
+  // Levels down to the first that fits in one page, which stays resident
+  uint32_t levelCount = 1;
+  while (std::max(chain.width >> (levelCount - 1),
+                  chain.height >> (levelCount - 1)) > kTileSize) {
+    ++levelCount;
+  }
+  if (chain.levels.size() < levelCount ||
+      std::any_of(chain.levels.begin(), chain.levels.begin() + levelCount,
+                  [](const auto& level) { return level.empty(); })) {
+    return std::nullopt;
+  }
+
+  VirtualTexture virtualTexture{
+      .chain = texture.mipChain,
+      .width = chain.width,
+      .height = chain.height,
+      .levelOffsets = {},
+  };
+  auto firstPage = static_cast<uint32_t>(pageSlots_.size());
+  uint32_t pageCount = 0;
+  for (uint32_t level = 0; level < levelCount; ++level) {
+    virtualTexture.levelOffsets.push_back(firstPage + pageCount);
+    pageCount += GetPagesX(virtualTexture, level) *
+                 GetPagesY(virtualTexture, level);
+  }
+  if (textures_.size() >= kMaxVirtualTextures ||
+      firstPage + pageCount > kMaxPages) {
+    LOG_WARNING("Virtual texture page table is full, keeping {}x{} bindless",
+                chain.width, chain.height);
+    return std::nullopt;
+  }
+
+  auto slot = AllocateSlot();
+  if (!slot) {
+    LOG_WARNING("Virtual texture cache is full, keeping {}x{} bindless",
+                chain.width, chain.height);
+    return std::nullopt;
+  }
+  uint32_t evicted = slots_[*slot].page;
+  if (evicted != kNoPage) {
+    pageSlots_[evicted] = kNoSlot;
+    RefreshPages(evicted);
+  }
+
+  auto index = static_cast<uint32_t>(textures_.size());
+  textures_.push_back(std::move(virtualTexture));
+  pageSlots_.resize(firstPage + pageCount, kNoSlot);
+  pageTable_.resize(firstPage + pageCount, 0);
+
+  // The page of the last level covers the whole texture
+  uint32_t pinnedPage = firstPage + pageCount - 1;
+  auto pixels = CopyTile(chain, {.texture = index,
+                                 .level = levelCount - 1,
+                                 .x = 0,
+                                 .y = 0});
+  std::array<rhi::TextureSubresourceData, 1> region{{{
+      .data = pixels,
+      .x = (*slot % slotsPerSide_) * kSlotSize,
+      .y = (*slot / slotsPerSide_) * kSlotSize,
+      .width = kSlotSize,
+      .height = kSlotSize,
+  }}};
+  cache_->UploadSubresources(region);
+
+  slots_[*slot] = {.page = pinnedPage, .lastUsed = frame_, .pinned = true};
+  pageSlots_[pinnedPage] = *slot;
+  RefreshPages(pinnedPage);
+  FlushPageTable();
+
+  VirtualTextureInfo info{
+      .width = chain.width,
+      .height = chain.height,
+      .levelCount = levelCount,
+      .pageOffset = firstPage,
+  };
+  infoBuffer_->Upload(std::as_bytes(std::span{&info, 1}),
+                      sizeof(VirtualTextureInfo) * index);
+
+  textureIndexMap_[texture.texture.get()] = index;
+  LOG_DEBUG("Virtual texture {}: {}x{}, {} pages", index, chain.width,
+            chain.height, pageCount);
+  return index;
+}
+
+std::optional<uint32_t> VirtualTextureSystem::AllocateSlot() {
+  // Free slots first, then the least recently used one not used this frame
+  std::optional<uint32_t> victim;
+  for (uint32_t i = 0; i < slots_.size(); ++i) {
+    const auto& slot = slots_[i];
+    if (slot.pinned) {
+      continue;
+    }
+    if (slot.page == kNoPage) {
+      return i;
+    }
+    if (slot.lastUsed < frame_ &&
+        (!victim || slot.lastUsed < slots_[*victim].lastUsed)) {
+      victim = i;
+    }
+  }
+  return victim;
+}
+
+void VirtualTextureSystem::Touch(uint32_t page) {
+  // A missing page keeps the coarser page drawn in its place
+  auto address = GetAddress(page);
+  const auto& texture = textures_[address.texture];
+  while (true) {
+    uint32_t slot = pageSlots_[page];
+    if (slot != kNoSlot) {
+      slots_[slot].lastUsed = frame_;
+      return;
+    }
+    if (address.level + 1 >= texture.levelOffsets.size()) {
+      return;
+    }
+    ++address.level;
+    address.x = std::min(address.x / 2, GetPagesX(texture, address.level) - 1);
+    address.y = std::min(address.y / 2, GetPagesY(texture, address.level) - 1);
+    page = GetPage(address.texture, address.level, address.x, address.y);
+  }
+}
+
+void VirtualTextureSystem::RefreshPages(uint32_t page) {
+  auto address = GetAddress(page);
+  const auto& texture = textures_[address.texture];
+  auto topLevel = static_cast<uint32_t>(texture.levelOffsets.size()) - 1;
+
+  // Walk down from the page through every finer page it covers; each takes
+  // its own slot if resident and its parent's entry otherwise
+  uint32_t beginX = address.x;
+  uint32_t endX = address.x + 1;
+  uint32_t beginY = address.y;
+  uint32_t endY = address.y + 1;
+  for (uint32_t level = address.level;; --level) {
+    uint32_t pagesX = GetPagesX(texture, level);
+    uint32_t pagesY = GetPagesY(texture, level);
+    endX = std::min(endX, pagesX);
+    endY = std::min(endY, pagesY);
+
+    for (uint32_t y = beginY; y < endY; ++y) {
+      for (uint32_t x = beginX; x < endX; ++x) {
+        uint32_t current = GetPage(address.texture, level, x, y);
+        uint32_t slot = pageSlots_[current];
+        uint32_t entry = 0;
+        if (slot != kNoSlot) {
+          entry = EncodeEntry(slot % slotsPerSide_, slot / slotsPerSide_,
+                              level);
+        } else if (level < topLevel) {
+          entry = pageTable_[GetPage(
+              address.texture, level + 1,
+              std::min(x / 2, GetPagesX(texture, level + 1) - 1),
+              std::min(y / 2, GetPagesY(texture, level + 1) - 1))];
+        }
+        pageTable_[current] = entry;
+        dirtyBegin_ = std::min(dirtyBegin_, current);
+        dirtyEnd_ = std::max(dirtyEnd_, current + 1);
+      }
+    }
+
+    if (level == 0) {
+      break;
+    }
+    // Odd level sizes round down, so the last column and row also cover the
+    // finer pages past twice their count
+    beginX *= 2;
+    beginY *= 2;
+    endX = endX == pagesX ? GetPagesX(texture, level - 1) : endX * 2;
+    endY = endY == pagesY ? GetPagesY(texture, level - 1) : endY * 2;
+  }
+}
+
+void VirtualTextureSystem::FlushPageTable() {
+  if (dirtyBegin_ >= dirtyEnd_) {
+    return;
+  }
+  std::span<const uint32_t> dirty{pageTable_.data() + dirtyBegin_,
+                                  dirtyEnd_ - dirtyBegin_};
+  pageTableBuffer_->Upload(std::as_bytes(dirty),
+                           sizeof(uint32_t) * dirtyBegin_);
+  dirtyBegin_ = UINT32_MAX;
+  dirtyEnd_ = 0;
+}
+
+void VirtualTextureSystem::Update(uint32_t frameIndex) {
+  if (!settings_.enabled) {
+    return;
+  }
+  ++frame_;
+
+  // The frame that wrote this list has finished, so it can be read and reset
+  // for the frame about to be recorded
+  auto* buffer = requestBuffers_[frameIndex].get();
+  auto* requests = static_cast<uint32_t*>(buffer->Map());
+  uint32_t count = std::min(requests[0], kMaxRequests);
+
+  std::vector<TileLoad> loads;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t page = requests[1 + i];
+    if (page >= pageSlots_.size()) {
+      continue;
+    }
+    Touch(page);
+    if (pageSlots_[page] == kNoSlot && pending_.insert(page).second) {
+      auto address = GetAddress(page);
+      loads.push_back({.page = page,
+                       .chain = textures_[address.texture].chain,
+                       .address = address,
+                       .pixels = {}});
+    }
+  }
+  requests[0] = 0;
+  buffer->Unmap();
+
+  std::vector<TileLoad> tiles;
+  {
+    std::scoped_lock lock{mutex_};
+    for (auto& load : loads) {
+      queue_.push_back(std::move(load));
+    }
+    while (tiles.size() < settings_.maxTileUploadsPerFrame &&
+           !ready_.empty()) {
+      tiles.push_back(std::move(ready_.front()));
+      ready_.pop_front();
+    }
+  }
+  if (!loads.empty()) {
+    wake_.notify_one();
+  }
+
+  if (!tiles.empty()) {
+    ApplyTiles(tiles);
+  }
+}
+
+void VirtualTextureSystem::ApplyTiles(std::vector<TileLoad>& tiles) {
+  std::vector<rhi::TextureSubresourceData> regions;
+  std::vector<uint32_t> placed;
+  for (const auto& tile : tiles) {
+    pending_.erase(tile.page);
+
+    // With every slot in use this frame the page is simply requested again
+    auto slot = AllocateSlot();
+    if (!slot) {
+      continue;
+    }
+    uint32_t evicted = slots_[*slot].page;
+    if (evicted != kNoPage) {
+      pageSlots_[evicted] = kNoSlot;
+      RefreshPages(evicted);
+    }
+    slots_[*slot] = {.page = tile.page, .lastUsed = frame_, .pinned = false};
+    pageSlots_[tile.page] = *slot;
+    placed.push_back(tile.page);
+
+    regions.push_back({
+        .data = tile.pixels,
+        .x = (*slot % slotsPerSide_) * kSlotSize,
+        .y = (*slot / slotsPerSide_) * kSlotSize,
+        .width = kSlotSize,
+        .height = kSlotSize,
+    });
+  }
+  if (regions.empty()) {
+    return;
+  }
+
+  // The upload waits for the queue to drain, so no frame reads the page
+  // table while it is rewritten
+  cache_->UploadSubresources(regions);
+
+  // Coarse pages first, so finer ones see their final parent entries
+  std::ranges::sort(placed, std::greater{},
+                    [this](uint32_t page) { return GetAddress(page).level; });
+  for (uint32_t page : placed) {
+    RefreshPages(page);
+  }
+  FlushPageTable();
+}
+
+void VirtualTextureSystem::ResetFeedback(rhi::CommandBuffer* cmd) {
+  if (compactPipeline_ == nullptr) {
+    return;
+  }
+
+  // pbr.frag only writes the feedback; the compaction clears it after
+  // reading, so it needs zeroing once
+  if (!feedbackCleared_) {
+    cmd->FillBuffer(feedbackBuffer_.get(), 0, feedbackBuffer_->GetSize(), 0);
+    cmd->BufferBarrier(
+        feedbackBuffer_.get(), rhi::AccessFlags::TransferWrite,
+        rhi::AccessFlags::ShaderRead | rhi::AccessFlags::ShaderWrite);
+    feedbackCleared_ = true;
+  } else {
+    cmd->BufferBarrier(
+        feedbackBuffer_.get(),
+        rhi::AccessFlags::ShaderRead | rhi::AccessFlags::ShaderWrite,
+        rhi::AccessFlags::ShaderWrite);
+  }
+
+  cmd->BufferBarrier(
+      requestedBitsBuffer_.get(),
+      rhi::AccessFlags::ShaderRead | rhi::AccessFlags::ShaderWrite,
+      rhi::AccessFlags::TransferWrite);
+  cmd->FillBuffer(requestedBitsBuffer_.get(), 0,
+                  requestedBitsBuffer_->GetSize(), 0);
+  cmd->BufferBarrier(
+      requestedBitsBuffer_.get(), rhi::AccessFlags::TransferWrite,
+      rhi::AccessFlags::ShaderRead | rhi::AccessFlags::ShaderWrite);
+}
+
+void VirtualTextureSystem::CompactFeedback(rhi::CommandBuffer* cmd,
+                                           uint32_t frameIndex,
+                                           uint32_t screenHeight) {
+  if (compactPipeline_ == nullptr) {
+    return;
+  }
+
+  // Barrier: fragment shader writes -> compute read
+  cmd->BufferBarrier(
+      feedbackBuffer_.get(), rhi::AccessFlags::ShaderWrite,
+      rhi::AccessFlags::ShaderRead | rhi::AccessFlags::ShaderWrite);
+
+  cmd->BindPipeline(compactPipeline_.get());
+  std::array<const rhi::DescriptorSet*, 1> sets = {
+      compactDescriptorSets_[frameIndex].get()};
+  cmd->BindDescriptorSets(compactPipeline_.get(), 0, sets);
+
+  // Only the block rows the screen covers hold feedback
+  uint32_t rows =
+      std::min((screenHeight + kFeedbackBlockSize - 1) / kFeedbackBlockSize,
+               kFeedbackBlocksPerRow);
+  uint32_t entryCount =
+      rows * kFeedbackBlocksPerRow * kFeedbackEntriesPerBlock;
+  cmd->PushConstants(compactPipeline_.get(), 0,
+                     std::as_bytes(std::span{&entryCount, 1}));
+  cmd->Dispatch((entryCount + kCompactGroupSize - 1) / kCompactGroupSize, 1,
+                1);
+}
+
+uint32_t VirtualTextureSystem::GetResidentTileCount() const {
+  return static_cast<uint32_t>(std::ranges::count_if(
+      slots_, [](const Slot& slot) { return slot.page != kNoPage; }));
+}
+
+void VirtualTextureSystem::Run(const std::stop_token& stop) {
+  while (true) {
+    TileLoad load;
+    {
+      std::unique_lock lock{mutex_};
+      if (!wake_.wait(lock, stop, [this] { return !queue_.empty(); })) {
+        return;
+      }
+      load = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    // Reading the level reads it in from disk for mapped packs, which is
+    // what keeps that off the render thread
+    load.pixels = CopyTile(*load.chain, load.address);
+
+    std::scoped_lock lock{mutex_};
+    ready_.push_back(std::move(load));
+  }
+}
+
+}  // namespace renderer
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "resource/types.hpp"
+#include "rhi/buffer.hpp"
+#include "rhi/command.hpp"
+#include "rhi/descriptor.hpp"
+#include "rhi/factory.hpp"
+#include "rhi/pipeline.hpp"
+#include "rhi/sampler.hpp"
+#include "rhi/shader.hpp"
+#include "rhi/texture.hpp"
+
+namespace renderer {
+
+struct VirtualTextureSettings {
+  // Off by default; every texture is then a bindless texture
+  bool enabled{false};
+  // The tile cache is a square atlas with this many tiles per side
+  uint32_t cacheTilesPerSide{32};
+  // Tiles copied into the cache per frame; each batch waits for the GPU
+  uint32_t maxTileUploadsPerFrame{16};
+};
+
+// Per virtual texture data read by the shaders - must match pbr.frag
+struct alignas(16) VirtualTextureInfo {
+  uint32_t width{0};
+  uint32_t height{0};
+  uint32_t levelCount{0};  // Levels addressed through the page table
+  uint32_t pageOffset{0};  // First page of level 0 in the page table
+};
+
+/**
+ * @brief Software virtual texturing for large RGBA8 textures.
+ *
+ * Every level of a virtual texture is split into 128x128 pages. Resident
+ * pages live in slots of one atlas shared by all virtual textures, each with
+ * a 4 texel border copied from its neighbours so bilinear filtering does not
+ * bleed between slots. A page table storage buffer maps every page to the
+ * finest resident page covering it, so a missing page falls back to a
+ * coarser one. The coarsest level that fits a single page is pinned.
+ *
+ * pbr.frag writes the pages it wanted into a screen-space feedback buffer,
+ * which a compute pass deduplicates into a per-frame request list. Requested
+ * pages are cut out of the imported or mapped mip chain on a worker thread;
+ * uploads and page table updates happen on the render thread between
+ * frames, replacing the least recently used slots. GPU memory is the atlas,
+ * whatever the size of the textures behind it.
+ */
+class VirtualTextureSystem {
+ public:
+  static constexpr uint32_t kTileSize = 128;
+  static constexpr uint32_t kTileBorder = 4;
+  static constexpr uint32_t kSlotSize = kTileSize + (2 * kTileBorder);
+  static constexpr uint32_t kMaxVirtualTextures = 4096;
+  static constexpr uint32_t kMaxPages = 1U << 20;
+  static constexpr uint32_t kMaxRequests = 4096;
+  // Set in material texture indices that refer to a virtual texture
+  static constexpr uint32_t kVirtualTextureBit = 1U << 31;
+  // Feedback has one block per 16x16 pixels and 16 entries per block
+  static constexpr uint32_t kFeedbackBlockSize = 16;
+  static constexpr uint32_t kFeedbackBlocksPerRow = 256;
+  static constexpr uint32_t kFeedbackEntriesPerBlock = 16;
+
+  VirtualTextureSystem(rhi::Factory& factory, uint32_t framesInFlight,
+                       VirtualTextureSettings settings = {});
+  ~VirtualTextureSystem();
+
+  VirtualTextureSystem(const VirtualTextureSystem&) = delete;
+  VirtualTextureSystem& operator=(const VirtualTextureSystem&) = delete;
+  VirtualTextureSystem(VirtualTextureSystem&&) = delete;
+  VirtualTextureSystem& operator=(VirtualTextureSystem&&) = delete;
+
+  [[nodiscard]] bool IsEnabled() const { return settings_.enabled; }
+
+  /**
+   * @brief Make a texture virtual.
+   *
+   * Only RGBA8 textures larger than a page that keep their mip chain are
+   * virtualised; the pinned page is uploaded right away.
+   *
+   * @return The virtual texture index, or nullopt to keep it bindless
+   */
+  std::optional<uint32_t> Register(const resource::TextureResource& texture);
+
+  /**
+   * @brief Read back a frame's page requests and apply finished tile loads.
+   *
+   * Must run after the frame's fence was waited on and before its commands
+   * are recorded.
+   */
+  void Update(uint32_t frameIndex);
+
+  /**
+   * @brief Prepare the feedback buffers; record before the frame renders.
+   */
+  void ResetFeedback(rhi::CommandBuffer* cmd);
+
+  /**
+   * @brief Compact the frame's feedback into its request list; record after
+   * the frame rendered.
+   */
+  void CompactFeedback(rhi::CommandBuffer* cmd, uint32_t frameIndex,
+                       uint32_t screenHeight);
+
+  // Descriptor set for the graphics pipelines (set 5)
+  [[nodiscard]] rhi::DescriptorSetLayout* GetDescriptorLayout() const {
+    return descriptorLayout_.get();
+  }
+  [[nodiscard]] rhi::DescriptorSet* GetDescriptorSet() const {
+    return descriptorSet_.get();
+  }
+
+  [[nodiscard]] uint32_t GetResidentTileCount() const;
+
+ private:
+  static constexpr uint32_t kNoSlot = UINT32_MAX;
+  static constexpr uint32_t kNoPage = UINT32_MAX;
+
+  struct VirtualTexture {
+    std::shared_ptr<const resource::TextureMipChain> chain;
+    uint32_t width{0};
+    uint32_t height{0};
+    std::vector<uint32_t> levelOffsets;  // First page of each level
+  };
+
+  struct PageAddress {
+    uint32_t texture{0};
+    uint32_t level{0};
+    uint32_t x{0};
+    uint32_t y{0};
+  };
+
+  struct Slot {
+    uint32_t page{kNoPage};
+    uint64_t lastUsed{0};
+    bool pinned{false};
+  };
+
+  struct TileLoad {
+    uint32_t page{0};
+    std::shared_ptr<const resource::TextureMipChain> chain;
+    PageAddress address;
+    std::vector<std::byte> pixels;  // kSlotSize squared RGBA8 texels
+  };
+
+  static std::vector<std::byte> CopyTile(
+      const resource::TextureMipChain& chain, const PageAddress& address);
+
+  void CreateResources(uint32_t framesInFlight);
+  void CreatePipeline(uint32_t framesInFlight);
+
+  [[nodiscard]] PageAddress GetAddress(uint32_t page) const;
+  [[nodiscard]] uint32_t GetPage(uint32_t texture, uint32_t level, uint32_t x,
+                                 uint32_t y) const;
+  static uint32_t GetPagesX(const VirtualTexture& texture, uint32_t level);
+  static uint32_t GetPagesY(const VirtualTexture& texture, uint32_t level);
+
+  std::optional<uint32_t> AllocateSlot();
+  void Touch(uint32_t page);
+  void ApplyTiles(std::vector<TileLoad>& tiles);
+  void RefreshPages(uint32_t page);
+  void FlushPageTable();
+
+  void Run(const std::stop_token& stop);
+
+  rhi::Factory& factory_;
+  VirtualTextureSettings settings_;
+  uint32_t slotsPerSide_{1};
+
+  // Tile cache and what the shaders read
+  std::shared_ptr<rhi::Texture> cache_;
+  std::unique_ptr<rhi::Sampler> sampler_;
+  std::unique_ptr<rhi::Buffer> infoBuffer_;
+  std::unique_ptr<rhi::Buffer> pageTableBuffer_;
+  std::unique_ptr<rhi::Buffer> feedbackBuffer_;
+  bool feedbackCleared_{false};
+  std::unique_ptr<rhi::DescriptorSetLayout> descriptorLayout_;
+  std::unique_ptr<rhi::DescriptorSet> descriptorSet_;
+
+  // Feedback compaction
+  std::unique_ptr<rhi::Buffer> requestedBitsBuffer_;
+  std::vector<std::unique_ptr<rhi::Buffer>> requestBuffers_;
+  std::unique_ptr<rhi::Shader> compactShader_;
+  std::unique_ptr<rhi::DescriptorSetLayout> compactDescriptorLayout_;
+  std::unique_ptr<rhi::PipelineLayout> compactPipelineLayout_;
+  std::unique_ptr<rhi::Pipeline> compactPipeline_;
+  std::vector<std::unique_ptr<rhi::DescriptorSet>> compactDescriptorSets_;
+
+  // Render thread state
+  std::vector<VirtualTexture> textures_;
+  std::unordered_map<const rhi::Texture*, uint32_t> textureIndexMap_;
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> pageSlots_;  // Slot of each resident page
+  std::vector<uint32_t> pageTable_;  // Mirror of pageTableBuffer_
+  uint32_t dirtyBegin_{UINT32_MAX};
+  uint32_t dirtyEnd_{0};
+  std::unordered_set<uint32_t> pending_;  // Requested, not yet resident
+  uint64_t frame_{0};
+
+  // Shared with the worker
+  std::mutex mutex_;
+  std::condition_variable_any wake_;
+  std::deque<TileLoad> queue_;
+  std::deque<TileLoad> ready_;
+
+  // Last member so it stops before the state above goes away
+  std::jthread worker_;
+};
+
+}  // namespace renderer
@@ -0,0 +1,428 @@
+#include "resource/gltf_accessor.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <memory_resource>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define VKR_ACCESSOR_SSE 1
+  #include <immintrin.h>
+#endif
+
+#include "core/arena.hpp"
+
+namespace resource {
+namespace {
+
+using ConvertFn = void (*)(const uint8_t* src, size_t srcStride, size_t count,
+                           const AccessorTarget& target, size_t firstElement);
+
+float* ElementAt(float* base, size_t stride, size_t index) {
+  return std::bit_cast<float*>(std::bit_cast<uint8_t*>(base) +
+                               (index * stride));
+}
+
+template <typename T>
+T LoadUnaligned(const uint8_t* src) {
+  T value;
+  std::memcpy(&value, src, sizeof(T));
+  return value;
+}
+
+template <typename T, bool Normalized>
+float ConvertComponent(T value) {
+  if constexpr (std::is_floating_point_v<T> || !Normalized) {
+    return static_cast<float>(value);
+  } else if constexpr (std::is_signed_v<T>) {
+    constexpr auto kMax = static_cast<float>(std::numeric_limits<T>::max());
+    return std::max(static_cast<float>(value) / kMax, -1.0F);
+  } else {
+    constexpr auto kMax = static_cast<float>(std::numeric_limits<T>::max());
+    return static_cast<float>(value) / kMax;
+  }
+}
+
+#ifdef VKR_ACCESSOR_SSE
+
+// Four-wide kernels for the common 4-component cases; returns true if handled
+template <typename T, bool Normalized, uint32_t SrcN, uint32_t DstN>
+bool ConvertElementsSSE(const uint8_t* src, size_t srcStride, size_t count,
+                        float* dst, size_t dstStride) {
+  if constexpr (SrcN == 4 && DstN == 4 && std::is_same_v<T, float>) {
+    for (size_t i = 0; i < count; ++i) {
+      __m128 value =
+          _mm_loadu_ps(std::bit_cast<const float*>(src + (i * srcStride)));
+      _mm_storeu_ps(ElementAt(dst, dstStride, i), value);
+    }
+    return true;
+  } else if constexpr (SrcN == 4 && DstN == 4 && std::is_same_v<T, uint8_t> &&
+                       Normalized) {
+    const __m128 scale = _mm_set1_ps(1.0F / 255.0F);
+    const __m128i zero = _mm_setzero_si128();
+    for (size_t i = 0; i < count; ++i) {
+      __m128i bytes =
+          _mm_cvtsi32_si128(LoadUnaligned<int32_t>(src + (i * srcStride)));
+      __m128i words = _mm_unpacklo_epi8(bytes, zero);
+      __m128i dwords = _mm_unpacklo_epi16(words, zero);
+      _mm_storeu_ps(ElementAt(dst, dstStride, i),
+                    _mm_mul_ps(_mm_cvtepi32_ps(dwords), scale));
+    }
+    return true;
+  } else if constexpr (SrcN == 4 && DstN == 4 && std::is_same_v<T, uint16_t> &&
+                       Normalized) {
+    const __m128 scale = _mm_set1_ps(1.0F / 65535.0F);
+    const __m128i zero = _mm_setzero_si128();
+    for (size_t i = 0; i < count; ++i) {
+      __m128i words = _mm_loadl_epi64(
+          std::bit_cast<const __m128i*>(src + (i * srcStride)));
+      __m128i dwords = _mm_unpacklo_epi16(words, zero);
+      _mm_storeu_ps(ElementAt(dst, dstStride, i),
+                    _mm_mul_ps(_mm_cvtepi32_ps(dwords), scale));
+    }
+    return true;
+  } else {
+    return false;
+  }
+}
+
+#endif  // VKR_ACCESSOR_SSE
+
+// Component type, counts and normalization are all compile-time, so the inner
+// loop has no branches and a fixed trip count
+template <typename T, bool Normalized, uint32_t SrcN, uint32_t DstN>
+void ConvertElements(const uint8_t* src, size_t srcStride, size_t count,
+                     const AccessorTarget& target, size_t firstElement) {
+  float* dst = ElementAt(target.data, target.stride, firstElement);
+
+#ifdef VKR_ACCESSOR_SSE
+  if (ConvertElementsSSE<T, Normalized, SrcN, DstN>(src, srcStride, count, dst,
+                                                    target.stride)) {
+    return;
+  }
+#endif
+
+  for (size_t i = 0; i < count; ++i) {
+    const uint8_t* element = src + (i * srcStride);
+    float* out = ElementAt(dst, target.stride, i);
+
+    for (uint32_t c = 0; c < DstN; ++c) {
+      if (c < SrcN) {
+        out[c] = ConvertComponent<T, Normalized>(
+            LoadUnaligned<T>(element + (c * sizeof(T))));
+      } else {
+        out[c] = target.fill[c];
+      }
+    }
+  }
+}
+
+template <typename T, bool Normalized, uint32_t SrcN>
+ConvertFn SelectDstCount(uint32_t dstCount) {
+  switch (dstCount) {
+    case 1:
+      return &ConvertElements<T, Normalized, SrcN, 1>;
+    case 2:
+      return &ConvertElements<T, Normalized, SrcN, 2>;
+    case 3:
+      return &ConvertElements<T, Normalized, SrcN, 3>;
+    case 4:
+      return &ConvertElements<T, Normalized, SrcN, 4>;
+    default:
+      return nullptr;
+  }
+}
+
+template <typename T, bool Normalized>
+ConvertFn SelectSrcCount(uint32_t srcCount, uint32_t dstCount) {
+  switch (srcCount) {
+    case 1:
+      return SelectDstCount<T, Normalized, 1>(dstCount);
+    case 2:
+      return SelectDstCount<T, Normalized, 2>(dstCount);
+    case 3:
+      return SelectDstCount<T, Normalized, 3>(dstCount);
+    case 4:
+      return SelectDstCount<T, Normalized, 4>(dstCount);
+    default:
+      return nullptr;
+  }
+}
+
+template <typename T>
+ConvertFn SelectNormalization(bool normalized, uint32_t srcCount,
+                              uint32_t dstCount) {
+  return normalized ? SelectSrcCount<T, true>(srcCount, dstCount)
+                    : SelectSrcCount<T, false>(srcCount, dstCount);
+}
+
+ConvertFn SelectConverter(int componentType, bool normalized,
+                          uint32_t srcCount, uint32_t dstCount) {
+  switch (componentType) {
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+      return SelectNormalization<int8_t>(normalized, srcCount, dstCount);
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      return SelectNormalization<uint8_t>(normalized, srcCount, dstCount);
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+      return SelectNormalization<int16_t>(normalized, srcCount, dstCount);
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      return SelectNormalization<uint16_t>(normalized, srcCount, dstCount);
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+      return SelectNormalization<uint32_t>(normalized, srcCount, dstCount);
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:
+      // Floats are never normalized
+      return SelectSrcCount<float, false>(srcCount, dstCount);
+    default:
+      return nullptr;
+  }
+}
+
+// Resolve a buffer view range and check that `count` elements of
+// `elementSize` bytes, `stride` apart, fit inside the underlying buffer
+const uint8_t* ResolveView(const tinygltf::Model& model,
+                           const BufferData& buffers, int bufferViewIndex,
+                           size_t byteOffset, size_t count, size_t elementSize,
+                           size_t stride) {
+  if (bufferViewIndex < 0 ||
+      static_cast<size_t>(bufferViewIndex) >= model.bufferViews.size()) {
+    return nullptr;
+  }
+
+  const auto& bufferView = model.bufferViews[bufferViewIndex];
+  if (bufferView.buffer < 0 ||
+      static_cast<size_t>(bufferView.buffer) >= buffers.size()) {
+    return nullptr;
+  }
+
+  auto buffer = buffers[bufferView.buffer];
+  size_t begin = bufferView.byteOffset + byteOffset;
+  size_t span = count == 0 ? 0 : ((count - 1) * stride) + elementSize;
+  if (begin + span > buffer.size() ||
+      byteOffset + span > bufferView.byteLength) {
+    return nullptr;
+  }
+
+  return buffer.data() + begin;
+}
+
+template <typename T>
+void ConvertIndices(const uint8_t* src, size_t count, uint32_t* dst) {
+  for (size_t i = 0; i < count; ++i) {
+    dst[i] = LoadUnaligned<T>(src + (i * sizeof(T)));
+  }
+}
+
+// Plain u8/u16/u32 array decode shared by index data and sparse indices
+bool ReadIndexArray(const uint8_t* src, int componentType, size_t count,
+                    uint32_t* dst) {
+  switch (componentType) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      ConvertIndices<uint8_t>(src, count, dst);
+      return true;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      ConvertIndices<uint16_t>(src, count, dst);
+      return true;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+      ConvertIndices<uint32_t>(src, count, dst);
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Resolve and decode the sparse index list of an accessor
+bool ReadSparseIndices(const tinygltf::Model& model,
+                       const BufferData& buffers,
+                       const tinygltf::Accessor& accessor,
+                       std::pmr::vector<uint32_t>& sparseIndices) {
+  const auto& sparse = accessor.sparse;
+  auto count = static_cast<size_t>(sparse.count);
+  int indexSize = tinygltf::GetComponentSizeInBytes(
+      static_cast<uint32_t>(sparse.indices.componentType));
+  if (indexSize <= 0) {
+    return false;
+  }
+
+  const uint8_t* src = ResolveView(
+      model, buffers, sparse.indices.bufferView,
+      static_cast<size_t>(sparse.indices.byteOffset), count,
+      static_cast<size_t>(indexSize), static_cast<size_t>(indexSize));
+  if (src == nullptr) {
+    return false;
+  }
+
+  sparseIndices.resize(count);
+  return ReadIndexArray(src, sparse.indices.componentType, count,
+                        sparseIndices.data());
+}
+
+}  // namespace
+
+BufferData GetBufferData(const tinygltf::Model& model) {
+  BufferData buffers;
+  buffers.reserve(model.buffers.size());
+  for (const auto& buffer : model.buffers) {
+    buffers.emplace_back(buffer.data);
+  }
+  return buffers;
+}
+
+bool ReadAccessor(const tinygltf::Model& model, const BufferData& buffers,
+                  const tinygltf::Accessor& accessor, size_t count,
+                  const AccessorTarget& target) {
+  count = std::min(count, accessor.count);
+
+  auto srcCount = static_cast<uint32_t>(
+      tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type)));
+  int componentSize = tinygltf::GetComponentSizeInBytes(
+      static_cast<uint32_t>(accessor.componentType));
+  if (componentSize <= 0 || srcCount == 0 || srcCount > 4) {
+    return false;
+  }
+
+  ConvertFn convert = SelectConverter(accessor.componentType,
+                                      accessor.normalized, srcCount,
+                                      target.components);
+  if (convert == nullptr) {
+    return false;
+  }
+
+  size_t elementSize = static_cast<size_t>(componentSize) * srcCount;
+
+  if (static_cast<size_t>(accessor.bufferView) >= model.bufferViews.size() &&
+      accessor.bufferView >= 0) {
+    return false;
+  }
+
+  if (accessor.bufferView >= 0) {
+    const auto& bufferView = model.bufferViews[accessor.bufferView];
+    int byteStride = accessor.ByteStride(bufferView);
+    if (byteStride <= 0) {
+      return false;
+    }
+
+    const uint8_t* src =
+        ResolveView(model, buffers, accessor.bufferView, accessor.byteOffset,
+                    count, elementSize, static_cast<size_t>(byteStride));
+    if (src == nullptr) {
+      return false;
+    }
+
+    convert(src, static_cast<size_t>(byteStride), count, target, 0);
+  } else {
+    // No buffer view: the accessor is all zeros apart from sparse entries
+    for (size_t i = 0; i < count; ++i) {
+      float* out = ElementAt(target.data, target.stride, i);
+      for (uint32_t c = 0; c < target.components; ++c) {
+        out[c] = c < srcCount ? 0.0F : target.fill[c];
+      }
+    }
+  }
+
+  if (!accessor.sparse.isSparse) {
+    return true;
+  }
+
+  std::pmr::vector<uint32_t> sparseIndices{core::GetScratchResource()};
+  if (!ReadSparseIndices(model, buffers, accessor, sparseIndices)) {
+    return false;
+  }
+
+  // Sparse values are tightly packed and use the accessor's component type
+  const uint8_t* values = ResolveView(
+      model, buffers, accessor.sparse.values.bufferView,
+      static_cast<size_t>(accessor.sparse.values.byteOffset),
+      sparseIndices.size(), elementSize, elementSize);
+  if (values == nullptr) {
+    return false;
+  }
+
+  for (size_t i = 0; i < sparseIndices.size(); ++i) {
+    if (sparseIndices[i] < count) {
+      convert(values + (i * elementSize), elementSize, 1, target,
+              sparseIndices[i]);
+    }
+  }
+
+  return true;
+}
+
+bool ReadIndices(const tinygltf::Model& model, const BufferData& buffers,
+                 const tinygltf::Accessor& accessor,
+                 std::pmr::vector<uint32_t>& indices) {
+  if (accessor.type != TINYGLTF_TYPE_SCALAR) {
+    return false;
+  }
+
+  int componentSize = tinygltf::GetComponentSizeInBytes(
+      static_cast<uint32_t>(accessor.componentType));
+  if (componentSize <= 0) {
+    return false;
+  }
+
+  indices.resize(accessor.count);
+
+  if (static_cast<size_t>(accessor.bufferView) >= model.bufferViews.size() &&
+      accessor.bufferView >= 0) {
+    return false;
+  }
+
+  if (accessor.bufferView >= 0) {
+    const auto& bufferView = model.bufferViews[accessor.bufferView];
+    int byteStride = accessor.ByteStride(bufferView);
+    if (byteStride != componentSize) {
+      // Index buffer views must be tightly packed
+      return false;
+    }
+
+    const uint8_t* src =
+        ResolveView(model, buffers, accessor.bufferView, accessor.byteOffset,
+                    accessor.count, static_cast<size_t>(componentSize),
+                    static_cast<size_t>(componentSize));
+    if (src == nullptr ||
+        !ReadIndexArray(src, accessor.componentType, accessor.count,
+                        indices.data())) {
+      return false;
+    }
+  } else {
+    std::ranges::fill(indices, 0U);
+  }
+
+  if (!accessor.sparse.isSparse) {
+    return true;
+  }
+
+  std::pmr::vector<uint32_t> sparseIndices{core::GetScratchResource()};
+  if (!ReadSparseIndices(model, buffers, accessor, sparseIndices)) {
+    return false;
+  }
+
+  const uint8_t* values = ResolveView(
+      model, buffers, accessor.sparse.values.bufferView,
+      static_cast<size_t>(accessor.sparse.values.byteOffset),
+      sparseIndices.size(), static_cast<size_t>(componentSize),
+      static_cast<size_t>(componentSize));
+  if (values == nullptr) {
+    return false;
+  }
+
+  std::pmr::vector<uint32_t> sparseValues(sparseIndices.size(),
+                                          core::GetScratchResource());
+  if (!ReadIndexArray(values, accessor.componentType, sparseValues.size(),
+                      sparseValues.data())) {
+    return false;
+  }
+
+  for (size_t i = 0; i < sparseIndices.size(); ++i) {
+    if (sparseIndices[i] < indices.size()) {
+      indices[sparseIndices[i]] = sparseValues[i];
+    }
+  }
+
+  return true;
+}
+
+}  // namespace resource
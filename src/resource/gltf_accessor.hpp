@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+#include <tiny_gltf.h>
+
+namespace resource {
+
+/**
+ * @brief Strided float destination for accessor decoding.
+ *
+ * `components` floats are written per element, `stride` bytes apart. Any
+ * component the accessor does not provide is taken from `fill`, e.g. alpha
+ * for a VEC3 color.
+ */
+struct AccessorTarget {
+  float* data{nullptr};
+  size_t stride{0};
+  uint32_t components{0};
+  std::array<float, 4> fill{0.0F, 0.0F, 0.0F, 0.0F};
+};
+
+/**
+ * @brief Bytes of each buffer of a glTF model, by buffer index.
+ *
+ * Usually views of tinygltf::Buffer::data, but a buffer may live elsewhere,
+ * such as the BIN chunk of a memory-mapped .glb that was never copied.
+ */
+using BufferData = std::vector<std::span<const uint8_t>>;
+
+/**
+ * @brief View the data tinygltf loaded for each buffer of a model.
+ */
+BufferData GetBufferData(const tinygltf::Model& model);
+
+/**
+ * @brief Convert up to `count` elements of a glTF accessor to floats.
+ *
+ * The conversion kernel is specialized on component type, component count
+ * and normalization and chosen once for the whole accessor. Normalized
+ * integer types follow the glTF rules (signed types clamp at -1), sparse
+ * substitutions are applied on top of the dense data, and an accessor
+ * without a buffer view reads as zeros.
+ *
+ * @return false if the accessor type is unsupported or its data is out of
+ * bounds; the destination is left partially written in that case
+ */
+bool ReadAccessor(const tinygltf::Model& model, const BufferData& buffers,
+                  const tinygltf::Accessor& accessor, size_t count,
+                  const AccessorTarget& target);
+
+/**
+ * @brief Decode an index accessor (u8, u16 or u32, sparse allowed).
+ *
+ * @return false if the accessor is not a valid scalar integer accessor
+ */
+bool ReadIndices(const tinygltf::Model& model, const BufferData& buffers,
+                 const tinygltf::Accessor& accessor,
+                 std::pmr::vector<uint32_t>& indices);
+
+}  // namespace resource
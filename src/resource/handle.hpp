@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+namespace resource {
+/**
+ * @brief Generational reference to a slot of a resource cache.
+ *
+ * The slot's generation changes when its resource is evicted, so a handle
+ * kept past that resolves to nothing rather than to whatever reuses the
+ * slot.
+ */
+template <typename Tag>
+struct Handle {
+  static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
+  uint32_t index{kInvalidIndex};
+  uint32_t generation{0};
+
+  [[nodiscard]] bool IsValid() const { return index != kInvalidIndex; }
+
+  bool operator==(const Handle&) const = default;
+};
+
+struct Model;
+struct Mesh;
+struct TextureResource;
+
+using ModelHandle = Handle<Model>;
+using MeshHandle = Handle<Mesh>;
+using TextureHandle = Handle<TextureResource>;
+}  // namespace resource
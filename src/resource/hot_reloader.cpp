@@ -0,0 +1,100 @@
+#include "resource/hot_reloader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <string>
+#include <string_view>
+
+#include "logger.hpp"
+#include "rhi/shader_utils.hpp"
+
+namespace resource {
+namespace {
+// Files a model is loaded from
+constexpr std::array<std::string_view, 8> kModelExtensions{
+    ".gltf", ".glb", ".bin", ".vkrpack", ".png", ".jpg", ".jpeg", ".ktx2",
+};
+
+std::string GetExtension(const std::filesystem::path& path) {
+  std::string extension = path.extension().string();
+  std::ranges::transform(extension, extension.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  return extension;
+}
+}  // namespace
+
+HotReloader::HotReloader(ResourceManager& resources,
+                         renderer::PipelineManager& pipelines)
+    : resources_{resources}, pipelines_{pipelines} {
+  worker_ = std::jthread{[this](const std::stop_token& stop) { Run(stop); }};
+}
+
+HotReloader::~HotReloader() = default;
+
+bool HotReloader::Watch(const std::filesystem::path& directory) {
+  if (!watcher_.Watch(directory)) {
+    LOG_WARNING("Cannot watch {} for changes", directory.string());
+    return false;
+  }
+  LOG_INFO("Watching {} for changes", directory.string());
+  return true;
+}
+
+void HotReloader::Update() {
+  for (const auto& path : watcher_.TakeChanges()) {
+    std::string extension = GetExtension(path);
+    if (extension == ".spv") {
+      {
+        std::scoped_lock lock{mutex_};
+        requests_.push_back(path);
+      }
+      wake_.notify_one();
+    } else if (std::ranges::find(kModelExtensions, extension) !=
+               kModelExtensions.end()) {
+      if (uint32_t count = resources_.ReloadModels(path); count > 0) {
+        LOG_INFO("{} changed, reloading {} models", path.string(), count);
+      }
+    }
+  }
+
+  std::vector<
+      std::pair<std::filesystem::path, std::optional<std::vector<uint32_t>>>>
+      shaders;
+  {
+    std::scoped_lock lock{mutex_};
+    shaders.swap(shaders_);
+  }
+  for (auto& [path, spirv] : shaders) {
+    if (!spirv) {
+      LOG_ERROR("Failed to read changed shader: {}", path.string());
+      continue;
+    }
+    if (uint32_t count = pipelines_.ReloadShader(path, std::move(*spirv));
+        count > 0) {
+      LOG_INFO("Reloaded {}, rebuilt {} pipelines", path.string(), count);
+    }
+  }
+}
+
+void HotReloader::Run(const std::stop_token& stop) {
+  while (true) {
+    std::filesystem::path path;
+    {
+      std::unique_lock lock{mutex_};
+      if (!wake_.wait(lock, stop, [this] { return !requests_.empty(); })) {
+        return;
+      }
+      path = std::move(requests_.front());
+      requests_.pop_front();
+    }
+
+    auto spirv = rhi::LoadSPIRV(path);
+
+    std::scoped_lock lock{mutex_};
+    shaders_.emplace_back(std::move(path), std::move(spirv));
+  }
+}
+
+}  // namespace resource
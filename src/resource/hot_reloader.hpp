@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "io/file_watcher.hpp"
+#include "renderer/pipeline_manager.hpp"
+#include "resource/resource_manager.hpp"
+
+namespace resource {
+
+/**
+ * @brief Reloads models, their images and shaders when their files change.
+ *
+ * Changed glTF files, buffers, images and cooked packs are handed to
+ * ResourceManager::ReloadModels, which reads the affected models on its
+ * loader threads and patches them in. Changed SPIR-V is read on a worker
+ * thread and the pipelines using it are rebuilt. Compute shaders are not
+ * reloaded.
+ */
+class HotReloader {
+ public:
+  HotReloader(ResourceManager& resources,
+              renderer::PipelineManager& pipelines);
+  ~HotReloader();
+
+  HotReloader(const HotReloader&) = delete;
+  HotReloader& operator=(const HotReloader&) = delete;
+  HotReloader(HotReloader&&) = delete;
+  HotReloader& operator=(HotReloader&&) = delete;
+
+  /**
+   * @brief Watch a directory tree for changes.
+   *
+   * @return false if it cannot be watched
+   */
+  bool Watch(const std::filesystem::path& directory);
+
+  /**
+   * @brief Start reloads for changed files and rebuild pipelines for shaders
+   * that were read.
+   *
+   * Call once per frame between frames, before ResourceManager::Update.
+   */
+  void Update();
+
+ private:
+  void Run(const std::stop_token& stop);
+
+  ResourceManager& resources_;
+  renderer::PipelineManager& pipelines_;
+  io::FileWatcher watcher_;
+
+  // Shared with the worker
+  std::mutex mutex_;
+  std::condition_variable_any wake_;
+  std::deque<std::filesystem::path> requests_;
+  std::vector<
+      std::pair<std::filesystem::path, std::optional<std::vector<uint32_t>>>>
+      shaders_;
+
+  // Last member so it stops before the state above goes away
+  std::jthread worker_;
+};
+
+}  // namespace resource
@@ -0,0 +1,168 @@
+#include "resource/ktx2.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "logger.hpp"
+
+namespace resource {
+namespace {
+constexpr std::array<uint8_t, 12> kIdentifier{
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+struct Ktx2Header {
+  std::array<uint8_t, 12> identifier{};
+  uint32_t vkFormat{0};
+  uint32_t typeSize{0};
+  uint32_t pixelWidth{0};
+  uint32_t pixelHeight{0};
+  uint32_t pixelDepth{0};
+  uint32_t layerCount{0};
+  uint32_t faceCount{0};
+  uint32_t levelCount{0};
+  uint32_t supercompressionScheme{0};
+  uint32_t dfdByteOffset{0};
+  uint32_t dfdByteLength{0};
+  uint32_t kvdByteOffset{0};
+  uint32_t kvdByteLength{0};
+  uint64_t sgdByteOffset{0};
+  uint64_t sgdByteLength{0};
+};
+static_assert(sizeof(Ktx2Header) == 80);
+
+struct Ktx2LevelIndex {
+  uint64_t byteOffset{0};
+  uint64_t byteLength{0};
+  uint64_t uncompressedByteLength{0};
+};
+static_assert(sizeof(Ktx2LevelIndex) == 24);
+
+// VkFormat values; sRGB variants load as UNORM because the shaders expect
+// the stored values, as with every other texture
+std::optional<rhi::Format> FromVkFormat(uint32_t vkFormat) {
+  switch (vkFormat) {
+    case 9:  // VK_FORMAT_R8_UNORM
+      return rhi::Format::R8Unorm;
+    case 16:  // VK_FORMAT_R8G8_UNORM
+      return rhi::Format::R8G8Unorm;
+    case 37:  // VK_FORMAT_R8G8B8A8_UNORM
+    case 43:  // VK_FORMAT_R8G8B8A8_SRGB
+      return rhi::Format::R8G8B8A8Unorm;
+    case 44:  // VK_FORMAT_B8G8R8A8_UNORM
+    case 50:  // VK_FORMAT_B8G8R8A8_SRGB
+      return rhi::Format::B8G8R8A8Unorm;
+    case 76:  // VK_FORMAT_R16_SFLOAT
+      return rhi::Format::R16Sfloat;
+    case 83:  // VK_FORMAT_R16G16_SFLOAT
+      return rhi::Format::R16G16Sfloat;
+    case 97:  // VK_FORMAT_R16G16B16A16_SFLOAT
+      return rhi::Format::R16G16B16A16Sfloat;
+    case 100:  // VK_FORMAT_R32_SFLOAT
+      return rhi::Format::R32Sfloat;
+    case 103:  // VK_FORMAT_R32G32_SFLOAT
+      return rhi::Format::R32G32Sfloat;
+    case 109:  // VK_FORMAT_R32G32B32A32_SFLOAT
+      return rhi::Format::R32G32B32A32Sfloat;
+    case 133:  // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+    case 134:  // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+      return rhi::Format::Bc1RgbaUnorm;
+    case 137:  // VK_FORMAT_BC3_UNORM_BLOCK
+    case 138:  // VK_FORMAT_BC3_SRGB_BLOCK
+      return rhi::Format::Bc3RgbaUnorm;
+    case 139:  // VK_FORMAT_BC4_UNORM_BLOCK
+      return rhi::Format::Bc4Unorm;
+    case 141:  // VK_FORMAT_BC5_UNORM_BLOCK
+      return rhi::Format::Bc5Unorm;
+    case 145:  // VK_FORMAT_BC7_UNORM_BLOCK
+    case 146:  // VK_FORMAT_BC7_SRGB_BLOCK
+      return rhi::Format::Bc7Unorm;
+    default:
+      return std::nullopt;
+  }
+}
+}  // namespace
+
+std::span<const std::byte> Ktx2Image::GetImage(uint32_t level, uint32_t layer,
+                                               uint32_t face) const {
+  uint64_t imageSize = rhi::GetMipLevelSize(format, width, height, level);
+  uint64_t offset = ((static_cast<uint64_t>(layer) * faceCount) + face) *
+                    imageSize;
+  return levels[level].subspan(offset, imageSize);
+}
+
+bool IsKtx2(std::span<const std::byte> bytes) {
+  return bytes.size() >= kIdentifier.size() &&
+         std::memcmp(bytes.data(), kIdentifier.data(), kIdentifier.size()) ==
+             0;
+}
+
+std::optional<Ktx2Image> ParseKtx2(std::span<const std::byte> bytes) {
+  Ktx2Header header{};
+  if (!IsKtx2(bytes) || bytes.size() < sizeof(header)) {
+    LOG_ERROR("Not a KTX2 file");
+    return std::nullopt;
+  }
+  std::memcpy(&header, bytes.data(), sizeof(header));
+
+  if (header.supercompressionScheme != 0 || header.vkFormat == 0) {
+    LOG_ERROR(
+        "KTX2 supercompression (scheme {}) is not supported; re-encode as "
+        "plain BCn",
+        header.supercompressionScheme);
+    return std::nullopt;
+  }
+  auto format = FromVkFormat(header.vkFormat);
+  if (!format) {
+    LOG_ERROR("Unsupported KTX2 VkFormat {}", header.vkFormat);
+    return std::nullopt;
+  }
+  if (header.pixelWidth == 0 || header.pixelDepth > 1 ||
+      (header.faceCount != 1 && header.faceCount != 6)) {
+    LOG_ERROR("Only 2D and cubemap KTX2 textures are supported");
+    return std::nullopt;
+  }
+
+  Ktx2Image image;
+  image.format = *format;
+  image.width = header.pixelWidth;
+  image.height = std::max(header.pixelHeight, 1U);
+  // Zero levels asks the loader to generate mips; only the base is stored
+  image.mipLevels = std::max(header.levelCount, 1U);
+  image.layerCount = std::max(header.layerCount, 1U);
+  image.faceCount = header.faceCount;
+
+  if (image.mipLevels > rhi::GetMipLevelCount(image.width, image.height)) {
+    LOG_ERROR("KTX2 file has more levels than its size allows");
+    return std::nullopt;
+  }
+  uint64_t indexEnd =
+      sizeof(header) + (sizeof(Ktx2LevelIndex) * image.mipLevels);
+  if (bytes.size() < indexEnd) {
+    LOG_ERROR("KTX2 level index is truncated");
+    return std::nullopt;
+  }
+
+  image.levels.reserve(image.mipLevels);
+  for (uint32_t level = 0; level < image.mipLevels; ++level) {
+    Ktx2LevelIndex index{};
+    std::memcpy(&index,
+                bytes.data() + sizeof(header) + (sizeof(index) * level),
+                sizeof(index));
+
+    uint64_t expected =
+        rhi::GetMipLevelSize(image.format, image.width, image.height, level) *
+        image.layerCount * image.faceCount;
+    if (index.byteOffset > bytes.size() ||
+        index.byteLength > bytes.size() - index.byteOffset ||
+        index.byteLength < expected) {
+      LOG_ERROR("KTX2 level {} is out of bounds", level);
+      return std::nullopt;
+    }
+    image.levels.push_back(bytes.subspan(index.byteOffset, expected));
+  }
+
+  return image;
+}
+
+}  // namespace resource
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "rhi/types.hpp"
+
+namespace resource {
+
+/**
+ * @brief A parsed KTX2 container whose level data views the source bytes.
+ *
+ * Only containers without supercompression are supported; Basis Universal
+ * and Zstd payloads need a transcoder and are rejected.
+ */
+struct Ktx2Image {
+  rhi::Format format{rhi::Format::Undefined};
+  uint32_t width{0};
+  uint32_t height{0};
+  uint32_t mipLevels{1};
+  uint32_t layerCount{1};  // Array layers
+  uint32_t faceCount{1};   // 6 for cubemaps
+  // Base level first; each holds every layer and face of its level
+  std::vector<std::span<const std::byte>> levels;
+
+  /**
+   * @brief The image of one face of one layer in a level.
+   */
+  [[nodiscard]] std::span<const std::byte> GetImage(uint32_t level,
+                                                    uint32_t layer = 0,
+                                                    uint32_t face = 0) const;
+};
+
+/**
+ * @brief Whether the bytes start with the KTX2 identifier.
+ */
+bool IsKtx2(std::span<const std::byte> bytes);
+
+/**
+ * @brief Parse a KTX2 container without copying its level data.
+ *
+ * @param bytes Whole file contents; must outlive the result
+ * @return The image or nullopt if it is malformed or unsupported
+ */
+std::optional<Ktx2Image> ParseKtx2(std::span<const std::byte> bytes);
+
+}  // namespace resource
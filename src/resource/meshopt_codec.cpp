@@ -0,0 +1,682 @@
+#include "resource/meshopt_codec.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define VKR_MESHOPT_SSE 1
+  #include <immintrin.h>
+#endif
+
+#include "core/parallel.hpp"
+
+namespace resource {
+namespace {
+
+// Bitstream constants shared with meshoptimizer's encoder (format version 0
+// for vertices, 0 and 1 for indices)
+constexpr uint8_t kVertexHeader = 0xa0;
+constexpr uint8_t kIndexHeader = 0xe0;
+constexpr uint8_t kSequenceHeader = 0xd0;
+
+constexpr size_t kVertexBlockSizeBytes = 8192;
+constexpr size_t kVertexBlockMaxSize = 256;
+constexpr size_t kByteGroupSize = 16;
+constexpr size_t kByteGroupDecodeLimit = 24;
+constexpr size_t kTailMaxSize = 32;
+
+size_t GetVertexBlockSize(size_t vertexSize) {
+  size_t result = kVertexBlockSizeBytes / vertexSize;
+  result &= ~(kByteGroupSize - 1);
+  return std::min(result, kVertexBlockMaxSize);
+}
+
+#ifndef VKR_MESHOPT_SSE
+uint8_t Unzigzag8(uint8_t v) {
+  return static_cast<uint8_t>(-(v & 1) ^ (v >> 1));
+}
+#endif
+
+// Unpack one group of 16 bytes stored with 0, 2, 4 or 8 bits per value;
+// values equal to the all-ones sentinel are followed by a full byte
+const uint8_t* DecodeBytesGroup(const uint8_t* data, uint8_t* buffer,
+                                int bitsLog2) {
+  if (bitsLog2 == 0) {
+    std::memset(buffer, 0, kByteGroupSize);
+    return data;
+  }
+  if (bitsLog2 == 3) {
+    std::memcpy(buffer, data, kByteGroupSize);
+    return data + kByteGroupSize;
+  }
+
+  const int bits = bitsLog2 == 1 ? 2 : 4;
+  const int valuesPerByte = 8 / bits;
+  const auto sentinel = static_cast<uint8_t>((1 << bits) - 1);
+  const size_t selectorBytes = kByteGroupSize / valuesPerByte;
+
+  const uint8_t* extra = data + selectorBytes;
+  for (size_t i = 0; i < selectorBytes; ++i) {
+    uint8_t byte = data[i];
+    for (int j = 0; j < valuesPerByte; ++j) {
+      auto value = static_cast<uint8_t>(byte >> (8 - bits));
+      byte = static_cast<uint8_t>(byte << bits);
+      if (value == sentinel) {
+        value = *extra++;
+      }
+      *buffer++ = value;
+    }
+  }
+  return extra;
+}
+
+const uint8_t* DecodeBytes(const uint8_t* data, const uint8_t* dataEnd,
+                           uint8_t* buffer, size_t bufferSize) {
+  const uint8_t* header = data;
+  size_t headerSize = ((bufferSize / kByteGroupSize) + 3) / 4;
+  if (static_cast<size_t>(dataEnd - data) < headerSize) {
+    return nullptr;
+  }
+  data += headerSize;
+
+  for (size_t i = 0; i < bufferSize; i += kByteGroupSize) {
+    if (static_cast<size_t>(dataEnd - data) < kByteGroupDecodeLimit) {
+      return nullptr;
+    }
+    size_t group = i / kByteGroupSize;
+    int bitsLog2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+    data = DecodeBytesGroup(data, buffer + i, bitsLog2);
+  }
+  return data;
+}
+
+// Reverse the per-byte delta encoding of one attribute byte across a block
+// and scatter it into the interleaved vertices
+void UndoDeltas(const uint8_t* buffer, size_t vertexCount, size_t vertexSize,
+                size_t byteIndex, uint8_t previous, uint8_t* transposed) {
+  size_t i = 0;
+#ifdef VKR_MESHOPT_SSE
+  const __m128i one = _mm_set1_epi8(1);
+  const __m128i lowBits = _mm_set1_epi8(0x7f);
+  alignas(16) std::array<uint8_t, kByteGroupSize> values{};
+
+  for (; i < vertexCount; i += kByteGroupSize) {
+    __m128i x = _mm_loadu_si128(std::bit_cast<const __m128i*>(buffer + i));
+
+    // Unzigzag: (0 - (x & 1)) ^ (x >> 1)
+    __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(x, one));
+    __m128i half = _mm_and_si128(_mm_srli_epi16(x, 1), lowBits);
+    x = _mm_xor_si128(sign, half);
+
+    // Inclusive prefix sum across the 16 lanes, seeded with the last value
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 1));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 2));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+    x = _mm_add_epi8(x, _mm_set1_epi8(static_cast<char>(previous)));
+
+    _mm_store_si128(std::bit_cast<__m128i*>(values.data()), x);
+    previous = values[kByteGroupSize - 1];
+
+    size_t groupEnd = std::min(kByteGroupSize, vertexCount - i);
+    for (size_t j = 0; j < groupEnd; ++j) {
+      transposed[((i + j) * vertexSize) + byteIndex] = values[j];
+    }
+  }
+#else
+  for (; i < vertexCount; ++i) {
+    previous = static_cast<uint8_t>(Unzigzag8(buffer[i]) + previous);
+    transposed[(i * vertexSize) + byteIndex] = previous;
+  }
+#endif
+}
+
+const uint8_t* DecodeVertexBlock(const uint8_t* data, const uint8_t* dataEnd,
+                                 uint8_t* vertexData, size_t vertexCount,
+                                 size_t vertexSize, uint8_t* lastVertex) {
+  std::array<uint8_t, kVertexBlockMaxSize> buffer{};
+  std::array<uint8_t, kVertexBlockSizeBytes> transposed{};
+
+  size_t alignedCount =
+      (vertexCount + kByteGroupSize - 1) & ~(kByteGroupSize - 1);
+
+  for (size_t k = 0; k < vertexSize; ++k) {
+    data = DecodeBytes(data, dataEnd, buffer.data(), alignedCount);
+    if (data == nullptr) {
+      return nullptr;
+    }
+    UndoDeltas(buffer.data(), vertexCount, vertexSize, k, lastVertex[k],
+               transposed.data());
+  }
+
+  std::memcpy(vertexData, transposed.data(), vertexCount * vertexSize);
+  std::memcpy(lastVertex, &transposed[vertexSize * (vertexCount - 1)],
+              vertexSize);
+  return data;
+}
+
+bool DecodeVertexBuffer(uint8_t* destination, size_t vertexCount,
+                        size_t vertexSize, std::span<const uint8_t> source) {
+  if (vertexSize == 0 || vertexSize > 256 || vertexSize % 4 != 0) {
+    return false;
+  }
+
+  const uint8_t* data = source.data();
+  const uint8_t* dataEnd = data + source.size();
+  if (source.size() < 1 + vertexSize) {
+    return false;
+  }
+
+  uint8_t header = *data++;
+  if ((header & 0xf0) != kVertexHeader || (header & 0x0f) != 0) {
+    return false;
+  }
+
+  // The first vertex of the stream is stored in the tail
+  std::array<uint8_t, 256> lastVertex{};
+  std::memcpy(lastVertex.data(), dataEnd - vertexSize, vertexSize);
+
+  size_t blockSize = GetVertexBlockSize(vertexSize);
+  for (size_t offset = 0; offset < vertexCount; offset += blockSize) {
+    size_t count = std::min(blockSize, vertexCount - offset);
+    data = DecodeVertexBlock(data, dataEnd, destination + (offset * vertexSize),
+                             count, vertexSize, lastVertex.data());
+    if (data == nullptr) {
+      return false;
+    }
+  }
+
+  size_t tailSize = std::max(vertexSize, kTailMaxSize);
+  return static_cast<size_t>(dataEnd - data) == tailSize;
+}
+
+uint32_t DecodeVByte(const uint8_t*& data) {
+  uint8_t lead = *data++;
+  if (lead < 128) {
+    return lead;
+  }
+
+  // At most four continuation bytes, so malformed data still terminates
+  uint32_t result = lead & 127U;
+  uint32_t shift = 7;
+  for (int i = 0; i < 4; ++i) {
+    uint8_t group = *data++;
+    result |= static_cast<uint32_t>(group & 127U) << shift;
+    shift += 7;
+    if (group < 128) {
+      break;
+    }
+  }
+  return result;
+}
+
+uint32_t DecodeIndex(const uint8_t*& data, uint32_t last) {
+  uint32_t v = DecodeVByte(data);
+  uint32_t delta = (v >> 1) ^ (0U - (v & 1));
+  return last + delta;
+}
+
+void WriteIndex(uint8_t* destination, size_t i, size_t indexSize,
+                uint32_t value) {
+  if (indexSize == 2) {
+    auto narrow = static_cast<uint16_t>(value);
+    std::memcpy(destination + (i * 2), &narrow, sizeof(narrow));
+  } else {
+    std::memcpy(destination + (i * 4), &value, sizeof(value));
+  }
+}
+
+struct IndexFifos {
+  std::array<std::array<uint32_t, 2>, 16> edges{};
+  std::array<uint32_t, 16> vertices{};
+  size_t edgeOffset{0};
+  size_t vertexOffset{0};
+
+  IndexFifos() {
+    for (auto& edge : edges) {
+      edge = {~0U, ~0U};
+    }
+    vertices.fill(~0U);
+  }
+
+  void PushEdge(uint32_t a, uint32_t b) {
+    edges[edgeOffset] = {a, b};
+    edgeOffset = (edgeOffset + 1) & 15;
+  }
+
+  void PushVertex(uint32_t v, bool advance = true) {
+    vertices[vertexOffset] = v;
+    vertexOffset = (vertexOffset + (advance ? 1 : 0)) & 15;
+  }
+};
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+bool DecodeIndexBuffer(uint8_t* destination, size_t indexCount,
+                       size_t indexSize, std::span<const uint8_t> source) {
+  if (indexCount % 3 != 0 || (indexSize != 2 && indexSize != 4)) {
+    return false;
+  }
+  // Header, one code byte per triangle and the 16-byte codeaux table
+  if (source.size() < 1 + (indexCount / 3) + 16) {
+    return false;
+  }
+  if ((source[0] & 0xf0) != kIndexHeader) {
+    return false;
+  }
+  int version = source[0] & 0x0f;
+  if (version > 1) {
+    return false;
+  }
+
+  IndexFifos fifo;
+  uint32_t next = 0;
+  uint32_t last = 0;
+  int fecMax = version >= 1 ? 13 : 15;
+
+  const uint8_t* code = source.data() + 1;
+  const uint8_t* data = code + (indexCount / 3);
+  const uint8_t* dataSafeEnd = source.data() + source.size() - 16;
+  const uint8_t* codeAuxTable = dataSafeEnd;
+
+  auto write = [&](size_t i, uint32_t a, uint32_t b, uint32_t c) {
+    WriteIndex(destination, i + 0, indexSize, a);
+    WriteIndex(destination, i + 1, indexSize, b);
+    WriteIndex(destination, i + 2, indexSize, c);
+  };
+
+  for (size_t i = 0; i < indexCount; i += 3) {
+    // A triangle reads at most 16 data bytes, which the table tail covers
+    if (data > dataSafeEnd) {
+      return false;
+    }
+
+    uint8_t codeTri = *code++;
+
+    if (codeTri < 0xf0) {
+      // Edge from the FIFO plus one vertex
+      int fe = codeTri >> 4;
+      uint32_t a = fifo.edges[(fifo.edgeOffset - 1 - fe) & 15][0];
+      uint32_t b = fifo.edges[(fifo.edgeOffset - 1 - fe) & 15][1];
+      int fec = codeTri & 15;
+
+      if (fec < fecMax) {
+        uint32_t c = fec == 0
+                         ? next
+                         : fifo.vertices[(fifo.vertexOffset - 1 - fec) & 15];
+        bool isNew = fec == 0;
+        next += isNew ? 1 : 0;
+
+        write(i, a, b, c);
+        fifo.PushVertex(c, isNew);
+        fifo.PushEdge(c, b);
+        fifo.PushEdge(a, c);
+      } else {
+        // 13 and 14 encode last -1 and +1 in version 1
+        uint32_t c = fec != 15 ? last + static_cast<uint32_t>(fec - (fec ^ 3))
+                               : DecodeIndex(data, last);
+        last = c;
+
+        write(i, a, b, c);
+        fifo.PushVertex(c);
+        fifo.PushEdge(c, b);
+        fifo.PushEdge(a, c);
+      }
+    } else if (codeTri < 0xfe) {
+      // Three vertices, FIFO offsets looked up in the codeaux table
+      uint8_t codeAux = codeAuxTable[codeTri & 15];
+      int feb = codeAux >> 4;
+      int fec = codeAux & 15;
+
+      uint32_t a = next++;
+      uint32_t b =
+          feb == 0 ? next : fifo.vertices[(fifo.vertexOffset - feb) & 15];
+      bool bNew = feb == 0;
+      next += bNew ? 1 : 0;
+      uint32_t c =
+          fec == 0 ? next : fifo.vertices[(fifo.vertexOffset - fec) & 15];
+      bool cNew = fec == 0;
+      next += cNew ? 1 : 0;
+
+      write(i, a, b, c);
+      fifo.PushVertex(a);
+      fifo.PushVertex(b, bNew);
+      fifo.PushVertex(c, cNew);
+      fifo.PushEdge(b, a);
+      fifo.PushEdge(c, b);
+      fifo.PushEdge(a, c);
+    } else {
+      // Three vertices with an explicit codeaux byte and free indices
+      uint8_t codeAux = *data++;
+      int fea = codeTri == 0xfe ? 0 : 15;
+      int feb = codeAux >> 4;
+      int fec = codeAux & 15;
+
+      if (codeAux == 0) {
+        next = 0;
+      }
+
+      uint32_t a = fea == 0 ? next++ : 0;
+      uint32_t b = feb == 0
+                       ? next++
+                       : fifo.vertices[(fifo.vertexOffset - feb) & 15];
+      uint32_t c = fec == 0
+                       ? next++
+                       : fifo.vertices[(fifo.vertexOffset - fec) & 15];
+
+      if (fea == 15) {
+        last = a = DecodeIndex(data, last);
+      }
+      if (feb == 15) {
+        last = b = DecodeIndex(data, last);
+      }
+      if (fec == 15) {
+        last = c = DecodeIndex(data, last);
+      }
+
+      write(i, a, b, c);
+      fifo.PushVertex(a);
+      fifo.PushVertex(b, feb == 0 || feb == 15);
+      fifo.PushVertex(c, fec == 0 || fec == 15);
+      fifo.PushEdge(b, a);
+      fifo.PushEdge(c, b);
+      fifo.PushEdge(a, c);
+    }
+  }
+
+  return data == dataSafeEnd;
+}
+
+bool DecodeIndexSequence(uint8_t* destination, size_t indexCount,
+                         size_t indexSize, std::span<const uint8_t> source) {
+  if (indexSize != 2 && indexSize != 4) {
+    return false;
+  }
+  // Header, at least one byte per index and a 4-byte tail
+  if (source.size() < 1 + indexCount + 4) {
+    return false;
+  }
+  if ((source[0] & 0xf0) != kSequenceHeader || (source[0] & 0x0f) > 1) {
+    return false;
+  }
+
+  const uint8_t* data = source.data() + 1;
+  const uint8_t* dataSafeEnd = source.data() + source.size() - 4;
+  std::array<uint32_t, 2> last{};
+
+  for (size_t i = 0; i < indexCount; ++i) {
+    if (data >= dataSafeEnd) {
+      return false;
+    }
+
+    uint32_t v = DecodeVByte(data);
+    uint32_t baseline = v & 1;
+    v >>= 1;
+    uint32_t delta = (v >> 1) ^ (0U - (v & 1));
+    uint32_t index = last[baseline] + delta;
+    last[baseline] = index;
+
+    WriteIndex(destination, i, indexSize, index);
+  }
+
+  return data == dataSafeEnd;
+}
+
+template <typename T>
+void DecodeFilterOctahedral(uint8_t* data, size_t count) {
+  constexpr auto kMax = static_cast<float>((1 << ((sizeof(T) * 8) - 1)) - 1);
+
+  for (size_t i = 0; i < count; ++i) {
+    std::array<T, 4> v{};
+    std::memcpy(v.data(), data + (i * sizeof(v)), sizeof(v));
+
+    // Reconstruct z; the w lane carries the encoding's scale
+    auto x = static_cast<float>(v[0]);
+    auto y = static_cast<float>(v[1]);
+    float z = static_cast<float>(v[2]) - std::abs(x) - std::abs(y);
+
+    // Fix up octahedral coordinates for z < 0
+    float t = std::min(z, 0.0F);
+    x += x >= 0.0F ? t : -t;
+    y += y >= 0.0F ? t : -t;
+
+    float scale = kMax / std::sqrt((x * x) + (y * y) + (z * z));
+    v[0] = static_cast<T>(std::lround(x * scale));
+    v[1] = static_cast<T>(std::lround(y * scale));
+    v[2] = static_cast<T>(std::lround(z * scale));
+
+    std::memcpy(data + (i * sizeof(v)), v.data(), sizeof(v));
+  }
+}
+
+void DecodeFilterQuaternion(uint8_t* data, size_t count) {
+  const float kScale = 1.0F / std::sqrt(2.0F);
+
+  for (size_t i = 0; i < count; ++i) {
+    std::array<int16_t, 4> v{};
+    std::memcpy(v.data(), data + (i * sizeof(v)), sizeof(v));
+
+    // The scale is recovered from the high bits of the fourth component
+    int sf = v[3] | 3;
+    float ss = kScale / static_cast<float>(sf);
+
+    float x = static_cast<float>(v[0]) * ss;
+    float y = static_cast<float>(v[1]) * ss;
+    float z = static_cast<float>(v[2]) * ss;
+    float ww = 1.0F - (x * x) - (y * y) - (z * z);
+    float w = std::sqrt(std::max(ww, 0.0F));
+
+    // The low two bits pick which component was dropped
+    int qc = v[3] & 3;
+    std::array<int16_t, 4> out{};
+    out[(qc + 1) & 3] = static_cast<int16_t>(std::lround(x * 32767.0F));
+    out[(qc + 2) & 3] = static_cast<int16_t>(std::lround(y * 32767.0F));
+    out[(qc + 3) & 3] = static_cast<int16_t>(std::lround(z * 32767.0F));
+    out[(qc + 0) & 3] = static_cast<int16_t>(std::lround(w * 32767.0F));
+
+    std::memcpy(data + (i * sizeof(out)), out.data(), sizeof(out));
+  }
+}
+
+void DecodeFilterExponential(uint8_t* data, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t v = 0;
+    std::memcpy(&v, data + (i * sizeof(v)), sizeof(v));
+
+    // 24-bit signed mantissa, 8-bit signed exponent
+    int32_t mantissa = std::bit_cast<int32_t>(v << 8) >> 8;
+    int32_t exponent = std::bit_cast<int32_t>(v) >> 24;
+    float value = std::ldexp(static_cast<float>(mantissa), exponent);
+
+    std::memcpy(data + (i * sizeof(value)), &value, sizeof(value));
+  }
+}
+
+bool ApplyFilter(std::span<uint8_t> data, size_t count, size_t stride,
+                 MeshoptFilter filter) {
+  switch (filter) {
+    case MeshoptFilter::None:
+      return true;
+    case MeshoptFilter::Octahedral:
+      if (stride == 4) {
+        DecodeFilterOctahedral<int8_t>(data.data(), count);
+        return true;
+      }
+      if (stride == 8) {
+        DecodeFilterOctahedral<int16_t>(data.data(), count);
+        return true;
+      }
+      return false;
+    case MeshoptFilter::Quaternion:
+      if (stride != 8) {
+        return false;
+      }
+      DecodeFilterQuaternion(data.data(), count);
+      return true;
+    case MeshoptFilter::Exponential:
+      if (stride % 4 != 0) {
+        return false;
+      }
+      DecodeFilterExponential(data.data(), count * (stride / 4));
+      return true;
+  }
+  return false;
+}
+
+size_t GetSize(const tinygltf::Value& object, const char* key,
+               size_t fallback) {
+  if (!object.Has(key) || !object.Get(key).IsNumber()) {
+    return fallback;
+  }
+  return static_cast<size_t>(object.Get(key).GetNumberAsDouble());
+}
+
+std::string GetString(const tinygltf::Value& object, const char* key,
+                      const char* fallback) {
+  if (!object.Has(key) || !object.Get(key).IsString()) {
+    return fallback;
+  }
+  return object.Get(key).Get<std::string>();
+}
+
+struct MeshoptView {
+  size_t bufferView{0};
+  size_t buffer{0};
+  size_t byteOffset{0};
+  size_t byteLength{0};
+  size_t stride{0};
+  size_t count{0};
+  MeshoptMode mode{MeshoptMode::Attributes};
+  MeshoptFilter filter{MeshoptFilter::None};
+};
+
+bool ParseMeshoptView(const BufferData& buffers, size_t viewIndex,
+                      const tinygltf::Value& extension, MeshoptView& view) {
+  view.bufferView = viewIndex;
+  view.buffer = GetSize(extension, "buffer", buffers.size());
+  view.byteOffset = GetSize(extension, "byteOffset", 0);
+  view.byteLength = GetSize(extension, "byteLength", 0);
+  view.stride = GetSize(extension, "byteStride", 0);
+  view.count = GetSize(extension, "count", 0);
+
+  std::string mode = GetString(extension, "mode", "");
+  if (mode == "ATTRIBUTES") {
+    view.mode = MeshoptMode::Attributes;
+  } else if (mode == "TRIANGLES") {
+    view.mode = MeshoptMode::Triangles;
+  } else if (mode == "INDICES") {
+    view.mode = MeshoptMode::Indices;
+  } else {
+    return false;
+  }
+
+  std::string filter = GetString(extension, "filter", "NONE");
+  if (filter == "NONE") {
+    view.filter = MeshoptFilter::None;
+  } else if (filter == "OCTAHEDRAL") {
+    view.filter = MeshoptFilter::Octahedral;
+  } else if (filter == "QUATERNION") {
+    view.filter = MeshoptFilter::Quaternion;
+  } else if (filter == "EXPONENTIAL") {
+    view.filter = MeshoptFilter::Exponential;
+  } else {
+    return false;
+  }
+
+  return view.buffer < buffers.size() &&
+         view.byteOffset + view.byteLength <= buffers[view.buffer].size();
+}
+
+}  // namespace
+
+bool DecodeMeshoptStream(std::span<uint8_t> destination, size_t count,
+                         size_t stride, std::span<const uint8_t> source,
+                         MeshoptMode mode, MeshoptFilter filter) {
+  if (destination.size() != count * stride) {
+    return false;
+  }
+
+  bool decoded = false;
+  switch (mode) {
+    case MeshoptMode::Attributes:
+      decoded = DecodeVertexBuffer(destination.data(), count, stride, source);
+      break;
+    case MeshoptMode::Triangles:
+      decoded = DecodeIndexBuffer(destination.data(), count, stride, source);
+      break;
+    case MeshoptMode::Indices:
+      decoded = DecodeIndexSequence(destination.data(), count, stride, source);
+      break;
+  }
+
+  return decoded && ApplyFilter(destination, count, stride, filter);
+}
+
+bool DecompressMeshoptBufferViews(tinygltf::Model& model,
+                                  BufferData& buffers) {
+  std::vector<MeshoptView> views;
+  for (size_t i = 0; i < model.bufferViews.size(); ++i) {
+    const auto& extensions = model.bufferViews[i].extensions;
+    auto it = extensions.find("EXT_meshopt_compression");
+    if (it == extensions.end()) {
+      continue;
+    }
+
+    MeshoptView view;
+    if (!ParseMeshoptView(buffers, i, it->second, view)) {
+      return false;
+    }
+    views.push_back(view);
+  }
+
+  if (views.empty()) {
+    return true;
+  }
+
+  std::vector<std::vector<unsigned char>> decoded(views.size());
+  std::atomic<bool> success{true};
+
+  core::ParallelFor(views.size(), [&](size_t i) {
+    const auto& view = views[i];
+    decoded[i].resize(view.count * view.stride);
+
+    auto source = buffers[view.buffer].subspan(view.byteOffset,
+                                                view.byteLength);
+    if (!DecodeMeshoptStream(decoded[i], view.count, view.stride, source,
+                             view.mode, view.filter)) {
+      success.store(false, std::memory_order_relaxed);
+    }
+  });
+
+  if (!success.load()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < views.size(); ++i) {
+    auto& bufferView = model.bufferViews[views[i].bufferView];
+
+    tinygltf::Buffer buffer;
+    buffer.data = std::move(decoded[i]);
+    bufferView.buffer = static_cast<int>(model.buffers.size());
+    bufferView.byteOffset = 0;
+    bufferView.byteLength = buffer.data.size();
+    bufferView.extensions.erase("EXT_meshopt_compression");
+    model.buffers.push_back(std::move(buffer));
+  }
+
+  // Moving a buffer keeps its data where it is, so the views stay valid
+  for (size_t i = buffers.size(); i < model.buffers.size(); ++i) {
+    buffers.emplace_back(model.buffers[i].data);
+  }
+
+  return true;
+}
+
+}  // namespace resource
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include <tiny_gltf.h>
+
+#include "resource/gltf_accessor.hpp"
+
+namespace resource {
+
+enum class MeshoptMode : uint8_t {
+  Attributes,  // Vertex codec
+  Triangles,   // Index buffer codec
+  Indices,     // Index sequence codec
+};
+
+enum class MeshoptFilter : uint8_t {
+  None,
+  Octahedral,
+  Quaternion,
+  Exponential,
+};
+
+/**
+ * @brief Decode one EXT_meshopt_compression stream.
+ *
+ * @param destination Output of exactly count * stride bytes
+ * @return false if the stream is malformed or the parameters are invalid
+ */
+bool DecodeMeshoptStream(std::span<uint8_t> destination, size_t count,
+                         size_t stride, std::span<const uint8_t> source,
+                         MeshoptMode mode, MeshoptFilter filter);
+
+/**
+ * @brief Decode every buffer view that carries EXT_meshopt_compression.
+ *
+ * Each decoded view is moved into a new buffer of its own and the view is
+ * pointed at it, so accessors read it like any uncompressed view. Views are
+ * decoded in parallel.
+ *
+ * @param buffers Data of the model's buffers, which compressed views are
+ * read from; the new buffers are appended
+ * @return false if any view fails to decode
+ */
+bool DecompressMeshoptBufferViews(tinygltf::Model& model, BufferData& buffers);
+
+}  // namespace resource
@@ -0,0 +1,233 @@
+#include "resource/mip_generation.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define VKR_MIP_SSE 1
+  #include <immintrin.h>
+#endif
+
+#include "rhi/types.hpp"
+
+namespace resource {
+namespace {
+constexpr uint32_t kChannels = 4;
+
+// Linear values are quantized to this many steps before the sRGB lookup,
+// fine enough that every 8-bit sRGB code is reachable
+constexpr size_t kLinearToSrgbTableSize = 4096;
+
+uint8_t ToUnorm8(float value) {
+  return static_cast<uint8_t>(
+      std::lround(std::clamp(value, 0.0F, 1.0F) * 255.0F));
+}
+
+struct SrgbTables {
+  std::array<float, 256> toLinear{};
+  std::array<uint8_t, kLinearToSrgbTableSize> fromLinear{};
+};
+
+const SrgbTables& GetSrgbTables() {
+  static const SrgbTables kTables = [] {
+    SrgbTables tables;
+    for (size_t i = 0; i < tables.toLinear.size(); ++i) {
+      float c = static_cast<float>(i) / 255.0F;
+      tables.toLinear[i] = c <= 0.04045F
+                               ? c / 12.92F
+                               : std::pow((c + 0.055F) / 1.055F, 2.4F);
+    }
+    for (size_t i = 0; i < tables.fromLinear.size(); ++i) {
+      // Sample each bucket at its center
+      float c = (static_cast<float>(i) + 0.5F) /
+                static_cast<float>(kLinearToSrgbTableSize);
+      float srgb = c <= 0.0031308F
+                       ? c * 12.92F
+                       : (1.055F * std::pow(c, 1.0F / 2.4F)) - 0.055F;
+      tables.fromLinear[i] = ToUnorm8(srgb);
+    }
+    return tables;
+  }();
+  return kTables;
+}
+
+// The four source texels that make up one destination texel
+struct Footprint {
+  std::array<const uint8_t*, 4> texels;
+};
+
+Footprint GetFootprint(const uint8_t* src, uint32_t srcWidth, uint32_t y0,
+                       uint32_t y1, uint32_t x0, uint32_t x1) {
+  const uint8_t* row0 = src + (static_cast<size_t>(y0) * srcWidth * kChannels);
+  const uint8_t* row1 = src + (static_cast<size_t>(y1) * srcWidth * kChannels);
+  return {{
+      row0 + (x0 * kChannels),
+      row0 + (x1 * kChannels),
+      row1 + (x0 * kChannels),
+      row1 + (x1 * kChannels),
+  }};
+}
+
+void FilterLinear(const Footprint& fp, uint8_t* dst) {
+  for (uint32_t c = 0; c < kChannels; ++c) {
+    uint32_t sum =
+        fp.texels[0][c] + fp.texels[1][c] + fp.texels[2][c] + fp.texels[3][c];
+    dst[c] = static_cast<uint8_t>((sum + 2) / 4);
+  }
+}
+
+void FilterSrgb(const Footprint& fp, uint8_t* dst) {
+  const auto& tables = GetSrgbTables();
+
+  std::array<float, kChannels> sum{};
+  for (const uint8_t* texel : fp.texels) {
+    sum[0] += tables.toLinear[texel[0]];
+    sum[1] += tables.toLinear[texel[1]];
+    sum[2] += tables.toLinear[texel[2]];
+    sum[3] += static_cast<float>(texel[3]);
+  }
+
+  for (uint32_t c = 0; c < 3; ++c) {
+    auto index = static_cast<size_t>(
+        sum[c] * 0.25F * static_cast<float>(kLinearToSrgbTableSize));
+    dst[c] = tables.fromLinear[std::min(index, kLinearToSrgbTableSize - 1)];
+  }
+  dst[3] = static_cast<uint8_t>(std::lround(sum[3] * 0.25F));
+}
+
+void FilterNormal(const Footprint& fp, uint8_t* dst) {
+  std::array<float, kChannels> sum{};
+  for (const uint8_t* texel : fp.texels) {
+    for (uint32_t c = 0; c < kChannels; ++c) {
+      sum[c] += static_cast<float>(texel[c]);
+    }
+  }
+
+  // Average the decoded vectors, then bring the result back to unit length
+  float x = (sum[0] / (2.0F * 255.0F)) - 1.0F;
+  float y = (sum[1] / (2.0F * 255.0F)) - 1.0F;
+  float z = (sum[2] / (2.0F * 255.0F)) - 1.0F;
+  float length = std::sqrt((x * x) + (y * y) + (z * z));
+  if (length > 1e-6F) {
+    x /= length;
+    y /= length;
+    z /= length;
+  } else {
+    x = 0.0F;
+    y = 0.0F;
+    z = 1.0F;
+  }
+
+  dst[0] = ToUnorm8((x * 0.5F) + 0.5F);
+  dst[1] = ToUnorm8((y * 0.5F) + 0.5F);
+  dst[2] = ToUnorm8((z * 0.5F) + 0.5F);
+  dst[3] = static_cast<uint8_t>(std::lround(sum[3] * 0.25F));
+}
+
+#ifdef VKR_MIP_SSE
+// Two destination texels from a full 4x2 block of source texels
+void FilterLinearPair(const uint8_t* row0, const uint8_t* row1,
+                      uint8_t* dst) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i top = _mm_loadu_si128(std::bit_cast<const __m128i*>(row0));
+  __m128i bottom = _mm_loadu_si128(std::bit_cast<const __m128i*>(row1));
+
+  // Vertical sums in 16 bits: texels 0-1 and texels 2-3
+  __m128i left = _mm_add_epi16(_mm_unpacklo_epi8(top, zero),
+                               _mm_unpacklo_epi8(bottom, zero));
+  __m128i right = _mm_add_epi16(_mm_unpackhi_epi8(top, zero),
+                                _mm_unpackhi_epi8(bottom, zero));
+
+  // Horizontal sums of neighbouring texels, then a rounded divide by four
+  __m128i even = _mm_unpacklo_epi64(left, right);
+  __m128i odd = _mm_unpackhi_epi64(left, right);
+  __m128i sum = _mm_add_epi16(_mm_add_epi16(even, odd), _mm_set1_epi16(2));
+  __m128i average = _mm_srli_epi16(sum, 2);
+
+  _mm_storel_epi64(std::bit_cast<__m128i*>(dst),
+                   _mm_packus_epi16(average, zero));
+}
+#endif
+
+void DownsampleLevel(const uint8_t* src, uint32_t srcWidth,
+                     uint32_t srcHeight, uint8_t* dst, uint32_t dstWidth,
+                     uint32_t dstHeight, MipFilter filter) {
+  for (uint32_t y = 0; y < dstHeight; ++y) {
+    uint32_t y0 = std::min(y * 2, srcHeight - 1);
+    uint32_t y1 = std::min((y * 2) + 1, srcHeight - 1);
+    uint8_t* dstRow = dst + (static_cast<size_t>(y) * dstWidth * kChannels);
+
+    uint32_t x = 0;
+#ifdef VKR_MIP_SSE
+    if (filter == MipFilter::Linear) {
+      const uint8_t* row0 =
+          src + (static_cast<size_t>(y0) * srcWidth * kChannels);
+      const uint8_t* row1 =
+          src + (static_cast<size_t>(y1) * srcWidth * kChannels);
+      // Pairs whose four source columns all exist
+      for (; (x + 1) < dstWidth && (x * 2) + 3 < srcWidth; x += 2) {
+        FilterLinearPair(row0 + (x * 2 * kChannels),
+                         row1 + (x * 2 * kChannels), dstRow + (x * kChannels));
+      }
+    }
+#endif
+
+    for (; x < dstWidth; ++x) {
+      uint32_t x0 = std::min(x * 2, srcWidth - 1);
+      uint32_t x1 = std::min((x * 2) + 1, srcWidth - 1);
+      Footprint fp = GetFootprint(src, srcWidth, y0, y1, x0, x1);
+      uint8_t* out = dstRow + (x * kChannels);
+
+      switch (filter) {
+        case MipFilter::Linear:
+          FilterLinear(fp, out);
+          break;
+        case MipFilter::Srgb:
+          FilterSrgb(fp, out);
+          break;
+        case MipFilter::NormalMap:
+          FilterNormal(fp, out);
+          break;
+      }
+    }
+  }
+}
+}  // namespace
+
+std::vector<uint8_t> GenerateMipChain(std::span<const uint8_t> base,
+                                      uint32_t width, uint32_t height,
+                                      MipFilter filter) {
+  uint32_t levels = rhi::GetMipLevelCount(width, height);
+
+  size_t totalSize = 0;
+  for (uint32_t level = 0; level < levels; ++level) {
+    totalSize += static_cast<size_t>(std::max(1U, width >> level)) *
+                 std::max(1U, height >> level) * kChannels;
+  }
+
+  std::vector<uint8_t> chain(totalSize);
+  std::copy(base.begin(), base.end(), chain.begin());
+
+  size_t srcOffset = 0;
+  size_t dstOffset = base.size();
+  for (uint32_t level = 1; level < levels; ++level) {
+    uint32_t srcWidth = std::max(1U, width >> (level - 1));
+    uint32_t srcHeight = std::max(1U, height >> (level - 1));
+    uint32_t dstWidth = std::max(1U, width >> level);
+    uint32_t dstHeight = std::max(1U, height >> level);
+
+    DownsampleLevel(chain.data() + srcOffset, srcWidth, srcHeight,
+                    chain.data() + dstOffset, dstWidth, dstHeight, filter);
+
+    srcOffset = dstOffset;
+    dstOffset += static_cast<size_t>(dstWidth) * dstHeight * kChannels;
+  }
+
+  return chain;
+}
+
+}  // namespace resource
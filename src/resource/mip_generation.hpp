@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace resource {
+
+/**
+ * @brief How texel values are combined when downsampling.
+ */
+enum class MipFilter : uint8_t {
+  Linear,     // Data maps (metallic-roughness, occlusion)
+  Srgb,       // Color; RGB is averaged in linear light, alpha as-is
+  NormalMap,  // Tangent-space normals; averaged and renormalized
+};
+
+/**
+ * @brief Build the full mip chain of an RGBA8 image with a 2x2 box filter.
+ *
+ * Each level halves the previous one (rounding down, at least 1 texel);
+ * odd edges repeat their last row or column.
+ *
+ * @param base Tightly packed base level, width * height * 4 bytes
+ * @return All levels, base level first, tightly packed one after another
+ */
+std::vector<uint8_t> GenerateMipChain(std::span<const uint8_t> base,
+                                      uint32_t width, uint32_t height,
+                                      MipFilter filter);
+
+}  // namespace resource
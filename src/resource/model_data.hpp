@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "core/hash.hpp"
+#include "ecs/components.hpp"
+#include "resource/types.hpp"
+#include "rhi/types.hpp"
+
+namespace resource {
+
+// ============================================================================
+// CPU-side model data
+// ============================================================================
+// Everything a Model needs, with vertex, index and texel data already in the
+// layout the GPU consumes. Produced by the glTF importer or read straight out
+// of a mapped model pack, and turned into GPU resources by
+// ModelLoader::Upload.
+
+struct MeshData {
+  std::string name;
+  ecs::VertexFormat vertexFormat{ecs::VertexFormat::Float};
+  glm::mat4 positionDequantization{1.0F};
+  rhi::IndexType indexType{rhi::IndexType::Uint32};
+  std::span<const std::byte> vertices;
+  std::span<const std::byte> indices;
+  std::vector<MeshPrimitive> primitives;
+  ecs::BoundingBoxComponent bounds;
+};
+
+struct TextureData {
+  std::string name;
+  uint32_t width{0};
+  uint32_t height{0};
+  rhi::Format format{rhi::Format::R8G8B8A8Unorm};
+  uint32_t mipLevels{1};
+  std::span<const std::byte> pixels;
+  // Where each level starts in `pixels`, base first. Empty when the levels
+  // are tightly packed largest first; KTX2 files store them the other way
+  std::vector<uint64_t> levelOffsets;
+  // ComputeContentHash of the texture; zero when not computed yet
+  uint64_t contentHash{0};
+
+  [[nodiscard]] std::span<const std::byte> GetLevel(uint32_t level) const {
+    uint64_t size = rhi::GetMipLevelSize(format, width, height, level);
+    uint64_t offset = 0;
+    if (level < levelOffsets.size()) {
+      offset = levelOffsets[level];
+    } else {
+      for (uint32_t i = 0; i < level; ++i) {
+        offset += rhi::GetMipLevelSize(format, width, height, i);
+      }
+    }
+    if (offset > pixels.size() || size > pixels.size() - offset) {
+      return {};
+    }
+    return pixels.subspan(offset, size);
+  }
+
+  /**
+   * @brief Hash of the size, format and every level's texels; equal textures
+   * share GPU memory however they were named or stored.
+   */
+  [[nodiscard]] uint64_t ComputeContentHash() const {
+    std::array<uint32_t, 4> header{width, height,
+                                   static_cast<uint32_t>(format), mipLevels};
+    uint64_t hash = core::HashValue(header);
+    for (uint32_t level = 0; level < mipLevels; ++level) {
+      hash = core::HashBytes(GetLevel(level), hash);
+    }
+    return hash;
+  }
+};
+
+struct ModelData {
+  ModelData() = default;
+  ~ModelData() = default;
+
+  // Spans point into `storage`, which a copy would not carry along
+  ModelData(const ModelData&) = delete;
+  ModelData& operator=(const ModelData&) = delete;
+  ModelData(ModelData&&) = default;
+  ModelData& operator=(ModelData&&) = default;
+
+  /**
+   * @brief Take ownership of a blob and return a view of it.
+   */
+  std::span<const std::byte> Store(std::vector<uint8_t> bytes) {
+    auto& blob = storage.emplace_back(std::move(bytes));
+    return {std::bit_cast<const std::byte*>(blob.data()), blob.size()};
+  }
+
+  std::string name;
+  std::string sourcePath;
+
+  std::vector<MeshData> meshes;
+  std::vector<TextureData> textures;
+  std::vector<Material> materials;
+  std::vector<SceneNode> nodes;
+  std::vector<Light> lights;
+  std::vector<CameraData> cameras;
+
+  std::vector<uint32_t> rootNodes;
+
+  // Backing memory for the spans above unless they view a mapped pack
+  std::vector<std::vector<uint8_t>> storage;
+};
+
+}  // namespace resource
@@ -0,0 +1,1540 @@
+#include "resource/model_importer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory_resource>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <tiny_gltf.h>
+
+#include "core/arena.hpp"
+#include "core/parallel.hpp"
+#include "core/process_memory.hpp"
+#include "io/file_reader.hpp"
+#include "io/mapped_file.hpp"
+#include "logger.hpp"
+#include "resource/gltf_accessor.hpp"
+#include "resource/ktx2.hpp"
+#include "resource/meshopt_codec.hpp"
+#include "resource/mip_generation.hpp"
+#include "resource/scene_flattening.hpp"
+#include "resource/tangent_space.hpp"
+#include "resource/texture_compression.hpp"
+#include "resource/vertex_quantization.hpp"
+#include "resource/vertex_welding.hpp"
+
+namespace resource {
+namespace {
+// The largest index is then 0xFFFE, so 16-bit indices never hold the
+// primitive restart value
+constexpr uint32_t kMaxVerticesFor16BitIndices =
+    std::numeric_limits<uint16_t>::max();
+
+// Keeps KTX2 payloads as raw bytes for ParseKtx2 and decodes everything
+// else with stb_image as before
+bool LoadImageDataOrKtx2(tinygltf::Image* image, int imageIndex,
+                         std::string* err, std::string* warn, int reqWidth,
+                         int reqHeight, const unsigned char* bytes, int size,
+                         void* userData) {
+  std::span<const std::byte> data{std::bit_cast<const std::byte*>(bytes),
+                                  static_cast<size_t>(size)};
+  if (IsKtx2(data)) {
+    image->image.assign(bytes, bytes + size);
+    image->mimeType = "image/ktx2";
+    return true;
+  }
+  return tinygltf::LoadImageData(image, imageIndex, err, warn, reqWidth,
+                                 reqHeight, bytes, size, userData);
+}
+
+// External files of a glTF document, read in one batch before tinygltf asks
+// for them one at a time
+using PrefetchedFiles = std::unordered_map<std::string, io::FileBuffer>;
+
+std::string GetPrefetchKey(const std::filesystem::path& path) {
+  return path.lexically_normal().string();
+}
+
+// Undoes the percent-encoding of a URI
+std::string DecodeUri(std::string_view uri) {
+  std::string decoded;
+  decoded.reserve(uri.size());
+  for (size_t i = 0; i < uri.size(); ++i) {
+    uint8_t value = 0;
+    if (uri[i] == '%' && i + 2 < uri.size() &&
+        std::from_chars(uri.data() + i + 1, uri.data() + i + 3, value, 16)
+                .ptr == uri.data() + i + 3) {
+      decoded.push_back(static_cast<char>(value));
+      i += 2;
+    } else {
+      decoded.push_back(uri[i]);
+    }
+  }
+  return decoded;
+}
+
+// One-byte buffer tinygltf accepts in place of data it must not load
+constexpr const char* kStandInUri =
+    "data:application/octet-stream;base64,AA==";
+
+// Files the buffers and images of a glTF document point to
+std::vector<std::filesystem::path> GetExternalFiles(
+    const nlohmann::json& document, const std::filesystem::path& baseDir) {
+  std::vector<std::filesystem::path> files;
+  for (const char* key : {"buffers", "images"}) {
+    auto entries = document.find(key);
+    if (entries == document.end() || !entries->is_array()) {
+      continue;
+    }
+    for (const auto& entry : *entries) {
+      if (!entry.is_object()) {
+        continue;
+      }
+      auto uri = entry.find("uri");
+      if (uri != entry.end() && uri->is_string() &&
+          !uri->get_ref<const std::string&>().starts_with("data:")) {
+        files.push_back(baseDir /
+                        DecodeUri(uri->get_ref<const std::string&>()));
+      }
+    }
+  }
+  return files;
+}
+
+// EXT_meshopt_compression fallback buffers have neither a URI nor data,
+// which tinygltf rejects outside the GLB buffer. They are only read when
+// the decoder is missing, so each gets the stand-in; returns their indices
+std::vector<size_t> StandInFallbackBuffers(nlohmann::json& document) {
+  std::vector<size_t> replaced;
+  auto buffers = document.find("buffers");
+  if (buffers == document.end() || !buffers->is_array()) {
+    return replaced;
+  }
+  for (size_t i = 0; i < buffers->size(); ++i) {
+    auto& buffer = (*buffers)[i];
+    if (!buffer.is_object() || buffer.contains("uri")) {
+      continue;
+    }
+    auto extensions = buffer.find("extensions");
+    if (extensions == buffer.end() || !extensions->is_object()) {
+      continue;
+    }
+    auto meshopt = extensions->find("EXT_meshopt_compression");
+    if (meshopt == extensions->end() || !meshopt->is_object()) {
+      continue;
+    }
+    auto fallback = meshopt->find("fallback");
+    if (fallback != meshopt->end() && fallback->is_boolean() &&
+        fallback->get<bool>()) {
+      buffer["uri"] = kStandInUri;
+      buffer["byteLength"] = 1;
+      replaced.push_back(i);
+    }
+  }
+  return replaced;
+}
+
+// tinygltf's file reads, served from the prefetched files when possible
+bool ReadPrefetchedFile(std::vector<unsigned char>* out, std::string* err,
+                        const std::string& path, void* userData) {
+  auto& prefetched = *static_cast<PrefetchedFiles*>(userData);
+  std::optional<io::FileBuffer> file;
+  if (auto node = prefetched.extract(GetPrefetchKey(path))) {
+    file = std::move(node.mapped());
+  } else {
+    file = io::FileReader::GetThreadReader().Read(path);
+  }
+  if (!file) {
+    if (err != nullptr) {
+      *err += "File read error: " + path + "\n";
+    }
+    return false;
+  }
+
+  auto data = file->GetData();
+  const auto* bytes = std::bit_cast<const unsigned char*>(data.data());
+  out->assign(bytes, bytes + data.size());
+  return true;
+}
+
+// The chunks of a binary glTF container
+struct GlbChunks {
+  std::span<const std::byte> json;
+  std::span<const std::byte> bin;  // Empty if the file has none
+};
+
+std::optional<GlbChunks> ParseGlb(std::span<const std::byte> file) {
+  constexpr uint32_t kMagic = 0x46546C67;      // "glTF"
+  constexpr uint32_t kJsonChunk = 0x4E4F534A;  // "JSON"
+  constexpr uint32_t kBinChunk = 0x004E4942;   // "BIN\0"
+  constexpr size_t kHeaderSize = 12;
+  constexpr size_t kChunkHeaderSize = 8;
+
+  auto readU32 = [&file](size_t offset) {
+    uint32_t value = 0;
+    std::memcpy(&value, file.data() + offset, sizeof(value));
+    return value;
+  };
+
+  if (file.size() < kHeaderSize || readU32(0) != kMagic || readU32(4) != 2) {
+    return std::nullopt;
+  }
+
+  size_t length = std::min<size_t>(readU32(8), file.size());
+  GlbChunks chunks;
+  size_t offset = kHeaderSize;
+  while (offset + kChunkHeaderSize <= length) {
+    size_t chunkLength = readU32(offset);
+    uint32_t type = readU32(offset + 4);
+    offset += kChunkHeaderSize;
+    if (chunkLength > length - offset) {
+      return std::nullopt;
+    }
+
+    // Only the first chunk of each type counts; unknown ones are skipped
+    auto data = file.subspan(offset, chunkLength);
+    if (type == kJsonChunk && chunks.json.empty()) {
+      chunks.json = data;
+    } else if (type == kBinChunk && chunks.bin.empty()) {
+      chunks.bin = data;
+    }
+    offset += chunkLength;
+  }
+
+  if (chunks.json.empty()) {
+    return std::nullopt;
+  }
+  return chunks;
+}
+
+std::string GetJsonString(const nlohmann::json& object, const char* key) {
+  auto it = object.find(key);
+  return it != object.end() && it->is_string() ? it->get<std::string>()
+                                                : std::string{};
+}
+
+// Decode one image of a .glb document like tinygltf would. Images in buffer
+// views are read straight from `buffers`, so from the mapped BIN chunk.
+bool LoadGlbImage(const nlohmann::json& entry, const tinygltf::Model& gltf,
+                  const BufferData& buffers, const std::string& baseDir,
+                  int index, tinygltf::Image& image, std::string& err,
+                  std::string& warn) {
+  if (!entry.is_object()) {
+    err += "Invalid image " + std::to_string(index) + "\n";
+    return false;
+  }
+  image.name = GetJsonString(entry, "name");
+  image.mimeType = GetJsonString(entry, "mimeType");
+  image.uri = GetJsonString(entry, "uri");
+
+  std::span<const uint8_t> bytes;
+  std::optional<io::FileBuffer> file;
+  std::vector<unsigned char> decoded;
+  if (auto view = entry.find("bufferView"); view != entry.end()) {
+    image.bufferView = view->is_number_integer() ? view->get<int>() : -1;
+    if (image.bufferView < 0 ||
+        static_cast<size_t>(image.bufferView) >= gltf.bufferViews.size()) {
+      err += "Invalid bufferView of image " + std::to_string(index) + "\n";
+      return false;
+    }
+
+    const auto& bufferView = gltf.bufferViews[image.bufferView];
+    if (bufferView.buffer < 0 ||
+        static_cast<size_t>(bufferView.buffer) >= buffers.size() ||
+        bufferView.byteOffset + bufferView.byteLength >
+            buffers[bufferView.buffer].size()) {
+      err += "Image " + std::to_string(index) + " is out of bounds\n";
+      return false;
+    }
+    bytes = buffers[bufferView.buffer].subspan(bufferView.byteOffset,
+                                               bufferView.byteLength);
+  } else if (tinygltf::IsDataURI(image.uri)) {
+    std::string mimeType;
+    if (!tinygltf::DecodeDataURI(&decoded, mimeType, image.uri, 0, false)) {
+      err += "Failed to decode data URI of image " + std::to_string(index) +
+             "\n";
+      return false;
+    }
+    if (image.mimeType.empty()) {
+      image.mimeType = mimeType;
+    }
+    bytes = decoded;
+  } else if (!image.uri.empty()) {
+    auto path = std::filesystem::path{baseDir} / DecodeUri(image.uri);
+    file = io::FileReader::GetThreadReader().Read(path);
+    if (!file) {
+      err += "File read error: " + path.string() + "\n";
+      return false;
+    }
+    auto data = file->GetData();
+    bytes = {std::bit_cast<const uint8_t*>(data.data()), data.size()};
+  } else {
+    err += "`bufferView` or `uri` required for image " +
+           std::to_string(index) + "\n";
+    return false;
+  }
+
+  return LoadImageDataOrKtx2(&image, index, &err, &warn, 0, 0, bytes.data(),
+                             static_cast<int>(bytes.size()), nullptr);
+}
+
+// Every texture a material samples
+std::array<int32_t*, 5> GetTextureSlots(Material& material) {
+  return {&material.baseColorTexture, &material.metallicRoughnessTexture,
+          &material.normalTexture, &material.occlusionTexture,
+          &material.emissiveTexture};
+}
+
+template <typename T>
+std::vector<uint8_t> ToBytes(std::span<const T> values) {
+  std::vector<uint8_t> bytes(values.size_bytes());
+  std::memcpy(bytes.data(), values.data(), bytes.size());
+  return bytes;
+}
+}  // namespace
+
+struct ModelImporter::Impl {
+  ModelLoadOptions options;
+  tinygltf::TinyGLTF loader;
+  PrefetchedFiles prefetched;
+
+  explicit Impl(ModelLoadOptions opts) : options{opts} {
+    loader.SetImageLoader(LoadImageDataOrKtx2, nullptr);
+
+    tinygltf::FsCallbacks callbacks{};
+    callbacks.FileExists = &tinygltf::FileExists;
+    callbacks.ExpandFilePath = &tinygltf::ExpandFilePath;
+    callbacks.ReadWholeFile = &ReadPrefetchedFile;
+    callbacks.WriteWholeFile = &tinygltf::WriteWholeFile;
+    callbacks.GetFileSizeInBytes = &tinygltf::GetFileSizeInBytes;
+    callbacks.user_data = &prefetched;
+    loader.SetFsCallbacks(callbacks);
+  }
+
+  // CPU-side result of decoding a single glTF primitive, in the scratch
+  // memory of the thread that decoded it
+  struct PrimitiveData {
+    explicit PrimitiveData(std::pmr::memory_resource* memory)
+        : vertices{memory}, indices{memory} {}
+
+    bool valid{false};
+    int materialIndex{-1};
+    std::pmr::vector<ecs::Vertex> vertices;
+    std::pmr::vector<uint32_t> indices;
+    glm::vec3 minBounds{std::numeric_limits<float>::max()};
+    glm::vec3 maxBounds{std::numeric_limits<float>::lowest()};
+    size_t sourceVertexCount{0};
+    std::chrono::nanoseconds tangentSpaceTime{0};
+  };
+
+  static bool UsesExtension(const tinygltf::Model& gltf,
+                            std::string_view extension) {
+    return std::ranges::find(gltf.extensionsUsed, extension) !=
+           gltf.extensionsUsed.end();
+  }
+
+  // Load a .gltf document, reading the files it references in one batch
+  bool LoadText(const std::filesystem::path& path, tinygltf::Model& gltf,
+                BufferData& buffers, std::string& err, std::string& warn) {
+    auto& reader = io::FileReader::GetThreadReader();
+    auto file = reader.Read(path);
+    if (!file) {
+      err += "File read error: " + path.string() + "\n";
+      return false;
+    }
+    auto bytes = file->GetData();
+
+    auto document = nlohmann::json::parse(
+        std::bit_cast<const char*>(bytes.data()),
+        std::bit_cast<const char*>(bytes.data() + bytes.size()), nullptr,
+        false);
+    std::vector<size_t> standIns;
+    std::string json;
+    const char* text = std::bit_cast<const char*>(bytes.data());
+    size_t size = bytes.size();
+    if (!document.is_discarded() && document.is_object()) {
+      auto files = GetExternalFiles(document, path.parent_path());
+      reader.ReadBatch(
+          files, [&](size_t index, std::optional<io::FileBuffer> buffer) {
+            if (buffer) {
+              prefetched.insert_or_assign(GetPrefetchKey(files[index]),
+                                          std::move(*buffer));
+            }
+          });
+
+      standIns = StandInFallbackBuffers(document);
+      if (!standIns.empty()) {
+        json = document.dump();
+        text = json.data();
+        size = json.size();
+      }
+    }
+
+    bool success = loader.LoadASCIIFromString(
+        &gltf, &err, &warn, text, static_cast<unsigned int>(size),
+        path.parent_path().string());
+    // Whatever the document referenced but did not load
+    prefetched.clear();
+
+    buffers = GetBufferData(gltf);
+    for (size_t buffer : standIns) {
+      if (buffer < buffers.size()) {
+        buffers[buffer] = {};
+      }
+    }
+    return success;
+  }
+
+  // Load a .glb document from `mapping` without copying its BIN chunk.
+  // tinygltf only parses the JSON chunk, with the buffer the BIN chunk holds
+  // swapped for a one-byte stand-in and the images left out; the real buffer
+  // is then viewed in the mapping and images are decoded from there.
+  bool LoadBinary(const std::filesystem::path& path, io::MappedFile& mapping,
+                  tinygltf::Model& gltf, BufferData& buffers, std::string& err,
+                  std::string& warn) {
+    auto mapped = io::MappedFile::Open(path);
+    if (!mapped) {
+      err += "File read error: " + path.string() + "\n";
+      return false;
+    }
+    mapping = std::move(*mapped);
+
+    auto chunks = ParseGlb(mapping.GetData());
+    if (!chunks) {
+      err += "Invalid GLB container: " + path.string() + "\n";
+      return false;
+    }
+
+    auto document = nlohmann::json::parse(
+        std::bit_cast<const char*>(chunks->json.data()),
+        std::bit_cast<const char*>(chunks->json.data() + chunks->json.size()),
+        nullptr, false);
+    if (document.is_discarded() || !document.is_object()) {
+      err += "Invalid GLB JSON chunk: " + path.string() + "\n";
+      return false;
+    }
+
+    std::vector<size_t> standIns = StandInFallbackBuffers(document);
+
+    // Only the first buffer may live in the BIN chunk, and then has no URI
+    std::optional<size_t> binLength;
+    if (auto it = document.find("buffers");
+        it != document.end() && it->is_array() && !it->empty() &&
+        (*it)[0].is_object() && !(*it)[0].contains("uri")) {
+      auto& buffer = (*it)[0];
+      auto length = buffer.find("byteLength");
+      if (length == buffer.end() || !length->is_number_unsigned() ||
+          length->get<size_t>() > chunks->bin.size()) {
+        err += "GLB buffer does not fit its BIN chunk\n";
+        return false;
+      }
+      binLength = length->get<size_t>();
+      buffer["uri"] = kStandInUri;
+      buffer["byteLength"] = 1;
+    }
+
+    nlohmann::json images;
+    if (auto it = document.find("images"); it != document.end()) {
+      images = std::move(*it);
+      document.erase(it);
+    }
+
+    // The JSON is small next to the BIN chunk, so writing it back out for
+    // tinygltf costs little
+    std::string json = document.dump();
+    std::string baseDir = path.parent_path().string();
+    if (!loader.LoadASCIIFromString(&gltf, &err, &warn, json.data(),
+                                    static_cast<unsigned int>(json.size()),
+                                    baseDir)) {
+      return false;
+    }
+
+    buffers = GetBufferData(gltf);
+    for (size_t buffer : standIns) {
+      buffers[buffer] = {};
+    }
+    if (binLength) {
+      buffers[0] = {std::bit_cast<const uint8_t*>(chunks->bin.data()),
+                    *binLength};
+    }
+
+    if (!images.is_array()) {
+      return images.is_null();
+    }
+
+    // Unlike tinygltf, which decodes them one after the other
+    gltf.images.resize(images.size());
+    std::vector<std::string> errors(images.size());
+    std::vector<std::string> warnings(images.size());
+    std::atomic<bool> success{true};
+    core::ParallelFor(images.size(), [&](size_t i) {
+      if (!LoadGlbImage(images[i], gltf, buffers, baseDir,
+                        static_cast<int>(i), gltf.images[i], errors[i],
+                        warnings[i])) {
+        success.store(false, std::memory_order_relaxed);
+      }
+    });
+    for (size_t i = 0; i < images.size(); ++i) {
+      err += errors[i];
+      warn += warnings[i];
+    }
+    return success.load();
+  }
+
+  std::optional<ModelData> LoadGLTF(const std::filesystem::path& path,
+                                    const LoadStageCallback& onStage) {
+    auto enterStage = [&onStage](LoadStage stage) {
+      return !onStage || onStage(stage);
+    };
+
+    // Transient buffers of the import come from here and are freed at once
+    // when it returns
+    core::ScratchArena scratch;
+    core::ScratchScope scratchScope{scratch};
+
+    if (!enterStage(LoadStage::Parse)) {
+      return std::nullopt;
+    }
+    tinygltf::Model gltfModel;
+    BufferData buffers;
+    std::string err{};
+    std::string warn{};
+
+    // Accessors of a .glb read from the mapping until the model is built
+    io::MappedFile mapping;
+    bool success =
+        path.extension() == ".glb"
+            ? LoadBinary(path, mapping, gltfModel, buffers, err, warn)
+            : LoadText(path, gltfModel, buffers, err, warn);
+
+    if (!warn.empty()) {
+      LOG_WARNING("glTF warning: {}", warn);
+    }
+    if (!err.empty()) {
+      LOG_ERROR("glTF error: {}", err);
+    }
+    if (!success) {
+      return std::nullopt;
+    }
+
+    // Compressed buffer views are expanded once up front; everything below
+    // reads them like regular views
+    if (UsesExtension(gltfModel, "EXT_meshopt_compression") &&
+        !DecompressMeshoptBufferViews(gltfModel, buffers)) {
+      LOG_ERROR("Failed to decode EXT_meshopt_compression data: {}",
+                path.string());
+      return std::nullopt;
+    }
+
+    ModelData model;
+    model.name = path.stem().string();
+    model.sourcePath = path.string();
+
+    // Load textures
+    LoadTextures(gltfModel, model);
+
+    // Load materials
+    LoadMaterials(gltfModel, model);
+
+    // Fewer distinct textures per material mean fewer samples in pbr.frag
+    PackMaterialTextures(model);
+
+    // Mip filters and formats depend on how materials use each texture
+    if (!enterStage(LoadStage::Textures)) {
+      return std::nullopt;
+    }
+    ProcessTextures(model);
+
+    // Fingerprints of the final texels let loaders share identical textures
+    core::ParallelFor(model.textures.size(), [&](size_t i) {
+      model.textures[i].contentHash = model.textures[i].ComputeContentHash();
+    });
+
+    // Load nodes
+    LoadNodes(gltfModel, buffers, model);
+
+    // Load lights (KHR_lights_punctual extension)
+    LoadLights(gltfModel, model);
+
+    // Load cameras
+    LoadCameras(gltfModel, model);
+
+    // Set root nodes
+    if (!gltfModel.scenes.empty()) {
+      int sceneIndex = gltfModel.defaultScene >= 0 ? gltfModel.defaultScene : 0;
+      const auto& scene = gltfModel.scenes[sceneIndex];
+      model.rootNodes.reserve(scene.nodes.size());
+      for (int nodeIndex : scene.nodes) {
+        model.rootNodes.push_back(static_cast<uint32_t>(nodeIndex));
+      }
+    }
+
+    // Load meshes; flattening rewrites the nodes, so they come first
+    if (!enterStage(LoadStage::Geometry)) {
+      return std::nullopt;
+    }
+    LoadMeshes(gltfModel, buffers, scratch, model);
+
+    auto stats = scratch.GetStats();
+    LOG_INFO(
+        "Import scratch: {} allocations ({:.1f} MiB) from {} blocks "
+        "({:.1f} MiB), peak RSS {:.1f} MiB",
+        stats.allocations,
+        static_cast<double>(stats.allocatedBytes) / 1048576.0, stats.blocks,
+        static_cast<double>(stats.blockBytes) / 1048576.0,
+        static_cast<double>(core::GetPeakResidentBytes()) / 1048576.0);
+
+    return model;
+  }
+
+  // The image a texture samples; KHR_texture_basisu points at a KTX2 image
+  static int GetTextureSource(const tinygltf::Texture& texture) {
+    auto it = texture.extensions.find("KHR_texture_basisu");
+    if (it != texture.extensions.end() && it->second.Has("source") &&
+        it->second.Get("source").IsNumber()) {
+      return it->second.Get("source").GetNumberAsInt();
+    }
+    return texture.source;
+  }
+
+  // Level layout and pixels of one image, without its name
+  static TextureData DecodeImage(tinygltf::Image& image, ModelData& model) {
+    TextureData tex;
+    if (image.image.empty()) {
+      return tex;
+    }
+
+    if (image.mimeType != "image/ktx2") {
+      tex.width = static_cast<uint32_t>(image.width);
+      tex.height = static_cast<uint32_t>(image.height);
+      tex.format = rhi::Format::R8G8B8A8Unorm;
+      tex.pixels = model.Store(std::move(image.image));
+      return tex;
+    }
+
+    // KTX2 levels stay where the file put them, smallest first
+    auto file = model.Store(std::move(image.image));
+    auto ktx = ParseKtx2(file);
+    if (!ktx || ktx->faceCount != 1 || ktx->layerCount != 1) {
+      // A white texel keeps the material indices valid
+      LOG_WARNING("Replacing unsupported KTX2 image with white: {}",
+                  image.name);
+      tex.width = 1;
+      tex.height = 1;
+      tex.pixels = model.Store(std::vector<uint8_t>(4, 255));
+      return tex;
+    }
+
+    const std::byte* begin = file.data() + file.size();
+    const std::byte* end = file.data();
+    for (const auto& level : ktx->levels) {
+      begin = std::min(begin, level.data());
+      end = std::max(end, level.data() + level.size());
+    }
+    tex.width = ktx->width;
+    tex.height = ktx->height;
+    tex.format = ktx->format;
+    tex.mipLevels = ktx->mipLevels;
+    tex.pixels = {begin, end};
+    for (const auto& level : ktx->levels) {
+      tex.levelOffsets.push_back(static_cast<uint64_t>(level.data() - begin));
+    }
+    return tex;
+  }
+
+  void LoadTextures(tinygltf::Model& gltf, ModelData& model) {
+    (void)this;
+
+    // Images are decoded once, even when several textures share them
+    std::vector<std::optional<TextureData>> images(gltf.images.size());
+
+    for (const auto& gltfTexture : gltf.textures) {
+      int source = GetTextureSource(gltfTexture);
+      if (source < 0 || static_cast<size_t>(source) >= images.size()) {
+        continue;
+      }
+
+      auto& image = gltf.images[source];
+      if (!images[source]) {
+        images[source] = DecodeImage(image, model);
+      }
+
+      TextureData tex = *images[source];
+      tex.name = image.name.empty()
+                     ? "texture_" + std::to_string(model.textures.size())
+                     : image.name;
+
+      model.textures.push_back(std::move(tex));
+    }
+  }
+
+  // Repack occlusion into the red channel of the metallic-roughness texture
+  // (glTF's ORM layout), so pbr.frag fetches both with one sample. Emissive
+  // textures scaled to zero are dropped, letting those materials use the
+  // shader variant without emission.
+  static void PackMaterialTextures(ModelData& model) {
+    auto isPlainRgba8 = [&](int32_t index) {
+      if (index < 0 || static_cast<size_t>(index) >= model.textures.size()) {
+        return false;
+      }
+      const auto& texture = model.textures[index];
+      size_t size = static_cast<size_t>(texture.width) * texture.height * 4;
+      return texture.format == rhi::Format::R8G8B8A8Unorm &&
+             texture.mipLevels == 1 && size != 0 &&
+             texture.pixels.size() == size;
+    };
+
+    // Materials sharing a pair of source images share one packed texture
+    std::map<std::pair<const std::byte*, const std::byte*>, int32_t> packed;
+    for (auto& material : model.materials) {
+      if (material.emissiveFactor == glm::vec3(0.0F)) {
+        material.emissiveTexture = -1;
+      }
+
+      int32_t occlusion = material.occlusionTexture;
+      int32_t metallicRoughness = material.metallicRoughnessTexture;
+      if (occlusion == metallicRoughness || !isPlainRgba8(occlusion) ||
+          !isPlainRgba8(metallicRoughness)) {
+        continue;
+      }
+
+      const auto& occlusionTex = model.textures[occlusion];
+      const auto& metallicRoughnessTex = model.textures[metallicRoughness];
+      std::span<const std::byte> occlusionPixels = occlusionTex.pixels;
+      std::span<const std::byte> metallicRoughnessPixels =
+          metallicRoughnessTex.pixels;
+      if (occlusionPixels.data() == metallicRoughnessPixels.data()) {
+        material.occlusionTexture = metallicRoughness;
+        continue;
+      }
+      if (occlusionTex.width != metallicRoughnessTex.width ||
+          occlusionTex.height != metallicRoughnessTex.height) {
+        continue;
+      }
+
+      auto [it, inserted] = packed.try_emplace(
+          {occlusionPixels.data(), metallicRoughnessPixels.data()},
+          static_cast<int32_t>(model.textures.size()));
+      if (inserted) {
+        std::vector<uint8_t> orm(metallicRoughnessPixels.size());
+        for (size_t i = 0; i < orm.size(); i += 4) {
+          orm[i] = std::to_integer<uint8_t>(occlusionPixels[i]);
+          orm[i + 1] = std::to_integer<uint8_t>(metallicRoughnessPixels[i + 1]);
+          orm[i + 2] = std::to_integer<uint8_t>(metallicRoughnessPixels[i + 2]);
+          orm[i + 3] = 255;
+        }
+
+        TextureData tex;
+        tex.name = metallicRoughnessTex.name + "_orm";
+        tex.width = metallicRoughnessTex.width;
+        tex.height = metallicRoughnessTex.height;
+        tex.pixels = model.Store(std::move(orm));
+        model.textures.push_back(std::move(tex));
+      }
+      material.occlusionTexture = it->second;
+      material.metallicRoughnessTexture = it->second;
+    }
+
+    size_t textureCount = model.textures.size();
+    RemoveUnusedTextures(model);
+    if (!packed.empty()) {
+      LOG_INFO(
+          "Packed {} occlusion/metallic-roughness pairs, {} -> {} textures",
+          packed.size(), textureCount - packed.size(), model.textures.size());
+    }
+  }
+
+  // Drops textures no material samples and renumbers the rest
+  static void RemoveUnusedTextures(ModelData& model) {
+    std::vector<int32_t> remap(model.textures.size(), -1);
+    for (auto& material : model.materials) {
+      for (int32_t* slot : GetTextureSlots(material)) {
+        if (*slot >= 0 && static_cast<size_t>(*slot) < remap.size()) {
+          remap[*slot] = 0;
+        }
+      }
+    }
+
+    std::vector<TextureData> used;
+    for (size_t i = 0; i < remap.size(); ++i) {
+      if (remap[i] >= 0) {
+        remap[i] = static_cast<int32_t>(used.size());
+        used.push_back(std::move(model.textures[i]));
+      }
+    }
+    model.textures = std::move(used);
+
+    for (auto& material : model.materials) {
+      for (int32_t* slot : GetTextureSlots(material)) {
+        if (*slot >= 0) {
+          *slot = static_cast<size_t>(*slot) < remap.size() ? remap[*slot] : -1;
+        }
+      }
+    }
+  }
+
+  // How materials sample a texture, which decides its filter and format
+  struct TextureUsage {
+    bool color{false};
+    bool normal{false};
+    bool occlusion{false};
+    bool data{false};
+  };
+
+  static MipFilter ChooseMipFilter(const TextureUsage& usage) {
+    // Color is filtered in linear light and normals are renormalized
+    if (usage.color) {
+      return MipFilter::Srgb;
+    }
+    return usage.normal ? MipFilter::NormalMap : MipFilter::Linear;
+  }
+
+  rhi::Format ChooseTextureFormat(const TextureUsage& usage,
+                                  std::span<const std::byte> base) const {
+    if (options.textureCompression == TextureCompression::None) {
+      return rhi::Format::R8G8B8A8Unorm;
+    }
+    // pbr.frag reads .rg of normal maps and .r of occlusion maps
+    if (usage.normal && !usage.color && !usage.occlusion && !usage.data) {
+      return rhi::Format::Bc5Unorm;
+    }
+    if (usage.occlusion && !usage.color && !usage.normal && !usage.data) {
+      return rhi::Format::Bc4Unorm;
+    }
+    if (options.textureCompression == TextureCompression::Quality) {
+      return rhi::Format::Bc7Unorm;
+    }
+
+    bool opaque = true;
+    for (size_t i = 3; i < base.size() && opaque; i += 4) {
+      opaque = base[i] == std::byte{255};
+    }
+    return opaque ? rhi::Format::Bc1RgbaUnorm : rhi::Format::Bc3RgbaUnorm;
+  }
+
+  void ProcessTextures(ModelData& model) {
+    std::vector<TextureUsage> usages(model.textures.size());
+    auto use = [&](int32_t index, bool TextureUsage::* role) {
+      if (index >= 0 && static_cast<size_t>(index) < usages.size()) {
+        usages[index].*role = true;
+      }
+    };
+    for (const auto& material : model.materials) {
+      use(material.baseColorTexture, &TextureUsage::color);
+      use(material.emissiveTexture, &TextureUsage::color);
+      use(material.normalTexture, &TextureUsage::normal);
+      use(material.occlusionTexture, &TextureUsage::occlusion);
+      use(material.metallicRoughnessTexture, &TextureUsage::data);
+    }
+
+    // Textures sharing an image, a filter and a format share one result
+    struct TextureJob {
+      std::span<const std::byte> base;
+      uint32_t width;
+      uint32_t height;
+      MipFilter filter;
+      rhi::Format format;
+      uint32_t mipLevels;
+      std::vector<uint8_t> pixels;
+    };
+    std::vector<TextureJob> jobs;
+    std::vector<size_t> textureJobs(model.textures.size(),
+                                    std::numeric_limits<size_t>::max());
+    for (size_t i = 0; i < model.textures.size(); ++i) {
+      const auto& texture = model.textures[i];
+      size_t baseSize = static_cast<size_t>(texture.width) * texture.height *
+                        rhi::GetFormatInfo(texture.format).blockSize;
+      if (texture.format != rhi::Format::R8G8B8A8Unorm ||
+          texture.mipLevels != 1 || texture.pixels.size() != baseSize ||
+          baseSize == 0) {
+        continue;
+      }
+
+      MipFilter filter = ChooseMipFilter(usages[i]);
+      rhi::Format format = ChooseTextureFormat(usages[i], texture.pixels);
+      uint32_t mipLevels =
+          options.generateMips
+              ? rhi::GetMipLevelCount(texture.width, texture.height)
+              : 1;
+      if (mipLevels == 1 && format == texture.format) {
+        continue;
+      }
+
+      auto it = std::ranges::find_if(jobs, [&](const TextureJob& job) {
+        return job.base.data() == texture.pixels.data() &&
+               job.filter == filter && job.format == format;
+      });
+      textureJobs[i] = static_cast<size_t>(it - jobs.begin());
+      if (it == jobs.end()) {
+        jobs.push_back({texture.pixels, texture.width, texture.height, filter,
+                        format, mipLevels, {}});
+      }
+    }
+
+    auto mipStart = std::chrono::steady_clock::now();
+    core::ParallelFor(jobs.size(), [&](size_t j) {
+      auto& job = jobs[j];
+      std::span<const uint8_t> base{
+          std::bit_cast<const uint8_t*>(job.base.data()), job.base.size()};
+      if (job.mipLevels > 1) {
+        job.pixels =
+            GenerateMipChain(base, job.width, job.height, job.filter);
+      } else {
+        job.pixels.assign(base.begin(), base.end());
+      }
+    });
+    std::chrono::duration<double, std::milli> mipTime =
+        std::chrono::steady_clock::now() - mipStart;
+
+    // Each encode already spreads its blocks over every thread
+    auto compressStart = std::chrono::steady_clock::now();
+    size_t compressedCount = 0;
+    for (auto& job : jobs) {
+      if (job.format == rhi::Format::R8G8B8A8Unorm) {
+        continue;
+      }
+      job.pixels = CompressMipChain(job.pixels, job.width, job.height,
+                                    job.mipLevels, job.format);
+      ++compressedCount;
+    }
+    std::chrono::duration<double, std::milli> compressTime =
+        std::chrono::steady_clock::now() - compressStart;
+
+    std::vector<std::span<const std::byte>> results;
+    results.reserve(jobs.size());
+    for (auto& job : jobs) {
+      results.push_back(model.Store(std::move(job.pixels)));
+    }
+
+    for (size_t i = 0; i < model.textures.size(); ++i) {
+      if (textureJobs[i] < jobs.size()) {
+        const auto& job = jobs[textureJobs[i]];
+        auto& texture = model.textures[i];
+        texture.format = job.format;
+        texture.mipLevels = job.mipLevels;
+        texture.pixels = results[textureJobs[i]];
+        texture.levelOffsets.clear();
+      }
+    }
+
+    LOG_INFO(
+        "Processed {} textures: mip chains in {:.2f} ms, {} block-compressed "
+        "in {:.2f} ms",
+        jobs.size(), mipTime.count(), compressedCount, compressTime.count());
+  }
+
+  void LoadMaterials(const tinygltf::Model& gltf, ModelData& model) {
+    (void)this;
+
+    model.materials.reserve(std::max<size_t>(gltf.materials.size(), 1));
+    for (const auto& gltfMat : gltf.materials) {
+      Material mat;
+      mat.name = gltfMat.name;
+
+      // PBR Metallic Roughness
+      const auto& pbr = gltfMat.pbrMetallicRoughness;
+      mat.baseColorFactor =
+          glm::vec4(pbr.baseColorFactor[0], pbr.baseColorFactor[1],
+                    pbr.baseColorFactor[2], pbr.baseColorFactor[3]);
+      mat.metallicFactor = static_cast<float>(pbr.metallicFactor);
+      mat.roughnessFactor = static_cast<float>(pbr.roughnessFactor);
+
+      if (pbr.baseColorTexture.index >= 0) {
+        mat.baseColorTexture = pbr.baseColorTexture.index;
+      }
+      if (pbr.metallicRoughnessTexture.index >= 0) {
+        mat.metallicRoughnessTexture = pbr.metallicRoughnessTexture.index;
+      }
+
+      // Normal map
+      if (gltfMat.normalTexture.index >= 0) {
+        mat.normalTexture = gltfMat.normalTexture.index;
+      }
+
+      // Occlusion
+      if (gltfMat.occlusionTexture.index >= 0) {
+        mat.occlusionTexture = gltfMat.occlusionTexture.index;
+      }
+
+      // Emissive
+      if (gltfMat.emissiveTexture.index >= 0) {
+        mat.emissiveTexture = gltfMat.emissiveTexture.index;
+      }
+      mat.emissiveFactor =
+          glm::vec3(gltfMat.emissiveFactor[0], gltfMat.emissiveFactor[1],
+                    gltfMat.emissiveFactor[2]);
+
+      // Alpha mode
+      if (gltfMat.alphaMode == "MASK") {
+        mat.alphaMode = Material::AlphaMode::Mask;
+        mat.alphaCutoff = static_cast<float>(gltfMat.alphaCutoff);
+      } else if (gltfMat.alphaMode == "BLEND") {
+        mat.alphaMode = Material::AlphaMode::Blend;
+      }
+
+      mat.doubleSided = gltfMat.doubleSided;
+
+      model.materials.push_back(std::move(mat));
+    }
+
+    // Add default material if none exist
+    if (model.materials.empty()) {
+      Material defaultMat;
+      defaultMat.name = "default";
+      model.materials.push_back(defaultMat);
+    }
+  }
+
+  // Decode one triangle primitive into standalone vertex and index arrays,
+  // fill in missing normals, weld duplicates and generate missing tangents.
+  // Runs on worker threads, so it only reads the glTF model and writes to
+  // `out`.
+  // NOLINTNEXTLINE(readability-function-cognitive-complexity)
+  void DecodePrimitive(const tinygltf::Model& gltf, const BufferData& buffers,
+                       const tinygltf::Primitive& primitive,
+                       const std::string& meshName, PrimitiveData& out) const {
+    if (primitive.mode != TINYGLTF_MODE_TRIANGLES) {
+      LOG_WARNING("Skipping non-triangle primitive in mesh: {}", meshName);
+      return;
+    }
+
+    auto& vertices = out.vertices;
+    auto& indices = out.indices;
+    out.materialIndex = primitive.material;
+
+    auto findAccessor = [&](const char* name) -> const tinygltf::Accessor* {
+      auto it = primitive.attributes.find(name);
+      if (it == primitive.attributes.end() || it->second < 0 ||
+          static_cast<size_t>(it->second) >= gltf.accessors.size()) {
+        return nullptr;
+      }
+      return &gltf.accessors[it->second];
+    };
+
+    // Position (required)
+    const tinygltf::Accessor* posAccessor = findAccessor("POSITION");
+    if (posAccessor == nullptr) {
+      LOG_WARNING("Mesh primitive missing POSITION attribute: {}", meshName);
+      return;
+    }
+
+    // Update bounds
+    if (posAccessor->minValues.size() >= 3) {
+      out.minBounds = glm::min(
+          out.minBounds,
+          glm::vec3(posAccessor->minValues[0], posAccessor->minValues[1],
+                    posAccessor->minValues[2]));
+    }
+    if (posAccessor->maxValues.size() >= 3) {
+      out.maxBounds = glm::max(
+          out.maxBounds,
+          glm::vec3(posAccessor->maxValues[0], posAccessor->maxValues[1],
+                    posAccessor->maxValues[2]));
+    }
+
+    const tinygltf::Accessor* normAccessor = findAccessor("NORMAL");
+    const tinygltf::Accessor* tangentAccessor = findAccessor("TANGENT");
+    const tinygltf::Accessor* texAccessor = findAccessor("TEXCOORD_0");
+    const tinygltf::Accessor* colorAccessor = findAccessor("COLOR_0");
+
+    // Vertices start from their defaults and each present attribute is
+    // converted in one pass over its accessor
+    size_t vertexCount = posAccessor->count;
+    if (vertexCount == 0) {
+      return;
+    }
+    vertices.resize(vertexCount);
+
+    auto readAttribute = [&](const tinygltf::Accessor* accessor,
+                             const char* name, float* first,
+                             uint32_t components, std::array<float, 4> fill) {
+      if (accessor == nullptr) {
+        return false;
+      }
+      AccessorTarget target{
+          .data = first,
+          .stride = sizeof(ecs::Vertex),
+          .components = components,
+          .fill = fill,
+      };
+      if (!ReadAccessor(gltf, buffers, *accessor, vertexCount, target)) {
+        LOG_WARNING("Unsupported or invalid {} accessor in mesh: {}", name,
+                    meshName);
+        return false;
+      }
+      return true;
+    };
+
+    if (!readAttribute(posAccessor, "POSITION", &vertices[0].position.x, 3,
+                       {})) {
+      vertices.clear();
+      return;
+    }
+    bool hasNormals =
+        readAttribute(normAccessor, "NORMAL", &vertices[0].normal.x, 3, {});
+    bool hasTangents = readAttribute(tangentAccessor, "TANGENT",
+                                     &vertices[0].tangent.x, 4, {});
+    readAttribute(texAccessor, "TEXCOORD_0", &vertices[0].texCoord.x, 2, {});
+    readAttribute(colorAccessor, "COLOR_0", &vertices[0].color.x, 4,
+                  {0.0F, 0.0F, 0.0F, 1.0F});
+
+    out.sourceVertexCount = vertexCount;
+
+    // Indices
+    if (primitive.indices >= 0 &&
+        static_cast<size_t>(primitive.indices) < gltf.accessors.size()) {
+      if (!ReadIndices(gltf, buffers, gltf.accessors[primitive.indices],
+                       indices)) {
+        LOG_WARNING("Unsupported or invalid index accessor in mesh: {}",
+                    meshName);
+        return;
+      }
+      if (std::ranges::any_of(indices, [&](uint32_t index) {
+            return index >= vertices.size();
+          })) {
+        LOG_WARNING("Index out of range in mesh: {}", meshName);
+        return;
+      }
+    } else {
+      // Non-indexed triangle list: give it sequential indices so welding can
+      // share its vertices
+      indices.resize(vertices.size());
+      std::iota(indices.begin(), indices.end(), 0U);
+    }
+
+    auto tangentStart = std::chrono::steady_clock::now();
+
+    // glTF requires flat normals when a primitive has none; generate them
+    // before welding so coplanar corners can be shared again
+    if (!hasNormals && !indices.empty()) {
+      GenerateNormals(vertices, indices, options.generatedNormals);
+    }
+
+    if (options.weldVertices) {
+      WeldVertices(vertices, indices, options.weldEpsilon);
+    }
+
+    if (!hasTangents && !indices.empty()) {
+      GenerateTangents(vertices, indices);
+    }
+
+    out.tangentSpaceTime = std::chrono::steady_clock::now() - tangentStart;
+    out.valid = true;
+  }
+
+  void LoadMeshes(const tinygltf::Model& gltf, const BufferData& buffers,
+                  core::ScratchArena& scratch, ModelData& model) {
+    // Decode every primitive of every mesh in parallel
+    std::vector<std::vector<std::optional<PrimitiveData>>> meshPrimitives(
+        gltf.meshes.size());
+    std::vector<std::pair<size_t, size_t>> jobs;
+    for (size_t m = 0; m < gltf.meshes.size(); ++m) {
+      meshPrimitives[m].resize(gltf.meshes[m].primitives.size());
+      for (size_t p = 0; p < gltf.meshes[m].primitives.size(); ++p) {
+        jobs.emplace_back(m, p);
+      }
+    }
+
+    auto decodeStart = std::chrono::steady_clock::now();
+    core::ParallelFor(jobs.size(), [&](size_t job) {
+      core::ScratchScope scope{scratch};
+      auto [m, p] = jobs[job];
+      auto& data = meshPrimitives[m][p].emplace(core::GetScratchResource());
+      DecodePrimitive(gltf, buffers, gltf.meshes[m].primitives[p],
+                      gltf.meshes[m].name, data);
+    });
+    std::chrono::duration<double, std::milli> decodeTime =
+        std::chrono::steady_clock::now() - decodeStart;
+
+    std::chrono::nanoseconds tangentSpaceTime{0};
+    for (const auto& primitives : meshPrimitives) {
+      for (const auto& data : primitives) {
+        tangentSpaceTime += data->tangentSpaceTime;
+      }
+    }
+    LOG_INFO(
+        "Decoded {} primitives in {:.2f} ms ({:.2f} ms CPU in normal/tangent "
+        "generation and welding)",
+        jobs.size(), decodeTime.count(),
+        std::chrono::duration<double, std::milli>(tangentSpaceTime).count());
+
+    size_t sourceVertexCount = 0;
+    size_t weldedVertexCount = 0;
+
+    // Concatenate primitives per mesh
+    std::vector<MeshGeometry> geometries;
+    geometries.reserve(gltf.meshes.size());
+    for (size_t m = 0; m < gltf.meshes.size(); ++m) {
+      auto& geometry = geometries.emplace_back(core::GetScratchResource());
+      geometry.name = gltf.meshes[m].name;
+
+      size_t vertexTotal = 0;
+      size_t indexTotal = 0;
+      for (const auto& data : meshPrimitives[m]) {
+        vertexTotal += data->vertices.size();
+        indexTotal += data->indices.size();
+      }
+      geometry.vertices.reserve(vertexTotal);
+      geometry.indices.reserve(indexTotal);
+      geometry.primitives.reserve(meshPrimitives[m].size());
+
+      glm::vec3 minBounds{std::numeric_limits<float>::max()};
+      glm::vec3 maxBounds{std::numeric_limits<float>::lowest()};
+
+      for (auto& primitive : meshPrimitives[m]) {
+        const auto& data = *primitive;
+        if (!data.valid) {
+          continue;
+        }
+
+        MeshPrimitive prim;
+        prim.vertexOffset = static_cast<uint32_t>(geometry.vertices.size());
+        prim.indexOffset = static_cast<uint32_t>(geometry.indices.size());
+        prim.vertexCount = static_cast<uint32_t>(data.vertices.size());
+        prim.indexCount = static_cast<uint32_t>(data.indices.size());
+        prim.materialIndex = data.materialIndex;
+
+        minBounds = glm::min(minBounds, data.minBounds);
+        maxBounds = glm::max(maxBounds, data.maxBounds);
+
+        sourceVertexCount += data.sourceVertexCount;
+        weldedVertexCount += data.vertices.size();
+
+        geometry.vertices.insert(geometry.vertices.end(), data.vertices.begin(),
+                                 data.vertices.end());
+        geometry.indices.insert(geometry.indices.end(), data.indices.begin(),
+                                data.indices.end());
+
+        geometry.primitives.push_back(prim);
+      }
+
+      geometry.bounds.min = minBounds;
+      geometry.bounds.max = maxBounds;
+    }
+
+    if (options.flattenStaticScene) {
+      FlattenScene(gltf, geometries, model);
+    }
+
+    // Quantized sources stay compact on the GPU instead of expanding to
+    // float vertices
+    bool quantize = options.quantizeVertices ||
+                    UsesExtension(gltf, "KHR_mesh_quantization");
+    model.meshes.reserve(geometries.size());
+    for (const auto& geometry : geometries) {
+      model.meshes.push_back(StoreMesh(geometry, quantize, model));
+    }
+
+    if (options.weldVertices && sourceVertexCount > 0) {
+      // Signed: flat normal generation can leave more vertices than it found
+      double removed = static_cast<double>(sourceVertexCount) -
+                       static_cast<double>(weldedVertexCount);
+      LOG_INFO("Vertex welding: {} -> {} vertices ({:.1f}% removed)",
+               sourceVertexCount, weldedVertexCount,
+               100.0 * removed / static_cast<double>(sourceVertexCount));
+    }
+  }
+
+  // Lay out vertex and index data exactly as the GPU buffers will hold it
+  static MeshData StoreMesh(const MeshGeometry& geometry, bool quantize,
+                            ModelData& model) {
+    MeshData mesh;
+    mesh.name = geometry.name;
+    mesh.primitives = geometry.primitives;
+    mesh.bounds = geometry.bounds;
+
+    auto* memory = core::GetScratchResource();
+    const auto& vertices = geometry.vertices;
+    if (!vertices.empty() && quantize) {
+      std::pmr::vector<ecs::QuantizedVertex> quantized{memory};
+      mesh.vertexFormat = ecs::VertexFormat::Quantized;
+      mesh.positionDequantization = QuantizeVertices(vertices, quantized);
+      mesh.vertices = model.Store(ToBytes<ecs::QuantizedVertex>(quantized));
+    } else if (!vertices.empty()) {
+      mesh.vertices = model.Store(ToBytes<ecs::Vertex>(vertices));
+    }
+
+    const auto& indices = geometry.indices;
+    if (!indices.empty()) {
+      // Indices are relative to each primitive's vertex offset, so 16 bits
+      // are enough as long as no primitive exceeds the uint16_t range.
+      bool fits16Bit = std::ranges::all_of(
+          mesh.primitives, [](const MeshPrimitive& prim) {
+            return prim.vertexCount <= kMaxVerticesFor16BitIndices;
+          });
+      mesh.indexType =
+          fits16Bit ? rhi::IndexType::Uint16 : rhi::IndexType::Uint32;
+
+      if (fits16Bit) {
+        std::pmr::vector<uint16_t> narrow(indices.size(), memory);
+        for (size_t i = 0; i < indices.size(); ++i) {
+          narrow[i] = static_cast<uint16_t>(indices[i]);
+        }
+        mesh.indices = model.Store(ToBytes<uint16_t>(narrow));
+      } else {
+        mesh.indices = model.Store(ToBytes<uint32_t>(indices));
+      }
+    }
+
+    return mesh;
+  }
+
+  // Bake static subtrees into single meshes. Animated and skinned nodes
+  // keep their transforms, as do nodes with cameras, lights or instances.
+  static void FlattenScene(const tinygltf::Model& gltf,
+                           std::vector<MeshGeometry>& geometries,
+                           ModelData& model) {
+    std::vector<bool> pinned(model.nodes.size(), false);
+    auto pin = [&pinned](int node) {
+      if (node >= 0 && static_cast<size_t>(node) < pinned.size()) {
+        pinned[node] = true;
+      }
+    };
+    for (const auto& animation : gltf.animations) {
+      for (const auto& channel : animation.channels) {
+        pin(channel.target_node);
+      }
+    }
+    for (const auto& skin : gltf.skins) {
+      std::ranges::for_each(skin.joints, pin);
+    }
+    for (size_t i = 0; i < gltf.nodes.size(); ++i) {
+      if (gltf.nodes[i].skin >= 0 || !gltf.nodes[i].weights.empty()) {
+        pin(static_cast<int>(i));
+      }
+    }
+
+    auto stats = FlattenStaticNodes(model.nodes, model.rootNodes, geometries,
+                                    pinned);
+    if (!stats) {
+      LOG_WARNING("Not flattening {}: a node has several parents",
+                  model.name);
+      return;
+    }
+    LOG_INFO("Scene flattening: {} -> {} nodes, {} -> {} draws",
+             stats->nodesBefore, stats->nodesAfter, stats->drawsBefore,
+             stats->drawsAfter);
+  }
+
+  // Per-instance transforms of an EXT_mesh_gpu_instancing node. Attributes
+  // are optional, but those present must agree on the instance count.
+  static std::vector<NodeInstance> LoadInstances(
+      const tinygltf::Model& gltf, const BufferData& buffers,
+      const tinygltf::Node& gltfNode) {
+    auto it = gltfNode.extensions.find("EXT_mesh_gpu_instancing");
+    if (it == gltfNode.extensions.end() || !it->second.Has("attributes")) {
+      return {};
+    }
+    const auto& attributes = it->second.Get("attributes");
+
+    std::optional<size_t> count;
+    auto findAccessor = [&](const char* name) -> const tinygltf::Accessor* {
+      if (!attributes.Has(name) || !attributes.Get(name).IsNumber()) {
+        return nullptr;
+      }
+      int index = attributes.Get(name).GetNumberAsInt();
+      if (index < 0 || static_cast<size_t>(index) >= gltf.accessors.size()) {
+        return nullptr;
+      }
+      const auto& accessor = gltf.accessors[index];
+      count = std::min(count.value_or(accessor.count), accessor.count);
+      return &accessor;
+    };
+    const auto* translations = findAccessor("TRANSLATION");
+    const auto* rotations = findAccessor("ROTATION");
+    const auto* scales = findAccessor("SCALE");
+    if (!count || *count == 0) {
+      return {};
+    }
+
+    // Missing attributes read as the identity
+    std::vector<glm::vec3> translation(*count, glm::vec3{0.0F});
+    std::vector<glm::vec4> rotation(*count, glm::vec4{0.0F, 0.0F, 0.0F, 1.0F});
+    std::vector<glm::vec3> scale(*count, glm::vec3{1.0F});
+    auto read = [&](const tinygltf::Accessor* accessor, float* data,
+                    uint32_t components) {
+      return accessor == nullptr ||
+             ReadAccessor(gltf, buffers, *accessor, *count,
+                          {.data = data,
+                           .stride = components * sizeof(float),
+                           .components = components,
+                           .fill = {0.0F, 0.0F, 0.0F, 1.0F}});
+    };
+    if (!read(translations, &translation[0].x, 3) ||
+        !read(rotations, &rotation[0].x, 4) || !read(scales, &scale[0].x, 3)) {
+      LOG_WARNING("Unsupported or invalid instance accessor in node: {}",
+                  gltfNode.name);
+      return {};
+    }
+
+    std::vector<NodeInstance> instances(*count);
+    for (size_t i = 0; i < instances.size(); ++i) {
+      instances[i] = {
+          .translation = translation[i],
+          .rotation = glm::quat(rotation[i].w, rotation[i].x, rotation[i].y,
+                                rotation[i].z),
+          .scale = scale[i],
+      };
+    }
+    return instances;
+  }
+
+  void LoadNodes(const tinygltf::Model& gltf, const BufferData& buffers,
+                 ModelData& model) {
+    (void)this;
+
+    model.nodes.reserve(gltf.nodes.size());
+    for (const auto& gltfNode : gltf.nodes) {
+      SceneNode node;
+      node.name = gltfNode.name;
+
+      // Transform
+      if (!gltfNode.translation.empty()) {
+        node.translation =
+            glm::vec3(gltfNode.translation[0], gltfNode.translation[1],
+                      gltfNode.translation[2]);
+      }
+      if (!gltfNode.rotation.empty()) {
+        node.rotation =
+            glm::quat(static_cast<float>(gltfNode.rotation[3]),   // w
+                      static_cast<float>(gltfNode.rotation[0]),   // x
+                      static_cast<float>(gltfNode.rotation[1]),   // y
+                      static_cast<float>(gltfNode.rotation[2]));  // z
+      }
+      if (!gltfNode.scale.empty()) {
+        node.scale =
+            glm::vec3(gltfNode.scale[0], gltfNode.scale[1], gltfNode.scale[2]);
+      }
+
+      // Matrix (overrides TRS if present)
+      if (!gltfNode.matrix.empty()) {
+        glm::mat4 matrix{glm::make_mat4(gltfNode.matrix.data())};
+
+        // Decompose matrix to TRS
+        node.translation = glm::vec3(matrix[3]);
+        node.scale = glm::vec3(glm::length(glm::vec3(matrix[0])),
+                               glm::length(glm::vec3(matrix[1])),
+                               glm::length(glm::vec3(matrix[2])));
+        glm::mat3 rotMat(glm::vec3(matrix[0]) / node.scale.x,
+                         glm::vec3(matrix[1]) / node.scale.y,
+                         glm::vec3(matrix[2]) / node.scale.z);
+        node.rotation = glm::quat_cast(rotMat);
+      }
+
+      node.meshIndex = gltfNode.mesh;
+      node.cameraIndex = gltfNode.camera;
+      node.lightIndex = gltfNode.light;
+      if (gltfNode.mesh >= 0) {
+        node.instances = LoadInstances(gltf, buffers, gltfNode);
+      }
+
+      for (int child : gltfNode.children) {
+        node.children.push_back(static_cast<uint32_t>(child));
+      }
+
+      model.nodes.push_back(std::move(node));
+    }
+  }
+
+  void LoadLights(const tinygltf::Model& gltf, ModelData& model) {
+    (void)this;
+
+    // KHR_lights_punctual extension
+    if (auto it = gltf.extensions.find("KHR_lights_punctual");
+        it != gltf.extensions.end()) {
+      if (it->second.Has("lights") && it->second.Get("lights").IsArray()) {
+        const auto& lights = it->second.Get("lights");
+        for (size_t i = 0; i < lights.ArrayLen(); ++i) {
+          const auto& gltfLight = lights.Get(static_cast<int>(i));
+
+          Light light;
+          if (gltfLight.Has("name")) {
+            light.name = gltfLight.Get("name").Get<std::string>();
+          }
+
+          if (gltfLight.Has("type")) {
+            std::string type = gltfLight.Get("type").Get<std::string>();
+            if (type == "directional") {
+              light.type = Light::Type::Directional;
+
+            } else if (type == "point") {
+              light.type = Light::Type::Point;
+
+            } else if (type == "spot") {
+              light.type = Light::Type::Spot;
+            }
+          }
+
+          if (gltfLight.Has("color") && gltfLight.Get("color").IsArray()) {
+            const auto& c = gltfLight.Get("color");
+            light.color = glm::vec3(c.Get(0).GetNumberAsDouble(),
+                                    c.Get(1).GetNumberAsDouble(),
+                                    c.Get(2).GetNumberAsDouble());
+          }
+
+          if (gltfLight.Has("intensity")) {
+            light.intensity = static_cast<float>(
+                gltfLight.Get("intensity").GetNumberAsDouble());
+          }
+
+          if (gltfLight.Has("range")) {
+            light.range =
+                static_cast<float>(gltfLight.Get("range").GetNumberAsDouble());
+          }
+
+          model.lights.push_back(std::move(light));
+        }
+      }
+    }
+  }
+
+  void LoadCameras(const tinygltf::Model& gltf, ModelData& model) {
+    (void)this;
+
+    for (const auto& gltfCamera : gltf.cameras) {
+      CameraData cam;
+      cam.name = gltfCamera.name;
+      cam.perspective = (gltfCamera.type == "perspective");
+
+      if (cam.perspective) {
+        cam.yfov = static_cast<float>(gltfCamera.perspective.yfov);
+        cam.aspectRatio =
+            static_cast<float>(gltfCamera.perspective.aspectRatio);
+        cam.znear = static_cast<float>(gltfCamera.perspective.znear);
+        cam.zfar = static_cast<float>(gltfCamera.perspective.zfar);
+      }
+
+      model.cameras.push_back(std::move(cam));
+    }
+  }
+};
+
+ModelImporter::ModelImporter(ModelLoadOptions options)
+    : impl_{std::make_unique<Impl>(options)} {}
+
+ModelImporter::~ModelImporter() = default;
+
+std::optional<ModelData> ModelImporter::Import(
+    const std::filesystem::path& path, const LoadStageCallback& onStage) {
+  return impl_->LoadGLTF(path, onStage);
+}
+
+}  // namespace resource
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include "resource/model_data.hpp"
+#include "resource/tangent_space.hpp"
+#include "resource/texture_compression.hpp"
+
+namespace resource {
+
+struct ModelLoadOptions {
+  // Merge duplicate vertices within each primitive
+  bool weldVertices{true};
+  // Attribute grid size for welding; 0 welds only exact duplicates
+  float weldEpsilon{0.0F};
+  // How to fill in primitives without a NORMAL attribute
+  NormalMode generatedNormals{NormalMode::Flat};
+  // Upload compact ecs::QuantizedVertex data; always on for assets that
+  // declare KHR_mesh_quantization
+  bool quantizeVertices{false};
+  // Build full mip chains for textures on worker threads
+  bool generateMips{true};
+  // Block-compress textures; slow enough to belong in offline cooking
+  TextureCompression textureCompression{TextureCompression::None};
+  // Upload only the small mips of each texture and let the renderer stream
+  // in the rest; keeps the CPU copy of the model's textures alive
+  bool streamTextures{true};
+  // Largest dimension of the mip tail streamed textures start with
+  uint32_t streamingTailSize{64};
+  // Bake the transforms of static subtrees into their meshes, drop nodes
+  // that only carry a transform and merge primitives sharing a material
+  bool flattenStaticScene{false};
+};
+
+// Stages a model goes through while loading, in order
+enum class LoadStage : uint8_t {
+  None,      // Not loading; the handle refers to nothing
+  Queued,    // Waiting for a loader thread
+  Parse,     // Reading the file and decoding images
+  Textures,  // Mip generation and compression
+  Geometry,  // Vertex processing
+  Upload,    // Waiting to be uploaded on the main thread
+  Ready,
+  Failed,
+};
+
+// Called from the loading thread as each stage begins; returning false
+// abandons the load
+using LoadStageCallback = std::function<bool(LoadStage)>;
+
+/**
+ * @brief Converts glTF files into upload-ready ModelData.
+ *
+ * Does all parsing, decoding and vertex processing on the CPU without
+ * touching the GPU, so offline tools can use it as well.
+ */
+class ModelImporter {
+ public:
+  explicit ModelImporter(ModelLoadOptions options = {});
+  ~ModelImporter();
+
+  /**
+   * @brief Import a glTF model from file.
+   *
+   * @param path Path to .gltf or .glb file
+   * @param onStage Reports the Parse, Textures and Geometry stages
+   * @return Imported model data or nullopt on failure or when abandoned
+   */
+  [[nodiscard]] std::optional<ModelData> Import(
+      const std::filesystem::path& path,
+      const LoadStageCallback& onStage = {});
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+}  // namespace resource
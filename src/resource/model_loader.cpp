@@ -1,667 +1,185 @@
 #include "resource/model_loader.hpp"
 
-#include <bit>
+#include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
 
-#include <glm/gtc/type_ptr.hpp>
-
-#define TINYGLTF_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include <tiny_gltf.h>
-
+#include "core/parallel.hpp"
 #include "logger.hpp"
+#include "resource/model_pack.hpp"
 
 namespace resource {
-struct ModelLoader::Impl {
-  rhi::Factory& factory;
-  tinygltf::TinyGLTF loader;
+ModelLoader::ModelLoader(rhi::Factory& factory, ModelLoadOptions options)
+    : factory_{factory}, options_{options} {}
 
-  explicit Impl(rhi::Factory& f) : factory{f} {}
+std::optional<Model> ModelLoader::Load(const std::filesystem::path& path) {
+  auto start = std::chrono::steady_clock::now();
 
-  std::optional<Model> LoadGLTF(const std::filesystem::path& path) {
-    tinygltf::Model gltfModel;
-    std::string err{};
-    std::string warn{};
+  auto pending = Read(path);
+  if (!pending) {
+    return std::nullopt;
+  }
+  Model model = Upload(*pending->data, pending->owner);
 
-    bool success = false;
-    if (path.extension() == ".glb") {
-      success =
-          loader.LoadBinaryFromFile(&gltfModel, &err, &warn, path.string());
-    } else {
-      success =
-          loader.LoadASCIIFromFile(&gltfModel, &err, &warn, path.string());
-    }
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  LOG_INFO("Loaded {} in {:.2f} ms", path.string(), elapsed.count());
+  return model;
+}
 
-    if (!warn.empty()) {
-      LOG_WARNING("glTF warning: {}", warn);
-    }
-    if (!err.empty()) {
-      LOG_ERROR("glTF error: {}", err);
-    }
-    if (!success) {
+std::optional<PendingModel> ModelLoader::Read(
+    const std::filesystem::path& path,
+    const LoadStageCallback& onStage) const {
+  if (path.extension() == kModelPackExtension) {
+    if (onStage && !onStage(LoadStage::Parse)) {
       return std::nullopt;
     }
-
-    Model model;
-    model.name = path.stem().string();
-    model.sourcePath = path.string();
-
-    // Load textures
-    LoadTextures(gltfModel, model);
-
-    // Load materials
-    LoadMaterials(gltfModel, model);
-
-    // Load meshes
-    LoadMeshes(gltfModel, model);
-
-    // Load nodes
-    LoadNodes(gltfModel, model);
-
-    // Load lights (KHR_lights_punctual extension)
-    LoadLights(gltfModel, model);
-
-    // Load cameras
-    LoadCameras(gltfModel, model);
-
-    // Set root nodes
-    if (!gltfModel.scenes.empty()) {
-      int sceneIndex = gltfModel.defaultScene >= 0 ? gltfModel.defaultScene : 0;
-      const auto& scene = gltfModel.scenes[sceneIndex];
-      for (int nodeIndex : scene.nodes) {
-        model.rootNodes.push_back(static_cast<uint32_t>(nodeIndex));
-      }
+    auto pack = ModelPack::Open(path);
+    if (!pack) {
+      return std::nullopt;
     }
-
-    return model;
+    // Streamed textures keep reading from the mapping
+    auto shared = std::make_shared<ModelPack>(std::move(*pack));
+    return PendingModel{.owner = shared, .data = &shared->GetData()};
   }
 
-  void LoadTextures(const tinygltf::Model& gltf, Model& model) {
-    for (const auto& gltfTexture : gltf.textures) {
-      if (gltfTexture.source < 0) {
-        continue;
-      }
-
-      const auto& image = gltf.images[gltfTexture.source];
-
-      TextureResource tex;
-      tex.name = image.name.empty()
-                     ? "texture_" + std::to_string(model.textures.size())
-                     : image.name;
-      tex.width = static_cast<uint32_t>(image.width);
-      tex.height = static_cast<uint32_t>(image.height);
-
-      // Create RHI texture
-      rhi::Format format = rhi::Format::R8G8B8A8Unorm;
-
-      tex.texture = factory.CreateTexture(tex.width, tex.height, format,
-                                          rhi::TextureUsage::Sampled);
-
-      // Upload data
-      if (!image.image.empty()) {
-        std::span<const std::byte> data{
-            std::bit_cast<const std::byte*>(image.image.data()),
-            image.image.size()};
-        tex.texture->Upload(data);
-      }
-
-      model.textures.push_back(std::move(tex));
-    }
+  // The importer keeps per-file state, so every read gets its own
+  ModelImporter importer{options_};
+  auto data = importer.Import(path, onStage);
+  if (!data) {
+    return std::nullopt;
   }
+  auto shared = std::make_shared<ModelData>(std::move(*data));
+  return PendingModel{.owner = shared, .data = shared.get()};
+}
 
-  void LoadMaterials(const tinygltf::Model& gltf, Model& model) {
-    (void)this;
-
-    for (const auto& gltfMat : gltf.materials) {
-      Material mat;
-      mat.name = gltfMat.name;
-
-      // PBR Metallic Roughness
-      const auto& pbr = gltfMat.pbrMetallicRoughness;
-      mat.baseColorFactor =
-          glm::vec4(pbr.baseColorFactor[0], pbr.baseColorFactor[1],
-                    pbr.baseColorFactor[2], pbr.baseColorFactor[3]);
-      mat.metallicFactor = static_cast<float>(pbr.metallicFactor);
-      mat.roughnessFactor = static_cast<float>(pbr.roughnessFactor);
-
-      if (pbr.baseColorTexture.index >= 0) {
-        mat.baseColorTexture = pbr.baseColorTexture.index;
-      }
-      if (pbr.metallicRoughnessTexture.index >= 0) {
-        mat.metallicRoughnessTexture = pbr.metallicRoughnessTexture.index;
-      }
-
-      // Normal map
-      if (gltfMat.normalTexture.index >= 0) {
-        mat.normalTexture = gltfMat.normalTexture.index;
-      }
-
-      // Occlusion
-      if (gltfMat.occlusionTexture.index >= 0) {
-        mat.occlusionTexture = gltfMat.occlusionTexture.index;
-      }
-
-      // Emissive
-      if (gltfMat.emissiveTexture.index >= 0) {
-        mat.emissiveTexture = gltfMat.emissiveTexture.index;
-      }
-      mat.emissiveFactor =
-          glm::vec3(gltfMat.emissiveFactor[0], gltfMat.emissiveFactor[1],
-                    gltfMat.emissiveFactor[2]);
-
-      // Alpha mode
-      if (gltfMat.alphaMode == "MASK") {
-        mat.alphaMode = Material::AlphaMode::Mask;
-        mat.alphaCutoff = static_cast<float>(gltfMat.alphaCutoff);
-      } else if (gltfMat.alphaMode == "BLEND") {
-        mat.alphaMode = Material::AlphaMode::Blend;
-      }
-
-      mat.doubleSided = gltfMat.doubleSided;
-
-      model.materials.push_back(std::move(mat));
-    }
-
-    // Add default material if none exist
-    if (model.materials.empty()) {
-      Material defaultMat;
-      defaultMat.name = "default";
-      model.materials.push_back(defaultMat);
-    }
-  }
-
-  // Compute tangents using MikkTSpace-style algorithm (simplified)
-  static void ComputeTangents(std::vector<ecs::Vertex>& vertices,
-                              const std::vector<uint32_t>& indices,
-                              uint32_t indexOffset, uint32_t indexCount,
-                              uint32_t vertexOffset) {
-    // Zero out tangents for accumulation
-    for (uint32_t i = vertexOffset; i < vertexOffset + indexCount; ++i) {
-      if (i < vertices.size()) {
-        vertices[i].tangent = glm::vec4(0.0F);
-      }
-    }
-
-    // Process each triangle
-    for (uint32_t i = indexOffset; i < indexOffset + indexCount; i += 3) {
-      if (i + 2 >= indices.size()) {
-        break;
-      }
-
-      uint32_t i0 = indices[i] + vertexOffset;
-      uint32_t i1 = indices[i + 1] + vertexOffset;
-      uint32_t i2 = indices[i + 2] + vertexOffset;
-
-      if (i0 >= vertices.size() || i1 >= vertices.size() ||
-          i2 >= vertices.size()) {
+Model ModelLoader::Upload(const ModelData& data,
+                          std::shared_ptr<const void> owner) {
+  Model model;
+  model.name = data.name;
+  model.sourcePath = data.sourcePath;
+  model.materials = data.materials;
+  model.nodes = data.nodes;
+  model.lights = data.lights;
+  model.cameras = data.cameras;
+  model.rootNodes = data.rootNodes;
+
+  // Packs and imports carry content hashes; anything else is hashed here
+  std::vector<uint64_t> hashes(data.textures.size());
+  core::ParallelFor(data.textures.size(), [&](size_t i) {
+    const auto& textureData = data.textures[i];
+    hashes[i] = textureData.contentHash != 0
+                    ? textureData.contentHash
+                    : textureData.ComputeContentHash();
+  });
+  std::erase_if(textureCache_, [](const auto& entry) {
+    return entry.second.texture.expired();
+  });
+
+  bool stream = options_.streamTextures && owner != nullptr;
+  size_t sharedCount = 0;
+  for (size_t i = 0; i < data.textures.size(); ++i) {
+    const auto& textureData = data.textures[i];
+    TextureResource tex;
+    tex.name = textureData.name;
+    tex.width = textureData.width;
+    tex.height = textureData.height;
+    tex.contentHash = hashes[i];
+
+    // Textures with the same content, in this model or one loaded before,
+    // share one GPU texture and so one bindless slot
+    if (auto it = textureCache_.find(tex.contentHash);
+        it != textureCache_.end()) {
+      if (auto texture = it->second.texture.lock()) {
+        tex.texture = std::move(texture);
+        tex.mipChain = it->second.mipChain.lock();
+        tex.residentMip = it->second.residentMip;
+        model.textures.push_back(std::move(tex));
+        ++sharedCount;
         continue;
       }
-
-      const glm::vec3& p0 = vertices[i0].position;
-      const glm::vec3& p1 = vertices[i1].position;
-      const glm::vec3& p2 = vertices[i2].position;
-
-      const glm::vec2& uv0 = vertices[i0].texCoord;
-      const glm::vec2& uv1 = vertices[i1].texCoord;
-      const glm::vec2& uv2 = vertices[i2].texCoord;
-
-      glm::vec3 edge1 = p1 - p0;
-      glm::vec3 edge2 = p2 - p0;
-
-      glm::vec2 deltaUV1 = uv1 - uv0;
-      glm::vec2 deltaUV2 = uv2 - uv0;
-
-      float denom = (deltaUV1.x * deltaUV2.y) - (deltaUV2.x * deltaUV1.y);
-      if (std::abs(denom) < 1e-6F) {
-        continue;  // Degenerate UV mapping
-      }
-
-      float f = 1.0F / denom;
-
-      glm::vec3 tangent;
-      tangent.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-      tangent.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-      tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-
-      // Accumulate tangents (will normalize later)
-      vertices[i0].tangent += glm::vec4(tangent, 0.0F);
-      vertices[i1].tangent += glm::vec4(tangent, 0.0F);
-      vertices[i2].tangent += glm::vec4(tangent, 0.0F);
     }
 
-    // Normalize tangents and compute handedness
-    for (uint32_t i = vertexOffset;
-         i < vertexOffset + indexCount && i < vertices.size(); ++i) {
-      glm::vec3 n = vertices[i].normal;
-      auto t = glm::vec3(vertices[i].tangent);
-
-      if (glm::length(t) > 1e-6F) {
-        // Gram-Schmidt orthogonalize
-        t = glm::normalize(t - n * glm::dot(n, t));
-
-        // Calculate handedness (bitangent direction)
-        // For glTF, tangent.w should already be set, but we default to 1.0
-        vertices[i].tangent = glm::vec4(t, 1.0F);
-      } else {
-        // Create arbitrary tangent perpendicular to normal
-        glm::vec3 up =
-            std::abs(n.y) < 0.999F ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
-        t = glm::normalize(glm::cross(n, up));
-        vertices[i].tangent = glm::vec4(t, 1.0F);
-      }
+    // Streamed textures start with the levels that fit the tail size
+    if (stream && textureData.mipLevels > 1) {
+      auto chain = std::make_shared<TextureMipChain>();
+      chain->format = textureData.format;
+      chain->width = textureData.width;
+      chain->height = textureData.height;
+      chain->owner = owner;
+      for (uint32_t level = 0; level < textureData.mipLevels; ++level) {
+        chain->levels.push_back(textureData.GetLevel(level));
+      }
+      uint32_t size = std::max(textureData.width, textureData.height);
+      while (tex.residentMip + 1 < textureData.mipLevels &&
+             (size >> tex.residentMip) > options_.streamingTailSize) {
+        ++tex.residentMip;
+      }
+      tex.mipChain = std::move(chain);
     }
-  }
 
-  // NOLINTNEXTLINE(readability-function-cognitive-complexity)
-  void LoadMeshes(const tinygltf::Model& gltf, Model& model) {
-    for (const auto& gltfMesh : gltf.meshes) {
-      Mesh mesh;
-      mesh.name = gltfMesh.name;
-
-      std::vector<ecs::Vertex> vertices;
-      std::vector<uint32_t> indices;
-
-      glm::vec3 minBounds{std::numeric_limits<float>::max()};
-      glm::vec3 maxBounds{std::numeric_limits<float>::lowest()};
-
-      for (const auto& primitive : gltfMesh.primitives) {
-        if (primitive.mode != TINYGLTF_MODE_TRIANGLES) {
-          LOG_WARNING("Skipping non-triangle primitive in mesh: {}", mesh.name);
-          continue;
-        }
-
-        MeshPrimitive prim;
-        prim.vertexOffset = static_cast<uint32_t>(vertices.size());
-        prim.indexOffset = static_cast<uint32_t>(indices.size());
-        prim.materialIndex = primitive.material;
-
-        size_t vertexCount = 0;
-
-        // Get position accessor info (required)
-        const tinygltf::Accessor* posAccessor = nullptr;
-        const uint8_t* posData = nullptr;
-        size_t posStride = 0;
-
-        if (auto it = primitive.attributes.find("POSITION");
-            it != primitive.attributes.end()) {
-          posAccessor = &gltf.accessors[it->second];
-          const auto& bufferView = gltf.bufferViews[posAccessor->bufferView];
-          const auto& buffer = gltf.buffers[bufferView.buffer];
-          posData = buffer.data.data() + bufferView.byteOffset +
-                    posAccessor->byteOffset;
-          posStride = (bufferView.byteStride != 0U) ? bufferView.byteStride
-                                                    : sizeof(float) * 3;
-          vertexCount = posAccessor->count;
-
-          // Update bounds
-          if (posAccessor->minValues.size() >= 3) {
-            minBounds =
-                glm::min(minBounds, glm::vec3(posAccessor->minValues[0],
-                                              posAccessor->minValues[1],
-                                              posAccessor->minValues[2]));
-          }
-          if (posAccessor->maxValues.size() >= 3) {
-            maxBounds =
-                glm::max(maxBounds, glm::vec3(posAccessor->maxValues[0],
-                                              posAccessor->maxValues[1],
-                                              posAccessor->maxValues[2]));
-          }
-        } else {
-          LOG_WARNING("Mesh primitive missing POSITION attribute: {}",
-                      mesh.name);
-          continue;
-        }
-
-        // Normal
-        const uint8_t* normData = nullptr;
-        size_t normStride = 0;
-        if (auto it = primitive.attributes.find("NORMAL");
-            it != primitive.attributes.end()) {
-          const auto& accessor = gltf.accessors[it->second];
-          const auto& bufferView = gltf.bufferViews[accessor.bufferView];
-          const auto& buffer = gltf.buffers[bufferView.buffer];
-          normData =
-              buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
-          normStride = (bufferView.byteStride != 0U) ? bufferView.byteStride
-                                                     : sizeof(float) * 3;
-        }
-
-        // Texcoord
-        const uint8_t* texData = nullptr;
-        size_t texStride = 0;
-        if (auto it = primitive.attributes.find("TEXCOORD_0");
-            it != primitive.attributes.end()) {
-          const auto& accessor = gltf.accessors[it->second];
-          const auto& bufferView = gltf.bufferViews[accessor.bufferView];
-          const auto& buffer = gltf.buffers[bufferView.buffer];
-          texData =
-              buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
-          texStride = (bufferView.byteStride != 0U) ? bufferView.byteStride
-                                                    : sizeof(float) * 2;
-        }
-
-        // Color (handle different types)
-        const uint8_t* colorData = nullptr;
-        size_t colorStride = 0;
-        int colorComponentType = 0;
-        int colorType = 0;  // VEC3 or VEC4
-        if (auto it = primitive.attributes.find("COLOR_0");
-            it != primitive.attributes.end()) {
-          const auto& accessor = gltf.accessors[it->second];
-          const auto& bufferView = gltf.bufferViews[accessor.bufferView];
-          const auto& buffer = gltf.buffers[bufferView.buffer];
-          colorData =
-              buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
-          colorComponentType = accessor.componentType;
-          colorType = accessor.type;  // TINYGLTF_TYPE_VEC3 or VEC4
-
-          size_t componentSize = 4;  // float
-          if (colorComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
-            componentSize = 1;
-          } else if (colorComponentType ==
-                     TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
-            componentSize = 2;
-          }
-          size_t numComponents = (colorType == TINYGLTF_TYPE_VEC3) ? 3 : 4;
-          colorStride = (bufferView.byteStride != 0U)
-                            ? bufferView.byteStride
-                            : componentSize * numComponents;
-        }
-
-        // Tangent
-        const uint8_t* tangentData = nullptr;
-        size_t tangentStride = 0;
-        if (auto it = primitive.attributes.find("TANGENT");
-            it != primitive.attributes.end()) {
-          const auto& accessor = gltf.accessors[it->second];
-          const auto& bufferView = gltf.bufferViews[accessor.bufferView];
-          const auto& buffer = gltf.buffers[bufferView.buffer];
-          tangentData =
-              buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
-          tangentStride = (bufferView.byteStride != 0U) ? bufferView.byteStride
-                                                        : sizeof(float) * 4;
-        }
-
-        // Build vertices
-        for (size_t i = 0; i < vertexCount; ++i) {
-          ecs::Vertex v{};
-
-          // Position
-          const auto* pos =
-              std::bit_cast<const float*>(posData + (i * posStride));
-          v.position = glm::vec3(pos[0], pos[1], pos[2]);
-
-          // Normal
-          if (normData != nullptr) {
-            const auto* norm =
-                std::bit_cast<const float*>(normData + (i * normStride));
-            v.normal = glm::vec3(norm[0], norm[1], norm[2]);
-          } else {
-            v.normal = glm::vec3(0.0F, 1.0F, 0.0F);
-          }
-
-          // Tangent
-          if (tangentData != nullptr) {
-            const auto* tan =
-                std::bit_cast<const float*>(tangentData + (i * tangentStride));
-            v.tangent = glm::vec4(tan[0], tan[1], tan[2], tan[3]);
-          } else {
-            // Default tangent (will be computed later if needed)
-            v.tangent = glm::vec4(1.0F, 0.0F, 0.0F, 1.0F);
-          }
-
-          // Texcoord
-          if (texData != nullptr) {
-            const auto* tex =
-                std::bit_cast<const float*>(texData + (i * texStride));
-            v.texCoord = glm::vec2(tex[0], tex[1]);
-          }
-
-          // Color
-          if (colorData != nullptr) {
-            const uint8_t* c = colorData + (i * colorStride);
-            if (colorComponentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
-              const auto* cf = std::bit_cast<const float*>(c);
-              if (colorType == TINYGLTF_TYPE_VEC4) {
-                v.color = glm::vec4(cf[0], cf[1], cf[2], cf[3]);
-              } else {
-                v.color = glm::vec4(cf[0], cf[1], cf[2], 1.0F);
-              }
-            } else if (colorComponentType ==
-                       TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
-              if (colorType == TINYGLTF_TYPE_VEC4) {
-                v.color = glm::vec4(static_cast<float>(c[0]) / 255.0F,
-                                    static_cast<float>(c[1]) / 255.0F,
-                                    static_cast<float>(c[2]) / 255.0F,
-                                    static_cast<float>(c[3]) / 255.0F);
-              } else {
-                v.color = glm::vec4(static_cast<float>(c[0]) / 255.0F,
-                                    static_cast<float>(c[1]) / 255.0F,
-                                    static_cast<float>(c[2]) / 255.0F, 1.0F);
-              }
-            } else if (colorComponentType ==
-                       TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
-              const auto* cs = std::bit_cast<const uint16_t*>(c);
-              if (colorType == TINYGLTF_TYPE_VEC4) {
-                v.color = glm::vec4(static_cast<float>(cs[0]) / 65535.0F,
-                                    static_cast<float>(cs[1]) / 65535.0F,
-                                    static_cast<float>(cs[2]) / 65535.0F,
-                                    static_cast<float>(cs[3]) / 65535.0F);
-              } else {
-                v.color = glm::vec4(static_cast<float>(cs[0]) / 65535.0F,
-                                    static_cast<float>(cs[1]) / 65535.0F,
-                                    static_cast<float>(cs[2]) / 65535.0F, 1.0F);
-              }
-            }
-          } else {
-            v.color = glm::vec4(1.0F);
-          }
-
-          vertices.push_back(v);
-        }
-
-        prim.vertexCount = static_cast<uint32_t>(vertexCount);
-
-        // Indices
-        if (primitive.indices >= 0) {
-          const auto& accessor = gltf.accessors[primitive.indices];
-          const auto& bufferView = gltf.bufferViews[accessor.bufferView];
-          const auto& buffer = gltf.buffers[bufferView.buffer];
-          const uint8_t* data =
-              buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
-
-          prim.indexCount = static_cast<uint32_t>(accessor.count);
-
-          for (size_t i = 0; i < accessor.count; ++i) {
-            uint32_t index = 0;
-            switch (accessor.componentType) {
-              case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-                index = data[i];
-                break;
-              case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-                index = std::bit_cast<const uint16_t*>(data)[i];
-                break;
-              case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
-                index = std::bit_cast<const uint32_t*>(data)[i];
-                break;
-              default:
-                LOG_WARNING("Unsupported index component type in mesh: {}",
-                            mesh.name);
-                break;
-            }
-
-            indices.push_back(index);
-          }
-        }
-
-        // Compute tangents if not provided in the glTF
-        if (tangentData == nullptr && !indices.empty()) {
-          ComputeTangents(vertices, indices, prim.indexOffset, prim.indexCount,
-                          prim.vertexOffset);
-          LOG_DEBUG("Computed tangents for primitive in mesh: {}", mesh.name);
-        }
-
-        mesh.primitives.push_back(prim);
-      }
-
-      // Create GPU buffers (CPU-visible for simplicity)
-      if (!vertices.empty()) {
-        size_t vertexSize = vertices.size() * sizeof(ecs::Vertex);
-        mesh.vertexBuffer = factory.CreateBuffer(
-            vertexSize, rhi::BufferUsage::Vertex, rhi::MemoryUsage::CPUToGPU);
-        void* mapped = mesh.vertexBuffer->Map();
-        std::memcpy(mapped, vertices.data(), vertexSize);
-        mesh.vertexBuffer->Unmap();
-      }
-
-      if (!indices.empty()) {
-        size_t indexSize = indices.size() * sizeof(uint32_t);
-        mesh.indexBuffer = factory.CreateBuffer(
-            indexSize, rhi::BufferUsage::Index, rhi::MemoryUsage::CPUToGPU);
-        void* mapped = mesh.indexBuffer->Map();
-        std::memcpy(mapped, indices.data(), indexSize);
-        mesh.indexBuffer->Unmap();
+    uint32_t mipLevels = textureData.mipLevels - tex.residentMip;
+    tex.texture = factory_.CreateTexture(
+        std::max(1U, tex.width >> tex.residentMip),
+        std::max(1U, tex.height >> tex.residentMip), textureData.format,
+        rhi::TextureUsage::Sampled, mipLevels);
+    // Levels go to staging straight from the imported or mapped bytes
+    std::vector<rhi::TextureSubresourceData> levels;
+    for (uint32_t level = 0; level < mipLevels; ++level) {
+      auto pixels = textureData.GetLevel(tex.residentMip + level);
+      if (!pixels.empty()) {
+        levels.push_back({.data = pixels, .mipLevel = level});
       }
-
-      mesh.bounds.min = minBounds;
-      mesh.bounds.max = maxBounds;
-
-      model.meshes.push_back(std::move(mesh));
     }
+    tex.texture->UploadSubresources(levels);
+    textureCache_[tex.contentHash] = {
+        .texture = tex.texture,
+        .mipChain = tex.mipChain,
+        .residentMip = tex.residentMip,
+    };
+    model.textures.push_back(std::move(tex));
   }
-
-  void LoadNodes(const tinygltf::Model& gltf, Model& model) {
-    (void)this;
-
-    for (const auto& gltfNode : gltf.nodes) {
-      SceneNode node;
-      node.name = gltfNode.name;
-
-      // Transform
-      if (!gltfNode.translation.empty()) {
-        node.translation =
-            glm::vec3(gltfNode.translation[0], gltfNode.translation[1],
-                      gltfNode.translation[2]);
-      }
-      if (!gltfNode.rotation.empty()) {
-        node.rotation =
-            glm::quat(static_cast<float>(gltfNode.rotation[3]),   // w
-                      static_cast<float>(gltfNode.rotation[0]),   // x
-                      static_cast<float>(gltfNode.rotation[1]),   // y
-                      static_cast<float>(gltfNode.rotation[2]));  // z
-      }
-      if (!gltfNode.scale.empty()) {
-        node.scale =
-            glm::vec3(gltfNode.scale[0], gltfNode.scale[1], gltfNode.scale[2]);
-      }
-
-      // Matrix (overrides TRS if present)
-      if (!gltfNode.matrix.empty()) {
-        glm::mat4 matrix{glm::make_mat4(gltfNode.matrix.data())};
-
-        // Decompose matrix to TRS
-        node.translation = glm::vec3(matrix[3]);
-        node.scale = glm::vec3(glm::length(glm::vec3(matrix[0])),
-                               glm::length(glm::vec3(matrix[1])),
-                               glm::length(glm::vec3(matrix[2])));
-        glm::mat3 rotMat(glm::vec3(matrix[0]) / node.scale.x,
-                         glm::vec3(matrix[1]) / node.scale.y,
-                         glm::vec3(matrix[2]) / node.scale.z);
-        node.rotation = glm::quat_cast(rotMat);
-      }
-
-      node.meshIndex = gltfNode.mesh;
-      node.cameraIndex = gltfNode.camera;
-
-      for (int child : gltfNode.children) {
-        node.children.push_back(static_cast<uint32_t>(child));
-      }
-
-      model.nodes.push_back(std::move(node));
-    }
+  if (sharedCount > 0) {
+    LOG_INFO("{}: {} of {} textures shared with identical content",
+             data.name, sharedCount, data.textures.size());
   }
 
-  void LoadLights(const tinygltf::Model& gltf, Model& model) {
-    (void)this;
-
-    // KHR_lights_punctual extension
-    if (auto it = gltf.extensions.find("KHR_lights_punctual");
-        it != gltf.extensions.end()) {
-      if (it->second.Has("lights") && it->second.Get("lights").IsArray()) {
-        const auto& lights = it->second.Get("lights");
-        for (size_t i = 0; i < lights.ArrayLen(); ++i) {
-          const auto& gltfLight = lights.Get(static_cast<int>(i));
-
-          Light light;
-          if (gltfLight.Has("name")) {
-            light.name = gltfLight.Get("name").Get<std::string>();
-          }
-
-          if (gltfLight.Has("type")) {
-            std::string type = gltfLight.Get("type").Get<std::string>();
-            if (type == "directional") {
-              light.type = Light::Type::Directional;
-
-            } else if (type == "point") {
-              light.type = Light::Type::Point;
-
-            } else if (type == "spot") {
-              light.type = Light::Type::Spot;
-            }
-          }
-
-          if (gltfLight.Has("color") && gltfLight.Get("color").IsArray()) {
-            const auto& c = gltfLight.Get("color");
-            light.color = glm::vec3(c.Get(0).GetNumberAsDouble(),
-                                    c.Get(1).GetNumberAsDouble(),
-                                    c.Get(2).GetNumberAsDouble());
-          }
-
-          if (gltfLight.Has("intensity")) {
-            light.intensity = static_cast<float>(
-                gltfLight.Get("intensity").GetNumberAsDouble());
-          }
-
-          if (gltfLight.Has("range")) {
-            light.range =
-                static_cast<float>(gltfLight.Get("range").GetNumberAsDouble());
-          }
-
-          model.lights.push_back(std::move(light));
-        }
-      }
+  // Create GPU buffers (CPU-visible for simplicity); the data is already in
+  // its final layout, so this is a plain copy
+  auto createBuffer = [this](std::span<const std::byte> bytes,
+                             rhi::BufferUsage usage) {
+    std::shared_ptr<rhi::Buffer> buffer =
+        factory_.CreateBuffer(bytes.size(), usage, rhi::MemoryUsage::CPUToGPU);
+    void* mapped = buffer->Map();
+    std::memcpy(mapped, bytes.data(), bytes.size());
+    buffer->Unmap();
+    return buffer;
+  };
+
+  for (const auto& meshData : data.meshes) {
+    Mesh mesh;
+    mesh.name = meshData.name;
+    mesh.indexType = meshData.indexType;
+    mesh.vertexFormat = meshData.vertexFormat;
+    mesh.positionDequantization = meshData.positionDequantization;
+    mesh.primitives = meshData.primitives;
+    mesh.bounds = meshData.bounds;
+
+    if (!meshData.vertices.empty()) {
+      mesh.vertexBuffer =
+          createBuffer(meshData.vertices, rhi::BufferUsage::Vertex);
     }
-  }
-
-  void LoadCameras(const tinygltf::Model& gltf, Model& model) {
-    (void)this;
-
-    for (const auto& gltfCamera : gltf.cameras) {
-      CameraData cam;
-      cam.name = gltfCamera.name;
-      cam.perspective = (gltfCamera.type == "perspective");
-
-      if (cam.perspective) {
-        cam.yfov = static_cast<float>(gltfCamera.perspective.yfov);
-        cam.aspectRatio =
-            static_cast<float>(gltfCamera.perspective.aspectRatio);
-        cam.znear = static_cast<float>(gltfCamera.perspective.znear);
-        cam.zfar = static_cast<float>(gltfCamera.perspective.zfar);
-      }
-
-      model.cameras.push_back(std::move(cam));
+    if (!meshData.indices.empty()) {
+      mesh.indexBuffer =
+          createBuffer(meshData.indices, rhi::BufferUsage::Index);
     }
-  }
-};
 
-ModelLoader::ModelLoader(rhi::Factory& factory)
-    : impl_{std::make_unique<Impl>(factory)} {}
-
-ModelLoader::~ModelLoader() = default;
+    model.meshes.push_back(std::move(mesh));
+  }
 
-std::optional<Model> ModelLoader::Load(const std::filesystem::path& path) {
-  return impl_->LoadGLTF(path);
+  return model;
 }
-
 }  // namespace resource
@@ -3,27 +3,66 @@
 #include <filesystem>
 #include <memory>
 #include <optional>
+#include <unordered_map>
 
+#include "resource/model_data.hpp"
+#include "resource/model_importer.hpp"
 #include "resource/types.hpp"
 #include "rhi/factory.hpp"
 
 namespace resource {
 
+// Model data read by ModelLoader::Read, kept alive by `owner`
+struct PendingModel {
+  std::shared_ptr<const void> owner;
+  const ModelData* data{nullptr};
+};
+
 class ModelLoader {
  public:
-  explicit ModelLoader(rhi::Factory& factory);
-  ~ModelLoader();
+  explicit ModelLoader(rhi::Factory& factory, ModelLoadOptions options = {});
 
   /**
-   * @brief Load a glTF model from file.
+   * @brief Load a model from file.
+   *
+   * Cooked model packs (.vkrpack) are memory-mapped and uploaded straight
+   * from the mapping; anything else is imported as glTF first.
    *
-   * @param path Path to .gltf or .glb file
+   * @param path Path to .gltf, .glb or .vkrpack file
    * @return Loaded model or nullopt on failure
    */
   [[nodiscard]] std::optional<Model> Load(const std::filesystem::path& path);
 
+  /**
+   * @brief Read a model into upload-ready data without touching the GPU.
+   *
+   * The CPU half of Load. Safe to call from any thread, also while another
+   * thread uploads.
+   */
+  [[nodiscard]] std::optional<PendingModel> Read(
+      const std::filesystem::path& path,
+      const LoadStageCallback& onStage = {}) const;
+
+  /**
+   * @brief Create the GPU resources for imported model data.
+   *
+   * @param owner Keeps `data` alive for texture streaming; without one every
+   * texture is uploaded in full
+   * @note Not thread-safe; call from the thread that renders.
+   */
+  [[nodiscard]] Model Upload(const ModelData& data,
+                             std::shared_ptr<const void> owner = nullptr);
+
  private:
-  struct Impl;
-  std::unique_ptr<Impl> impl_;
+  // A texture uploaded before, shared while any model still holds it
+  struct SharedTexture {
+    std::weak_ptr<rhi::Texture> texture;
+    std::weak_ptr<const TextureMipChain> mipChain;
+    uint32_t residentMip{0};
+  };
+
+  rhi::Factory& factory_;
+  ModelLoadOptions options_;
+  std::unordered_map<uint64_t, SharedTexture> textureCache_;  // By content
 };
 }  // namespace resource
@@ -0,0 +1,445 @@
+#include "resource/model_pack.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "logger.hpp"
+
+namespace resource {
+namespace {
+static_assert(std::endian::native == std::endian::little,
+              "Model packs are stored little-endian");
+
+constexpr std::array<char, 8> kMagic{'V', 'K', 'R', 'P', 'A', 'C', 'K', '\0'};
+
+// Blobs start on cache-line boundaries so uploads copy from aligned memory
+constexpr uint64_t kBlobAlignment = 64;
+
+struct PackHeader {
+  std::array<char, 8> magic{};
+  uint32_t version{0};
+  uint32_t headerSize{0};
+  uint64_t metadataOffset{0};
+  uint64_t metadataSize{0};
+  uint64_t dataOffset{0};
+  uint64_t dataSize{0};
+};
+static_assert(sizeof(PackHeader) == 48);
+
+struct BlobRef {
+  uint64_t offset{0};
+  uint64_t size{0};
+};
+
+constexpr uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+template <typename T>
+constexpr bool kIsVector = false;
+template <typename T>
+constexpr bool kIsVector<std::vector<T>> = true;
+
+template <typename T, typename U>
+concept MaybeConst = std::same_as<std::remove_const_t<T>, U>;
+
+// ----------------------------------------------------------------------------
+// Field lists, shared by the writer and the reader
+// ----------------------------------------------------------------------------
+
+template <typename Archive, MaybeConst<MeshData> T>
+void Serialize(Archive& ar, T& mesh) {
+  ar(mesh.name);
+  ar(mesh.vertexFormat);
+  ar(mesh.positionDequantization);
+  ar(mesh.indexType);
+  ar(mesh.vertices);
+  ar(mesh.indices);
+  ar(mesh.primitives);
+  ar(mesh.bounds.min);
+  ar(mesh.bounds.max);
+}
+
+template <typename Archive, MaybeConst<TextureData> T>
+void Serialize(Archive& ar, T& texture) {
+  ar(texture.name);
+  ar(texture.width);
+  ar(texture.height);
+  ar(texture.format);
+  ar(texture.mipLevels);
+  ar(texture.pixels);
+  ar(texture.levelOffsets);
+  ar(texture.contentHash);
+}
+
+template <typename Archive, MaybeConst<Material> T>
+void Serialize(Archive& ar, T& material) {
+  ar(material.name);
+  ar(material.baseColorFactor);
+  ar(material.metallicFactor);
+  ar(material.roughnessFactor);
+  ar(material.emissiveFactor);
+  ar(material.alphaCutoff);
+  ar(material.baseColorTexture);
+  ar(material.metallicRoughnessTexture);
+  ar(material.normalTexture);
+  ar(material.occlusionTexture);
+  ar(material.emissiveTexture);
+  ar(material.alphaMode);
+  ar(material.doubleSided);
+}
+
+template <typename Archive, MaybeConst<SceneNode> T>
+void Serialize(Archive& ar, T& node) {
+  ar(node.name);
+  ar(node.translation);
+  ar(node.rotation);
+  ar(node.scale);
+  ar(node.meshIndex);
+  ar(node.cameraIndex);
+  ar(node.lightIndex);
+  ar(node.instances);
+  ar(node.children);
+}
+
+template <typename Archive, MaybeConst<Light> T>
+void Serialize(Archive& ar, T& light) {
+  ar(light.name);
+  ar(light.type);
+  ar(light.color);
+  ar(light.intensity);
+  ar(light.range);
+  ar(light.innerConeAngle);
+  ar(light.outerConeAngle);
+}
+
+template <typename Archive, MaybeConst<CameraData> T>
+void Serialize(Archive& ar, T& camera) {
+  ar(camera.name);
+  ar(camera.perspective);
+  ar(camera.yfov);
+  ar(camera.aspectRatio);
+  ar(camera.znear);
+  ar(camera.zfar);
+}
+
+template <typename Archive, MaybeConst<ModelData> T>
+void Serialize(Archive& ar, T& model) {
+  ar(model.name);
+  ar(model.sourcePath);
+  ar(model.meshes);
+  ar(model.textures);
+  ar(model.materials);
+  ar(model.nodes);
+  ar(model.lights);
+  ar(model.cameras);
+  ar(model.rootNodes);
+}
+
+// ----------------------------------------------------------------------------
+// Archives
+// ----------------------------------------------------------------------------
+
+class PackWriter {
+ public:
+  template <typename T>
+  void operator()(const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+      WriteRaw(static_cast<uint8_t>(value ? 1 : 0));
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      WriteRaw(static_cast<uint32_t>(value.size()));
+      Append(value.data(), value.size());
+    } else if constexpr (std::is_same_v<T, std::span<const std::byte>>) {
+      // Blobs only get a reference here; their bytes go to the data section
+      dataSize_ = AlignUp(dataSize_, kBlobAlignment);
+      WriteRaw(BlobRef{.offset = dataSize_, .size = value.size()});
+      blobs_.emplace_back(dataSize_, value);
+      dataSize_ += value.size();
+    } else if constexpr (kIsVector<T>) {
+      WriteRaw(static_cast<uint32_t>(value.size()));
+      using Element = typename T::value_type;
+      if constexpr (std::is_trivially_copyable_v<Element>) {
+        Append(value.data(), value.size() * sizeof(Element));
+      } else {
+        for (const auto& element : value) {
+          Serialize(*this, element);
+        }
+      }
+    } else if constexpr (std::is_trivially_copyable_v<T>) {
+      WriteRaw(value);
+    } else {
+      Serialize(*this, value);
+    }
+  }
+
+  [[nodiscard]] const std::vector<char>& GetMetadata() const {
+    return metadata_;
+  }
+  [[nodiscard]] uint64_t GetDataSize() const { return dataSize_; }
+  [[nodiscard]] const auto& GetBlobs() const { return blobs_; }
+
+ private:
+  template <typename T>
+  void WriteRaw(const T& value) {
+    Append(&value, sizeof(T));
+  }
+
+  void Append(const void* data, size_t size) {
+    const auto* bytes = static_cast<const char*>(data);
+    metadata_.insert(metadata_.end(), bytes, bytes + size);
+  }
+
+  std::vector<char> metadata_;
+  std::vector<std::pair<uint64_t, std::span<const std::byte>>> blobs_;
+  uint64_t dataSize_{0};
+};
+
+class PackReader {
+ public:
+  PackReader(std::span<const std::byte> metadata,
+             std::span<const std::byte> data)
+      : metadata_{metadata}, data_{data} {}
+
+  template <typename T>
+  void operator()(T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+      value = ReadRaw<uint8_t>() != 0;
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      auto size = ReadRaw<uint32_t>();
+      if (!Require(size)) {
+        return;
+      }
+      value.assign(std::bit_cast<const char*>(metadata_.data() + offset_),
+                   size);
+      offset_ += size;
+    } else if constexpr (std::is_same_v<T, std::span<const std::byte>>) {
+      auto ref = ReadRaw<BlobRef>();
+      if (ref.offset > data_.size() || ref.size > data_.size() - ref.offset) {
+        failed_ = true;
+        return;
+      }
+      value = data_.subspan(ref.offset, ref.size);
+    } else if constexpr (kIsVector<T>) {
+      using Element = typename T::value_type;
+      auto count = ReadRaw<uint32_t>();
+      // Every element takes at least one byte, which bounds hostile counts
+      if (!Require(count)) {
+        return;
+      }
+      if constexpr (std::is_trivially_copyable_v<Element>) {
+        if (!Require(count * sizeof(Element))) {
+          return;
+        }
+        value.resize(count);
+        std::memcpy(value.data(), metadata_.data() + offset_,
+                    count * sizeof(Element));
+        offset_ += count * sizeof(Element);
+      } else {
+        value.resize(count);
+        for (auto& element : value) {
+          Serialize(*this, element);
+        }
+      }
+    } else if constexpr (std::is_trivially_copyable_v<T>) {
+      value = ReadRaw<T>();
+    } else {
+      Serialize(*this, value);
+    }
+  }
+
+  [[nodiscard]] bool Succeeded() const {
+    return !failed_ && offset_ == metadata_.size();
+  }
+
+ private:
+  bool Require(size_t size) {
+    if (failed_ || size > metadata_.size() - offset_) {
+      failed_ = true;
+    }
+    return !failed_;
+  }
+
+  template <typename T>
+  T ReadRaw() {
+    T value{};
+    if (Require(sizeof(T))) {
+      std::memcpy(&value, metadata_.data() + offset_, sizeof(T));
+      offset_ += sizeof(T);
+    }
+    return value;
+  }
+
+  std::span<const std::byte> metadata_;
+  std::span<const std::byte> data_;
+  size_t offset_{0};
+  bool failed_{false};
+};
+
+// The reader only checks that fields fit their sections; this checks that
+// what gets uploaded stays within its blobs
+bool IsConsistent(const MeshData& mesh) {
+  if (mesh.vertexFormat > ecs::VertexFormat::Quantized ||
+      mesh.indexType > rhi::IndexType::Uint32) {
+    return false;
+  }
+  uint64_t stride = mesh.vertexFormat == ecs::VertexFormat::Quantized
+                        ? sizeof(ecs::QuantizedVertex)
+                        : sizeof(ecs::Vertex);
+  uint64_t indexSize = rhi::GetIndexSize(mesh.indexType);
+  if (mesh.vertices.size() % stride != 0 ||
+      mesh.indices.size() % indexSize != 0) {
+    return false;
+  }
+  uint64_t vertexCount = mesh.vertices.size() / stride;
+  uint64_t indexCount = mesh.indices.size() / indexSize;
+  return std::ranges::all_of(mesh.primitives, [&](const auto& primitive) {
+    return uint64_t{primitive.vertexOffset} + primitive.vertexCount <=
+               vertexCount &&
+           uint64_t{primitive.indexOffset} + primitive.indexCount <=
+               indexCount;
+  });
+}
+
+bool IsConsistent(const TextureData& texture) {
+  if (rhi::GetFormatInfo(texture.format).blockSize == 0 ||
+      texture.width == 0 || texture.height == 0 || texture.mipLevels == 0 ||
+      texture.mipLevels >
+          rhi::GetMipLevelCount(texture.width, texture.height)) {
+    return false;
+  }
+  for (uint32_t level = 0; level < texture.mipLevels; ++level) {
+    if (texture.GetLevel(level).empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IsConsistent(const ModelData& data) {
+  auto consistent = [](const auto& item) { return IsConsistent(item); };
+  return std::ranges::all_of(data.meshes, consistent) &&
+         std::ranges::all_of(data.textures, consistent);
+}
+
+void WritePadding(std::ofstream& file, uint64_t& position, uint64_t target) {
+  static constexpr std::array<char, kBlobAlignment> kZeros{};
+  while (position < target) {
+    auto count = std::min<uint64_t>(target - position, kZeros.size());
+    file.write(kZeros.data(), static_cast<std::streamsize>(count));
+    position += count;
+  }
+}
+}  // namespace
+
+bool WriteModelPack(const ModelData& data, const std::filesystem::path& path) {
+  PackWriter writer;
+  Serialize(writer, data);
+
+  const auto& metadata = writer.GetMetadata();
+  PackHeader header{
+      .magic = kMagic,
+      .version = kModelPackVersion,
+      .headerSize = sizeof(PackHeader),
+      .metadataOffset = sizeof(PackHeader),
+      .metadataSize = metadata.size(),
+      .dataOffset = AlignUp(sizeof(PackHeader) + metadata.size(),
+                            kBlobAlignment),
+      .dataSize = writer.GetDataSize(),
+  };
+
+  std::filesystem::path tempPath = path;
+  tempPath += ".tmp";
+
+  {
+    std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+    if (!file) {
+      LOG_ERROR("Failed to create model pack: {}", tempPath.string());
+      return false;
+    }
+
+    file.write(std::bit_cast<const char*>(&header), sizeof(header));
+    file.write(metadata.data(), static_cast<std::streamsize>(metadata.size()));
+
+    uint64_t position = sizeof(header) + metadata.size();
+    WritePadding(file, position, header.dataOffset);
+
+    for (const auto& [offset, blob] : writer.GetBlobs()) {
+      WritePadding(file, position, header.dataOffset + offset);
+      file.write(std::bit_cast<const char*>(blob.data()),
+                 static_cast<std::streamsize>(blob.size()));
+      position += blob.size();
+    }
+
+    if (!file.good()) {
+      LOG_ERROR("Failed to write model pack: {}", tempPath.string());
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tempPath, path, error);
+  if (error) {
+    LOG_ERROR("Failed to move model pack into place: {} ({})", path.string(),
+              error.message());
+    return false;
+  }
+  return true;
+}
+
+std::optional<ModelPack> ModelPack::Open(const std::filesystem::path& path) {
+  auto file = io::MappedFile::Open(path);
+  if (!file) {
+    LOG_ERROR("Failed to map model pack: {}", path.string());
+    return std::nullopt;
+  }
+
+  auto bytes = file->GetData();
+  PackHeader header{};
+  if (bytes.size() < sizeof(header)) {
+    LOG_ERROR("Model pack is truncated: {}", path.string());
+    return std::nullopt;
+  }
+  std::memcpy(&header, bytes.data(), sizeof(header));
+
+  if (header.magic != kMagic || header.headerSize != sizeof(header)) {
+    LOG_ERROR("Not a model pack: {}", path.string());
+    return std::nullopt;
+  }
+  if (header.version != kModelPackVersion) {
+    LOG_ERROR("Model pack {} has version {}, expected {}; re-cook it",
+              path.string(), header.version, kModelPackVersion);
+    return std::nullopt;
+  }
+  if (header.metadataOffset > bytes.size() ||
+      header.metadataSize > bytes.size() - header.metadataOffset ||
+      header.dataOffset > bytes.size() ||
+      header.dataSize > bytes.size() - header.dataOffset) {
+    LOG_ERROR("Model pack sections are out of bounds: {}", path.string());
+    return std::nullopt;
+  }
+
+  // Moving the mapping keeps its address, so spans taken below stay valid
+  ModelPack pack;
+  pack.file_ = std::move(*file);
+
+  PackReader reader{bytes.subspan(header.metadataOffset, header.metadataSize),
+                    bytes.subspan(header.dataOffset, header.dataSize)};
+  Serialize(reader, pack.data_);
+  if (!reader.Succeeded() || !IsConsistent(pack.data_)) {
+    LOG_ERROR("Model pack is corrupt: {}", path.string());
+    return std::nullopt;
+  }
+
+  return pack;
+}
+
+}  // namespace resource
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+#include "io/mapped_file.hpp"
+#include "resource/model_data.hpp"
+
+namespace resource {
+
+constexpr std::string_view kModelPackExtension = ".vkrpack";
+
+// Bumped whenever the layout changes; older packs must be re-cooked
+constexpr uint32_t kModelPackVersion = 5;
+
+/**
+ * @brief Write model data as a cooked model pack.
+ *
+ * The pack is a small header, a metadata section (materials, nodes, mesh and
+ * texture descriptions) and a data section with every vertex, index and
+ * texel blob aligned for direct upload. The file is written under a
+ * temporary name and renamed into place once complete.
+ *
+ * @return false if the file cannot be written
+ */
+bool WriteModelPack(const ModelData& data, const std::filesystem::path& path);
+
+/**
+ * @brief A memory-mapped model pack.
+ *
+ * Mesh and texture spans in the data point directly into the mapping, which
+ * lives as long as the pack.
+ */
+class ModelPack {
+ public:
+  /**
+   * @brief Map and validate a model pack.
+   *
+   * @param path Path to a .vkrpack file
+   * @return The pack or nullopt if it is missing, corrupt or from another
+   * version
+   */
+  [[nodiscard]] static std::optional<ModelPack> Open(
+      const std::filesystem::path& path);
+
+  [[nodiscard]] const ModelData& GetData() const { return data_; }
+
+ private:
+  ModelPack() = default;
+
+  io::MappedFile file_;
+  ModelData data_;
+};
+
+}  // namespace resource
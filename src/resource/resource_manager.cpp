@@ -1,40 +1,578 @@
 #include "resource/resource_manager.hpp"
 
+#include <algorithm>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+
 #include "logger.hpp"
+#include "resource/model_pack.hpp"
 
 namespace resource {
-ResourceManager::ResourceManager(rhi::Factory& factory)
-    : factory_{factory}, modelLoader_{factory} {}
+namespace {
+// A cooked pack next to the source (same stem, .vkrpack) is used instead of
+// the source as long as it is not older than it
+std::filesystem::path ResolveCookedPath(const std::filesystem::path& path) {
+  if (path.extension() == kModelPackExtension) {
+    return path;
+  }
+
+  std::filesystem::path packPath = path;
+  packPath.replace_extension(kModelPackExtension);
+
+  std::error_code error;
+  auto packTime = std::filesystem::last_write_time(packPath, error);
+  if (error) {
+    return path;
+  }
+  auto sourceTime = std::filesystem::last_write_time(path, error);
+  if (!error && sourceTime > packTime) {
+    LOG_WARNING("Ignoring stale model pack: {}", packPath.string());
+    return path;
+  }
+  return packPath;
+}
+
+// CPU memory is what the mip chains keep alive for streaming, GPU memory the
+// buffers and textures as uploaded. Resources shared with other models are
+// counted for each of them.
+uint64_t MeasureCpuBytes(const Model& model) {
+  std::unordered_set<const TextureMipChain*> chains;
+  uint64_t size = 0;
+  for (const auto& texture : model.textures) {
+    if (texture.mipChain && chains.insert(texture.mipChain.get()).second) {
+      for (const auto& level : texture.mipChain->levels) {
+        size += level.size();
+      }
+    }
+  }
+  return size;
+}
+
+uint64_t MeasureGpuBytes(const Model& model) {
+  std::unordered_set<const void*> counted;
+  uint64_t size = 0;
+  for (const auto& mesh : model.meshes) {
+    for (const auto& buffer : {mesh.vertexBuffer, mesh.indexBuffer}) {
+      if (buffer && counted.insert(buffer.get()).second) {
+        size += buffer->GetSize();
+      }
+    }
+  }
+  for (const auto& resource : model.textures) {
+    const auto* texture = resource.texture.get();
+    if (texture == nullptr || !counted.insert(texture).second) {
+      continue;
+    }
+    for (uint32_t level = 0; level < texture->GetMipLevels(); ++level) {
+      size += rhi::GetMipLevelSize(texture->GetFormat(), texture->GetWidth(),
+                                   texture->GetHeight(), level);
+    }
+  }
+  return size;
+}
+}  // namespace
 
-Model* ResourceManager::LoadModel(const std::filesystem::path& path) {
+ResourceManager::ResourceManager(rhi::Factory& factory, ResourceBudget budget,
+                                 uint32_t loaderThreads)
+    : factory_{factory}, modelLoader_{factory}, budget_{budget} {
+  for (uint32_t i = 0; i < std::max(1U, loaderThreads); ++i) {
+    loaders_.emplace_back([this](const std::stop_token& stop) { Run(stop); });
+  }
+}
+
+ResourceManager::~ResourceManager() {
+  if (registry_ != nullptr) {
+    registry_->on_construct<ecs::ModelReferenceComponent>().disconnect(this);
+    registry_->on_destroy<ecs::ModelReferenceComponent>().disconnect(this);
+  }
+}
+
+ModelHandle ResourceManager::LoadModel(const std::filesystem::path& path) {
   std::string key = path.string();
 
   // Check cache
-  if (auto it = models_.find(key); it != models_.end()) {
-    return it->second.get();
+  if (auto it = modelIndexMap_.find(key); it != modelIndexMap_.end()) {
+    uint32_t index = it->second;
+    auto& slot = models_[index];
+
+    // An asynchronous load of the same model is waited for and finished here
+    if (auto load = std::move(slot.load)) {
+      for (auto stage = load->stage.load(std::memory_order_acquire);
+           stage < LoadStage::Upload;
+           stage = load->stage.load(std::memory_order_acquire)) {
+        load->stage.wait(stage, std::memory_order_acquire);
+      }
+      Finish(index, std::move(load->result));
+      if (!slot.model) {
+        return {};
+      }
+    }
+
+    slot.lastUsed = submittedFrames_;
+    return {.index = index, .generation = slot.generation};
+  }
+
+  // Load, from the cooked pack when there is one
+  uint32_t index = AllocateSlot(key);
+  Finish(index, modelLoader_.Read(ResolveCookedPath(path)));
+  if (!models_[index].model) {
+    return {};
+  }
+  return {.index = index, .generation = models_[index].generation};
+}
+
+ModelHandle ResourceManager::LoadModelAsync(const std::filesystem::path& path) {
+  std::string key = path.string();
+
+  // Loaded or already loading
+  if (auto it = modelIndexMap_.find(key); it != modelIndexMap_.end()) {
+    auto& slot = models_[it->second];
+    slot.lastUsed = submittedFrames_;
+    return {.index = it->second, .generation = slot.generation};
+  }
+
+  uint32_t index = AllocateSlot(key);
+  auto load = std::make_shared<AsyncLoad>();
+  load->path = path;
+  models_[index].load = load;
+  {
+    std::scoped_lock lock{queueMutex_};
+    queue_.push_back(std::move(load));
+  }
+  wake_.notify_one();
+
+  return {.index = index, .generation = models_[index].generation};
+}
+
+uint32_t ResourceManager::AllocateSlot(const std::string& key) {
+  uint32_t index = 0;
+  if (!freeSlots_.empty()) {
+    index = freeSlots_.back();
+    freeSlots_.pop_back();
+  } else {
+    index = static_cast<uint32_t>(models_.size());
+    models_.emplace_back();
+  }
+
+  auto& slot = models_[index];
+  slot.key = key;
+  slot.lastUsed = submittedFrames_;
+  modelIndexMap_[key] = index;
+  return index;
+}
+
+void ResourceManager::FreeSlot(uint32_t index) {
+  // Handles to the slot no longer resolve
+  auto& slot = models_[index];
+  uint32_t generation = slot.generation + 1;
+  slot = {};
+  slot.generation = generation;
+  freeSlots_.push_back(index);
+}
+
+void ResourceManager::Finish(uint32_t index,
+                             std::optional<PendingModel> pending) {
+  auto& slot = models_[index];
+  slot.load.reset();
+
+  if (!pending) {
+    LOG_ERROR("Failed to load model: {}", slot.key);
+    // A later request for the path tries again. The slot stays to report
+    // the failure while references are held.
+    modelIndexMap_.erase(slot.key);
+    slot.failed = true;
+    if (slot.refCount == 0) {
+      FreeSlot(index);
+    }
+    return;
+  }
+
+  slot.model = std::make_unique<Model>(
+      modelLoader_.Upload(*pending->data, std::move(pending->owner)));
+  slot.cpuBytes = MeasureCpuBytes(*slot.model);
+  slot.gpuBytes = MeasureGpuBytes(*slot.model);
+  cpuBytes_ += slot.cpuBytes;
+  gpuBytes_ += slot.gpuBytes;
+
+  LOG_INFO(
+      "Loaded model: {} ({} meshes, {} materials, {} textures, {} MiB GPU)",
+      slot.key, slot.model->meshes.size(), slot.model->materials.size(),
+      slot.model->textures.size(), slot.gpuBytes >> 20);
+}
+
+uint32_t ResourceManager::ReloadModels(
+    const std::filesystem::path& changedFile) {
+  std::filesystem::path changed = changedFile.lexically_normal();
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < models_.size(); ++i) {
+    auto& slot = models_[i];
+    if (!slot.model) {
+      continue;
+    }
+    std::filesystem::path source =
+        std::filesystem::path{slot.key}.lexically_normal();
+    std::filesystem::path relative =
+        changed.lexically_relative(source.parent_path());
+    if (changed != source &&
+        (relative.empty() || *relative.begin() == "..")) {
+      continue;
+    }
+
+    if (slot.reload) {
+      slot.reloadAgain = true;
+    } else {
+      StartReload(i);
+    }
+    ++count;
+  }
+  return count;
+}
+
+void ResourceManager::StartReload(uint32_t index) {
+  auto& slot = models_[index];
+  auto load = std::make_shared<AsyncLoad>();
+  load->path = slot.key;
+  slot.reload = load;
+  {
+    std::scoped_lock lock{queueMutex_};
+    queue_.push_back(std::move(load));
+  }
+  wake_.notify_one();
+}
+
+void ResourceManager::FinishReload(uint32_t index,
+                                   std::optional<PendingModel> pending) {
+  auto& slot = models_[index];
+  if (!pending) {
+    LOG_ERROR("Failed to reload model: {}; keeping the loaded one", slot.key);
+    return;
+  }
+
+  auto model = std::make_unique<Model>(
+      modelLoader_.Upload(*pending->data, std::move(pending->owner)));
+  Patch({.index = index, .generation = slot.generation}, *slot.model, *model);
+
+  // Frames already submitted may still draw with the previous resources
+  cpuBytes_ -= slot.cpuBytes;
+  gpuBytes_ -= slot.gpuBytes;
+  retired_.push_back({.frame = submittedFrames_,
+                      .model = std::move(slot.model),
+                      .materialIndices = {}});
+  slot.model = std::move(model);
+  slot.cpuBytes = MeasureCpuBytes(*slot.model);
+  slot.gpuBytes = MeasureGpuBytes(*slot.model);
+  cpuBytes_ += slot.cpuBytes;
+  gpuBytes_ += slot.gpuBytes;
+
+  LOG_INFO("Reloaded model: {}", slot.key);
+}
+
+void ResourceManager::Patch(ModelHandle handle, const Model& previous,
+                            const Model& model) {
+  // Textures are patched in their bindless slots, so every material using
+  // them picks them up wherever it is drawn from
+  if (materials_ != nullptr) {
+    uint32_t skipped = 0;
+    if (previous.textures.size() == model.textures.size()) {
+      for (size_t i = 0; i < model.textures.size(); ++i) {
+        const auto& before = previous.textures[i];
+        const auto& after = model.textures[i];
+        if (before.texture && before.texture != after.texture &&
+            !materials_->ReloadTexture(before.texture.get(), after)) {
+          ++skipped;
+        }
+      }
+    } else {
+      skipped = static_cast<uint32_t>(model.textures.size());
+    }
+    if (skipped > 0) {
+      LOG_WARNING("{} textures of {} were not reloaded", skipped,
+                  previous.sourcePath);
+    }
+  }
+
+  if (registry_ == nullptr) {
+    return;
+  }
+
+  // Mesh components share the model's buffers, so pointing them at the new
+  // ones is all instantiated meshes need. Resident draws were laid out with
+  // the old buffers and keep them alive.
+  uint32_t skipped = 0;
+  auto view = registry_->view<ecs::MeshComponent>(
+      entt::exclude<ecs::ResidentDrawTag>);
+  for (auto entity : view) {
+    auto& mesh = view.get<ecs::MeshComponent>(entity);
+    if (mesh.model != handle) {
+      continue;
+    }
+    if (mesh.meshIndex >= model.meshes.size() ||
+        model.meshes[mesh.meshIndex].primitives.size() !=
+            mesh.subMeshes.size()) {
+      ++skipped;
+      continue;
+    }
+
+    const Mesh& source = model.meshes[mesh.meshIndex];
+    mesh.vertexBuffer = source.vertexBuffer;
+    mesh.indexBuffer = source.indexBuffer;
+    mesh.indexType = source.indexType;
+    mesh.vertexFormat = source.vertexFormat;
+    mesh.positionDequantization = source.positionDequantization;
+    for (size_t i = 0; i < source.primitives.size(); ++i) {
+      const auto& primitive = source.primitives[i];
+      mesh.subMeshes[i].indexOffset = primitive.indexOffset;
+      mesh.subMeshes[i].indexCount = primitive.indexCount;
+      mesh.subMeshes[i].vertexOffset = primitive.vertexOffset;
+    }
+    if (auto* bounds = registry_->try_get<ecs::BoundingBoxComponent>(entity)) {
+      *bounds = source.bounds;
+    }
+  }
+  if (skipped > 0) {
+    LOG_WARNING(
+        "{} meshes of {} changed structure; instantiate it again to see them",
+        skipped, previous.sourcePath);
+  }
+}
+
+void ResourceManager::Run(const std::stop_token& stop) {
+  while (true) {
+    std::shared_ptr<AsyncLoad> load;
+    {
+      std::unique_lock lock{queueMutex_};
+      if (!wake_.wait(lock, stop, [this] { return !queue_.empty(); })) {
+        return;
+      }
+      load = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    auto enterStage = [&load](LoadStage stage) {
+      load->stage.store(stage, std::memory_order_release);
+      load->stage.notify_all();
+      return !load->cancelled.load(std::memory_order_relaxed);
+    };
+    enterStage(LoadStage::Parse);
+    load->result = modelLoader_.Read(ResolveCookedPath(load->path), enterStage);
+    enterStage(load->result ? LoadStage::Upload : LoadStage::Failed);
+  }
+}
+
+LoadStage ResourceManager::GetLoadStage(ModelHandle handle) const {
+  if (!handle.IsValid() || handle.index >= models_.size() ||
+      models_[handle.index].generation != handle.generation) {
+    return LoadStage::None;
   }
+  const auto& slot = models_[handle.index];
+  if (slot.load) {
+    return slot.load->stage.load(std::memory_order_acquire);
+  }
+  if (slot.model) {
+    return LoadStage::Ready;
+  }
+  return slot.failed ? LoadStage::Failed : LoadStage::None;
+}
 
-  // Load
-  auto model = modelLoader_.Load(path);
-  if (!model) {
-    LOG_ERROR("Failed to load model: {}", path.string());
+float ResourceManager::GetLoadProgress(ModelHandle handle) const {
+  LoadStage stage = GetLoadStage(handle);
+  if (stage == LoadStage::None || stage == LoadStage::Failed) {
+    return 0.0F;
+  }
+  return static_cast<float>(static_cast<uint8_t>(stage) -
+                            static_cast<uint8_t>(LoadStage::Queued)) /
+         static_cast<float>(static_cast<uint8_t>(LoadStage::Ready) -
+                            static_cast<uint8_t>(LoadStage::Queued));
+}
+
+const ResourceManager::ModelSlot* ResourceManager::GetSlot(
+    ModelHandle handle) const {
+  if (!handle.IsValid() || handle.index >= models_.size()) {
+    return nullptr;
+  }
+  const auto& slot = models_[handle.index];
+  if (slot.generation != handle.generation ||
+      (!slot.model && !slot.load && !slot.failed)) {
     return nullptr;
   }
+  return &slot;
+}
+
+ResourceManager::ModelSlot* ResourceManager::GetSlot(ModelHandle handle) {
+  return const_cast<ModelSlot*>(  // NOLINT
+      std::as_const(*this).GetSlot(handle));
+}
 
-  auto* ptr = models_.emplace(key, std::make_unique<Model>(std::move(*model)))
-                  .first->second.get();
-  LOG_INFO("Loaded model: {} ({} meshes, {} materials, {} textures)",
-           path.string(), ptr->meshes.size(), ptr->materials.size(),
-           ptr->textures.size());
-  return ptr;
+Model* ResourceManager::GetModel(ModelHandle handle) {
+  auto* slot = GetSlot(handle);
+  return slot != nullptr ? slot->model.get() : nullptr;
 }
 
-Model* ResourceManager::GetModel(const std::string& name) {
-  if (auto it = models_.find(name); it != models_.end()) {
-    return it->second.get();
+ModelHandle ResourceManager::FindModel(
+    const std::filesystem::path& path) const {
+  if (auto it = modelIndexMap_.find(path.string());
+      it != modelIndexMap_.end()) {
+    return {.index = it->second, .generation = models_[it->second].generation};
   }
-  return nullptr;
+  return {};
 }
 
-void ResourceManager::Clear() { models_.clear(); }
+std::filesystem::path ResourceManager::GetModelPath(
+    ModelHandle handle) const {
+  const auto* slot = GetSlot(handle);
+  return slot != nullptr ? std::filesystem::path{slot->key}
+                         : std::filesystem::path{};
+}
+
+void ResourceManager::AddRef(ModelHandle handle) {
+  if (auto* slot = GetSlot(handle)) {
+    ++slot->refCount;
+  }
+}
+
+void ResourceManager::Release(ModelHandle handle) {
+  auto* slot = GetSlot(handle);
+  if (slot == nullptr || slot->refCount == 0 || --slot->refCount > 0) {
+    return;
+  }
+  // Unreferenced models are evicted in the order they were last released
+  slot->lastUsed = submittedFrames_;
+  if (slot->failed) {
+    FreeSlot(handle.index);
+  }
+}
+
+void ResourceManager::Connect(entt::registry& registry,
+                              renderer::BindlessMaterialManager& materials) {
+  registry_ = &registry;
+  materials_ = &materials;
+  registry.on_construct<ecs::ModelReferenceComponent>()
+      .connect<&ResourceManager::OnReferenceCreated>(*this);
+  registry.on_destroy<ecs::ModelReferenceComponent>()
+      .connect<&ResourceManager::OnReferenceDestroyed>(*this);
+}
+
+void ResourceManager::OnReferenceCreated(entt::registry& registry,
+                                         entt::entity entity) {
+  AddRef(registry.get<ecs::ModelReferenceComponent>(entity).model);
+}
+
+void ResourceManager::OnReferenceDestroyed(entt::registry& registry,
+                                           entt::entity entity) {
+  auto& reference = registry.get<ecs::ModelReferenceComponent>(entity);
+  Release(reference.model);
+
+  // Frames already submitted may still draw with the materials
+  if (!reference.materialIndices.empty()) {
+    retired_.push_back({
+        .frame = submittedFrames_,
+        .model = nullptr,
+        .materialIndices = std::move(reference.materialIndices),
+    });
+  }
+}
+
+void ResourceManager::Evict(uint32_t index) {
+  auto& slot = models_[index];
+  LOG_INFO("Evicting model: {} ({} MiB GPU)", slot.key, slot.gpuBytes >> 20);
+
+  cpuBytes_ -= slot.cpuBytes;
+  gpuBytes_ -= slot.gpuBytes;
+  modelIndexMap_.erase(slot.key);
+  retired_.push_back({.frame = submittedFrames_,
+                      .model = std::move(slot.model),
+                      .materialIndices = {}});
+  FreeSlot(index);
+}
+
+void ResourceManager::Update(uint64_t submittedFrames,
+                             uint64_t completedFrames) {
+  submittedFrames_ = submittedFrames;
+
+  // Loader threads publish through each load's stage, so polling takes no
+  // lock. One upload per frame bounds the hitch while models stream in.
+  for (uint32_t i = 0; i < models_.size(); ++i) {
+    auto& load = models_[i].load;
+    if (load && load->stage.load(std::memory_order_acquire) >=
+                    LoadStage::Upload) {
+      auto finished = std::move(load);
+      Finish(i, std::move(finished->result));
+      break;
+    }
+  }
+
+  // Reloads are patched in at the same rate
+  for (uint32_t i = 0; i < models_.size(); ++i) {
+    auto& slot = models_[i];
+    if (slot.reload && slot.reload->stage.load(std::memory_order_acquire) >=
+                           LoadStage::Upload) {
+      auto finished = std::move(slot.reload);
+      FinishReload(i, std::move(finished->result));
+      if (std::exchange(slot.reloadAgain, false)) {
+        StartReload(i);
+      }
+      break;
+    }
+  }
+
+  while (cpuBytes_ > budget_.cpuBytes || gpuBytes_ > budget_.gpuBytes) {
+    auto victim = std::ranges::min_element(
+        models_, {}, [](const ModelSlot& slot) {
+          return slot.model && slot.refCount == 0 ? slot.lastUsed : UINT64_MAX;
+        });
+    if (victim == models_.end() || !victim->model || victim->refCount > 0) {
+      break;  // Everything left is in use
+    }
+    Evict(static_cast<uint32_t>(victim - models_.begin()));
+  }
+
+  // Retired in frame N, so in use by at most the frames before N
+  while (!retired_.empty() && retired_.front().frame <= completedFrames) {
+    if (materials_ != nullptr) {
+      for (uint32_t materialIndex : retired_.front().materialIndices) {
+        materials_->ReleaseMaterial(materialIndex);
+      }
+    }
+    retired_.pop_front();
+  }
+}
+
+void ResourceManager::Clear() {
+  // Nobody is left to upload what the loader threads would read
+  {
+    std::scoped_lock lock{queueMutex_};
+    queue_.clear();
+  }
+  for (auto& slot : models_) {
+    for (const auto& load : {slot.load, slot.reload}) {
+      if (load) {
+        load->cancelled.store(true, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  for (auto& retired : retired_) {
+    if (materials_ != nullptr) {
+      for (uint32_t materialIndex : retired.materialIndices) {
+        materials_->ReleaseMaterial(materialIndex);
+      }
+    }
+  }
+  retired_.clear();
+
+  // Outstanding handles are invalidated along with the models
+  for (auto& slot : models_) {
+    uint32_t generation = slot.generation + 1;
+    slot = {};
+    slot.generation = generation;
+  }
+  freeSlots_.clear();
+  for (uint32_t i = 0; i < models_.size(); ++i) {
+    freeSlots_.push_back(i);
+  }
+  modelIndexMap_.clear();
+  cpuBytes_ = 0;
+  gpuBytes_ = 0;
+}
 }  // namespace resource
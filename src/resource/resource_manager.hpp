@@ -1,38 +1,227 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <filesystem>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
+#include <entt/entt.hpp>
+
+#include "renderer/bindless_materials.hpp"
 #include "resource/model_loader.hpp"
 #include "resource/types.hpp"
 #include "rhi/factory.hpp"
 
 namespace resource {
 
+struct ResourceBudget {
+  // Mip chains kept in memory for texture streaming
+  uint64_t cpuBytes{512ULL << 20};
+  // Vertex, index and texture memory of the cached models
+  uint64_t gpuBytes{1ULL << 30};
+};
+
+/**
+ * @brief Cache of loaded models, addressed through generational handles.
+ *
+ * Models are reference counted, either directly or by the
+ * ModelReferenceComponents of a connected registry. Unreferenced models stay
+ * cached until the cache goes over budget, then the least recently used are
+ * evicted. Evicted models and released materials are destroyed once the
+ * frames that may still use them have completed.
+ *
+ * Models load either synchronously or on a pool of loader threads, which
+ * parse and process them without touching the GPU. The main thread uploads
+ * finished reads in Update. All members are called from the main thread.
+ */
 class ResourceManager {
  public:
-  explicit ResourceManager(rhi::Factory& factory);
+  /**
+   * @param loaderThreads Threads reading models for LoadModelAsync
+   */
+  explicit ResourceManager(rhi::Factory& factory, ResourceBudget budget = {},
+                           uint32_t loaderThreads = 2);
+  ~ResourceManager();
+
+  ResourceManager(const ResourceManager&) = delete;
+  ResourceManager& operator=(const ResourceManager&) = delete;
+  ResourceManager(ResourceManager&&) = delete;
+  ResourceManager& operator=(ResourceManager&&) = delete;
 
   /**
    * @brief Load a model from file. Returns cached version if already loaded.
+   *
+   * An up-to-date cooked pack next to a glTF file (same name, .vkrpack
+   * extension) is loaded in its place. The model starts unreferenced, so it
+   * may be evicted by the next Update unless a reference is taken.
+   *
+   * @return Handle of the model, invalid on failure
+   */
+  [[nodiscard]] ModelHandle LoadModel(const std::filesystem::path& path);
+
+  /**
+   * @brief Start loading a model on the loader threads.
+   *
+   * Returns at once with a handle that GetModel resolves once the model is
+   * uploaded. Requests for a path that is loaded or loading share its
+   * handle. References can be taken while the model loads.
+   */
+  [[nodiscard]] ModelHandle LoadModelAsync(const std::filesystem::path& path);
+
+  /**
+   * @brief Stage a model is in; None for handles that refer to nothing.
+   *
+   * A failed load reads Failed while references to it are held. Its slot is
+   * reused once the last one is released, or at once if there were none.
+   */
+  [[nodiscard]] LoadStage GetLoadStage(ModelHandle handle) const;
+
+  /**
+   * @brief Fraction of the load stages a model has completed, in [0, 1].
+   */
+  [[nodiscard]] float GetLoadProgress(ModelHandle handle) const;
+
+  /**
+   * @brief Get a loaded model; nullptr while it loads or once it was
+   * evicted.
+   */
+  [[nodiscard]] Model* GetModel(ModelHandle handle);
+
+  /**
+   * @brief Find a cached model by the path it was loaded from.
    */
-  [[nodiscard]] Model* LoadModel(const std::filesystem::path& path);
+  [[nodiscard]] ModelHandle FindModel(const std::filesystem::path& path) const;
 
   /**
-   * @brief Get a previously loaded model.
+   * @brief Path a model was requested with; empty for handles that refer to
+   * nothing.
    */
-  [[nodiscard]] Model* GetModel(const std::string& name);
+  [[nodiscard]] std::filesystem::path GetModelPath(ModelHandle handle) const;
 
   /**
-   * @brief Unload all resources.
+   * @brief Read models again after a file they were loaded from changed.
+   *
+   * A model is affected when `changedFile` is the file it was requested
+   * with or lies in that file's directory tree, which is where glTF buffers
+   * and images sit. Affected models are read on the loader threads and
+   * patched in Update: slots of bindless textures show the new textures,
+   * and the meshes of instantiated models draw with the new buffers.
+   * Resident draws and material parameters keep what they had, as do parts
+   * whose structure changed, until the model is instantiated again.
+   *
+   * @return Number of models being reloaded
+   */
+  uint32_t ReloadModels(const std::filesystem::path& changedFile);
+
+  void AddRef(ModelHandle handle);
+  void Release(ModelHandle handle);
+
+  /**
+   * @brief Count the ModelReferenceComponents of a registry as references.
+   *
+   * Materials listed in destroyed components are released from `materials`.
+   * Both must outlive this manager's use of them; the registry must outlive
+   * the manager.
+   */
+  void Connect(entt::registry& registry,
+               renderer::BindlessMaterialManager& materials);
+
+  /**
+   * @brief Upload a finished asynchronous load, evict over budget and
+   * destroy what the GPU is done with.
+   *
+   * Call once per frame.
+   *
+   * @param submittedFrames Frames submitted so far
+   * @param completedFrames Frames whose fence has been waited on
+   */
+  void Update(uint64_t submittedFrames, uint64_t completedFrames);
+
+  [[nodiscard]] uint64_t GetCpuBytes() const { return cpuBytes_; }
+  [[nodiscard]] uint64_t GetGpuBytes() const { return gpuBytes_; }
+
+  /**
+   * @brief Unload all resources. The GPU must be idle; queued loads are
+   * dropped and those being read stop at their next stage.
    */
   void Clear();
 
  private:
+  // Shared between a loader thread and the main thread. `stage` publishes
+  // `result`: the loader writes it before storing Upload or Failed.
+  struct AsyncLoad {
+    std::filesystem::path path;
+    std::atomic<LoadStage> stage{LoadStage::Queued};
+    std::atomic<bool> cancelled{false};  // Checked as each stage begins
+    std::optional<PendingModel> result;
+  };
+
+  struct ModelSlot {
+    std::unique_ptr<Model> model;
+    std::shared_ptr<AsyncLoad> load;    // While loading asynchronously
+    std::shared_ptr<AsyncLoad> reload;  // While reading a changed model
+    bool reloadAgain{false};            // Changed again while `reload` was read
+    bool failed{false};
+    std::string key;
+    uint32_t generation{0};
+    uint32_t refCount{0};
+    uint64_t lastUsed{0};
+    uint64_t cpuBytes{0};
+    uint64_t gpuBytes{0};
+  };
+
+  // Destroyed once the frame it was retired in has completed
+  struct Retired {
+    uint64_t frame{0};
+    std::unique_ptr<Model> model;
+    std::vector<uint32_t> materialIndices;
+  };
+
+  [[nodiscard]] ModelSlot* GetSlot(ModelHandle handle);
+  [[nodiscard]] const ModelSlot* GetSlot(ModelHandle handle) const;
+  uint32_t AllocateSlot(const std::string& key);
+  void FreeSlot(uint32_t index);
+  void Finish(uint32_t index, std::optional<PendingModel> pending);
+  void StartReload(uint32_t index);
+  void FinishReload(uint32_t index, std::optional<PendingModel> pending);
+  void Patch(ModelHandle handle, const Model& previous, const Model& model);
+  void Evict(uint32_t index);
+  void Run(const std::stop_token& stop);
+  void OnReferenceCreated(entt::registry& registry, entt::entity entity);
+  void OnReferenceDestroyed(entt::registry& registry, entt::entity entity);
+
   rhi::Factory& factory_;
   ModelLoader modelLoader_;
-  std::unordered_map<std::string, std::unique_ptr<Model>> models_;
+  ResourceBudget budget_;
+
+  std::vector<ModelSlot> models_;
+  std::vector<uint32_t> freeSlots_;
+  std::unordered_map<std::string, uint32_t> modelIndexMap_;  // By path
+  uint64_t cpuBytes_{0};
+  uint64_t gpuBytes_{0};
+
+  std::deque<Retired> retired_;
+  uint64_t submittedFrames_{0};
+
+  entt::registry* registry_{nullptr};
+  renderer::BindlessMaterialManager* materials_{nullptr};
+
+  // Shared with the loader threads
+  std::mutex queueMutex_;
+  std::condition_variable_any wake_;
+  std::deque<std::shared_ptr<AsyncLoad>> queue_;
+
+  // Last member so they stop before the state above goes away
+  std::vector<std::jthread> loaders_;
 };
 
 }  // namespace resource
@@ -0,0 +1,428 @@
+#include "resource/scene_flattening.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <span>
+#include <utility>
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "core/arena.hpp"
+
+namespace resource {
+namespace {
+constexpr uint32_t kRemoved = std::numeric_limits<uint32_t>::max();
+
+// Largest error, relative to the largest element, allowed when folding a
+// transform into a child's translation, rotation and scale
+constexpr float kDecomposeTolerance = 1e-5F;
+
+struct Trs {
+  glm::vec3 translation{0.0F};
+  glm::quat rotation{1.0F, 0.0F, 0.0F, 0.0F};
+  glm::vec3 scale{1.0F};
+};
+
+// A mesh placed in the space of the subtree being baked
+struct Instance {
+  uint32_t mesh{0};
+  glm::mat4 transform{1.0F};
+};
+
+glm::mat4 GetLocalMatrix(const SceneNode& node) {
+  return glm::translate(glm::mat4{1.0F}, node.translation) *
+         glm::mat4_cast(node.rotation) *
+         glm::scale(glm::mat4{1.0F}, node.scale);
+}
+
+// Split a matrix into translation, rotation and scale; fails for shear and
+// degenerate scales, which a node cannot express
+std::optional<Trs> Decompose(const glm::mat4& matrix) {
+  Trs trs;
+  trs.translation = glm::vec3{matrix[3]};
+  trs.scale = {glm::length(glm::vec3{matrix[0]}),
+               glm::length(glm::vec3{matrix[1]}),
+               glm::length(glm::vec3{matrix[2]})};
+  if (std::min({trs.scale.x, trs.scale.y, trs.scale.z}) <=
+      std::numeric_limits<float>::epsilon()) {
+    return std::nullopt;
+  }
+
+  glm::mat3 rotation{glm::vec3{matrix[0]} / trs.scale.x,
+                     glm::vec3{matrix[1]} / trs.scale.y,
+                     glm::vec3{matrix[2]} / trs.scale.z};
+  // A mirror goes into the scale so the rotation stays proper
+  if (glm::determinant(rotation) < 0.0F) {
+    trs.scale.x = -trs.scale.x;
+    rotation[0] = -rotation[0];
+  }
+  trs.rotation = glm::normalize(glm::quat_cast(rotation));
+
+  glm::mat4 rebuilt = glm::translate(glm::mat4{1.0F}, trs.translation) *
+                      glm::mat4_cast(trs.rotation) *
+                      glm::scale(glm::mat4{1.0F}, trs.scale);
+  float largest = 1.0F;
+  float error = 0.0F;
+  for (int column = 0; column < 4; ++column) {
+    for (int row = 0; row < 4; ++row) {
+      largest = std::max(largest, std::abs(matrix[column][row]));
+      error = std::max(error,
+                       std::abs(matrix[column][row] - rebuilt[column][row]));
+    }
+  }
+  if (error > kDecomposeTolerance * largest) {
+    return std::nullopt;
+  }
+  return trs;
+}
+
+glm::vec3 NormalizeOrZero(const glm::vec3& v) {
+  float length = glm::length(v);
+  return length > 0.0F ? v / length : v;
+}
+
+bool HasDistinctMaterials(const MeshGeometry& mesh) {
+  for (size_t i = 0; i < mesh.primitives.size(); ++i) {
+    for (size_t j = 0; j < i; ++j) {
+      if (mesh.primitives[i].materialIndex ==
+          mesh.primitives[j].materialIndex) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+class Flattener {
+ public:
+  Flattener(std::vector<SceneNode>& nodes, std::vector<MeshGeometry>& meshes,
+            const std::vector<bool>& pinned)
+      : nodes_{nodes},
+        meshes_{meshes},
+        pinned_{pinned},
+        visited_(nodes.size(), false),
+        dynamic_(nodes.size(), false) {}
+
+  // Find the dynamic nodes; false if the nodes do not form a forest
+  bool Prepare(std::span<const uint32_t> roots) {
+    return std::ranges::all_of(roots, [this](uint32_t root) {
+      return root < nodes_.size() && Visit(root);
+    });
+  }
+
+  // The nodes that take the place of `index` among its parent's children
+  std::vector<uint32_t> Flatten(uint32_t index) {
+    if (!dynamic_[index]) {
+      Bake(index);
+      if (nodes_[index].meshIndex < 0) {
+        return {};
+      }
+      return {index};
+    }
+
+    std::vector<uint32_t> children;
+    for (uint32_t child : nodes_[index].children) {
+      if (child < nodes_.size()) {
+        auto kept = Flatten(child);
+        children.insert(children.end(), kept.begin(), kept.end());
+      }
+    }
+
+    auto& node = nodes_[index];
+    node.children = std::move(children);
+    if (node.meshIndex >= 0 || IsPinned(index)) {
+      return {index};
+    }
+
+    // A bare transform: push it down into the children if they can hold it
+    glm::mat4 local = GetLocalMatrix(node);
+    std::vector<Trs> folded;
+    folded.reserve(node.children.size());
+    for (uint32_t child : node.children) {
+      auto trs = Decompose(local * GetLocalMatrix(nodes_[child]));
+      if (!trs) {
+        return {index};
+      }
+      folded.push_back(*trs);
+    }
+    for (size_t i = 0; i < node.children.size(); ++i) {
+      auto& child = nodes_[node.children[i]];
+      child.translation = folded[i].translation;
+      child.rotation = folded[i].rotation;
+      child.scale = folded[i].scale;
+    }
+    return node.children;
+  }
+
+  // Drop unreachable nodes and unused meshes and renumber the rest
+  void Compact(std::vector<uint32_t>& roots) {
+    std::vector<uint32_t> order;
+    order.reserve(nodes_.size());
+    for (uint32_t root : roots) {
+      Collect(root, order);
+    }
+
+    std::vector<uint32_t> nodeRemap(nodes_.size(), kRemoved);
+    for (size_t i = 0; i < order.size(); ++i) {
+      nodeRemap[order[i]] = static_cast<uint32_t>(i);
+    }
+
+    std::vector<uint32_t> meshRemap(meshes_.size(), kRemoved);
+    std::vector<MeshGeometry> meshes;
+    std::vector<SceneNode> nodes;
+    nodes.reserve(order.size());
+    for (uint32_t index : order) {
+      auto& node = nodes.emplace_back(std::move(nodes_[index]));
+      for (uint32_t& child : node.children) {
+        child = nodeRemap[child];
+      }
+      if (node.meshIndex >= 0) {
+        auto& mesh = meshRemap[node.meshIndex];
+        if (mesh == kRemoved) {
+          mesh = static_cast<uint32_t>(meshes.size());
+          meshes.push_back(std::move(meshes_[node.meshIndex]));
+        }
+        node.meshIndex = static_cast<int32_t>(mesh);
+      }
+    }
+    for (uint32_t& root : roots) {
+      root = nodeRemap[root];
+    }
+
+    nodes_ = std::move(nodes);
+    meshes_ = std::move(meshes);
+  }
+
+  // Primitives drawn for every reachable mesh node
+  [[nodiscard]] size_t CountDraws(std::span<const uint32_t> roots) const {
+    size_t draws = 0;
+    std::vector<uint32_t> stack{roots.begin(), roots.end()};
+    while (!stack.empty()) {
+      const auto& node = nodes_[stack.back()];
+      stack.pop_back();
+      if (node.meshIndex >= 0 &&
+          static_cast<size_t>(node.meshIndex) < meshes_.size()) {
+        draws += meshes_[node.meshIndex].primitives.size();
+      }
+      for (uint32_t child : node.children) {
+        if (child < nodes_.size()) {
+          stack.push_back(child);
+        }
+      }
+    }
+    return draws;
+  }
+
+ private:
+  [[nodiscard]] bool IsPinned(uint32_t index) const {
+    const auto& node = nodes_[index];
+    return (index < pinned_.size() && pinned_[index]) ||
+           node.cameraIndex >= 0 || node.lightIndex >= 0 ||
+           !node.instances.empty();
+  }
+
+  bool Visit(uint32_t index) {
+    if (visited_[index]) {
+      return false;  // A second parent or a cycle
+    }
+    visited_[index] = true;
+
+    bool dynamic = IsPinned(index);
+    for (uint32_t child : nodes_[index].children) {
+      if (child >= nodes_.size()) {
+        continue;
+      }
+      if (!Visit(child)) {
+        return false;
+      }
+      dynamic = dynamic || dynamic_[child];
+    }
+    dynamic_[index] = dynamic;
+    return true;
+  }
+
+  void Collect(uint32_t index, std::vector<uint32_t>& order) const {
+    order.push_back(index);
+    for (uint32_t child : nodes_[index].children) {
+      Collect(child, order);
+    }
+  }
+
+  // Turn a static subtree into a single node holding all of its geometry
+  void Bake(uint32_t index) {
+    std::vector<Instance> instances;
+    std::vector<std::pair<uint32_t, glm::mat4>> stack{{index, glm::mat4{1.0F}}};
+    while (!stack.empty()) {
+      auto [current, transform] = stack.back();
+      stack.pop_back();
+
+      const auto& node = nodes_[current];
+      if (node.meshIndex >= 0 &&
+          static_cast<size_t>(node.meshIndex) < meshes_.size()) {
+        instances.push_back(
+            {.mesh = static_cast<uint32_t>(node.meshIndex),
+             .transform = transform});
+      }
+      // Reversed, so children are visited in order
+      for (auto child = node.children.rbegin(); child != node.children.rend();
+           ++child) {
+        if (*child < nodes_.size()) {
+          stack.emplace_back(*child,
+                             transform * GetLocalMatrix(nodes_[*child]));
+        }
+      }
+    }
+
+    auto& root = nodes_[index];
+    root.children.clear();
+    root.meshIndex = -1;
+    if (instances.empty()) {
+      return;
+    }
+
+    // Nothing to gain from a copy of a mesh that is already as merged as it
+    // gets
+    if (instances.size() == 1 && instances[0].transform == glm::mat4{1.0F} &&
+        HasDistinctMaterials(meshes_[instances[0].mesh])) {
+      root.meshIndex = static_cast<int32_t>(instances[0].mesh);
+      return;
+    }
+
+    std::string name =
+        root.name.empty() ? meshes_[instances[0].mesh].name : root.name;
+    MeshGeometry merged = Merge(instances, std::move(name));
+    nodes_[index].meshIndex = static_cast<int32_t>(meshes_.size());
+    meshes_.push_back(std::move(merged));
+  }
+
+  // Bake the instances into one mesh with one primitive per material, in
+  // the order the materials first appear
+  MeshGeometry Merge(std::span<const Instance> instances, std::string name) {
+    std::vector<int32_t> materials;
+    std::vector<std::vector<std::pair<size_t, size_t>>> groups;
+    size_t vertexTotal = 0;
+    size_t indexTotal = 0;
+    for (size_t i = 0; i < instances.size(); ++i) {
+      const auto& primitives = meshes_[instances[i].mesh].primitives;
+      for (size_t p = 0; p < primitives.size(); ++p) {
+        auto material = std::ranges::find(materials,
+                                          primitives[p].materialIndex);
+        if (material == materials.end()) {
+          materials.push_back(primitives[p].materialIndex);
+          groups.emplace_back();
+          material = materials.end() - 1;
+        }
+        groups[material - materials.begin()].emplace_back(i, p);
+        vertexTotal += primitives[p].vertexCount;
+        indexTotal += primitives[p].indexCount;
+      }
+    }
+
+    MeshGeometry merged{core::GetScratchResource()};
+    merged.name = std::move(name);
+    merged.vertices.reserve(vertexTotal);
+    merged.indices.reserve(indexTotal);
+    merged.primitives.reserve(groups.size());
+
+    glm::vec3 minBounds{std::numeric_limits<float>::max()};
+    glm::vec3 maxBounds{std::numeric_limits<float>::lowest()};
+
+    for (size_t g = 0; g < groups.size(); ++g) {
+      MeshPrimitive primitive{
+          .vertexOffset = static_cast<uint32_t>(merged.vertices.size()),
+          .vertexCount = 0,
+          .indexOffset = static_cast<uint32_t>(merged.indices.size()),
+          .indexCount = 0,
+          .materialIndex = materials[g],
+      };
+
+      for (auto [i, p] : groups[g]) {
+        const auto& mesh = meshes_[instances[i].mesh];
+        const auto& source = mesh.primitives[p];
+        const glm::mat4& transform = instances[i].transform;
+        glm::mat3 linear{transform};
+        glm::mat3 normalMatrix = glm::inverseTranspose(linear);
+        // Mirroring turns the winding and the tangent frame's handedness
+        bool mirrored = glm::determinant(linear) < 0.0F;
+
+        auto base = static_cast<uint32_t>(merged.vertices.size() -
+                                          primitive.vertexOffset);
+        for (uint32_t v = 0; v < source.vertexCount; ++v) {
+          ecs::Vertex vertex = mesh.vertices[source.vertexOffset + v];
+          vertex.position = glm::vec3{transform * glm::vec4{vertex.position,
+                                                            1.0F}};
+          vertex.normal = NormalizeOrZero(normalMatrix * vertex.normal);
+          glm::vec3 tangent =
+              NormalizeOrZero(linear * glm::vec3{vertex.tangent});
+          vertex.tangent = {tangent,
+                            mirrored ? -vertex.tangent.w : vertex.tangent.w};
+          minBounds = glm::min(minBounds, vertex.position);
+          maxBounds = glm::max(maxBounds, vertex.position);
+          merged.vertices.push_back(vertex);
+        }
+
+        const uint32_t* indices = mesh.indices.data() + source.indexOffset;
+        for (uint32_t k = 0; k + 2 < source.indexCount; k += 3) {
+          uint32_t a = indices[k] + base;
+          uint32_t b = indices[k + 1] + base;
+          uint32_t c = indices[k + 2] + base;
+          if (mirrored) {
+            std::swap(b, c);
+          }
+          merged.indices.insert(merged.indices.end(), {a, b, c});
+        }
+      }
+
+      primitive.vertexCount = static_cast<uint32_t>(
+          merged.vertices.size() - primitive.vertexOffset);
+      primitive.indexCount = static_cast<uint32_t>(
+          merged.indices.size() - primitive.indexOffset);
+      merged.primitives.push_back(primitive);
+    }
+
+    if (!merged.vertices.empty()) {
+      merged.bounds = {.min = minBounds, .max = maxBounds};
+    }
+    return merged;
+  }
+
+  std::vector<SceneNode>& nodes_;
+  std::vector<MeshGeometry>& meshes_;
+  const std::vector<bool>& pinned_;
+  std::vector<bool> visited_;
+  std::vector<bool> dynamic_;
+};
+}  // namespace
+
+std::optional<FlattenStats> FlattenStaticNodes(
+    std::vector<SceneNode>& nodes, std::vector<uint32_t>& rootNodes,
+    std::vector<MeshGeometry>& meshes, const std::vector<bool>& pinned) {
+  Flattener flattener{nodes, meshes, pinned};
+  if (!flattener.Prepare(rootNodes)) {
+    return std::nullopt;
+  }
+
+  FlattenStats stats{
+      .nodesBefore = nodes.size(),
+      .nodesAfter = 0,
+      .drawsBefore = flattener.CountDraws(rootNodes),
+      .drawsAfter = 0,
+  };
+
+  std::vector<uint32_t> roots;
+  for (uint32_t root : rootNodes) {
+    auto kept = flattener.Flatten(root);
+    roots.insert(roots.end(), kept.begin(), kept.end());
+  }
+  flattener.Compact(roots);
+  rootNodes = std::move(roots);
+
+  stats.nodesAfter = nodes.size();
+  stats.drawsAfter = flattener.CountDraws(rootNodes);
+  return stats;
+}
+
+}  // namespace resource
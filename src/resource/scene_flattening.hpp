@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ecs/components.hpp"
+#include "resource/types.hpp"
+
+namespace resource {
+
+/**
+ * @brief Float vertices and 32-bit indices of one mesh, before they are
+ * laid out for the GPU. Primitive indices are relative to the primitive's
+ * vertex offset.
+ */
+struct MeshGeometry {
+  explicit MeshGeometry(std::pmr::memory_resource* memory)
+      : vertices{memory}, indices{memory} {}
+
+  std::string name;
+  std::pmr::vector<ecs::Vertex> vertices;
+  std::pmr::vector<uint32_t> indices;
+  std::vector<MeshPrimitive> primitives;
+  ecs::BoundingBoxComponent bounds;
+};
+
+struct FlattenStats {
+  size_t nodesBefore{0};
+  size_t nodesAfter{0};
+  // Primitives over all mesh nodes, so one per draw
+  size_t drawsBefore{0};
+  size_t drawsAfter{0};
+};
+
+/**
+ * @brief Collapse the static parts of a node hierarchy.
+ *
+ * A node is static unless it or a node below it is pinned or holds a camera,
+ * light or mesh instances. Every maximal static subtree becomes one node: the meshes in it
+ * are baked into a new mesh in the space of the subtree's root, with the
+ * primitives that share a material merged into one. Nodes without a mesh
+ * above pinned ones are removed where their transform can be folded into
+ * their children exactly. Meshes and nodes nothing refers to any more are
+ * dropped, and the remaining ones renumbered.
+ *
+ * @param pinned Nodes that need a transform of their own, such as animated
+ * ones; may be shorter than `nodes`
+ * @return Node and draw counts before and after, or nullopt if a node has
+ * several parents, in which case nothing is changed
+ */
+std::optional<FlattenStats> FlattenStaticNodes(
+    std::vector<SceneNode>& nodes, std::vector<uint32_t>& rootNodes,
+    std::vector<MeshGeometry>& meshes, const std::vector<bool>& pinned);
+
+}  // namespace resource
@@ -1,13 +1,13 @@
 #include "resource/scene_loader.hpp"
 
+#include <iterator>
+#include <utility>
+
 #include "ecs/components.hpp"
 
 namespace resource {
-
-entt::entity InstantiateModel(
-    entt::registry& registry, const Model& model,
-    renderer::BindlessMaterialManager& bindlessMaterials) {
-  // Register all materials and get their bindless indices
+std::vector<uint32_t> RegisterMaterials(
+    const Model& model, renderer::BindlessMaterialManager& bindlessMaterials) {
   std::vector<uint32_t> materialIndices;
   materialIndices.reserve(model.materials.size());
 
@@ -20,15 +20,205 @@ entt::entity InstantiateModel(
   if (materialIndices.empty()) {
     materialIndices.push_back(0);  // Default material is always index 0
   }
+  return materialIndices;
+}
 
-  // Create root entity
+void MakeMeshComponents(const Model& model, uint32_t meshIndex,
+                        const std::vector<uint32_t>& materialIndices,
+                        ModelHandle handle, ecs::MeshComponent& meshComp,
+                        ecs::MaterialComponent& matComp) {
+  const Mesh& mesh = model.meshes[meshIndex];
+  meshComp.vertexBuffer = mesh.vertexBuffer;
+  meshComp.indexBuffer = mesh.indexBuffer;
+  meshComp.indexType = mesh.indexType;
+  meshComp.vertexFormat = mesh.vertexFormat;
+  meshComp.positionDequantization = mesh.positionDequantization;
+  meshComp.model = handle;
+  meshComp.meshIndex = meshIndex;
+
+  meshComp.subMeshes.reserve(mesh.primitives.size());
+  matComp.materialIndices.reserve(mesh.primitives.size());
+
+  for (const auto& prim : mesh.primitives) {
+    ecs::SubMesh subMesh{};
+    subMesh.indexCount = prim.indexCount;
+    subMesh.indexOffset = prim.indexOffset;
+    subMesh.vertexOffset = prim.vertexOffset;
+
+    // Map to bindless material index
+    if (prim.materialIndex >= 0 &&
+        prim.materialIndex < static_cast<int32_t>(materialIndices.size())) {
+      subMesh.materialIndex = materialIndices[prim.materialIndex];
+    } else {
+      subMesh.materialIndex = 0;  // Default material
+    }
+
+    meshComp.subMeshes.push_back(subMesh);
+    matComp.materialIndices.push_back(subMesh.materialIndex);
+  }
+}
+
+namespace {
+// Root entity owning the model reference and the registered materials
+entt::entity CreateRoot(entt::registry& registry,
+                        std::vector<uint32_t> materialIndices,
+                        ModelHandle handle) {
   entt::entity root = registry.create();
   registry.emplace<ecs::TransformComponent>(root);
   registry.emplace<ecs::WorldTransformComponent>(root);
+  // Releasing the default material is a no-op, so all indices can be kept
+  registry.emplace<ecs::ModelReferenceComponent>(root, handle,
+                                                 std::move(materialIndices));
+  return root;
+}
+
+ecs::TransformComponent GetNodeTransform(const SceneNode& node) {
+  return {
+      .position = node.translation,
+      .rotation = node.rotation,
+      .scale = node.scale,
+  };
+}
+
+// Instance transforms as the renderer consumes them, or null without any
+std::shared_ptr<const std::vector<glm::mat4>> MakeInstanceTable(
+    const SceneNode& node) {
+  if (node.instances.empty()) {
+    return nullptr;
+  }
+  auto transforms = std::make_shared<std::vector<glm::mat4>>();
+  transforms->reserve(node.instances.size());
+  for (const auto& instance : node.instances) {
+    ecs::TransformComponent transform{
+        .position = instance.translation,
+        .rotation = instance.rotation,
+        .scale = instance.scale,
+    };
+    transforms->push_back(transform.GetMatrix());
+  }
+  return transforms;
+}
+
+bool HasMesh(const Model& model, const SceneNode& node) {
+  return node.meshIndex >= 0 &&
+         node.meshIndex < static_cast<int32_t>(model.meshes.size());
+}
+}  // namespace
+
+entt::entity InstantiateModel(
+    entt::registry& registry, const Model& model,
+    renderer::BindlessMaterialManager& bindlessMaterials, ModelHandle handle) {
+  std::vector<uint32_t> materialIndices =
+      RegisterMaterials(model, bindlessMaterials);
+
+  // Create root entity
+  entt::entity root = CreateRoot(registry, materialIndices, handle);
 
   // Instantiate all root nodes
   for (uint32_t nodeIndex : model.rootNodes) {
-    InstantiateNode(registry, model, materialIndices, nodeIndex, root);
+    InstantiateNode(registry, model, materialIndices, nodeIndex, root,
+                    handle);
+  }
+
+  return root;
+}
+
+entt::entity InstantiateModelInstances(
+    entt::registry& registry, const Model& model,
+    renderer::BindlessMaterialManager& bindlessMaterials,
+    std::span<const ecs::TransformComponent> transforms, ModelHandle handle) {
+  std::vector<uint32_t> materialIndices =
+      RegisterMaterials(model, bindlessMaterials);
+
+  // Nodes of one instance in pre-order, so parents precede their children
+  struct TemplateNode {
+    uint32_t node;
+    int32_t parent;  // Template index, -1 for the instance root
+  };
+  std::vector<TemplateNode> nodes;
+  std::vector<TemplateNode> stack;
+  for (auto it = model.rootNodes.rbegin(); it != model.rootNodes.rend(); ++it) {
+    stack.push_back({.node = *it, .parent = -1});
+  }
+  while (!stack.empty()) {
+    TemplateNode current = stack.back();
+    stack.pop_back();
+    if (current.node >= model.nodes.size()) {
+      continue;
+    }
+    auto index = static_cast<int32_t>(nodes.size());
+    nodes.push_back(current);
+    const auto& children = model.nodes[current.node].children;
+    for (auto it = children.rbegin(); it != children.rend(); ++it) {
+      stack.push_back({.node = *it, .parent = index});
+    }
+  }
+
+  entt::entity root = CreateRoot(registry, materialIndices, handle);
+
+  // Entities are laid out per template node, instance roots first, so every
+  // component a node's copies share is added to a contiguous range at once
+  size_t count = transforms.size();
+  std::vector<entt::entity> entities((nodes.size() + 1) * count);
+  registry.create(entities.begin(), entities.end());
+  auto range = [&](size_t slot) {
+    return std::pair{entities.begin() + static_cast<ptrdiff_t>(slot * count),
+                     entities.begin() +
+                         static_cast<ptrdiff_t>((slot + 1) * count)};
+  };
+
+  std::vector<ecs::HierarchyComponent> hierarchies(entities.size());
+  auto& rootHierarchy = registry.emplace<ecs::HierarchyComponent>(root);
+  rootHierarchy.children.assign(entities.begin(),
+                                entities.begin() +
+                                    static_cast<ptrdiff_t>(count));
+  for (size_t i = 0; i < count; ++i) {
+    hierarchies[i].parent = root;
+  }
+  for (size_t t = 0; t < nodes.size(); ++t) {
+    size_t parentSlot = static_cast<size_t>(nodes[t].parent + 1);
+    for (size_t i = 0; i < count; ++i) {
+      size_t child = ((t + 1) * count) + i;
+      size_t parent = (parentSlot * count) + i;
+      hierarchies[child].parent = entities[parent];
+      hierarchies[parent].children.push_back(entities[child]);
+    }
+  }
+
+  registry.insert<ecs::WorldTransformComponent>(entities.begin(),
+                                                entities.end());
+  registry.insert<ecs::HierarchyComponent>(
+      entities.begin(), entities.end(),
+      std::make_move_iterator(hierarchies.begin()));
+
+  auto [first, last] = range(0);
+  registry.insert<ecs::TransformComponent>(first, last, transforms.begin());
+
+  for (size_t t = 0; t < nodes.size(); ++t) {
+    const auto& node = model.nodes[nodes[t].node];
+    auto [nodeFirst, nodeLast] = range(t + 1);
+    registry.insert<ecs::TransformComponent>(nodeFirst, nodeLast,
+                                             GetNodeTransform(node));
+
+    if (!HasMesh(model, node)) {
+      continue;
+    }
+    auto meshIndex = static_cast<uint32_t>(node.meshIndex);
+
+    // Every copy shares the GPU buffers and registered materials
+    ecs::MeshComponent meshComp;
+    ecs::MaterialComponent matComp;
+    MakeMeshComponents(model, meshIndex, materialIndices, handle, meshComp,
+                       matComp);
+    registry.insert<ecs::MeshComponent>(nodeFirst, nodeLast, meshComp);
+    registry.insert<ecs::MaterialComponent>(nodeFirst, nodeLast, matComp);
+    registry.insert<ecs::BoundingBoxComponent>(
+        nodeFirst, nodeLast, model.meshes[meshIndex].bounds);
+    registry.insert<ecs::RenderableComponent>(nodeFirst, nodeLast);
+    if (auto table = MakeInstanceTable(node)) {
+      registry.insert<ecs::MeshInstancesComponent>(
+          nodeFirst, nodeLast, ecs::MeshInstancesComponent{table});
+    }
   }
 
   return root;
@@ -37,7 +227,8 @@ entt::entity InstantiateModel(
 // NOLINTNEXTLINE
 void InstantiateNode(entt::registry& registry, const Model& model,
                      const std::vector<uint32_t>& materialIndices,
-                     uint32_t nodeIndex, entt::entity parent) {
+                     uint32_t nodeIndex, entt::entity parent,
+                     ModelHandle handle) {
   if (nodeIndex >= model.nodes.size()) {
     return;
   }
@@ -47,11 +238,7 @@ void InstantiateNode(entt::registry& registry, const Model& model,
   entt::entity entity = registry.create();
 
   // Transform
-  auto& transform = registry.emplace<ecs::TransformComponent>(entity);
-  transform.position = node.translation;
-  transform.rotation = node.rotation;
-  transform.scale = node.scale;
-
+  registry.emplace<ecs::TransformComponent>(entity, GetNodeTransform(node));
   registry.emplace<ecs::WorldTransformComponent>(entity);
 
   // Hierarchy
@@ -65,45 +252,29 @@ void InstantiateNode(entt::registry& registry, const Model& model,
   }
 
   // Mesh
-  if (node.meshIndex >= 0 &&
-      node.meshIndex < static_cast<int32_t>(model.meshes.size())) {
-    const auto& mesh = model.meshes[node.meshIndex];
-
+  if (HasMesh(model, node)) {
+    auto meshIndex = static_cast<uint32_t>(node.meshIndex);
     auto& meshComp = registry.emplace<ecs::MeshComponent>(entity);
-    meshComp.vertexBuffer = mesh.vertexBuffer;
-    meshComp.indexBuffer = mesh.indexBuffer;
-
-    for (const auto& prim : mesh.primitives) {
-      ecs::SubMesh subMesh{};
-      subMesh.indexCount = prim.indexCount;
-      subMesh.indexOffset = prim.indexOffset;
-      subMesh.vertexOffset = prim.vertexOffset;
-
-      // Map to bindless material index
-      if (prim.materialIndex >= 0 &&
-          prim.materialIndex < static_cast<int32_t>(materialIndices.size())) {
-        subMesh.materialIndex = materialIndices[prim.materialIndex];
-      } else {
-        subMesh.materialIndex = 0;  // Default material
-      }
-
-      meshComp.subMeshes.push_back(subMesh);
-    }
-
-    // Material component with bindless indices
     auto& matComp = registry.emplace<ecs::MaterialComponent>(entity);
-    matComp.materialIndices = materialIndices;
+    MakeMeshComponents(model, meshIndex, materialIndices, handle, meshComp,
+                       matComp);
 
     // Bounding box
-    registry.emplace<ecs::BoundingBoxComponent>(entity, mesh.bounds);
+    registry.emplace<ecs::BoundingBoxComponent>(
+        entity, model.meshes[meshIndex].bounds);
 
     // Renderable tag
     registry.emplace<ecs::RenderableComponent>(entity);
+
+    if (auto table = MakeInstanceTable(node)) {
+      registry.emplace<ecs::MeshInstancesComponent>(entity, std::move(table));
+    }
   }
 
   // Recursively instantiate children
   for (uint32_t childIndex : node.children) {
-    InstantiateNode(registry, model, materialIndices, childIndex, entity);
+    InstantiateNode(registry, model, materialIndices, childIndex, entity,
+                    handle);
   }
 }
 
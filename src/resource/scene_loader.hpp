@@ -1,8 +1,12 @@
 #pragma once
 
+#include <span>
+
 #include <entt/entt.hpp>
 
+#include "ecs/components.hpp"
 #include "renderer/bindless_materials.hpp"
+#include "resource/handle.hpp"
 #include "resource/types.hpp"
 
 namespace resource {
@@ -13,11 +17,39 @@ namespace resource {
  * @param model The loaded model data
  * @param bindlessMaterials Bindless material manager for registering
  * materials
- * @return Root entity of the instantiated scene
+ * @param handle Handle of the model, referenced while the root entity lives
+ * @return Root entity of the instantiated scene, which holds an
+ * ecs::ModelReferenceComponent
  */
 entt::entity InstantiateModel(
     entt::registry& registry, const Model& model,
-    renderer::BindlessMaterialManager& bindlessMaterials);
+    renderer::BindlessMaterialManager& bindlessMaterials,
+    ModelHandle handle = {});
+
+/**
+ * @brief Instantiate many copies of a loaded model at once.
+ *
+ * Materials are registered once for all copies, and the copies share the
+ * model's GPU buffers. Entities are created in one batch and components are
+ * added per node of the model for all copies together, which is much cheaper
+ * than calling InstantiateModel once per copy. The renderer draws the copies
+ * of a mesh as instances of one draw.
+ *
+ * @param registry The ECS registry to populate
+ * @param model The loaded model data
+ * @param bindlessMaterials Bindless material manager for registering
+ * materials
+ * @param transforms Transform of each copy, relative to the returned root
+ * @param handle Handle of the model, referenced while the root entity lives
+ * @return Root entity of all copies, which holds an
+ * ecs::ModelReferenceComponent and lists the copies' root entities as its
+ * children
+ */
+entt::entity InstantiateModelInstances(
+    entt::registry& registry, const Model& model,
+    renderer::BindlessMaterialManager& bindlessMaterials,
+    std::span<const ecs::TransformComponent> transforms,
+    ModelHandle handle = {});
 
 /**
  * @brief Instantiate a node and its children recursively.
@@ -27,8 +59,31 @@ entt::entity InstantiateModel(
  * @param materialIndices Material indices for the model
  * @param nodeIndex Index of the node to instantiate
  * @param parent Parent entity
+ * @param handle Handle of the model, recorded in the mesh components
  */
 void InstantiateNode(entt::registry& registry, const Model& model,
                      const std::vector<uint32_t>& materialIndices,
-                     uint32_t nodeIndex, entt::entity parent);
+                     uint32_t nodeIndex, entt::entity parent,
+                     ModelHandle handle = {});
+
+/**
+ * @brief Register a model's materials as bindless materials.
+ *
+ * @return Bindless index of each material of the model, or only the default
+ * material if it has none
+ */
+std::vector<uint32_t> RegisterMaterials(
+    const Model& model, renderer::BindlessMaterialManager& bindlessMaterials);
+
+/**
+ * @brief Fill the components that draw one mesh of a model.
+ *
+ * @param meshIndex Index of the mesh in the model, which must be in range
+ * @param materialIndices Bindless indices from RegisterMaterials
+ * @param handle Handle of the model, recorded in the mesh component
+ */
+void MakeMeshComponents(const Model& model, uint32_t meshIndex,
+                        const std::vector<uint32_t>& materialIndices,
+                        ModelHandle handle, ecs::MeshComponent& meshComp,
+                        ecs::MaterialComponent& matComp);
 }  // namespace resource
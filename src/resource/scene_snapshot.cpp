@@ -0,0 +1,782 @@
+#include "resource/scene_snapshot.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "ecs/components.hpp"
+#include "io/mapped_file.hpp"
+#include "logger.hpp"
+#include "resource/scene_loader.hpp"
+
+namespace resource {
+namespace {
+static_assert(std::endian::native == std::endian::little,
+              "Scene snapshots are stored little-endian");
+
+constexpr std::array<char, 8> kMagic{'V', 'K', 'R', 'S', 'C', 'N', 'E', '\0'};
+
+struct SnapshotHeader {
+  std::array<char, 8> magic{};
+  uint32_t version{0};
+  uint32_t headerSize{0};
+  uint64_t bodySize{0};
+};
+static_assert(sizeof(SnapshotHeader) == 24);
+
+constexpr uint32_t kNone = UINT32_MAX;
+
+// Components holding GPU resources are stored as indices into the
+// snapshot's model and instance tables
+struct ModelRecord {
+  uint32_t model{kNone};
+};
+
+struct MeshRecord {
+  uint32_t model{kNone};
+  uint32_t mesh{0};
+};
+
+struct MaterialRecord {
+  uint32_t model{kNone};  // Model of the entity's mesh
+  std::vector<uint32_t> materials;  // Model materials, kNone for the default
+};
+
+struct InstanceTableRecord {
+  uint32_t table{kNone};
+};
+
+template <typename T>
+struct RecordOf {
+  using Type = T;
+};
+template <>
+struct RecordOf<ecs::ModelReferenceComponent> {
+  using Type = ModelRecord;
+};
+template <>
+struct RecordOf<ecs::MeshComponent> {
+  using Type = MeshRecord;
+};
+template <>
+struct RecordOf<ecs::MaterialComponent> {
+  using Type = MaterialRecord;
+};
+template <>
+struct RecordOf<ecs::MeshInstancesComponent> {
+  using Type = InstanceTableRecord;
+};
+
+template <typename T>
+using Record = typename RecordOf<T>::Type;
+
+template <typename... Components>
+struct ComponentList {};
+
+// Sections after the entity identifiers, in file order. Model references
+// are restored before meshes, which draw with the materials they register.
+using SnapshotComponents =
+    ComponentList<ecs::TransformComponent, ecs::WorldTransformComponent,
+                  ecs::HierarchyComponent, ecs::ModelReferenceComponent,
+                  ecs::MeshComponent, ecs::MaterialComponent,
+                  ecs::BoundingBoxComponent, ecs::RenderableComponent,
+                  ecs::MeshInstancesComponent, ecs::DirectionalLightComponent,
+                  ecs::PointLightComponent, ecs::SpotLightComponent>;
+
+// One component type as entt::snapshot writes it: entity, record, entity...
+template <typename Component>
+struct Section {
+  std::vector<entt::entity> entities;
+  std::vector<Record<Component>> records;
+};
+
+template <typename List>
+struct SectionsOf;
+template <typename... Components>
+struct SectionsOf<ComponentList<Components...>> {
+  using Type = std::tuple<Section<Components>...>;
+};
+
+// ----------------------------------------------------------------------------
+// Archives
+// ----------------------------------------------------------------------------
+
+template <typename T>
+void Append(std::vector<char>& out, const T& value) {
+  const auto* bytes = std::bit_cast<const char*>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+void AppendVector(std::vector<char>& out, const std::vector<T>& values) {
+  Append(out, static_cast<uint32_t>(values.size()));
+  const auto* bytes = std::bit_cast<const char*>(values.data());
+  out.insert(out.end(), bytes, bytes + (values.size() * sizeof(T)));
+}
+
+// Output archive for entt::snapshot
+class SnapshotWriter {
+ public:
+  SnapshotWriter(const entt::registry& registry,
+                 const ResourceManager& resources)
+      : registry_{registry}, resources_{resources} {
+    // Bindless materials map back to model materials through the indices
+    // each model reference registered
+    registry.view<const ecs::ModelReferenceComponent>().each(
+        [this](const ecs::ModelReferenceComponent& reference) {
+          uint32_t model = GetModelIndex(reference.model);
+          if (model == kNone) {
+            return;
+          }
+          auto& lookup = materialLookup_[model];
+          for (size_t i = 0; i < reference.materialIndices.size(); ++i) {
+            lookup.try_emplace(reference.materialIndices[i],
+                               static_cast<uint32_t>(i));
+          }
+        });
+  }
+
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  void operator()(const T& value) {
+    Append(stream_, value);
+  }
+
+  void operator()(entt::entity entity) {
+    current_ = entity;
+    Append(stream_, entity);
+  }
+
+  void operator()(const ecs::HierarchyComponent& hierarchy) {
+    Append(stream_, hierarchy.parent);
+    AppendVector(stream_, hierarchy.children);
+  }
+
+  void operator()(const ecs::ModelReferenceComponent& reference) {
+    Append(stream_, ModelRecord{.model = GetModelIndex(reference.model)});
+  }
+
+  void operator()(const ecs::MeshComponent& mesh) {
+    Append(stream_, MeshRecord{
+                        .model = GetModelIndex(mesh.model),
+                        .mesh = mesh.meshIndex,
+                    });
+  }
+
+  void operator()(const ecs::MaterialComponent& material) {
+    const auto* mesh = registry_.try_get<ecs::MeshComponent>(current_);
+    uint32_t model = mesh != nullptr ? GetModelIndex(mesh->model) : kNone;
+
+    std::vector<uint32_t> materials;
+    materials.reserve(material.materialIndices.size());
+    for (uint32_t index : material.materialIndices) {
+      uint32_t local = kNone;
+      if (auto lookup = materialLookup_.find(model);
+          lookup != materialLookup_.end()) {
+        if (auto it = lookup->second.find(index); it != lookup->second.end()) {
+          local = it->second;
+        }
+      }
+      materials.push_back(local);
+    }
+    Append(stream_, model);
+    AppendVector(stream_, materials);
+  }
+
+  void operator()(const ecs::MeshInstancesComponent& instances) {
+    InstanceTableRecord record{};
+    if (instances.transforms) {
+      auto [it, inserted] = tableIndices_.try_emplace(
+          instances.transforms.get(), static_cast<uint32_t>(tables_.size()));
+      if (inserted) {
+        tables_.push_back(instances.transforms.get());
+      }
+      record.table = it->second;
+    }
+    Append(stream_, record);
+  }
+
+  [[nodiscard]] size_t GetModelCount() const { return models_.size(); }
+
+  /**
+   * @brief The snapshot body: model paths, instance tables, then what the
+   * snapshot wrote.
+   */
+  [[nodiscard]] std::vector<char> Finish() const {
+    std::vector<char> body;
+    Append(body, static_cast<uint32_t>(models_.size()));
+    for (const auto& path : models_) {
+      Append(body, static_cast<uint32_t>(path.size()));
+      body.insert(body.end(), path.begin(), path.end());
+    }
+    Append(body, static_cast<uint32_t>(tables_.size()));
+    for (const auto* table : tables_) {
+      AppendVector(body, *table);
+    }
+    body.insert(body.end(), stream_.begin(), stream_.end());
+    return body;
+  }
+
+ private:
+  uint32_t GetModelIndex(ModelHandle handle) {
+    uint64_t key = (uint64_t{handle.generation} << 32) | handle.index;
+    if (auto it = modelIndices_.find(key); it != modelIndices_.end()) {
+      return it->second;
+    }
+    uint32_t index = kNone;
+    std::filesystem::path path = resources_.GetModelPath(handle);
+    if (!path.empty()) {
+      index = static_cast<uint32_t>(models_.size());
+      models_.push_back(path.string());
+    }
+    modelIndices_.emplace(key, index);
+    return index;
+  }
+
+  const entt::registry& registry_;
+  const ResourceManager& resources_;
+  entt::entity current_{entt::null};
+
+  std::vector<char> stream_;
+  std::vector<std::string> models_;
+  std::unordered_map<uint64_t, uint32_t> modelIndices_;  // By handle
+  // Bindless material to model material, per model
+  std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t>>
+      materialLookup_;
+  std::vector<const std::vector<glm::mat4>*> tables_;
+  std::unordered_map<const std::vector<glm::mat4>*, uint32_t> tableIndices_;
+};
+
+// Input archive for entt::snapshot_loader, and decoder of the sections
+class SnapshotReader {
+ public:
+  explicit SnapshotReader(std::span<const std::byte> bytes) : bytes_{bytes} {}
+
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  void operator()(T& value) {
+    value = Read<T>();
+  }
+
+  template <typename T>
+  T Read() {
+    T value{};
+    if (Require(sizeof(T))) {
+      std::memcpy(&value, bytes_.data() + offset_, sizeof(T));
+      offset_ += sizeof(T);
+    }
+    return value;
+  }
+
+  template <typename T>
+  std::vector<T> ReadVector() {
+    auto count = Read<uint32_t>();
+    std::vector<T> values;
+    if (Require(size_t{count} * sizeof(T))) {
+      values.resize(count);
+      std::memcpy(values.data(), bytes_.data() + offset_, count * sizeof(T));
+      offset_ += count * sizeof(T);
+    }
+    return values;
+  }
+
+  std::string ReadString() {
+    auto size = Read<uint32_t>();
+    std::string value;
+    if (Require(size)) {
+      value.assign(std::bit_cast<const char*>(bytes_.data() + offset_), size);
+      offset_ += size;
+    }
+    return value;
+  }
+
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  void Decode(T& record) {
+    record = Read<T>();
+  }
+
+  void Decode(ecs::HierarchyComponent& hierarchy) {
+    hierarchy.parent = Read<entt::entity>();
+    hierarchy.children = ReadVector<entt::entity>();
+  }
+
+  void Decode(MaterialRecord& record) {
+    record.model = Read<uint32_t>();
+    record.materials = ReadVector<uint32_t>();
+  }
+
+  void Skip(size_t size) {
+    if (Require(size)) {
+      offset_ += size;
+    }
+  }
+
+  bool Require(size_t size) {
+    if (failed_ || size > bytes_.size() - offset_) {
+      failed_ = true;
+    }
+    return !failed_;
+  }
+
+  [[nodiscard]] size_t GetOffset() const { return offset_; }
+
+  // Bytes read since `offset`
+  [[nodiscard]] std::span<const std::byte> GetReadSince(size_t offset) const {
+    return bytes_.subspan(offset, offset_ - offset);
+  }
+
+  [[nodiscard]] bool Succeeded() const {
+    return !failed_ && offset_ == bytes_.size();
+  }
+
+ private:
+  std::span<const std::byte> bytes_;
+  size_t offset_{0};
+  bool failed_{false};
+};
+
+// ----------------------------------------------------------------------------
+// Loading
+// ----------------------------------------------------------------------------
+
+// Everything a snapshot holds, decoded before the registry is touched
+struct SnapshotContents {
+  std::vector<std::string> models;
+  std::vector<std::vector<glm::mat4>> instanceTables;
+  std::vector<std::byte> entities;  // As entt::snapshot wrote them
+  uint32_t aliveEntities{0};
+  SectionsOf<SnapshotComponents>::Type sections;
+};
+
+template <typename Component>
+void ReadSection(SnapshotReader& reader, Section<Component>& section) {
+  auto length = reader.Read<uint32_t>();
+  // Every element takes at least one byte, which bounds hostile counts
+  if (!reader.Require(length)) {
+    return;
+  }
+  section.entities.resize(length);
+  section.records.resize(length);
+  for (uint32_t i = 0; i < length; ++i) {
+    section.entities[i] = reader.Read<entt::entity>();
+    reader.Decode(section.records[i]);
+  }
+}
+
+template <typename... Components>
+void ReadSections(SnapshotReader& reader,
+                  std::tuple<Section<Components>...>& sections) {
+  (ReadSection(reader, std::get<Section<Components>>(sections)), ...);
+}
+
+bool ReadContents(SnapshotReader& reader, SnapshotContents& contents) {
+  auto modelCount = reader.Read<uint32_t>();
+  if (!reader.Require(modelCount)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < modelCount; ++i) {
+    contents.models.push_back(reader.ReadString());
+  }
+
+  auto tableCount = reader.Read<uint32_t>();
+  if (!reader.Require(tableCount)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < tableCount; ++i) {
+    contents.instanceTables.push_back(reader.ReadVector<glm::mat4>());
+  }
+
+  // Only skipped here; entt::snapshot_loader reads it on Restore
+  size_t entitiesBegin = reader.GetOffset();
+  auto entityCount = reader.Read<uint32_t>();
+  contents.aliveEntities = reader.Read<uint32_t>();
+  reader.Skip(size_t{entityCount} * sizeof(entt::entity));
+  auto entities = reader.GetReadSince(entitiesBegin);
+  contents.entities.assign(entities.begin(), entities.end());
+
+  ReadSections(reader, contents.sections);
+  return reader.Succeeded();
+}
+
+// What the snapshot's tables refer to in this run
+struct RestoreContext {
+  renderer::BindlessMaterialManager& bindless;
+  std::vector<ModelHandle> handles;
+  std::vector<const Model*> models;
+  // Bindless index of each model material, from its first reference
+  std::vector<std::vector<uint32_t>> materials;
+  std::vector<std::shared_ptr<const std::vector<glm::mat4>>> instanceTables;
+};
+
+// Load the models of a snapshot; nullopt if one fails
+std::optional<RestoreContext> ResolveModels(
+    SnapshotContents& contents, ResourceManager& resources,
+    renderer::BindlessMaterialManager& materials) {
+  RestoreContext context{
+      .bindless = materials,
+      .handles = {},
+      .models = {},
+      .materials = std::vector<std::vector<uint32_t>>(contents.models.size()),
+      .instanceTables = {},
+  };
+  for (const auto& modelPath : contents.models) {
+    ModelHandle handle = resources.LoadModel(modelPath);
+    const Model* model = resources.GetModel(handle);
+    if (model == nullptr) {
+      LOG_ERROR("Scene snapshot needs {}, which failed to load", modelPath);
+      return std::nullopt;
+    }
+    context.handles.push_back(handle);
+    context.models.push_back(model);
+  }
+  for (auto& table : contents.instanceTables) {
+    context.instanceTables.push_back(
+        std::make_shared<const std::vector<glm::mat4>>(std::move(table)));
+  }
+  return context;
+}
+
+std::optional<ecs::ModelReferenceComponent> Resolve(
+    const ModelRecord& record, RestoreContext& context) {
+  if (record.model >= context.models.size()) {
+    return std::nullopt;
+  }
+  // Each reference registers the materials it releases, as on instantiation
+  std::vector<uint32_t> indices =
+      RegisterMaterials(*context.models[record.model], context.bindless);
+  if (context.materials[record.model].empty()) {
+    context.materials[record.model] = indices;
+  }
+  return ecs::ModelReferenceComponent{
+      .model = context.handles[record.model],
+      .materialIndices = std::move(indices),
+  };
+}
+
+std::optional<ecs::MeshComponent> Resolve(const MeshRecord& record,
+                                          RestoreContext& context) {
+  if (record.model >= context.models.size() ||
+      record.mesh >= context.models[record.model]->meshes.size()) {
+    return std::nullopt;
+  }
+  ecs::MeshComponent mesh;
+  ecs::MaterialComponent material;
+  MakeMeshComponents(*context.models[record.model], record.mesh,
+                     context.materials[record.model],
+                     context.handles[record.model], mesh, material);
+  return mesh;
+}
+
+std::optional<ecs::MaterialComponent> Resolve(const MaterialRecord& record,
+                                              RestoreContext& context) {
+  const std::vector<uint32_t>* indices = record.model < context.models.size()
+                                             ? &context.materials[record.model]
+                                             : nullptr;
+  ecs::MaterialComponent material;
+  material.materialIndices.reserve(record.materials.size());
+  for (uint32_t local : record.materials) {
+    bool known = indices != nullptr && local < indices->size();
+    material.materialIndices.push_back(known ? (*indices)[local] : 0);
+  }
+  return material;
+}
+
+std::optional<ecs::MeshInstancesComponent> Resolve(
+    const InstanceTableRecord& record, RestoreContext& context) {
+  if (record.table >= context.instanceTables.size()) {
+    return std::nullopt;
+  }
+  return ecs::MeshInstancesComponent{context.instanceTables[record.table]};
+}
+
+template <typename Component>
+void Insert(entt::registry& registry, Section<Component>& section,
+            RestoreContext& context) {
+  if constexpr (std::is_same_v<Record<Component>, Component>) {
+    registry.insert<Component>(
+        section.entities.begin(), section.entities.end(),
+        std::make_move_iterator(section.records.begin()));
+  } else {
+    // Records whose resource is gone are dropped with their entity's entry
+    std::vector<entt::entity> entities;
+    std::vector<Component> components;
+    entities.reserve(section.entities.size());
+    components.reserve(section.records.size());
+    for (size_t i = 0; i < section.records.size(); ++i) {
+      if (auto component = Resolve(section.records[i], context)) {
+        entities.push_back(section.entities[i]);
+        components.push_back(std::move(*component));
+      }
+    }
+    registry.insert<Component>(entities.begin(), entities.end(),
+                               std::make_move_iterator(components.begin()));
+  }
+}
+
+template <typename... Components>
+bool AllEntitiesValid(const entt::registry& registry,
+                      const std::tuple<Section<Components>...>& sections) {
+  auto valid = [&registry](const auto& section) {
+    return std::ranges::all_of(section.entities, [&registry](auto entity) {
+      return registry.valid(entity);
+    });
+  };
+  return (valid(std::get<Section<Components>>(sections)) && ...);
+}
+
+template <typename... Components>
+void InsertSections(entt::registry& registry,
+                    std::tuple<Section<Components>...>& sections,
+                    RestoreContext& context) {
+  (Insert(registry, std::get<Section<Components>>(sections), context), ...);
+}
+
+// Stored entities in order of first appearance
+template <typename... Components>
+std::vector<entt::entity> CollectEntities(
+    const std::tuple<Section<Components>...>& sections) {
+  std::vector<entt::entity> entities;
+  std::unordered_set<entt::entity> seen;
+  auto collect = [&](const auto& section) {
+    for (auto entity : section.entities) {
+      if (seen.insert(entity).second) {
+        entities.push_back(entity);
+      }
+    }
+  };
+  (collect(std::get<Section<Components>>(sections)), ...);
+  return entities;
+}
+
+template <typename... Components>
+void RemapEntities(
+    std::tuple<Section<Components>...>& sections,
+    const std::unordered_map<entt::entity, entt::entity>& remap) {
+  auto map = [&remap](entt::entity entity) -> entt::entity {
+    auto it = remap.find(entity);
+    return it != remap.end() ? it->second : entt::null;
+  };
+  auto apply = [&map](auto& section) {
+    for (auto& entity : section.entities) {
+      entity = map(entity);
+    }
+  };
+  (apply(std::get<Section<Components>>(sections)), ...);
+
+  for (auto& hierarchy :
+       std::get<Section<ecs::HierarchyComponent>>(sections).records) {
+    hierarchy.parent = map(hierarchy.parent);
+    for (auto& child : hierarchy.children) {
+      child = map(child);
+    }
+    std::erase(hierarchy.children, static_cast<entt::entity>(entt::null));
+  }
+}
+
+// Submeshes draw with the stored materials, which need not be the model's
+void ApplyMaterials(entt::registry& registry,
+                    const Section<ecs::MaterialComponent>& section) {
+  for (auto entity : section.entities) {
+    auto* mesh = registry.try_get<ecs::MeshComponent>(entity);
+    if (mesh == nullptr) {
+      continue;
+    }
+    const auto& material = registry.get<ecs::MaterialComponent>(entity);
+    if (material.materialIndices.size() != mesh->subMeshes.size()) {
+      continue;
+    }
+    for (size_t i = 0; i < mesh->subMeshes.size(); ++i) {
+      mesh->subMeshes[i].materialIndex = material.materialIndices[i];
+    }
+  }
+}
+
+template <typename... Components>
+void WriteSections(const entt::snapshot& snapshot, SnapshotWriter& writer,
+                   ComponentList<Components...> /*components*/) {
+  (snapshot.get<Components>(writer), ...);
+}
+}  // namespace
+
+bool SaveSceneSnapshot(const entt::registry& registry,
+                       const ResourceManager& resources,
+                       const std::filesystem::path& path) {
+  SnapshotWriter writer{registry, resources};
+  entt::snapshot snapshot{registry};
+  snapshot.get<entt::entity>(writer);
+  WriteSections(snapshot, writer, SnapshotComponents{});
+  std::vector<char> body = writer.Finish();
+
+  SnapshotHeader header{
+      .magic = kMagic,
+      .version = kSceneSnapshotVersion,
+      .headerSize = sizeof(SnapshotHeader),
+      .bodySize = body.size(),
+  };
+
+  std::filesystem::path tempPath = path;
+  tempPath += ".tmp";
+
+  {
+    std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+    if (!file) {
+      LOG_ERROR("Failed to create scene snapshot: {}", tempPath.string());
+      return false;
+    }
+    file.write(std::bit_cast<const char*>(&header), sizeof(header));
+    file.write(body.data(), static_cast<std::streamsize>(body.size()));
+    if (!file.good()) {
+      LOG_ERROR("Failed to write scene snapshot: {}", tempPath.string());
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tempPath, path, error);
+  if (error) {
+    LOG_ERROR("Failed to move scene snapshot into place: {} ({})",
+              path.string(), error.message());
+    return false;
+  }
+
+  LOG_INFO("Saved scene snapshot {} ({} KiB, {} models)", path.string(),
+           (sizeof(header) + body.size()) >> 10, writer.GetModelCount());
+  return true;
+}
+
+struct SceneSnapshot::Contents : SnapshotContents {};
+
+SceneSnapshot::SceneSnapshot() : contents_{std::make_unique<Contents>()} {}
+SceneSnapshot::SceneSnapshot(SceneSnapshot&&) noexcept = default;
+SceneSnapshot& SceneSnapshot::operator=(SceneSnapshot&&) noexcept = default;
+SceneSnapshot::~SceneSnapshot() = default;
+
+std::optional<SceneSnapshot> SceneSnapshot::Read(
+    const std::filesystem::path& path) {
+  auto file = io::MappedFile::Open(path);
+  if (!file) {
+    LOG_ERROR("Failed to map scene snapshot: {}", path.string());
+    return std::nullopt;
+  }
+
+  auto bytes = file->GetData();
+  SnapshotHeader header{};
+  if (bytes.size() < sizeof(header)) {
+    LOG_ERROR("Scene snapshot is truncated: {}", path.string());
+    return std::nullopt;
+  }
+  std::memcpy(&header, bytes.data(), sizeof(header));
+
+  if (header.magic != kMagic || header.headerSize != sizeof(header)) {
+    LOG_ERROR("Not a scene snapshot: {}", path.string());
+    return std::nullopt;
+  }
+  if (header.version != kSceneSnapshotVersion) {
+    LOG_ERROR("Scene snapshot {} has version {}, expected {}", path.string(),
+              header.version, kSceneSnapshotVersion);
+    return std::nullopt;
+  }
+  if (header.bodySize != bytes.size() - sizeof(header)) {
+    LOG_ERROR("Scene snapshot is truncated: {}", path.string());
+    return std::nullopt;
+  }
+
+  SceneSnapshot snapshot;
+  SnapshotReader reader{bytes.subspan(sizeof(header))};
+  if (!ReadContents(reader, *snapshot.contents_)) {
+    LOG_ERROR("Scene snapshot is corrupt: {}", path.string());
+    return std::nullopt;
+  }
+  return snapshot;
+}
+
+const std::vector<std::string>& SceneSnapshot::GetModelPaths() const {
+  return contents_->models;
+}
+
+uint32_t SceneSnapshot::GetEntityCount() const {
+  return contents_->aliveEntities;
+}
+
+bool SceneSnapshot::Restore(entt::registry& registry,
+                            ResourceManager& resources,
+                            renderer::BindlessMaterialManager& materials) {
+  auto context = ResolveModels(*contents_, resources, materials);
+  if (!context) {
+    return false;
+  }
+
+  SnapshotReader entityReader{contents_->entities};
+  entt::snapshot_loader{registry}.get<entt::entity>(entityReader);
+  if (!AllEntitiesValid(registry, contents_->sections)) {
+    LOG_ERROR("Scene snapshot has components of dead entities");
+    registry.clear();
+    return false;
+  }
+
+  InsertSections(registry, contents_->sections, *context);
+  ApplyMaterials(registry, std::get<Section<ecs::MaterialComponent>>(
+                               contents_->sections));
+  return true;
+}
+
+std::optional<std::vector<entt::entity>> SceneSnapshot::Instantiate(
+    entt::registry& registry, ResourceManager& resources,
+    renderer::BindlessMaterialManager& materials) {
+  auto context = ResolveModels(*contents_, resources, materials);
+  if (!context) {
+    return std::nullopt;
+  }
+
+  std::vector<entt::entity> stored = CollectEntities(contents_->sections);
+  std::vector<entt::entity> created(stored.size());
+  registry.create(created.begin(), created.end());
+
+  std::unordered_map<entt::entity, entt::entity> remap;
+  remap.reserve(stored.size());
+  for (size_t i = 0; i < stored.size(); ++i) {
+    remap.emplace(stored[i], created[i]);
+  }
+  RemapEntities(contents_->sections, remap);
+
+  InsertSections(registry, contents_->sections, *context);
+  ApplyMaterials(registry, std::get<Section<ecs::MaterialComponent>>(
+                               contents_->sections));
+  return created;
+}
+
+bool LoadSceneSnapshot(entt::registry& registry, ResourceManager& resources,
+                       renderer::BindlessMaterialManager& materials,
+                       const std::filesystem::path& path) {
+  auto start = std::chrono::steady_clock::now();
+
+  auto snapshot = SceneSnapshot::Read(path);
+  if (!snapshot || !snapshot->Restore(registry, resources, materials)) {
+    return false;
+  }
+
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  LOG_INFO("Restored scene snapshot {} ({} entities, {} models) in {:.2f} ms",
+           path.string(), snapshot->GetEntityCount(),
+           snapshot->GetModelPaths().size(), elapsed.count());
+  return true;
+}
+
+}  // namespace resource
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+#include "renderer/bindless_materials.hpp"
+#include "resource/resource_manager.hpp"
+
+namespace resource {
+
+// Bumped whenever the layout changes; older snapshots are rejected
+constexpr uint32_t kSceneSnapshotVersion = 1;
+
+/**
+ * @brief Write the scene in a registry as a binary snapshot.
+ *
+ * Entity identifiers and components are written through entt::snapshot:
+ * transforms, hierarchy, bounds, lights and what draws meshes. Model
+ * references, meshes and materials hold GPU resources, so they are stored
+ * as the path of their model and indices into it; instance tables are
+ * stored once however many entities share them. Cameras and other
+ * components are not stored. The file is written under a temporary name
+ * and renamed into place once complete.
+ *
+ * @return false if the file cannot be written
+ */
+bool SaveSceneSnapshot(const entt::registry& registry,
+                       const ResourceManager& resources,
+                       const std::filesystem::path& path);
+
+/**
+ * @brief A decoded scene snapshot, ready to be added to a registry.
+ *
+ * Reading maps and checks the whole file without touching a registry or
+ * the GPU, so it may run on any thread. The decoded components are moved
+ * into the registry by Restore or Instantiate, only one of which may be
+ * called, once.
+ */
+class SceneSnapshot {
+ public:
+  SceneSnapshot(SceneSnapshot&&) noexcept;
+  SceneSnapshot& operator=(SceneSnapshot&&) noexcept;
+  SceneSnapshot(const SceneSnapshot&) = delete;
+  SceneSnapshot& operator=(const SceneSnapshot&) = delete;
+  ~SceneSnapshot();
+
+  /**
+   * @brief Map and decode a snapshot.
+   *
+   * @return The snapshot or nullopt if it is missing, corrupt or from
+   * another version
+   */
+  [[nodiscard]] static std::optional<SceneSnapshot> Read(
+      const std::filesystem::path& path);
+
+  /**
+   * @brief Paths of the models the snapshot refers to, which Restore and
+   * Instantiate load unless they are cached.
+   */
+  [[nodiscard]] const std::vector<std::string>& GetModelPaths() const;
+
+  /**
+   * @brief Live entities when the snapshot was written.
+   */
+  [[nodiscard]] uint32_t GetEntityCount() const;
+
+  /**
+   * @brief Add the snapshot to an empty registry with its entity
+   * identifiers.
+   *
+   * @return false if a model cannot be loaded or the snapshot lists
+   * components of dead entities; the registry is left without components
+   * then
+   */
+  bool Restore(entt::registry& registry, ResourceManager& resources,
+               renderer::BindlessMaterialManager& materials);
+
+  /**
+   * @brief Add the snapshot to a registry as new entities.
+   *
+   * Entity references in hierarchies are mapped to the new entities.
+   *
+   * @return The created entities, or nullopt if a model cannot be loaded,
+   * in which case nothing is created
+   */
+  std::optional<std::vector<entt::entity>> Instantiate(
+      entt::registry& registry, ResourceManager& resources,
+      renderer::BindlessMaterialManager& materials);
+
+ private:
+  struct Contents;
+
+  SceneSnapshot();
+
+  std::unique_ptr<Contents> contents_;
+};
+
+/**
+ * @brief Restore a scene snapshot into an empty registry.
+ *
+ * The whole file is decoded and checked first. The models it refers to are
+ * then loaded through `resources`, which picks up cooked packs, and their
+ * materials registered again; `resources` should be connected to the
+ * registry so the restored model references keep them cached. Entity
+ * identifiers are restored with entt::snapshot_loader, and each component
+ * type is added with one bulk insert. Shorthand for SceneSnapshot::Read
+ * followed by Restore.
+ *
+ * @return false if the snapshot is missing, corrupt or from another version,
+ * or a model it refers to cannot be loaded; the registry is left without
+ * components then
+ */
+bool LoadSceneSnapshot(entt::registry& registry, ResourceManager& resources,
+                       renderer::BindlessMaterialManager& materials,
+                       const std::filesystem::path& path);
+
+}  // namespace resource
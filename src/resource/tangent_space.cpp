@@ -0,0 +1,442 @@
+#include "resource/tangent_space.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <numbers>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define VKR_TANGENT_SPACE_SSE 1
+  #include <immintrin.h>
+#endif
+
+#include "core/arena.hpp"
+
+namespace resource {
+namespace {
+
+constexpr float kLengthEpsilon = 1e-12F;
+constexpr float kPi = std::numbers::pi_v<float>;
+constexpr uint32_t kNoCopy = std::numeric_limits<uint32_t>::max();
+
+// Per-triangle frames in structure-of-arrays layout so the SIMD kernel can
+// write four faces with plain vector stores
+struct FaceFrames {
+  using Floats = std::pmr::vector<float>;
+
+  Floats nx, ny, nz;              // Unit face normal
+  Floats tx, ty, tz;              // Unit UV-space tangent (zero if no UVs)
+  Floats bx, by, bz;              // Unit UV-space bitangent
+  Floats angle0, angle1, angle2;  // Corner angles
+
+  explicit FaceFrames(size_t count,
+                      std::pmr::memory_resource* memory =
+                          core::GetScratchResource())
+      : nx(count, memory),
+        ny(count, memory),
+        nz(count, memory),
+        tx(count, memory),
+        ty(count, memory),
+        tz(count, memory),
+        bx(count, memory),
+        by(count, memory),
+        bz(count, memory),
+        angle0(count, memory),
+        angle1(count, memory),
+        angle2(count, memory) {}
+};
+
+// Abramowitz-Stegun 4.4.45, max error ~7e-5 rad; plenty for weighting and
+// cheap enough to evaluate the same way in the SIMD path
+float FastAcos(float x) {
+  float ax = std::min(std::abs(x), 1.0F);
+  float poly = ((((-0.0187293F * ax) + 0.0742610F) * ax - 0.2121144F) * ax) +
+               1.5707288F;
+  float result = std::sqrt(1.0F - ax) * poly;
+  return x < 0.0F ? kPi - result : result;
+}
+
+glm::vec3 SafeNormalize(const glm::vec3& v) {
+  float lengthSq = glm::dot(v, v);
+  return lengthSq > kLengthEpsilon ? v / std::sqrt(lengthSq) : glm::vec3(0.0F);
+}
+
+void ComputeFaceScalar(std::span<const ecs::Vertex> vertices,
+                       std::span<const uint32_t> indices, size_t face,
+                       FaceFrames& out) {
+  uint32_t i0 = indices[(face * 3) + 0];
+  uint32_t i1 = indices[(face * 3) + 1];
+  uint32_t i2 = indices[(face * 3) + 2];
+
+  if (i0 >= vertices.size() || i1 >= vertices.size() ||
+      i2 >= vertices.size()) {
+    // Zero angles keep out-of-range faces from contributing anything
+    out.angle0[face] = out.angle1[face] = out.angle2[face] = 0.0F;
+    return;
+  }
+
+  const auto& v0 = vertices[i0];
+  const auto& v1 = vertices[i1];
+  const auto& v2 = vertices[i2];
+
+  glm::vec3 edge1 = v1.position - v0.position;
+  glm::vec3 edge2 = v2.position - v0.position;
+  glm::vec3 edge3 = v2.position - v1.position;
+
+  glm::vec2 deltaUV1 = v1.texCoord - v0.texCoord;
+  glm::vec2 deltaUV2 = v2.texCoord - v0.texCoord;
+
+  // Only the sign of the UV area matters once the result is normalized
+  float det = (deltaUV1.x * deltaUV2.y) - (deltaUV2.x * deltaUV1.y);
+  float sign = 0.0F;
+  if (det > kLengthEpsilon) {
+    sign = 1.0F;
+  } else if (det < -kLengthEpsilon) {
+    sign = -1.0F;
+  }
+
+  glm::vec3 n = SafeNormalize(glm::cross(edge1, edge2));
+  glm::vec3 t =
+      SafeNormalize(((edge1 * deltaUV2.y) - (edge2 * deltaUV1.y)) * sign);
+  glm::vec3 b =
+      SafeNormalize(((edge2 * deltaUV1.x) - (edge1 * deltaUV2.x)) * sign);
+
+  glm::vec3 d1 = SafeNormalize(edge1);
+  glm::vec3 d2 = SafeNormalize(edge2);
+  glm::vec3 d3 = SafeNormalize(edge3);
+
+  float a0 = FastAcos(glm::dot(d1, d2));
+  float a1 = FastAcos(-glm::dot(d1, d3));
+
+  out.nx[face] = n.x;
+  out.ny[face] = n.y;
+  out.nz[face] = n.z;
+  out.tx[face] = t.x;
+  out.ty[face] = t.y;
+  out.tz[face] = t.z;
+  out.bx[face] = b.x;
+  out.by[face] = b.y;
+  out.bz[face] = b.z;
+  out.angle0[face] = a0;
+  out.angle1[face] = a1;
+  out.angle2[face] = std::max(kPi - a0 - a1, 0.0F);
+}
+
+#ifdef VKR_TANGENT_SPACE_SSE
+
+struct Vec3x4 {
+  __m128 x;
+  __m128 y;
+  __m128 z;
+};
+
+inline Vec3x4 Sub(const Vec3x4& a, const Vec3x4& b) {
+  return {_mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z)};
+}
+
+inline Vec3x4 Scale(const Vec3x4& a, __m128 s) {
+  return {_mm_mul_ps(a.x, s), _mm_mul_ps(a.y, s), _mm_mul_ps(a.z, s)};
+}
+
+inline __m128 Dot(const Vec3x4& a, const Vec3x4& b) {
+  return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)),
+                    _mm_mul_ps(a.z, b.z));
+}
+
+inline Vec3x4 Cross(const Vec3x4& a, const Vec3x4& b) {
+  return {_mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(a.z, b.y)),
+          _mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(a.x, b.z)),
+          _mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(a.y, b.x))};
+}
+
+inline Vec3x4 Normalize(const Vec3x4& a) {
+  __m128 lengthSq = Dot(a, a);
+  __m128 valid = _mm_cmpgt_ps(lengthSq, _mm_set1_ps(kLengthEpsilon));
+  __m128 invLength =
+      _mm_and_ps(valid, _mm_div_ps(_mm_set1_ps(1.0F), _mm_sqrt_ps(lengthSq)));
+  return Scale(a, invLength);
+}
+
+inline __m128 FastAcos(__m128 x) {
+  __m128 ax =
+      _mm_min_ps(_mm_andnot_ps(_mm_set1_ps(-0.0F), x), _mm_set1_ps(1.0F));
+  __m128 poly = _mm_set1_ps(-0.0187293F);
+  poly = _mm_add_ps(_mm_mul_ps(poly, ax), _mm_set1_ps(0.0742610F));
+  poly = _mm_sub_ps(_mm_mul_ps(poly, ax), _mm_set1_ps(0.2121144F));
+  poly = _mm_add_ps(_mm_mul_ps(poly, ax), _mm_set1_ps(1.5707288F));
+  __m128 result =
+      _mm_mul_ps(_mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0F), ax)), poly);
+  __m128 negative = _mm_cmplt_ps(x, _mm_setzero_ps());
+  return _mm_or_ps(_mm_and_ps(negative, _mm_sub_ps(_mm_set1_ps(kPi), result)),
+                   _mm_andnot_ps(negative, result));
+}
+
+// Process faces [face, face + 4); all twelve indices must be in range
+void ComputeFacesSSE(const ecs::Vertex* vertices, const uint32_t* indices,
+                     size_t face, FaceFrames& out) {
+  const uint32_t* tri = indices + (face * 3);
+
+  auto gatherPosition = [&](int corner) {
+    const auto& a = vertices[tri[corner]].position;
+    const auto& b = vertices[tri[3 + corner]].position;
+    const auto& c = vertices[tri[6 + corner]].position;
+    const auto& d = vertices[tri[9 + corner]].position;
+    return Vec3x4{_mm_setr_ps(a.x, b.x, c.x, d.x),
+                  _mm_setr_ps(a.y, b.y, c.y, d.y),
+                  _mm_setr_ps(a.z, b.z, c.z, d.z)};
+  };
+  auto gatherUV = [&](int corner, __m128& u, __m128& v) {
+    const auto& a = vertices[tri[corner]].texCoord;
+    const auto& b = vertices[tri[3 + corner]].texCoord;
+    const auto& c = vertices[tri[6 + corner]].texCoord;
+    const auto& d = vertices[tri[9 + corner]].texCoord;
+    u = _mm_setr_ps(a.x, b.x, c.x, d.x);
+    v = _mm_setr_ps(a.y, b.y, c.y, d.y);
+  };
+
+  Vec3x4 p0 = gatherPosition(0);
+  Vec3x4 p1 = gatherPosition(1);
+  Vec3x4 p2 = gatherPosition(2);
+
+  __m128 u0;
+  __m128 v0;
+  __m128 u1;
+  __m128 v1;
+  __m128 u2;
+  __m128 v2;
+  gatherUV(0, u0, v0);
+  gatherUV(1, u1, v1);
+  gatherUV(2, u2, v2);
+
+  Vec3x4 edge1 = Sub(p1, p0);
+  Vec3x4 edge2 = Sub(p2, p0);
+  Vec3x4 edge3 = Sub(p2, p1);
+
+  __m128 du1 = _mm_sub_ps(u1, u0);
+  __m128 dv1 = _mm_sub_ps(v1, v0);
+  __m128 du2 = _mm_sub_ps(u2, u0);
+  __m128 dv2 = _mm_sub_ps(v2, v0);
+
+  __m128 det = _mm_sub_ps(_mm_mul_ps(du1, dv2), _mm_mul_ps(du2, dv1));
+  __m128 sign = _mm_or_ps(
+      _mm_and_ps(_mm_cmpgt_ps(det, _mm_set1_ps(kLengthEpsilon)),
+                 _mm_set1_ps(1.0F)),
+      _mm_and_ps(_mm_cmplt_ps(det, _mm_set1_ps(-kLengthEpsilon)),
+                 _mm_set1_ps(-1.0F)));
+
+  Vec3x4 n = Normalize(Cross(edge1, edge2));
+  Vec3x4 t = Normalize(Scale(Sub(Scale(edge1, dv2), Scale(edge2, dv1)), sign));
+  Vec3x4 b = Normalize(Scale(Sub(Scale(edge2, du1), Scale(edge1, du2)), sign));
+
+  Vec3x4 d1 = Normalize(edge1);
+  Vec3x4 d2 = Normalize(edge2);
+  Vec3x4 d3 = Normalize(edge3);
+
+  __m128 a0 = FastAcos(Dot(d1, d2));
+  __m128 a1 = FastAcos(_mm_sub_ps(_mm_setzero_ps(), Dot(d1, d3)));
+  __m128 a2 = _mm_max_ps(
+      _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(kPi), a0), a1), _mm_setzero_ps());
+
+  _mm_storeu_ps(&out.nx[face], n.x);
+  _mm_storeu_ps(&out.ny[face], n.y);
+  _mm_storeu_ps(&out.nz[face], n.z);
+  _mm_storeu_ps(&out.tx[face], t.x);
+  _mm_storeu_ps(&out.ty[face], t.y);
+  _mm_storeu_ps(&out.tz[face], t.z);
+  _mm_storeu_ps(&out.bx[face], b.x);
+  _mm_storeu_ps(&out.by[face], b.y);
+  _mm_storeu_ps(&out.bz[face], b.z);
+  _mm_storeu_ps(&out.angle0[face], a0);
+  _mm_storeu_ps(&out.angle1[face], a1);
+  _mm_storeu_ps(&out.angle2[face], a2);
+}
+
+#endif  // VKR_TANGENT_SPACE_SSE
+
+FaceFrames ComputeFaceFrames(std::span<const ecs::Vertex> vertices,
+                             std::span<const uint32_t> indices) {
+  size_t faceCount = indices.size() / 3;
+  FaceFrames frames(faceCount);
+
+  size_t face = 0;
+#ifdef VKR_TANGENT_SPACE_SSE
+  const auto vertexCount = static_cast<uint32_t>(vertices.size());
+  for (; face + 4 <= faceCount; face += 4) {
+    const uint32_t* tri = indices.data() + (face * 3);
+    bool inRange = std::all_of(
+        tri, tri + 12, [vertexCount](uint32_t i) { return i < vertexCount; });
+
+    if (inRange) {
+      ComputeFacesSSE(vertices.data(), indices.data(), face, frames);
+    } else {
+      for (size_t i = face; i < face + 4; ++i) {
+        ComputeFaceScalar(vertices, indices, i, frames);
+      }
+    }
+  }
+#endif
+
+  for (; face < faceCount; ++face) {
+    ComputeFaceScalar(vertices, indices, face, frames);
+  }
+
+  return frames;
+}
+
+}  // namespace
+
+void GenerateNormals(std::pmr::vector<ecs::Vertex>& vertices,
+                     std::pmr::vector<uint32_t>& indices, NormalMode mode) {
+  FaceFrames frames = ComputeFaceFrames(vertices, indices);
+  size_t faceCount = indices.size() / 3;
+
+  if (mode == NormalMode::Flat) {
+    std::pmr::vector<ecs::Vertex> flatVertices{vertices.get_allocator()};
+    flatVertices.reserve(faceCount * 3);
+
+    for (size_t face = 0; face < faceCount; ++face) {
+      glm::vec3 n{frames.nx[face], frames.ny[face], frames.nz[face]};
+      for (size_t corner = 0; corner < 3; ++corner) {
+        uint32_t index = indices[(face * 3) + corner];
+        ecs::Vertex v =
+            index < vertices.size() ? vertices[index] : ecs::Vertex{};
+        if (glm::dot(n, n) > 0.0F) {
+          v.normal = n;
+        }
+        flatVertices.push_back(v);
+      }
+    }
+
+    vertices = std::move(flatVertices);
+    indices.resize(faceCount * 3);
+    for (size_t i = 0; i < indices.size(); ++i) {
+      indices[i] = static_cast<uint32_t>(i);
+    }
+    return;
+  }
+
+  std::pmr::vector<glm::vec3> accumulated(vertices.size(), glm::vec3(0.0F),
+                                          core::GetScratchResource());
+  for (size_t face = 0; face < faceCount; ++face) {
+    glm::vec3 n{frames.nx[face], frames.ny[face], frames.nz[face]};
+    const float angles[3] = {frames.angle0[face], frames.angle1[face],
+                             frames.angle2[face]};
+    for (size_t corner = 0; corner < 3; ++corner) {
+      uint32_t index = indices[(face * 3) + corner];
+      if (index < accumulated.size()) {
+        accumulated[index] += n * angles[corner];
+      }
+    }
+  }
+
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    glm::vec3 n = SafeNormalize(accumulated[i]);
+    if (glm::dot(n, n) > 0.0F) {
+      vertices[i].normal = n;
+    }
+  }
+}
+
+void GenerateTangents(std::pmr::vector<ecs::Vertex>& vertices,
+                      std::pmr::vector<uint32_t>& indices) {
+  FaceFrames frames = ComputeFaceFrames(vertices, indices);
+  size_t faceCount = indices.size() / 3;
+  auto* scratch = core::GetScratchResource();
+
+  // Welding merges the corners of mirrored UV islands along their seam.
+  // MikkTSpace keeps the two sides apart, since their opposing tangents
+  // would otherwise cancel out, so corners of mirrored faces move to a
+  // copy of any vertex that regular faces share.
+  constexpr uint8_t kRegular = 1;
+  constexpr uint8_t kMirrored = 2;
+  std::pmr::vector<uint8_t> faceSides(faceCount, 0, scratch);
+  std::pmr::vector<uint8_t> vertexSides(vertices.size(), 0, scratch);
+  for (size_t face = 0; face < faceCount; ++face) {
+    glm::vec3 n{frames.nx[face], frames.ny[face], frames.nz[face]};
+    glm::vec3 t{frames.tx[face], frames.ty[face], frames.tz[face]};
+    glm::vec3 b{frames.bx[face], frames.by[face], frames.bz[face]};
+    if (glm::dot(t, t) == 0.0F) {
+      continue;
+    }
+    faceSides[face] =
+        glm::dot(glm::cross(n, t), b) < 0.0F ? kMirrored : kRegular;
+    for (size_t corner = 0; corner < 3; ++corner) {
+      uint32_t index = indices[(face * 3) + corner];
+      if (index < vertexSides.size()) {
+        vertexSides[index] |= faceSides[face];
+      }
+    }
+  }
+
+  std::pmr::vector<uint32_t> mirroredCopies(scratch);
+  for (size_t i = 0; i < vertexSides.size(); ++i) {
+    if (vertexSides[i] != (kRegular | kMirrored)) {
+      continue;
+    }
+    if (mirroredCopies.empty()) {
+      mirroredCopies.assign(vertexSides.size(), kNoCopy);
+    }
+    mirroredCopies[i] = static_cast<uint32_t>(vertices.size());
+    ecs::Vertex copy = vertices[i];
+    vertices.push_back(copy);
+  }
+  if (!mirroredCopies.empty()) {
+    for (size_t face = 0; face < faceCount; ++face) {
+      if (faceSides[face] != kMirrored) {
+        continue;
+      }
+      for (size_t corner = 0; corner < 3; ++corner) {
+        uint32_t& index = indices[(face * 3) + corner];
+        if (index < mirroredCopies.size() &&
+            mirroredCopies[index] != kNoCopy) {
+          index = mirroredCopies[index];
+        }
+      }
+    }
+  }
+
+  std::pmr::vector<glm::vec3> tangents(vertices.size(), glm::vec3(0.0F),
+                                       scratch);
+  std::pmr::vector<glm::vec3> bitangents(vertices.size(), glm::vec3(0.0F),
+                                         scratch);
+
+  for (size_t face = 0; face < faceCount; ++face) {
+    glm::vec3 t{frames.tx[face], frames.ty[face], frames.tz[face]};
+    glm::vec3 b{frames.bx[face], frames.by[face], frames.bz[face]};
+    const float angles[3] = {frames.angle0[face], frames.angle1[face],
+                             frames.angle2[face]};
+    for (size_t corner = 0; corner < 3; ++corner) {
+      uint32_t index = indices[(face * 3) + corner];
+      if (index < vertices.size()) {
+        tangents[index] += t * angles[corner];
+        bitangents[index] += b * angles[corner];
+      }
+    }
+  }
+
+  // Every vertex gets a tangent, including ones no triangle references
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    glm::vec3 n = vertices[i].normal;
+
+    // Gram-Schmidt orthogonalize against the vertex normal
+    glm::vec3 t = SafeNormalize(tangents[i] - (n * glm::dot(n, tangents[i])));
+
+    if (glm::dot(t, t) == 0.0F) {
+      // No usable UV gradient; any tangent perpendicular to the normal will do
+      glm::vec3 up = std::abs(n.y) < 0.999F ? glm::vec3(0.0F, 1.0F, 0.0F)
+                                            : glm::vec3(1.0F, 0.0F, 0.0F);
+      t = SafeNormalize(glm::cross(n, up));
+      vertices[i].tangent = glm::vec4(t, 1.0F);
+      continue;
+    }
+
+    float handedness =
+        glm::dot(glm::cross(n, t), bitangents[i]) < 0.0F ? -1.0F : 1.0F;
+    vertices[i].tangent = glm::vec4(t, handedness);
+  }
+}
+
+}  // namespace resource
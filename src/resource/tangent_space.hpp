@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "ecs/components.hpp"
+
+namespace resource {
+
+enum class NormalMode : uint8_t {
+  Flat,    // Face normals, triangles stop sharing vertices
+  Smooth,  // Angle-weighted average over shared vertices
+};
+
+/**
+ * @brief Generate vertex normals for an indexed triangle list.
+ *
+ * Flat mode gives every triangle its own three vertices, so both arrays are
+ * rewritten; weld afterwards to share coplanar corners again. This is the
+ * behaviour glTF requires when a primitive has no NORMAL attribute.
+ */
+void GenerateNormals(std::pmr::vector<ecs::Vertex>& vertices,
+                     std::pmr::vector<uint32_t>& indices, NormalMode mode);
+
+/**
+ * @brief Generate per-vertex tangents with handedness in tangent.w.
+ *
+ * Follows the MikkTSpace conventions glTF expects: per-face tangent and
+ * bitangent are taken from the UV gradients, normalized, weighted by corner
+ * angle, projected onto the vertex normal, and w is chosen so that
+ * bitangent = cross(normal, tangent.xyz) * w. The input should already be
+ * welded; vertices shared by mirrored and regular faces are split, as
+ * MikkTSpace does, so vertices may be appended and indices remapped.
+ */
+void GenerateTangents(std::pmr::vector<ecs::Vertex>& vertices,
+                      std::pmr::vector<uint32_t>& indices);
+
+}  // namespace resource
@@ -0,0 +1,508 @@
+#include "resource/texture_compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include "core/parallel.hpp"
+
+namespace resource {
+namespace {
+constexpr uint32_t kChannels = 4;
+constexpr uint32_t kBlockDim = 4;
+constexpr uint32_t kBlockTexels = kBlockDim * kBlockDim;
+
+using Texel = std::array<uint8_t, kChannels>;
+using Block = std::array<Texel, kBlockTexels>;
+using Color = std::array<float, kChannels>;
+using Weights = std::array<float, kBlockTexels>;
+
+Block LoadBlock(const uint8_t* level, uint32_t width, uint32_t height,
+                uint32_t blockX, uint32_t blockY) {
+  Block block{};
+  for (uint32_t y = 0; y < kBlockDim; ++y) {
+    uint32_t srcY = std::min((blockY * kBlockDim) + y, height - 1);
+    for (uint32_t x = 0; x < kBlockDim; ++x) {
+      uint32_t srcX = std::min((blockX * kBlockDim) + x, width - 1);
+      std::memcpy(
+          block[(y * kBlockDim) + x].data(),
+          level + ((static_cast<size_t>(srcY) * width + srcX) * kChannels),
+          kChannels);
+    }
+  }
+  return block;
+}
+
+uint32_t SquaredError(const Texel& a, const Texel& b, uint32_t channels) {
+  uint32_t error = 0;
+  for (uint32_t c = 0; c < channels; ++c) {
+    int32_t d = static_cast<int32_t>(a[c]) - static_cast<int32_t>(b[c]);
+    error += static_cast<uint32_t>(d * d);
+  }
+  return error;
+}
+
+struct Nearest {
+  uint32_t index{0};
+  uint32_t error{std::numeric_limits<uint32_t>::max()};
+};
+
+Nearest FindNearest(const Texel& texel, std::span<const Texel> palette,
+                    uint32_t channels) {
+  Nearest best;
+  for (uint32_t i = 0; i < palette.size(); ++i) {
+    uint32_t error = SquaredError(texel, palette[i], channels);
+    if (error < best.error) {
+      best = {.index = i, .error = error};
+    }
+  }
+  return best;
+}
+
+// Segment through the block along the principal axis of its texels, ending
+// at the extreme projections; only the first `channels` channels take part
+struct Line {
+  Color lo{};
+  Color hi{};
+};
+
+Line FitLine(const Block& block, uint32_t channels) {
+  Color mean{};
+  for (const Texel& texel : block) {
+    for (uint32_t c = 0; c < channels; ++c) {
+      mean[c] += static_cast<float>(texel[c]);
+    }
+  }
+  for (uint32_t c = 0; c < channels; ++c) {
+    mean[c] /= static_cast<float>(kBlockTexels);
+  }
+
+  std::array<Color, kChannels> covariance{};
+  for (const Texel& texel : block) {
+    for (uint32_t i = 0; i < channels; ++i) {
+      float di = static_cast<float>(texel[i]) - mean[i];
+      for (uint32_t j = 0; j < channels; ++j) {
+        covariance[i][j] += di * (static_cast<float>(texel[j]) - mean[j]);
+      }
+    }
+  }
+
+  // Power iteration, seeded with the channel that varies most
+  uint32_t seed = 0;
+  for (uint32_t c = 1; c < channels; ++c) {
+    if (covariance[c][c] > covariance[seed][seed]) {
+      seed = c;
+    }
+  }
+  Color axis{};
+  axis[seed] = 1.0F;
+  for (int iteration = 0; iteration < 8; ++iteration) {
+    Color next{};
+    float lengthSq = 0.0F;
+    for (uint32_t i = 0; i < channels; ++i) {
+      for (uint32_t j = 0; j < channels; ++j) {
+        next[i] += covariance[i][j] * axis[j];
+      }
+      lengthSq += next[i] * next[i];
+    }
+    if (lengthSq < 1e-12F) {
+      break;
+    }
+    float invLength = 1.0F / std::sqrt(lengthSq);
+    for (uint32_t c = 0; c < channels; ++c) {
+      axis[c] = next[c] * invLength;
+    }
+  }
+
+  float minT = 0.0F;
+  float maxT = 0.0F;
+  for (const Texel& texel : block) {
+    float t = 0.0F;
+    for (uint32_t c = 0; c < channels; ++c) {
+      t += (static_cast<float>(texel[c]) - mean[c]) * axis[c];
+    }
+    minT = std::min(minT, t);
+    maxT = std::max(maxT, t);
+  }
+
+  Line line;
+  for (uint32_t c = 0; c < channels; ++c) {
+    line.lo[c] = std::clamp(mean[c] + (axis[c] * minT), 0.0F, 255.0F);
+    line.hi[c] = std::clamp(mean[c] + (axis[c] * maxT), 0.0F, 255.0F);
+  }
+  return line;
+}
+
+// Least-squares endpoints for fixed interpolation weights (0 = lo, 1 = hi)
+Line RefineLine(const Block& block, const Weights& weights, uint32_t channels,
+                const Line& fallback) {
+  float a = 0.0F;
+  float b = 0.0F;
+  float c = 0.0F;
+  Color x0{};
+  Color x1{};
+  for (uint32_t i = 0; i < kBlockTexels; ++i) {
+    float w = weights[i];
+    a += (1.0F - w) * (1.0F - w);
+    b += w * (1.0F - w);
+    c += w * w;
+    for (uint32_t ch = 0; ch < channels; ++ch) {
+      float value = static_cast<float>(block[i][ch]);
+      x0[ch] += (1.0F - w) * value;
+      x1[ch] += w * value;
+    }
+  }
+
+  float det = (a * c) - (b * b);
+  if (std::abs(det) < 1e-6F) {
+    return fallback;
+  }
+
+  Line line;
+  for (uint32_t ch = 0; ch < channels; ++ch) {
+    line.lo[ch] = std::clamp(((c * x0[ch]) - (b * x1[ch])) / det, 0.0F, 255.0F);
+    line.hi[ch] = std::clamp(((a * x1[ch]) - (b * x0[ch])) / det, 0.0F, 255.0F);
+  }
+  return line;
+}
+
+class BitWriter {
+ public:
+  explicit BitWriter(uint8_t* out) : out_{out} {}
+
+  void Write(uint32_t value, uint32_t bits) {
+    for (uint32_t i = 0; i < bits; ++i, ++position_) {
+      if ((value >> i) & 1U) {
+        out_[position_ / 8] |= static_cast<uint8_t>(1U << (position_ % 8));
+      }
+    }
+  }
+
+ private:
+  uint8_t* out_;
+  uint32_t position_{0};
+};
+
+// ----------------------------------------------------------------------------
+// BC1 color and BC4 single-channel blocks (BC3 and BC5 combine these)
+// ----------------------------------------------------------------------------
+
+uint16_t PackRgb565(const Color& color) {
+  auto quantize = [](float value, float maxValue) {
+    return static_cast<uint16_t>(std::lround(value * maxValue / 255.0F));
+  };
+  return static_cast<uint16_t>((quantize(color[0], 31.0F) << 11) |
+                               (quantize(color[1], 63.0F) << 5) |
+                               quantize(color[2], 31.0F));
+}
+
+Texel UnpackRgb565(uint16_t value) {
+  uint32_t r = (value >> 11) & 31U;
+  uint32_t g = (value >> 5) & 63U;
+  uint32_t b = value & 31U;
+  return {static_cast<uint8_t>((r << 3) | (r >> 2)),
+          static_cast<uint8_t>((g << 2) | (g >> 4)),
+          static_cast<uint8_t>((b << 3) | (b >> 2)), 255};
+}
+
+Texel Lerp(const Texel& a, const Texel& b, uint32_t weightA, uint32_t weightB,
+           uint32_t divisor) {
+  Texel result{};
+  for (uint32_t c = 0; c < kChannels; ++c) {
+    result[c] = static_cast<uint8_t>(
+        ((weightA * a[c]) + (weightB * b[c]) + (divisor / 2)) / divisor);
+  }
+  return result;
+}
+
+void EncodeBc1Color(const Block& block, uint8_t* out) {
+  // Interpolation weight of each 2-bit index, measured from color0
+  constexpr std::array<float, 4> kWeights{0.0F, 1.0F, 1.0F / 3.0F,
+                                          2.0F / 3.0F};
+
+  Line line = FitLine(block, 3);
+  uint32_t bestError = std::numeric_limits<uint32_t>::max();
+
+  for (int pass = 0; pass < 2; ++pass) {
+    uint16_t color0 = PackRgb565(line.hi);
+    uint16_t color1 = PackRgb565(line.lo);
+    // color0 > color1 selects the four-color mode
+    if (color0 < color1) {
+      std::swap(color0, color1);
+    }
+
+    std::array<Texel, 4> palette{};
+    palette[0] = UnpackRgb565(color0);
+    palette[1] = UnpackRgb565(color1);
+    palette[2] = Lerp(palette[0], palette[1], 2, 1, 3);
+    palette[3] = Lerp(palette[0], palette[1], 1, 2, 3);
+
+    uint32_t indices = 0;
+    uint32_t error = 0;
+    Weights weights{};
+    for (uint32_t i = 0; i < kBlockTexels; ++i) {
+      Nearest nearest = color0 == color1 ? Nearest{.index = 0, .error = 0}
+                                         : FindNearest(block[i], palette, 3);
+      indices |= nearest.index << (i * 2);
+      error += nearest.error;
+      weights[i] = kWeights[nearest.index];
+    }
+
+    if (error < bestError) {
+      bestError = error;
+      out[0] = static_cast<uint8_t>(color0 & 0xFFU);
+      out[1] = static_cast<uint8_t>(color0 >> 8);
+      out[2] = static_cast<uint8_t>(color1 & 0xFFU);
+      out[3] = static_cast<uint8_t>(color1 >> 8);
+      for (uint32_t b = 0; b < 4; ++b) {
+        out[4 + b] = static_cast<uint8_t>(indices >> (b * 8));
+      }
+    }
+
+    // RefineLine treats lo as the weight-0 endpoint, which is color0
+    Line refined = RefineLine(block, weights, 3, line);
+    line = {.lo = refined.hi, .hi = refined.lo};
+  }
+}
+
+void EncodeBc4Channel(const Block& block, uint32_t channel, uint8_t* out) {
+  uint8_t lo = 255;
+  uint8_t hi = 0;
+  for (const Texel& texel : block) {
+    lo = std::min(lo, texel[channel]);
+    hi = std::max(hi, texel[channel]);
+  }
+
+  // red0 > red1 selects the eight-value mode
+  std::array<Texel, 8> palette{};
+  palette[0][0] = hi;
+  palette[1][0] = lo;
+  for (uint32_t i = 2; i < palette.size(); ++i) {
+    palette[i][0] =
+        static_cast<uint8_t>((((8 - i) * hi) + ((i - 1) * lo) + 3) / 7);
+  }
+
+  uint64_t indices = 0;
+  if (hi != lo) {
+    for (uint32_t i = 0; i < kBlockTexels; ++i) {
+      Texel value{block[i][channel]};
+      uint64_t index = FindNearest(value, palette, 1).index;
+      indices |= index << (i * 3);
+    }
+  }
+
+  out[0] = hi;
+  out[1] = lo;
+  for (uint32_t b = 0; b < 6; ++b) {
+    out[2 + b] = static_cast<uint8_t>(indices >> (b * 8));
+  }
+}
+
+void EncodeBc1(const Block& block, uint8_t* out) { EncodeBc1Color(block, out); }
+
+void EncodeBc3(const Block& block, uint8_t* out) {
+  EncodeBc4Channel(block, 3, out);
+  EncodeBc1Color(block, out + 8);
+}
+
+void EncodeBc4(const Block& block, uint8_t* out) {
+  EncodeBc4Channel(block, 0, out);
+}
+
+void EncodeBc5(const Block& block, uint8_t* out) {
+  EncodeBc4Channel(block, 0, out);
+  EncodeBc4Channel(block, 1, out + 8);
+}
+
+// ----------------------------------------------------------------------------
+// BC7 (mode 6 only: one subset, RGBA 7.7.7.7 endpoints with a p-bit each,
+// 4-bit indices)
+// ----------------------------------------------------------------------------
+
+constexpr std::array<uint32_t, 16> kBc7Weights4{
+    0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct Bc7Endpoint {
+  std::array<uint32_t, kChannels> value{};  // 7 bits per channel
+  uint32_t pbit{0};
+
+  [[nodiscard]] Texel Decode() const {
+    Texel texel{};
+    for (uint32_t c = 0; c < kChannels; ++c) {
+      texel[c] = static_cast<uint8_t>((value[c] << 1) | pbit);
+    }
+    return texel;
+  }
+};
+
+Bc7Endpoint QuantizeBc7Endpoint(const Color& color, bool opaque) {
+  Bc7Endpoint best;
+  float bestError = std::numeric_limits<float>::max();
+  // Opaque blocks keep p = 1 so alpha decodes to exactly 255
+  for (uint32_t pbit = opaque ? 1 : 0; pbit < 2; ++pbit) {
+    Bc7Endpoint candidate{.pbit = pbit};
+    float error = 0.0F;
+    for (uint32_t c = 0; c < kChannels; ++c) {
+      float scaled = (color[c] - static_cast<float>(pbit)) / 2.0F;
+      candidate.value[c] = static_cast<uint32_t>(
+          std::clamp(std::lround(scaled), 0L, 127L));
+      float d = static_cast<float>((candidate.value[c] << 1) | pbit) - color[c];
+      error += d * d;
+    }
+    if (error < bestError) {
+      bestError = error;
+      best = candidate;
+    }
+  }
+  return best;
+}
+
+void EncodeBc7(const Block& block, uint8_t* out) {
+  bool opaque = std::ranges::all_of(
+      block, [](const Texel& texel) { return texel[3] == 255; });
+
+  Line line = FitLine(block, kChannels);
+  uint32_t bestError = std::numeric_limits<uint32_t>::max();
+  std::array<Bc7Endpoint, 2> bestEndpoints{};
+  std::array<uint32_t, kBlockTexels> bestIndices{};
+
+  for (int pass = 0; pass < 2; ++pass) {
+    std::array<Bc7Endpoint, 2> endpoints{QuantizeBc7Endpoint(line.lo, opaque),
+                                         QuantizeBc7Endpoint(line.hi, opaque)};
+    Texel e0 = endpoints[0].Decode();
+    Texel e1 = endpoints[1].Decode();
+
+    std::array<Texel, 16> palette{};
+    for (uint32_t i = 0; i < palette.size(); ++i) {
+      palette[i] = Lerp(e0, e1, 64 - kBc7Weights4[i], kBc7Weights4[i], 64);
+    }
+
+    std::array<uint32_t, kBlockTexels> indices{};
+    uint32_t error = 0;
+    Weights weights{};
+    for (uint32_t i = 0; i < kBlockTexels; ++i) {
+      Nearest nearest = FindNearest(block[i], palette, kChannels);
+      indices[i] = nearest.index;
+      error += nearest.error;
+      weights[i] = static_cast<float>(kBc7Weights4[nearest.index]) / 64.0F;
+    }
+
+    if (error < bestError) {
+      bestError = error;
+      bestEndpoints = endpoints;
+      bestIndices = indices;
+    }
+
+    line = RefineLine(block, weights, kChannels, line);
+  }
+
+  // The first index is stored without its top bit, so it must be below 8
+  if (bestIndices[0] >= 8) {
+    std::swap(bestEndpoints[0], bestEndpoints[1]);
+    for (uint32_t& index : bestIndices) {
+      index = 15 - index;
+    }
+  }
+
+  std::memset(out, 0, 16);
+  BitWriter writer{out};
+  writer.Write(1U << 6, 7);  // Mode 6
+  for (uint32_t c = 0; c < kChannels; ++c) {
+    writer.Write(bestEndpoints[0].value[c], 7);
+    writer.Write(bestEndpoints[1].value[c], 7);
+  }
+  writer.Write(bestEndpoints[0].pbit, 1);
+  writer.Write(bestEndpoints[1].pbit, 1);
+  for (uint32_t i = 0; i < kBlockTexels; ++i) {
+    writer.Write(bestIndices[i], i == 0 ? 3 : 4);
+  }
+}
+
+using BlockEncoder = void (*)(const Block&, uint8_t*);
+
+BlockEncoder GetBlockEncoder(rhi::Format format) {
+  switch (format) {
+    case rhi::Format::Bc1RgbaUnorm:
+      return EncodeBc1;
+    case rhi::Format::Bc3RgbaUnorm:
+      return EncodeBc3;
+    case rhi::Format::Bc4Unorm:
+      return EncodeBc4;
+    case rhi::Format::Bc5Unorm:
+      return EncodeBc5;
+    case rhi::Format::Bc7Unorm:
+      return EncodeBc7;
+    default:
+      return nullptr;
+  }
+}
+}  // namespace
+
+std::vector<uint8_t> CompressMipChain(std::span<const uint8_t> chain,
+                                      uint32_t width, uint32_t height,
+                                      uint32_t mipLevels, rhi::Format format) {
+  BlockEncoder encoder = GetBlockEncoder(format);
+  if (encoder == nullptr) {
+    return {};
+  }
+  uint32_t blockSize = rhi::GetFormatInfo(format).blockSize;
+
+  // One job per row of blocks, across every level
+  struct RowJob {
+    const uint8_t* src;
+    uint8_t* dst;
+    uint32_t width;
+    uint32_t height;
+    uint32_t blockY;
+  };
+
+  size_t srcSize = 0;
+  size_t dstSize = 0;
+  for (uint32_t level = 0; level < mipLevels; ++level) {
+    srcSize += rhi::GetMipLevelSize(rhi::Format::R8G8B8A8Unorm, width, height,
+                                    level);
+    dstSize += rhi::GetMipLevelSize(format, width, height, level);
+  }
+  if (chain.size() < srcSize) {
+    return {};
+  }
+
+  std::vector<uint8_t> compressed(dstSize);
+  std::vector<RowJob> jobs;
+  size_t srcOffset = 0;
+  size_t dstOffset = 0;
+  for (uint32_t level = 0; level < mipLevels; ++level) {
+    uint32_t levelWidth = std::max(1U, width >> level);
+    uint32_t levelHeight = std::max(1U, height >> level);
+    uint32_t blocksX = (levelWidth + kBlockDim - 1) / kBlockDim;
+    uint32_t blocksY = (levelHeight + kBlockDim - 1) / kBlockDim;
+    for (uint32_t y = 0; y < blocksY; ++y) {
+      jobs.push_back({
+          .src = chain.data() + srcOffset,
+          .dst = compressed.data() + dstOffset +
+                 (static_cast<size_t>(y) * blocksX * blockSize),
+          .width = levelWidth,
+          .height = levelHeight,
+          .blockY = y,
+      });
+    }
+    srcOffset += static_cast<size_t>(levelWidth) * levelHeight * kChannels;
+    dstOffset += static_cast<size_t>(blocksX) * blocksY * blockSize;
+  }
+
+  core::ParallelFor(jobs.size(), [&](size_t j) {
+    const RowJob& job = jobs[j];
+    uint32_t blocksX = (job.width + kBlockDim - 1) / kBlockDim;
+    for (uint32_t x = 0; x < blocksX; ++x) {
+      Block block = LoadBlock(job.src, job.width, job.height, x, job.blockY);
+      encoder(block, job.dst + (static_cast<size_t>(x) * blockSize));
+    }
+  });
+
+  return compressed;
+}
+
+}  // namespace resource
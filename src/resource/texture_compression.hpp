@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "rhi/types.hpp"
+
+namespace resource {
+
+/**
+ * @brief Which block formats imported textures are encoded into.
+ *
+ * Normal maps always become BC5 (the shader rebuilds Z) and textures used
+ * only for occlusion become BC4.
+ */
+enum class TextureCompression : uint8_t {
+  None,     // Keep RGBA8
+  Fast,     // BC1 for opaque and BC3 for translucent color
+  Quality,  // BC7 for all color
+};
+
+/**
+ * @brief Encode a tightly packed RGBA8 mip chain into a BCn format.
+ *
+ * Blocks are encoded across all hardware threads. Bc4Unorm keeps only the
+ * red channel and Bc5Unorm red and green; Bc1RgbaUnorm drops alpha.
+ * Blocks that hang over the edge of a level repeat its last row or column.
+ *
+ * @param chain Levels as produced by GenerateMipChain
+ * @param format Bc1RgbaUnorm, Bc3RgbaUnorm, Bc4Unorm, Bc5Unorm or Bc7Unorm
+ * @return Encoded levels, largest first and tightly packed
+ */
+std::vector<uint8_t> CompressMipChain(std::span<const uint8_t> chain,
+                                      uint32_t width, uint32_t height,
+                                      uint32_t mipLevels, rhi::Format format);
+
+}  // namespace resource
@@ -1,13 +1,16 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
 
 #include "ecs/components.hpp"
+#include "resource/handle.hpp"
 #include "rhi/buffer.hpp"
 #include "rhi/texture.hpp"
 
@@ -28,6 +31,9 @@ struct Mesh {
   std::string name;
   std::shared_ptr<rhi::Buffer> vertexBuffer;
   std::shared_ptr<rhi::Buffer> indexBuffer;
+  rhi::IndexType indexType{rhi::IndexType::Uint32};
+  ecs::VertexFormat vertexFormat{ecs::VertexFormat::Float};
+  glm::mat4 positionDequantization{1.0F};
   std::vector<MeshPrimitive> primitives;
   ecs::BoundingBoxComponent bounds;
 };
@@ -62,16 +68,40 @@ struct Material {
 // ============================================================================
 // Texture Resource
 // ============================================================================
+// Every level of a streamed texture; the spans view imported or mapped bytes
+// kept alive by `owner`
+struct TextureMipChain {
+  rhi::Format format{rhi::Format::R8G8B8A8Unorm};
+  uint32_t width{0};
+  uint32_t height{0};
+  std::vector<std::span<const std::byte>> levels;  // Base level first
+  std::shared_ptr<const void> owner;
+};
+
 struct TextureResource {
   std::string name;
   std::shared_ptr<rhi::Texture> texture;
   uint32_t width{0};
   uint32_t height{0};
+  // Level of the full chain that is level 0 of `texture`
+  uint32_t residentMip{0};
+  // Set when the renderer streams in the levels above residentMip
+  std::shared_ptr<const TextureMipChain> mipChain;
+  // TextureData::ComputeContentHash; equal hashes share `texture`
+  uint64_t contentHash{0};
 };
 
 // ============================================================================
 // Scene Node
 // ============================================================================
+
+// One copy of a node's mesh, relative to the node (EXT_mesh_gpu_instancing)
+struct NodeInstance {
+  glm::vec3 translation{0.0F};
+  glm::quat rotation{1.0F, 0.0F, 0.0F, 0.0F};
+  glm::vec3 scale{1.0F};
+};
+
 struct SceneNode {
   std::string name;
   glm::vec3 translation{0.0F};
@@ -82,6 +112,9 @@ struct SceneNode {
   int32_t cameraIndex{-1};
   int32_t lightIndex{-1};
 
+  // When not empty, the mesh is drawn once per instance instead of once
+  std::vector<NodeInstance> instances;
+
   std::vector<uint32_t> children;
 };
 
@@ -129,13 +162,4 @@ struct Model {
   std::vector<uint32_t> rootNodes;  // Scene root node indices
 };
 
-// ============================================================================
-// Handle types for resource references
-// ============================================================================
-using ModelHandle = size_t;
-using TextureHandle = size_t;
-using MeshHandle = size_t;
-
-constexpr size_t kInvalidHandle = ~0ULL;
-
 }  // namespace resource
@@ -0,0 +1,46 @@
+#include "resource/vertex_quantization.hpp"
+
+#include <limits>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+namespace resource {
+namespace {
+// Keeps flat meshes from dividing by a zero extent
+constexpr float kMinExtent = 1e-6F;
+}  // namespace
+
+glm::mat4 QuantizeVertices(std::span<const ecs::Vertex> vertices,
+                           std::pmr::vector<ecs::QuantizedVertex>& quantized) {
+  quantized.resize(vertices.size());
+  if (vertices.empty()) {
+    return glm::mat4{1.0F};
+  }
+
+  glm::vec3 minPos{std::numeric_limits<float>::max()};
+  glm::vec3 maxPos{std::numeric_limits<float>::lowest()};
+  for (const auto& v : vertices) {
+    minPos = glm::min(minPos, v.position);
+    maxPos = glm::max(maxPos, v.position);
+  }
+
+  glm::vec3 center = (minPos + maxPos) * 0.5F;
+  glm::vec3 extent = glm::max((maxPos - minPos) * 0.5F, glm::vec3{kMinExtent});
+  glm::vec3 invExtent = 1.0F / extent;
+
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    const auto& v = vertices[i];
+    auto& q = quantized[i];
+    q.position =
+        glm::packSnorm4x16(glm::vec4((v.position - center) * invExtent, 0.0F));
+    q.normal = glm::packSnorm4x8(glm::vec4(v.normal, 0.0F));
+    q.tangent = glm::packSnorm4x8(v.tangent);
+    q.texCoord = glm::packHalf2x16(v.texCoord);
+    q.color = glm::packUnorm4x8(v.color);
+  }
+
+  return glm::scale(glm::translate(glm::mat4{1.0F}, center), extent);
+}
+
+}  // namespace resource
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ecs/components.hpp"
+
+namespace resource {
+
+/**
+ * @brief Pack float vertices into the compact ecs::QuantizedVertex layout.
+ *
+ * Positions are stored as snorm16 relative to the vertices' bounding box.
+ *
+ * @return Matrix mapping the stored positions back to mesh space
+ */
+glm::mat4 QuantizeVertices(std::span<const ecs::Vertex> vertices,
+                           std::pmr::vector<ecs::QuantizedVertex>& quantized);
+
+}  // namespace resource
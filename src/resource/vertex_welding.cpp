@@ -0,0 +1,107 @@
+#include "resource/vertex_welding.hpp"
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <memory_resource>
+#include <utility>
+
+#include "core/arena.hpp"
+
+namespace resource {
+namespace {
+
+constexpr size_t kFloatsPerVertex = sizeof(ecs::Vertex) / sizeof(float);
+constexpr uint32_t kEmptySlot = std::numeric_limits<uint32_t>::max();
+
+static_assert(sizeof(ecs::Vertex) == kFloatsPerVertex * sizeof(float),
+              "Vertex must be tightly packed floats for welding");
+
+using VertexKey = std::array<uint32_t, kFloatsPerVertex>;
+
+VertexKey MakeKey(const ecs::Vertex& vertex, float invEpsilon) {
+  const auto* values = std::bit_cast<const float*>(&vertex);
+
+  VertexKey key{};
+  for (size_t i = 0; i < kFloatsPerVertex; ++i) {
+    float value = values[i];
+    if (invEpsilon > 0.0F) {
+      value = std::round(value * invEpsilon);
+    }
+    // Fold -0.0 into 0.0 so signed zeros still weld
+    key[i] = value == 0.0F ? 0U : std::bit_cast<uint32_t>(value);
+  }
+  return key;
+}
+
+uint64_t HashKey(const VertexKey& key) {
+  // FNV-1a over 32-bit words with a final avalanche
+  uint64_t hash = 14695981039346656037ULL;
+  for (uint32_t word : key) {
+    hash = (hash ^ word) * 1099511628211ULL;
+  }
+  hash ^= hash >> 33U;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33U;
+  return hash;
+}
+
+}  // namespace
+
+size_t WeldVertices(std::pmr::vector<ecs::Vertex>& vertices,
+                    std::pmr::vector<uint32_t>& indices, float epsilon) {
+  if (vertices.empty() || indices.empty()) {
+    return vertices.size();
+  }
+
+  const float invEpsilon = epsilon > 0.0F ? 1.0F / epsilon : 0.0F;
+
+  // Open-addressing table sized to keep the load factor under one half
+  size_t capacity = std::bit_ceil(vertices.size() * 2);
+  size_t mask = capacity - 1;
+  auto* scratch = core::GetScratchResource();
+  std::pmr::vector<uint32_t> slots(capacity, kEmptySlot, scratch);
+
+  std::pmr::vector<VertexKey> uniqueKeys{scratch};
+  std::pmr::vector<ecs::Vertex> uniqueVertices{vertices.get_allocator()};
+  std::pmr::vector<uint32_t> remap(vertices.size(), scratch);
+  uniqueKeys.reserve(vertices.size());
+  uniqueVertices.reserve(vertices.size());
+
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    VertexKey key = MakeKey(vertices[i], invEpsilon);
+    size_t slot = HashKey(key) & mask;
+
+    while (slots[slot] != kEmptySlot && uniqueKeys[slots[slot]] != key) {
+      slot = (slot + 1) & mask;
+    }
+
+    if (slots[slot] == kEmptySlot) {
+      slots[slot] = static_cast<uint32_t>(uniqueVertices.size());
+      uniqueKeys.push_back(key);
+      uniqueVertices.push_back(vertices[i]);
+    }
+    remap[i] = slots[slot];
+  }
+
+  // Compact in place, dropping triangles that reference a missing vertex
+  size_t kept = 0;
+  for (size_t i = 0; i + 3 <= indices.size(); i += 3) {
+    uint32_t i0 = indices[i + 0];
+    uint32_t i1 = indices[i + 1];
+    uint32_t i2 = indices[i + 2];
+    if (i0 >= remap.size() || i1 >= remap.size() || i2 >= remap.size()) {
+      continue;
+    }
+    indices[kept++] = remap[i0];
+    indices[kept++] = remap[i1];
+    indices[kept++] = remap[i2];
+  }
+  indices.resize(kept);
+
+  vertices = std::move(uniqueVertices);
+  return vertices.size();
+}
+
+}  // namespace resource
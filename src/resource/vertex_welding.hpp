@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "ecs/components.hpp"
+
+namespace resource {
+
+/**
+ * @brief Merge duplicate vertices of an indexed primitive in place.
+ *
+ * Vertices are compared attribute by attribute. With a zero epsilon only
+ * bit-identical records are merged (treating -0.0 and 0.0 as equal); a
+ * positive epsilon snaps every attribute to a grid of that size first, so
+ * vertices that differ only by export noise collapse together. Indices are
+ * remapped to the surviving vertices, which keep their first-seen order.
+ * Triangles that reference a vertex past the end are dropped, as is a
+ * trailing incomplete triangle.
+ *
+ * @return Number of vertices after welding
+ */
+size_t WeldVertices(std::pmr::vector<ecs::Vertex>& vertices,
+                    std::pmr::vector<uint32_t>& indices, float epsilon = 0.0F);
+
+}  // namespace resource
@@ -0,0 +1,495 @@
+#include "resource/world_streamer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <string>
+#include <unordered_set>
+
+#include "io/mapped_file.hpp"
+#include "logger.hpp"
+
+namespace resource {
+namespace {
+constexpr std::array<char, 8> kManifestMagic{'V', 'K', 'R', 'W',
+                                             'R', 'L', 'D', '\0'};
+constexpr const char* kManifestName = "world.vkrworld";
+
+struct ManifestHeader {
+  std::array<char, 8> magic{};
+  uint32_t version{0};
+  uint32_t cellCount{0};
+  float cellSize{0.0F};
+  uint32_t _padding{0};
+};
+static_assert(sizeof(ManifestHeader) == 24);
+
+struct CellRecord {
+  int32_t x{0};
+  int32_t z{0};
+  glm::vec3 min{0.0F};
+  glm::vec3 max{0.0F};
+};
+static_assert(sizeof(CellRecord) == 32);
+
+// Axis-aligned bounds of a box after a transform
+ecs::BoundingBoxComponent TransformBounds(
+    const ecs::BoundingBoxComponent& bounds, const glm::mat4& matrix) {
+  ecs::BoundingBoxComponent result{
+      .min = glm::vec3(std::numeric_limits<float>::max()),
+      .max = glm::vec3(std::numeric_limits<float>::lowest()),
+  };
+  for (uint32_t corner = 0; corner < 8; ++corner) {
+    glm::vec3 point{(corner & 1U) != 0 ? bounds.max.x : bounds.min.x,
+                    (corner & 2U) != 0 ? bounds.max.y : bounds.min.y,
+                    (corner & 4U) != 0 ? bounds.max.z : bounds.min.z};
+    glm::vec3 world = glm::vec3(matrix * glm::vec4(point, 1.0F));
+    result.min = glm::min(result.min, world);
+    result.max = glm::max(result.max, world);
+  }
+  return result;
+}
+
+struct PartitionCell {
+  std::vector<entt::entity> entities;
+  ecs::BoundingBoxComponent bounds{
+      .min = glm::vec3(std::numeric_limits<float>::max()),
+      .max = glm::vec3(std::numeric_limits<float>::lowest()),
+  };
+};
+
+// Copy the static parts of a cell's entities into a registry of their own,
+// with the model references their materials were registered through
+void BuildCellRegistry(
+    const entt::registry& registry, const PartitionCell& cell,
+    const std::vector<const ecs::ModelReferenceComponent*>& references,
+    entt::registry& cellRegistry) {
+  std::vector<ModelHandle> models;
+  std::unordered_set<uint32_t> materials;
+  for (auto entity : cell.entities) {
+    auto copy = cellRegistry.create();
+    const auto& mesh = registry.get<ecs::MeshComponent>(entity);
+    cellRegistry.emplace<ecs::MeshComponent>(copy, mesh);
+    cellRegistry.emplace<ecs::WorldTransformComponent>(
+        copy, registry.get<ecs::WorldTransformComponent>(entity));
+    cellRegistry.emplace<ecs::BoundingBoxComponent>(
+        copy, registry.get<ecs::BoundingBoxComponent>(entity));
+    cellRegistry.emplace<ecs::RenderableComponent>(
+        copy, registry.get<ecs::RenderableComponent>(entity));
+    if (const auto* material =
+            registry.try_get<ecs::MaterialComponent>(entity)) {
+      cellRegistry.emplace<ecs::MaterialComponent>(copy, *material);
+      materials.insert(material->materialIndices.begin(),
+                       material->materialIndices.end());
+    }
+    if (const auto* instances =
+            registry.try_get<ecs::MeshInstancesComponent>(entity)) {
+      cellRegistry.emplace<ecs::MeshInstancesComponent>(copy, *instances);
+    }
+    if (std::ranges::find(models, mesh.model) == models.end()) {
+      models.push_back(mesh.model);
+    }
+  }
+
+  for (ModelHandle model : models) {
+    const ecs::ModelReferenceComponent* fallback = nullptr;
+    bool copied = false;
+    for (const auto* reference : references) {
+      if (reference->model != model) {
+        continue;
+      }
+      fallback = fallback != nullptr ? fallback : reference;
+      if (std::ranges::any_of(reference->materialIndices,
+                              [&materials](uint32_t index) {
+                                return materials.contains(index);
+                              })) {
+        cellRegistry.emplace<ecs::ModelReferenceComponent>(
+            cellRegistry.create(), *reference);
+        copied = true;
+      }
+    }
+    // Models of meshes with default materials still need to be loaded
+    if (!copied && fallback != nullptr) {
+      cellRegistry.emplace<ecs::ModelReferenceComponent>(
+          cellRegistry.create(), *fallback);
+    }
+  }
+}
+
+bool WriteManifest(const std::filesystem::path& path, float cellSize,
+                   const std::vector<CellRecord>& records) {
+  ManifestHeader header{
+      .magic = kManifestMagic,
+      .version = kWorldManifestVersion,
+      .cellCount = static_cast<uint32_t>(records.size()),
+      .cellSize = cellSize,
+      ._padding = 0,
+  };
+  std::ofstream file{path, std::ios::binary | std::ios::trunc};
+  if (!file) {
+    LOG_ERROR("Failed to create world manifest: {}", path.string());
+    return false;
+  }
+  file.write(std::bit_cast<const char*>(&header), sizeof(header));
+  file.write(std::bit_cast<const char*>(records.data()),
+             static_cast<std::streamsize>(sizeof(CellRecord) *
+                                          records.size()));
+  if (!file.good()) {
+    LOG_ERROR("Failed to write world manifest: {}", path.string());
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+std::filesystem::path WorldManifest::GetCellPath(const WorldCell& cell) const {
+  return directory / ("cell_" + std::to_string(cell.x) + "_" +
+                      std::to_string(cell.z) + ".vkrscene");
+}
+
+bool PartitionScene(const entt::registry& registry,
+                    const ResourceManager& resources, float cellSize,
+                    const std::filesystem::path& directory) {
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  if (error) {
+    LOG_ERROR("Failed to create world directory {} ({})", directory.string(),
+              error.message());
+    return false;
+  }
+
+  // Ordered by cell so the manifest comes out the same for the same scene
+  std::map<std::pair<int32_t, int32_t>, PartitionCell> cells;
+  size_t meshCount = 0;
+  auto view = registry.view<const ecs::MeshComponent,
+                            const ecs::WorldTransformComponent,
+                            const ecs::BoundingBoxComponent,
+                            const ecs::RenderableComponent>();
+  for (auto entity : view) {
+    const auto& world = view.get<const ecs::WorldTransformComponent>(entity);
+    const auto& bounds = view.get<const ecs::BoundingBoxComponent>(entity);
+    ecs::BoundingBoxComponent worldBounds =
+        TransformBounds(bounds, world.matrix);
+    glm::vec3 center = worldBounds.GetCenter();
+    auto& cell = cells[{static_cast<int32_t>(std::floor(center.x / cellSize)),
+                        static_cast<int32_t>(std::floor(center.z / cellSize))}];
+    cell.entities.push_back(entity);
+    cell.bounds.min = glm::min(cell.bounds.min, worldBounds.min);
+    cell.bounds.max = glm::max(cell.bounds.max, worldBounds.max);
+    ++meshCount;
+  }
+
+  std::vector<const ecs::ModelReferenceComponent*> references;
+  registry.view<const ecs::ModelReferenceComponent>().each(
+      [&references](const ecs::ModelReferenceComponent& reference) {
+        references.push_back(&reference);
+      });
+
+  WorldManifest manifest{
+      .directory = directory,
+      .cellSize = cellSize,
+      .cells = {},
+  };
+  std::vector<CellRecord> records;
+  records.reserve(cells.size());
+  for (const auto& [key, cell] : cells) {
+    entt::registry cellRegistry;
+    BuildCellRegistry(registry, cell, references, cellRegistry);
+
+    WorldCell info{.x = key.first, .z = key.second, .bounds = cell.bounds};
+    if (!SaveSceneSnapshot(cellRegistry, resources,
+                           manifest.GetCellPath(info))) {
+      return false;
+    }
+    records.push_back(CellRecord{
+        .x = info.x,
+        .z = info.z,
+        .min = info.bounds.min,
+        .max = info.bounds.max,
+    });
+  }
+
+  if (!WriteManifest(directory / kManifestName, cellSize, records)) {
+    return false;
+  }
+  LOG_INFO("Partitioned {} meshes into {} cells of {} units in {}", meshCount,
+           records.size(), cellSize, directory.string());
+  return true;
+}
+
+std::optional<WorldManifest> LoadWorldManifest(
+    const std::filesystem::path& directory) {
+  std::filesystem::path path = directory / kManifestName;
+  auto file = io::MappedFile::Open(path);
+  if (!file) {
+    LOG_ERROR("Failed to map world manifest: {}", path.string());
+    return std::nullopt;
+  }
+
+  auto bytes = file->GetData();
+  ManifestHeader header{};
+  if (bytes.size() < sizeof(header)) {
+    LOG_ERROR("World manifest is truncated: {}", path.string());
+    return std::nullopt;
+  }
+  std::memcpy(&header, bytes.data(), sizeof(header));
+
+  if (header.magic != kManifestMagic) {
+    LOG_ERROR("Not a world manifest: {}", path.string());
+    return std::nullopt;
+  }
+  if (header.version != kWorldManifestVersion) {
+    LOG_ERROR("World manifest {} has version {}, expected {}", path.string(),
+              header.version, kWorldManifestVersion);
+    return std::nullopt;
+  }
+  if (bytes.size() - sizeof(header) !=
+      static_cast<uint64_t>(header.cellCount) * sizeof(CellRecord)) {
+    LOG_ERROR("World manifest is truncated: {}", path.string());
+    return std::nullopt;
+  }
+
+  std::vector<CellRecord> records(header.cellCount);
+  std::memcpy(records.data(), bytes.data() + sizeof(header),
+              sizeof(CellRecord) * records.size());
+
+  WorldManifest manifest{
+      .directory = directory,
+      .cellSize = header.cellSize,
+      .cells = {},
+  };
+  manifest.cells.reserve(records.size());
+  for (const auto& record : records) {
+    manifest.cells.push_back(WorldCell{
+        .x = record.x,
+        .z = record.z,
+        .bounds = {.min = record.min, .max = record.max},
+    });
+  }
+  return manifest;
+}
+
+WorldStreamer::WorldStreamer(WorldManifest manifest, entt::registry& registry,
+                             ResourceManager& resources,
+                             renderer::BindlessMaterialManager& materials,
+                             renderer::RenderSystem& renderSystem,
+                             WorldStreamingSettings settings)
+    : manifest_{std::move(manifest)},
+      registry_{registry},
+      resources_{resources},
+      materials_{materials},
+      renderSystem_{renderSystem},
+      settings_{settings} {
+  cells_.reserve(manifest_.cells.size());
+  for (const auto& info : manifest_.cells) {
+    cells_.push_back(Cell{
+        .info = info,
+        .state = CellState::Unloaded,
+        .snapshot = std::nullopt,
+        .models = {},
+        .entities = {},
+        .segment = 0,
+    });
+  }
+
+  worker_ = std::jthread{[this](const std::stop_token& stop) { Run(stop); }};
+
+  LOG_INFO("World streamer initialized ({} cells of {} units)", cells_.size(),
+           manifest_.cellSize);
+}
+
+WorldStreamer::~WorldStreamer() {
+  // Active cells stay in the scene; loads that did not finish let go of
+  // their models
+  for (auto& cell : cells_) {
+    if (cell.state == CellState::Loading) {
+      Release(cell);
+    }
+  }
+}
+
+float WorldStreamer::GetDistance(const Cell& cell,
+                                 const glm::vec3& position) {
+  glm::vec2 point{position.x, position.z};
+  glm::vec2 min{cell.info.bounds.min.x, cell.info.bounds.min.z};
+  glm::vec2 max{cell.info.bounds.max.x, cell.info.bounds.max.z};
+  return glm::length(glm::max(glm::max(min - point, point - max),
+                              glm::vec2(0.0F)));
+}
+
+void WorldStreamer::Update(const camera::Camera& camera, float deltaTime) {
+  // The camera has no velocity of its own, so it is smoothed from how far
+  // it moved; a jump settles within a few smoothing periods
+  const glm::vec3& position = camera.GetPosition();
+  if (lastPosition_ && deltaTime > 0.0F) {
+    glm::vec3 measured = (position - *lastPosition_) / deltaTime;
+    float blend = 1.0F - std::exp(-deltaTime / settings_.velocitySmoothing);
+    velocity_ = glm::mix(velocity_, measured, blend);
+  }
+  lastPosition_ = position;
+  glm::vec3 predicted = position + (velocity_ * settings_.prefetchSeconds);
+  auto distance = [&](const Cell& cell) {
+    return std::min(GetDistance(cell, position),
+                    GetDistance(cell, predicted));
+  };
+
+  Receive();
+
+  // The margin keeps cells on the edge of the radius from being loaded and
+  // released over and over
+  float unloadRadius = settings_.loadRadius + settings_.unloadMargin;
+  for (auto& cell : cells_) {
+    if ((cell.state == CellState::Loading ||
+         cell.state == CellState::Active) &&
+        distance(cell) > unloadRadius) {
+      Release(cell);
+    }
+  }
+
+  // Nearest cells are read first
+  candidates_.clear();
+  for (uint32_t i = 0; i < cells_.size(); ++i) {
+    if (cells_[i].state == CellState::Unloaded) {
+      float cellDistance = distance(cells_[i]);
+      if (cellDistance <= settings_.loadRadius) {
+        candidates_.emplace_back(cellDistance, i);
+      }
+    }
+  }
+  std::ranges::sort(candidates_);
+  for (auto [cellDistance, index] : candidates_) {
+    if (readsInFlight_ >= settings_.maxReadsInFlight) {
+      break;
+    }
+    cells_[index].state = CellState::Reading;
+    ++readsInFlight_;
+    {
+      std::scoped_lock lock{mutex_};
+      requests_.push_back(index);
+    }
+    wake_.notify_one();
+  }
+
+  // Cells whose models are all uploaded join the scene, nearest first
+  candidates_.clear();
+  for (uint32_t i = 0; i < cells_.size(); ++i) {
+    if (cells_[i].state == CellState::Loading) {
+      candidates_.emplace_back(distance(cells_[i]), i);
+    }
+  }
+  std::ranges::sort(candidates_);
+  uint32_t activations = 0;
+  for (auto [cellDistance, index] : candidates_) {
+    if (activations >= settings_.maxActivationsPerUpdate) {
+      break;
+    }
+    auto& cell = cells_[index];
+    if (std::ranges::any_of(cell.models, [this](ModelHandle handle) {
+          return resources_.GetLoadStage(handle) == LoadStage::Failed;
+        })) {
+      LOG_ERROR("A model of world cell ({}, {}) failed to load", cell.info.x,
+                cell.info.z);
+      Release(cell);
+      cell.state = CellState::Failed;
+      continue;
+    }
+    if (std::ranges::all_of(cell.models, [this](ModelHandle handle) {
+          return resources_.GetModel(handle) != nullptr;
+        }) &&
+        Activate(cell)) {
+      ++activations;
+    }
+  }
+}
+
+void WorldStreamer::Receive() {
+  std::vector<std::pair<uint32_t, std::optional<SceneSnapshot>>> finished;
+  {
+    std::scoped_lock lock{mutex_};
+    finished.swap(finished_);
+  }
+
+  for (auto& [index, snapshot] : finished) {
+    --readsInFlight_;
+    auto& cell = cells_[index];
+    if (!snapshot) {
+      cell.state = CellState::Failed;
+      continue;
+    }
+    // References keep the models from being evicted before the cell is
+    // activated
+    for (const auto& path : snapshot->GetModelPaths()) {
+      ModelHandle handle = resources_.LoadModelAsync(path);
+      resources_.AddRef(handle);
+      cell.models.push_back(handle);
+    }
+    cell.snapshot = std::move(snapshot);
+    cell.state = CellState::Loading;
+  }
+}
+
+bool WorldStreamer::Activate(Cell& cell) {
+  auto entities = cell.snapshot->Instantiate(registry_, resources_, materials_);
+  cell.snapshot.reset();
+  // The cell's model references hold the models from here on
+  for (ModelHandle handle : cell.models) {
+    resources_.Release(handle);
+  }
+  cell.models.clear();
+  if (!entities) {
+    cell.state = CellState::Failed;
+    return false;
+  }
+
+  cell.entities = std::move(*entities);
+  cell.segment = renderSystem_.AddResidentObjects(registry_, cell.entities);
+  cell.state = CellState::Active;
+  ++activeCells_;
+  LOG_DEBUG("Activated world cell ({}, {}) with {} entities", cell.info.x,
+            cell.info.z, cell.entities.size());
+  return true;
+}
+
+void WorldStreamer::Release(Cell& cell) {
+  if (cell.state == CellState::Active) {
+    renderSystem_.RemoveResidentObjects(registry_, cell.segment);
+    registry_.destroy(cell.entities.begin(), cell.entities.end());
+    cell.entities.clear();
+    --activeCells_;
+    LOG_DEBUG("Released world cell ({}, {})", cell.info.x, cell.info.z);
+  }
+  for (ModelHandle handle : cell.models) {
+    resources_.Release(handle);
+  }
+  cell.models.clear();
+  cell.snapshot.reset();
+  cell.state = CellState::Unloaded;
+}
+
+void WorldStreamer::Run(const std::stop_token& stop) {
+  while (true) {
+    uint32_t index = 0;
+    {
+      std::unique_lock lock{mutex_};
+      if (!wake_.wait(lock, stop, [this] { return !requests_.empty(); })) {
+        return;
+      }
+      index = requests_.front();
+      requests_.pop_front();
+    }
+
+    // The manifest does not change once the streamer is constructed
+    auto snapshot =
+        SceneSnapshot::Read(manifest_.GetCellPath(manifest_.cells[index]));
+
+    std::scoped_lock lock{mutex_};
+    finished_.emplace_back(index, std::move(snapshot));
+  }
+}
+
+}  // namespace resource
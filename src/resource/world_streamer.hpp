@@ -0,0 +1,179 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+
+#include "camera/camera_controller.hpp"
+#include "ecs/components.hpp"
+#include "renderer/bindless_materials.hpp"
+#include "renderer/render_system.hpp"
+#include "resource/resource_manager.hpp"
+#include "resource/scene_snapshot.hpp"
+
+namespace resource {
+
+// Bumped whenever the manifest layout changes; older worlds are rejected
+constexpr uint32_t kWorldManifestVersion = 1;
+
+/**
+ * @brief A square cell of a partitioned world on the XZ plane.
+ */
+struct WorldCell {
+  int32_t x{0};
+  int32_t z{0};
+  // World-space bounds of the meshes in the cell, which may reach past it
+  ecs::BoundingBoxComponent bounds;
+};
+
+struct WorldManifest {
+  std::filesystem::path directory;
+  float cellSize{0.0F};
+  std::vector<WorldCell> cells;
+
+  /**
+   * @brief Snapshot file holding a cell's entities.
+   */
+  [[nodiscard]] std::filesystem::path GetCellPath(const WorldCell& cell) const;
+};
+
+/**
+ * @brief Split the meshes of a scene into cells saved as scene snapshots.
+ *
+ * Every entity with a mesh, world transform and bounds goes to the cell
+ * holding the center of its world bounds. Cells keep the world transforms
+ * only, so their entities are static once streamed back in, and a reference
+ * to each model they draw from. Lights, cameras and other entities are not
+ * partitioned. A manifest listing the cells is written next to them.
+ *
+ * @param cellSize Edge length of a cell in world units
+ * @return false if a file cannot be written
+ */
+bool PartitionScene(const entt::registry& registry,
+                    const ResourceManager& resources, float cellSize,
+                    const std::filesystem::path& directory);
+
+/**
+ * @brief Read the manifest of a world written by PartitionScene.
+ *
+ * @return The manifest or nullopt if it is missing, corrupt or from another
+ * version
+ */
+[[nodiscard]] std::optional<WorldManifest> LoadWorldManifest(
+    const std::filesystem::path& directory);
+
+struct WorldStreamingSettings {
+  // Cells whose bounds come this close to the camera are loaded
+  float loadRadius{48.0F};
+  // Loaded cells are kept until they are this much further away
+  float unloadMargin{16.0F};
+  // Cells near where the camera will be this many seconds ahead, at its
+  // current velocity, are loaded as well
+  float prefetchSeconds{2.0F};
+  // Seconds over which camera velocity is smoothed
+  float velocitySmoothing{0.25F};
+  // Cell snapshots read from disk at a time
+  uint32_t maxReadsInFlight{2};
+  // Cells added to the scene per update; each waits on its models
+  uint32_t maxActivationsPerUpdate{1};
+};
+
+/**
+ * @brief Loads and unloads the cells of a partitioned world around the
+ * camera.
+ *
+ * Cell snapshots are read and decoded on a worker thread. Their models are
+ * then loaded through the resource manager's loader threads, and once all
+ * are uploaded the cell's entities are created on the main thread and their
+ * draws added to the renderer as one resident segment, so activating a cell
+ * uploads only its own objects. Cells are released again once the camera is
+ * further than the load radius plus the unload margin from them and from
+ * its predicted position.
+ */
+class WorldStreamer {
+ public:
+  WorldStreamer(WorldManifest manifest, entt::registry& registry,
+                ResourceManager& resources,
+                renderer::BindlessMaterialManager& materials,
+                renderer::RenderSystem& renderSystem,
+                WorldStreamingSettings settings = {});
+  ~WorldStreamer();
+
+  WorldStreamer(const WorldStreamer&) = delete;
+  WorldStreamer& operator=(const WorldStreamer&) = delete;
+  WorldStreamer(WorldStreamer&&) = delete;
+  WorldStreamer& operator=(WorldStreamer&&) = delete;
+
+  /**
+   * @brief Request, activate and release cells for the camera's position.
+   *
+   * Call once per frame after ResourceManager::Update.
+   */
+  void Update(const camera::Camera& camera, float deltaTime);
+
+  /**
+   * @brief Cells whose entities are in the scene.
+   */
+  [[nodiscard]] uint32_t GetActiveCellCount() const { return activeCells_; }
+
+ private:
+  enum class CellState : uint8_t {
+    Unloaded,
+    Reading,  // Snapshot is read on the worker
+    Loading,  // Models are loaded by the resource manager
+    Active,
+    Failed,  // Not requested again
+  };
+
+  struct Cell {
+    WorldCell info;
+    CellState state{CellState::Unloaded};
+    std::optional<SceneSnapshot> snapshot;
+    std::vector<ModelHandle> models;  // Referenced while Loading
+    std::vector<entt::entity> entities;
+    uint32_t segment{0};
+  };
+
+  // Distance on the XZ plane from a point to a cell's bounds
+  static float GetDistance(const Cell& cell, const glm::vec3& position);
+
+  void Run(const std::stop_token& stop);
+  void Receive();
+  bool Activate(Cell& cell);
+  void Release(Cell& cell);
+
+  WorldManifest manifest_;
+  entt::registry& registry_;
+  ResourceManager& resources_;
+  renderer::BindlessMaterialManager& materials_;
+  renderer::RenderSystem& renderSystem_;
+  WorldStreamingSettings settings_;
+
+  std::vector<Cell> cells_;
+  std::vector<std::pair<float, uint32_t>> candidates_;  // Distance, cell
+  std::optional<glm::vec3> lastPosition_;
+  glm::vec3 velocity_{0.0F};
+  uint32_t readsInFlight_{0};
+  uint32_t activeCells_{0};
+
+  // Shared with the worker
+  std::mutex mutex_;
+  std::condition_variable_any wake_;
+  std::deque<uint32_t> requests_;
+  std::vector<std::pair<uint32_t, std::optional<SceneSnapshot>>> finished_;
+
+  // Last member so it stops before the state above goes away
+  std::jthread worker_;
+};
+
+}  // namespace resource
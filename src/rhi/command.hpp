@@ -253,10 +253,13 @@ class CommandBuffer {
    * @param dst The destination texture.
    * @param mipLevel The mip level of the texture to copy to.
    * @param arrayLayer The array layer of the texture to copy to.
+   * @param srcOffset Offset of the tightly packed texels in the source
+   * buffer; a multiple of 16.
    */
   virtual void CopyBufferToTexture(const Buffer* src, Texture* dst,
                                    uint32_t mipLevel = 0,
-                                   uint32_t arrayLayer = 0) = 0;
+                                   uint32_t arrayLayer = 0,
+                                   Size srcOffset = 0) = 0;
 
   /**
    * @brief Pushes constants to the pipeline.
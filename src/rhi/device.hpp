@@ -4,6 +4,15 @@
 #include "rhi/swapchain.hpp"
 
 namespace rhi {
+/**
+ * @brief Optional device features, true when supported and enabled.
+ */
+struct DeviceFeatures {
+  // Storage buffer writes and atomics in fragment shaders, which texture
+  // streaming feedback needs
+  bool fragmentStoresAndAtomics{false};
+};
+
 /**
  * @brief Abstract representation of a rendering device.
  */
@@ -30,5 +39,10 @@ class Device {
    * @return A pointer to the queue, or nullptr if not available.
    */
   [[nodiscard]] virtual Queue* GetQueue(QueueType type) = 0;
+
+  /**
+   * @brief Gets the optional features enabled on the device.
+   */
+  [[nodiscard]] virtual const DeviceFeatures& GetFeatures() const = 0;
 };
 }  // namespace rhi
@@ -41,11 +41,13 @@ class Factory {
    * @param height Height of the texture
    * @param format Texture format
    * @param usage Texture usage flags
+   * @param mipLevels Number of mip levels
    * @return std::unique_ptr<Texture> Pointer to the created texture
    */
   virtual std::unique_ptr<Texture> CreateTexture(uint32_t width,
                                                  uint32_t height, Format format,
-                                                 TextureUsage usage) = 0;
+                                                 TextureUsage usage,
+                                                 uint32_t mipLevels = 1) = 0;
 
   /**
    * @brief Creates a sampler resource.
@@ -1,11 +1,11 @@
 #pragma once
 
-#include <bit>
+#include <cstring>
 #include <filesystem>
-#include <fstream>
 #include <optional>
 #include <vector>
 
+#include "io/file_reader.hpp"
 #include "rhi/factory.hpp"
 #include "rhi/shader.hpp"
 
@@ -17,20 +17,18 @@ namespace rhi {
  */
 inline std::optional<std::vector<uint32_t>> LoadSPIRV(
     const std::filesystem::path& path) {
-  std::ifstream file(path, std::ios::binary | std::ios::ate);
-  if (!file.is_open()) {
+  auto file = io::FileReader::GetThreadReader().Read(path);
+  if (!file) {
     return std::nullopt;
   }
 
-  auto size = file.tellg();
-  if (size <= 0 || size % sizeof(uint32_t) != 0) {
+  auto bytes = file->GetData();
+  if (bytes.empty() || bytes.size() % sizeof(uint32_t) != 0) {
     return std::nullopt;
   }
 
-  std::vector<uint32_t> spirv(static_cast<size_t>(size) / sizeof(uint32_t));
-  file.seekg(0);
-  file.read(std::bit_cast<char*>(spirv.data()), size);
-
+  std::vector<uint32_t> spirv(bytes.size() / sizeof(uint32_t));
+  std::memcpy(spirv.data(), bytes.data(), bytes.size());
   return spirv;
 }
 
@@ -37,6 +37,24 @@ enum class ImageLayout : uint8_t {
   Present,
 };
 
+/**
+ * @brief Contents of one mip level of one array layer, or of a rectangle in
+ * it.
+ *
+ * With a zero width or height the data covers the whole level and whatever
+ * the level held before is discarded. A rectangle keeps the rest of the level
+ * and requires it to have been uploaded before.
+ */
+struct TextureSubresourceData {
+  std::span<const std::byte> data;
+  uint32_t mipLevel{0};
+  uint32_t arrayLayer{0};
+  uint32_t x{0};
+  uint32_t y{0};
+  uint32_t width{0};
+  uint32_t height{0};
+};
+
 /**
  * @brief Represents a GPU texture resource.
  */
@@ -47,12 +65,23 @@ class Texture {
   /**
    * @brief Uploads data to the texture.
    *
-   * @param data The data to upload.
-   * @param mipLevel Mip level to upload to.
+   * @param data The data to upload. With several levels, the levels are
+   * tightly packed one after another, largest first.
+   * @param mipLevel Mip level to upload to (the first one if several).
    * @param arrayLayer Array layer to upload to.
+   * @param levelCount Number of consecutive mip levels in data.
    */
   virtual void Upload(std::span<const std::byte> data, uint32_t mipLevel = 0,
-                      uint32_t arrayLayer = 0) = 0;
+                      uint32_t arrayLayer = 0, uint32_t levelCount = 1) = 0;
+
+  /**
+   * @brief Uploads any set of subresources with a single staging copy and
+   * submission. The data may live anywhere, e.g. in a mapped file.
+   *
+   * @param subresources Level and layer contents, in any order.
+   */
+  virtual void UploadSubresources(
+      std::span<const TextureSubresourceData> subresources) = 0;
 
   /**
    * @brief Gets the format of the texture.
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <cstdint>
 
 namespace rhi {
@@ -14,12 +16,14 @@ enum class Format : uint8_t {
   R8G8B8Unorm,
   R8G8B8A8Unorm,
   R8G8B8A8Srgb,
+  R8G8B8A8Snorm,
   B8G8R8A8Unorm,
   B8G8R8A8Srgb,
   // 16-bit formats
   R16Sfloat,
   R16G16Sfloat,
   R16G16B16A16Sfloat,
+  R16G16B16A16Snorm,
   // 32-bit formats
   R32Sfloat,
   R32G32Sfloat,
@@ -30,8 +34,110 @@ enum class Format : uint8_t {
   D32Sfloat,
   D24UnormS8Uint,
   D32SfloatS8Uint,
+  // Block-compressed formats (4x4 texel blocks)
+  Bc1RgbaUnorm,
+  Bc3RgbaUnorm,
+  Bc4Unorm,
+  Bc5Unorm,
+  Bc7Unorm,
 };
 
+/**
+ * @brief Memory layout of a format. Uncompressed formats are 1x1 blocks.
+ */
+struct FormatInfo {
+  uint32_t blockSize{0};  // Bytes per block
+  uint32_t blockWidth{1};
+  uint32_t blockHeight{1};
+};
+
+/**
+ * @brief Layout traits of a format; blockSize is 0 for Undefined.
+ */
+constexpr FormatInfo GetFormatInfo(Format format) {
+  switch (format) {
+    case Format::R8Unorm:
+      return {.blockSize = 1};
+    case Format::R8G8Unorm:
+    case Format::R16Sfloat:
+    case Format::D16Unorm:
+      return {.blockSize = 2};
+    case Format::R8G8B8Unorm:
+      return {.blockSize = 3};
+    case Format::R8G8B8A8Unorm:
+    case Format::R8G8B8A8Srgb:
+    case Format::R8G8B8A8Snorm:
+    case Format::B8G8R8A8Unorm:
+    case Format::B8G8R8A8Srgb:
+    case Format::R16G16Sfloat:
+    case Format::R32Sfloat:
+    case Format::D32Sfloat:
+    case Format::D24UnormS8Uint:
+      return {.blockSize = 4};
+    case Format::R16G16B16A16Sfloat:
+    case Format::R16G16B16A16Snorm:
+    case Format::R32G32Sfloat:
+    case Format::D32SfloatS8Uint:
+      return {.blockSize = 8};
+    case Format::R32G32B32Sfloat:
+      return {.blockSize = 12};
+    case Format::R32G32B32A32Sfloat:
+      return {.blockSize = 16};
+    case Format::Bc1RgbaUnorm:
+    case Format::Bc4Unorm:
+      return {.blockSize = 8, .blockWidth = 4, .blockHeight = 4};
+    case Format::Bc3RgbaUnorm:
+    case Format::Bc5Unorm:
+    case Format::Bc7Unorm:
+      return {.blockSize = 16, .blockWidth = 4, .blockHeight = 4};
+    default:
+      return {};
+  }
+}
+
+/**
+ * @brief Whether a format stores texels in compressed blocks.
+ */
+constexpr bool IsCompressed(Format format) {
+  return GetFormatInfo(format).blockWidth > 1;
+}
+
+/**
+ * @brief Size in bytes of one tightly packed mip level. Compressed levels
+ * round up to whole blocks.
+ */
+constexpr uint64_t GetMipLevelSize(Format format, uint32_t width,
+                                   uint32_t height, uint32_t mipLevel) {
+  FormatInfo info = GetFormatInfo(format);
+  uint64_t mipWidth = std::max(1U, width >> mipLevel);
+  uint64_t mipHeight = std::max(1U, height >> mipLevel);
+  uint64_t blocksX = (mipWidth + info.blockWidth - 1) / info.blockWidth;
+  uint64_t blocksY = (mipHeight + info.blockHeight - 1) / info.blockHeight;
+  return blocksX * blocksY * info.blockSize;
+}
+
+/**
+ * @brief Number of levels in a full mip chain down to 1x1.
+ */
+constexpr uint32_t GetMipLevelCount(uint32_t width, uint32_t height) {
+  return static_cast<uint32_t>(std::bit_width(std::max({width, height, 1U})));
+}
+
+/**
+ * @brief Index buffer element types
+ */
+enum class IndexType : uint8_t {
+  Uint16,
+  Uint32,
+};
+
+/**
+ * @brief Size in bytes of a single index of the given type.
+ */
+constexpr uint32_t GetIndexSize(IndexType type) {
+  return type == IndexType::Uint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
 /**
  * @brief Access flags for memory barriers
  */
@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+#include "logger.hpp"
+#include "resource/model_importer.hpp"
+#include "resource/model_pack.hpp"
+
+// Offline asset cooker: imports a glTF file once and writes it as a model
+// pack that the renderer maps and uploads without further processing.
+//
+//   vkr-cook <input.gltf|.glb> [output.vkrpack] [options]
+//
+//   --quantize        Store meshes as ecs::QuantizedVertex
+//   --no-weld         Keep duplicate vertices
+//   --smooth-normals  Generate smooth instead of flat missing normals
+//   --fast-bc         Encode color as BC1/BC3 instead of BC7
+//   --no-bc           Keep textures uncompressed
+//   --flatten         Bake static node transforms and merge their meshes
+int main(int argc, char** argv) {
+  quill::Backend::start();
+  GetLogger()->set_log_level(quill::LogLevel::Info);
+
+  std::span<char*> args{argv, static_cast<size_t>(argc)};
+
+  resource::ModelLoadOptions options;
+  // Cooking is where the time for block compression is best spent
+  options.textureCompression = resource::TextureCompression::Quality;
+  std::filesystem::path input;
+  std::filesystem::path output;
+
+  for (size_t i = 1; i < args.size(); ++i) {
+    std::string_view arg{args[i]};
+    if (arg == "--quantize") {
+      options.quantizeVertices = true;
+    } else if (arg == "--no-weld") {
+      options.weldVertices = false;
+    } else if (arg == "--smooth-normals") {
+      options.generatedNormals = resource::NormalMode::Smooth;
+    } else if (arg == "--fast-bc") {
+      options.textureCompression = resource::TextureCompression::Fast;
+    } else if (arg == "--no-bc") {
+      options.textureCompression = resource::TextureCompression::None;
+    } else if (arg == "--flatten") {
+      options.flattenStaticScene = true;
+    } else if (arg.starts_with("--")) {
+      LOG_ERROR("Unknown option: {}", arg);
+      return EXIT_FAILURE;
+    } else if (input.empty()) {
+      input = arg;
+    } else if (output.empty()) {
+      output = arg;
+    } else {
+      LOG_ERROR("Unexpected argument: {}", arg);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (input.empty()) {
+    LOG_ERROR(
+        "Usage: vkr-cook <input.gltf|.glb> [output.vkrpack] [--quantize] "
+        "[--no-weld] [--smooth-normals] [--fast-bc] [--no-bc] [--flatten]");
+    return EXIT_FAILURE;
+  }
+  if (output.empty()) {
+    output = input;
+    output.replace_extension(resource::kModelPackExtension);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  resource::ModelImporter importer{options};
+  auto data = importer.Import(input);
+  if (!data) {
+    LOG_ERROR("Failed to import {}", input.string());
+    return EXIT_FAILURE;
+  }
+
+  if (!resource::WriteModelPack(*data, output)) {
+    return EXIT_FAILURE;
+  }
+
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  LOG_INFO("Cooked {} -> {} ({} meshes, {} textures, {} bytes) in {:.2f} ms",
+           input.string(), output.string(), data->meshes.size(),
+           data->textures.size(), std::filesystem::file_size(output),
+           elapsed.count());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+#include "io/file_reader.hpp"
+#include "logger.hpp"
+
+// Compares asset reads through io::FileReader with the blocking
+// std::ifstream reads they replace, on a cold and on a warm page cache.
+//
+//   vkr-io-bench <file|directory>... [--runs N]
+//
+// Cold runs first drop the files from the page cache with posix_fadvise,
+// which needs no privileges but leaves pages mapped elsewhere in place.
+namespace {
+using Clock = std::chrono::steady_clock;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+struct RunResult {
+  double totalMs{0.0};
+  double meanLatencyMs{0.0};  // From the start of the batch to each file
+  double maxLatencyMs{0.0};
+  uint64_t bytes{0};
+};
+
+void DropFromPageCache(std::span<const std::filesystem::path> paths) {
+#ifndef _WIN32
+  for (const auto& path : paths) {
+    int file = open(path.c_str(), O_RDONLY);
+    if (file >= 0) {
+      fdatasync(file);
+      posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+      close(file);
+    }
+  }
+#else
+  (void)paths;
+#endif
+}
+
+template <typename ReadFn>
+RunResult Measure(std::span<const std::filesystem::path> paths, ReadFn&& read) {
+  RunResult result;
+  auto start = Clock::now();
+  read([&](size_t bytes) {
+    double latency = Milliseconds{Clock::now() - start}.count();
+    result.meanLatencyMs += latency;
+    result.maxLatencyMs = std::max(result.maxLatencyMs, latency);
+    result.bytes += bytes;
+  });
+  result.totalMs = Milliseconds{Clock::now() - start}.count();
+  result.meanLatencyMs /= static_cast<double>(paths.size());
+  return result;
+}
+
+// The path FileReader replaces: one blocking read after the other
+RunResult ReadWithIfstream(std::span<const std::filesystem::path> paths) {
+  return Measure(paths, [&](auto&& onComplete) {
+    for (const auto& path : paths) {
+      std::ifstream file(path, std::ios::binary | std::ios::ate);
+      std::vector<char> data(static_cast<size_t>(file.tellg()));
+      file.seekg(0);
+      file.read(data.data(), static_cast<std::streamsize>(data.size()));
+      onComplete(data.size());
+    }
+  });
+}
+
+RunResult ReadWithFileReader(std::span<const std::filesystem::path> paths,
+                             io::FileReader& reader) {
+  return Measure(paths, [&](auto&& onComplete) {
+    reader.ReadBatch(
+        paths, [&](size_t /*index*/, std::optional<io::FileBuffer> buffer) {
+          onComplete(buffer ? buffer->GetData().size() : 0);
+        });
+  });
+}
+
+void Report(std::string_view name, std::string_view cache,
+            std::span<const RunResult> runs) {
+  // The best of the runs is the least disturbed by everything else
+  const auto& best = *std::ranges::min_element(runs, {}, &RunResult::totalMs);
+  double mibPerSecond = static_cast<double>(best.bytes) / (1024.0 * 1024.0) /
+                        (best.totalMs / 1000.0);
+  LOG_INFO(
+      "{:<12} {:<5} {:>9.2f} ms {:>9.1f} MiB/s  latency mean {:>8.2f} ms "
+      "max {:>8.2f} ms",
+      name, cache, best.totalMs, mibPerSecond, best.meanLatencyMs,
+      best.maxLatencyMs);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  quill::Backend::start();
+  GetLogger()->set_log_level(quill::LogLevel::Info);
+
+  std::span<char*> args{argv, static_cast<size_t>(argc)};
+
+  std::vector<std::filesystem::path> paths;
+  int runCount = 3;
+  for (size_t i = 1; i < args.size(); ++i) {
+    std::string_view arg{args[i]};
+    if (arg == "--runs" && i + 1 < args.size()) {
+      std::string_view value{args[++i]};
+      std::from_chars(value.data(), value.data() + value.size(), runCount);
+    } else if (std::filesystem::is_directory(arg)) {
+      for (const auto& entry :
+           std::filesystem::recursive_directory_iterator{arg}) {
+        if (entry.is_regular_file()) {
+          paths.push_back(entry.path());
+        }
+      }
+    } else if (std::filesystem::is_regular_file(arg)) {
+      paths.emplace_back(arg);
+    } else {
+      LOG_ERROR("Not a file or directory: {}", arg);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (paths.empty()) {
+    LOG_ERROR("Usage: vkr-io-bench <file|directory>... [--runs N]");
+    return EXIT_FAILURE;
+  }
+
+  uint64_t totalSize = 0;
+  for (const auto& path : paths) {
+    totalSize += std::filesystem::file_size(path);
+  }
+  LOG_INFO("{} files, {} MiB, best of {} runs", paths.size(),
+           totalSize >> 20, runCount);
+
+  io::FileReader uring{{.useIoUring = true}};
+  io::FileReader threads{{.useIoUring = false}};
+  if (!uring.UsesIoUring()) {
+    LOG_WARNING("io_uring is not available; both readers use threads");
+  }
+
+  struct Method {
+    std::string_view name;
+    std::function<RunResult()> run;
+  };
+  std::vector<Method> methods = {
+      {"ifstream", [&] { return ReadWithIfstream(paths); }},
+      {"threads", [&] { return ReadWithFileReader(paths, threads); }},
+      {"io_uring", [&] { return ReadWithFileReader(paths, uring); }},
+  };
+
+  for (bool cold : {true, false}) {
+    for (const auto& method : methods) {
+      std::vector<RunResult> runs;
+      if (!cold) {
+        method.run();  // Fill the page cache
+      }
+      for (int run = 0; run < runCount; ++run) {
+        if (cold) {
+          DropFromPageCache(paths);
+        }
+        runs.push_back(method.run());
+      }
+      Report(method.name, cold ? "cold" : "warm", runs);
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "core/jobs.hpp"
+#include "logger.hpp"
+
+// Measures what core::JobSystem costs per job and how ParallelFor scales
+// with the number of workers.
+//
+//   vkr-jobs-bench [--jobs N] [--items N] [--runs N]
+//
+// Spawn/Wait overhead is timed with empty jobs, spawned in one batch and
+// one at a time. ParallelFor runs a compute-bound body over --items indices
+// on pools of 0 (the calling thread alone), 1, 2, 4, ... workers up to one
+// per hardware thread but one.
+namespace {
+using Clock = std::chrono::steady_clock;
+using Nanoseconds = std::chrono::duration<double, std::nano>;
+
+// The best of the runs is the least disturbed by everything else
+template <typename Fn>
+double BestOf(int runCount, Fn&& fn) {
+  double best = 0.0;
+  for (int run = 0; run < runCount; ++run) {
+    auto start = Clock::now();
+    fn();
+    double elapsed = Nanoseconds{Clock::now() - start}.count();
+    best = run == 0 ? elapsed : std::min(best, elapsed);
+  }
+  return best;
+}
+
+// Enough arithmetic per index that scaling is not bound by memory
+float Work(size_t index) {
+  float value = static_cast<float>(index);
+  for (int i = 0; i < 2000; ++i) {
+    value = std::sqrt(value * value + 1.0F);
+  }
+  return value;
+}
+
+void MeasureSpawnWait(core::JobSystem& jobs, uint32_t jobCount,
+                      int runCount) {
+  core::JobCounter counter;
+  double batch = BestOf(runCount, [&] {
+    for (uint32_t i = 0; i < jobCount; ++i) {
+      jobs.Spawn(counter, [] {});
+    }
+    jobs.Wait(counter);
+  });
+  double single = BestOf(runCount, [&] {
+    for (uint32_t i = 0; i < jobCount; ++i) {
+      jobs.Spawn(counter, [] {});
+      jobs.Wait(counter);
+    }
+  });
+  LOG_INFO("Spawn+Wait   batch {:>8.1f} ns/job  one at a time {:>8.1f} ns/job",
+           batch / jobCount, single / jobCount);
+}
+
+void MeasureParallelFor(uint32_t workerCount, size_t itemCount, int runCount,
+                        double& serialMs) {
+  core::JobSystem jobs{workerCount};
+  std::vector<float> results(itemCount);
+  double ms = BestOf(runCount, [&] {
+                jobs.ParallelFor(itemCount,
+                                 [&](size_t i) { results[i] = Work(i); });
+              }) /
+              1e6;
+  if (workerCount == 0) {
+    serialMs = ms;
+  }
+  LOG_INFO("ParallelFor  {:>3} workers {:>9.2f} ms  speedup {:>5.2f}x",
+           workerCount, ms, serialMs / ms);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  quill::Backend::start();
+  GetLogger()->set_log_level(quill::LogLevel::Info);
+
+  std::span<char*> args{argv, static_cast<size_t>(argc)};
+
+  uint32_t jobCount = 100000;
+  size_t itemCount = 1 << 14;
+  int runCount = 5;
+  for (size_t i = 1; i < args.size(); ++i) {
+    std::string_view arg{args[i]};
+    if (i + 1 >= args.size()) {
+      LOG_ERROR("Usage: vkr-jobs-bench [--jobs N] [--items N] [--runs N]");
+      return EXIT_FAILURE;
+    }
+    std::string_view value{args[++i]};
+    const char* end = value.data() + value.size();
+    if (arg == "--jobs") {
+      std::from_chars(value.data(), end, jobCount);
+    } else if (arg == "--items") {
+      std::from_chars(value.data(), end, itemCount);
+    } else if (arg == "--runs") {
+      std::from_chars(value.data(), end, runCount);
+    } else {
+      LOG_ERROR("Usage: vkr-jobs-bench [--jobs N] [--items N] [--runs N]");
+      return EXIT_FAILURE;
+    }
+  }
+  jobCount = std::max(jobCount, 1U);
+  runCount = std::max(runCount, 1);
+
+  uint32_t maxWorkers = std::max(1U, std::thread::hardware_concurrency()) - 1;
+  LOG_INFO("{} hardware threads, best of {} runs", maxWorkers + 1, runCount);
+
+  MeasureSpawnWait(core::JobSystem::Get(), jobCount, runCount);
+
+  double serialMs = 0.0;
+  MeasureParallelFor(0, itemCount, runCount, serialMs);
+  for (uint32_t workers = 1; workers <= maxWorkers; workers *= 2) {
+    MeasureParallelFor(workers, itemCount, runCount, serialMs);
+  }
+  if (maxWorkers > 0 && !std::has_single_bit(maxWorkers)) {
+    MeasureParallelFor(maxWorkers, itemCount, runCount, serialMs);
+  }
+  return EXIT_SUCCESS;
+}